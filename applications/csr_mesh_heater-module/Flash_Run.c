@@ -21,22 +21,28 @@
  *============================================================================*/
 static char FlashBuf[NVM_BLOCK_SZ];
 
+/* The BLE status block and the action records after it have to fit in the
+ * NVM store
+ */
+COMPILE_TIME_ASSERT(NVM_USED_MEMORY_WORDS <= NVM_STORE_SIZE_WORDS,
+                    nvm_layout_must_fit_in_the_store);
+
 //#define debug
 
 void flash_run(void)
 {
      MemSet(FlashBuf, NULL, sizeof(FlashBuf));
-     if(f_Ble_Reset == ON && tm_100ms.tRstWait500ms.fov == ON)
+     if(f_Ble_Reset == ON && TWExpired(TM_RST_WAIT))
      {
-          tm_100ms.tRstWait500ms.word = CLEAR;
+          TWStop(TM_RST_WAIT);
           MemSet(FlashBuf, NULL, sizeof(FlashBuf));
           Nvm_Write((uint16 *)FlashBuf,sizeof(FlashBuf),OffSetAddr);
           Reset_BLE_Module();
      }
-     if(FlashWrite == ON && tm_100ms.tWriteFlashDelay.fov == ON && tm_1s.tPoweronWait3s.fov == ON)
+     if(FlashWrite == ON && TWExpired(TM_WRITE_FLASH_DELAY) && TWExpired(TM_POWERON_WAIT))
      {
           FlashWrite = OFF;
-          tm_100ms.tWriteFlashDelay.word = CLEAR;
+          TWStop(TM_WRITE_FLASH_DELAY);
           FlashBuf[0] = (Local_MESH_ID >> 8) & 0x00ff;
           FlashBuf[1] = Local_MESH_ID & 0x00ff;
           FlashBuf[2] = (Gateway_MsgID >> 8) & 0x00ff;
@@ -46,7 +52,7 @@ void flash_run(void)
           Nvm_Write((uint16 *)FlashBuf,sizeof(FlashBuf),NVM_BLE_STATUS_MEMORY_WORDS);
      }
      
-     else if(FlashRead == ON && tm_1s.tPoweronWait3s.fov == ON)
+     else if(FlashRead == ON && TWExpired(TM_POWERON_WAIT))
      {
           FlashRead = OFF;
           MemSet(FlashBuf, NULL, sizeof(FlashBuf));
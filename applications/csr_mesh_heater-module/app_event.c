@@ -0,0 +1,197 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      app_event.c
+ *
+ *  DESCRIPTION
+ *      Run-to-completion application event queue. Producers in the UART and
+ *      mesh callbacks post typed events instead of raising global flags for
+ *      the tick to poll. Posting wakes the tick, which runs the handler of
+ *      each event once, in the order the events were posted.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "macros.h"
+#include "app_event.h"
+#include "timer_wheel.h"
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Pending event */
+typedef struct _APP_EVENT_T
+{
+    /* Event identifier */
+    uint8 id;
+
+    /* Event argument */
+    uint16 arg;
+}APP_EVENT_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Handler of each event */
+static AE_HANDLER_T g_ae_handler[AE_COUNT];
+
+/* Pending events */
+static APP_EVENT_T g_ae_queue[APP_EVENT_QUEUE_DEPTH];
+
+/* Index of the oldest pending event and number of pending events */
+static uint16 g_ae_head;
+static uint16 g_ae_count;
+
+/* TRUE while AEDispatch runs handlers */
+static bool g_ae_dispatching = FALSE;
+
+/* Events dropped because the queue was full */
+static uint16 g_ae_dropped;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AEInit
+ *
+ *  DESCRIPTION
+ *      Empty the queue and remove all handlers.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void AEInit(void)
+{
+    uint16 i;
+
+    for (i = 0; i < AE_COUNT; i++)
+        g_ae_handler[i] = NULL;
+
+    g_ae_head = 0;
+    g_ae_count = 0;
+    g_ae_dropped = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AERegister
+ *
+ *  DESCRIPTION
+ *      Set the handler run for an event.
+ *
+ * PARAMETERS
+ *      id      [in]    Event
+ *      handler [in]    Handler, or NULL to ignore the event
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void AERegister(APP_EVENT_ID_T id, AE_HANDLER_T handler)
+{
+    g_ae_handler[id] = handler;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AEPost
+ *
+ *  DESCRIPTION
+ *      Queue an event. An event identical to one that is still pending is
+ *      merged into it, as its handler has not run yet. Outside AEDispatch
+ *      the tick is kicked so the handler runs without waiting for the next
+ *      timer.
+ *
+ * PARAMETERS
+ *      id     [in]     Event
+ *      arg    [in]     Event argument
+ *
+ * RETURNS
+ *      TRUE if the event is pending, FALSE if the queue was full.
+ *----------------------------------------------------------------------------*/
+bool AEPost(APP_EVENT_ID_T id, uint16 arg)
+{
+    uint16 i;
+
+    for (i = 0; i < g_ae_count; i++)
+    {
+        const APP_EVENT_T *p_event =
+            &g_ae_queue[(g_ae_head + i) % APP_EVENT_QUEUE_DEPTH];
+
+        if (p_event->id == id && p_event->arg == arg)
+            return TRUE;
+    }
+
+    if (g_ae_count >= APP_EVENT_QUEUE_DEPTH)
+    {
+        if (g_ae_dropped < 0xFFFF)
+            g_ae_dropped++;
+
+        return FALSE;
+    }
+
+    i = (g_ae_head + g_ae_count) % APP_EVENT_QUEUE_DEPTH;
+    g_ae_queue[i].id = id;
+    g_ae_queue[i].arg = arg;
+    g_ae_count++;
+
+    /* AEDispatch runs events posted by handlers before it returns */
+    if (!g_ae_dispatching)
+        TWKick();
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AEDispatch
+ *
+ *  DESCRIPTION
+ *      Run the handlers of all pending events in the order they were posted.
+ *      Each handler runs to completion before the next event is taken, and
+ *      events posted meanwhile are run in the same call.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void AEDispatch(void)
+{
+    APP_EVENT_T event;
+
+    if (g_ae_dispatching)
+        return;
+
+    g_ae_dispatching = TRUE;
+
+    while (g_ae_count != 0)
+    {
+        event = g_ae_queue[g_ae_head];
+        g_ae_head = (g_ae_head + 1) % APP_EVENT_QUEUE_DEPTH;
+        g_ae_count--;
+
+        if (g_ae_handler[event.id] != NULL)
+            g_ae_handler[event.id](event.arg);
+    }
+
+    g_ae_dispatching = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AEGetDroppedCount
+ *
+ *  DESCRIPTION
+ *      Return the number of events dropped because the queue was full.
+ *
+ * RETURNS
+ *      Number of dropped events
+ *----------------------------------------------------------------------------*/
+uint16 AEGetDroppedCount(void)
+{
+    return g_ae_dropped;
+}
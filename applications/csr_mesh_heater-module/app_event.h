@@ -0,0 +1,71 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      app_event.h
+ *
+ *  DESCRIPTION
+ *      Interface to the run-to-completion application event queue.
+ *
+ *****************************************************************************/
+
+#ifndef __APP_EVENT_H__
+#define __APP_EVENT_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Number of events that can be pending at once */
+#define APP_EVENT_QUEUE_DEPTH        (8)
+
+/* Application events */
+typedef enum
+{
+    /* A verified Wi-Fi frame was added to the frame queue */
+    AE_WIFI_FRAME_RECEIVED = 0,
+
+    /* BLE_TX_DATA holds a frame waiting for the mesh sender */
+    AE_MESH_TX_READY,
+
+    /* BLE_RX_DATA holds a mesh frame for the Wi-Fi module, the argument is
+     * the UART frame type to send it as
+     */
+    AE_MESH_FRAME_RECEIVED,
+
+    AE_COUNT
+}APP_EVENT_ID_T;
+
+/* Event handler, called once for each posted event */
+typedef void (*AE_HANDLER_T)(uint16 arg);
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that empties the queue and removes all handlers. */
+extern void AEInit(void);
+
+/* Function that sets the handler run for an event. */
+extern void AERegister(APP_EVENT_ID_T id, AE_HANDLER_T handler);
+
+/* Function that queues an event and wakes the application tick to run it.
+ * Returns FALSE if the queue is full.
+ */
+extern bool AEPost(APP_EVENT_ID_T id, uint16 arg);
+
+/* Function that runs the handlers of all pending events, including events
+ * posted by the handlers themselves.
+ */
+extern void AEDispatch(void);
+
+/* Function that returns the number of events dropped on overflow. */
+extern uint16 AEGetDroppedCount(void);
+
+#endif /* __APP_EVENT_H__ */
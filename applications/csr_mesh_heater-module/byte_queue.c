@@ -16,6 +16,7 @@
  *============================================================================*/
 
 #include <mem.h>
+#include "macros.h"
 /*============================================================================*
  *  Local Header Files
  *============================================================================*/
@@ -25,29 +26,36 @@
  *  Private Definitions
  *============================================================================*/
 
-/* Number of 512 bytes buffer required to store the data from UART/BLE */
-#define BUFFER_SIZE              (256)
+/* Receive queue only */
+#define NO_OF_QUEUES             (1)
 
-/* Largest amount of data that can be stored in the buffer */
-#define BUFFER_LEN               (BUFFER_SIZE - 1)
-
-/* Send and Receive queue only */
-#define NO_OF_QUEUES             (2)
+/* Masked indexing relies on the queue size being a power of two */
+COMPILE_TIME_ASSERT((RECV_QUEUE_SIZE & (RECV_QUEUE_SIZE - 1)) == 0,
+                    recv_queue_size_must_be_power_of_two);
 
 /*============================================================================*
  *  Private Data Types
  *============================================================================*/
 
-/* Queue data structure */
+/* Queue data structure. The head, peek and tail indices run freely and are
+ * masked with the queue size only when the buffer is accessed, so the queue
+ * length is always g_tail - g_head and the whole buffer can be used.
+ */
 typedef struct _QUEUE_T
 {
-    /* Pointer to head of queue (next byte to be read out) */
+    /* Queue storage */
+    uint8 *buffer;
+
+    /* Queue size - 1, used to mask the indices */
+    uint16 mask;
+
+    /* Index of head of queue (next byte to be read out) */
     uint16 g_head ;
 
-    /* Pointer to head of queue after committing most recent peek */
+    /* Index of head of queue after committing most recent peek */
     uint16 g_peek ;
-    
-    /* Pointer to tail of queue (next byte to be inserted) */
+
+    /* Index of tail of queue (next byte to be inserted) */
     uint16 g_tail ;
 }QUEUE_T;
 
@@ -55,32 +63,36 @@ typedef struct _QUEUE_T
  *  Private Definitions
  *============================================================================*/
 
+/* Total size of the queue */
+#define QUEUE_CAPACITY(id) \
+  ((uint16)(g_queue[id].mask + 1))
+
 /* Length of data currently held in queue */
 #define QUEUE_LENGTH(id) \
-  ((g_queue[id].g_tail >= g_queue[id].g_head) ? \
-  g_queue[id].g_tail - g_queue[id].g_head \
-  : BUFFER_SIZE - g_queue[id].g_head + g_queue[id].g_tail)
+  ((uint16)(g_queue[id].g_tail - g_queue[id].g_head))
 
-/* Amount of free space left in queue (= BUFFER_LEN - QUEUE_LENGTH) */
+/* Amount of free space left in queue */
 #define QUEUE_FREE(id) \
-  ((g_queue[id].g_tail >= g_queue[id].g_head) ? \
-  BUFFER_LEN - g_queue[id].g_tail + g_queue[id].g_head \
-  : g_queue[id].g_head - g_queue[id].g_tail - 1)
-  
+  ((uint16)(QUEUE_CAPACITY(id) - QUEUE_LENGTH(id)))
+
+/* Position of an index within the queue buffer */
+#define QUEUE_OFFSET(id, index) \
+  ((index) & g_queue[id].mask)
+
 /*============================================================================*
  *  Private Data
  *============================================================================*/
 
-/* g_queue holds the head,peek,tail variables for send and recv queues */
-static QUEUE_T g_queue[NO_OF_QUEUES];
-
 /* receive queue buffer */
-uint8 g_recv_queue[BUFFER_SIZE];
+uint8 g_recv_queue[RECV_QUEUE_SIZE];
+
+/* g_queue holds the buffer and head,peek,tail indices for the recv queue */
+static QUEUE_T g_queue[NO_OF_QUEUES] =
+{
+    {g_recv_queue, RECV_QUEUE_SIZE - 1, 0, 0, 0}
+};
 
-/* send queue buffer */
-uint8 g_send_queue[BUFFER_SIZE];
 
-      
 /*============================================================================*
  *  Private Function Prototypes
  *============================================================================*/
@@ -117,78 +129,46 @@ static uint16 peekBuffer(uint8 *p_data, uint16 len,uint8 queue_idx);
  *----------------------------------------------------------------------------*/
 static void copyIntoBuffer(const uint8 *p_data, uint16 len,uint8 queue_id)
 {
+    QUEUE_T *p_queue = &g_queue[queue_id];
+    uint16 offset;
+    uint16 first;
+
     /* Sanity check */
     if ((len == 0) || (p_data == NULL))
         return;
 
     /* No point copying more data into the queue than the queue can hold */
-    if (len > BUFFER_LEN)
+    if (len > QUEUE_CAPACITY(queue_id))
     {
-        /* Advance input pointer to the last BUFFER_LEN bytes */
-        p_data += len - BUFFER_LEN;
+        /* Advance input pointer to the last QUEUE_CAPACITY bytes */
+        p_data += len - QUEUE_CAPACITY(queue_id);
 
         /* Adjust len */
-        len = BUFFER_LEN;
+        len = QUEUE_CAPACITY(queue_id);
     }
 
     /* Check whether the queue will overflow */
     if (len > QUEUE_FREE(queue_id))
     {
-        /* Advance g_head to point to the oldest item, after the overflow*/
-        g_queue[queue_id].g_head += len - (QUEUE_FREE(queue_id));
-
-        /* If this goes past the end of the buffer, wrap around */
-        if (g_queue[queue_id].g_head >= BUFFER_SIZE)
-            g_queue[queue_id].g_head -= BUFFER_SIZE;
+        /* Advance g_head to point to the oldest item, after the overflow */
+        p_queue->g_head += len - QUEUE_FREE(queue_id);
 
         /* Update g_peek similarly */
-        g_queue[queue_id].g_peek = g_queue[queue_id].g_head;
+        p_queue->g_peek = p_queue->g_head;
     }
 
-    /* Check whether we're going past the end of the buffer */
-    if (g_queue[queue_id].g_tail + len >= BUFFER_SIZE)
-    {
-        /* Calculate how much space there is till the end of the buffer */
-        const uint16 available = BUFFER_SIZE - g_queue[queue_id].g_tail;
-
-        /* Copy data into the queue up to end of buffer */
-        if(queue_id == SEND_QUEUE_ID)
-        {
-            MemCopy(&g_send_queue[g_queue[queue_id].g_tail], p_data, available);
-        }
-        else
-        {
-            MemCopy(&g_recv_queue[g_queue[queue_id].g_tail], p_data, available);
-        }
-
-        /* Update g_tail */
-        g_queue[queue_id].g_tail = len - available;
-
-        /* Copy data into the queue up to end of buffer */
-        if(queue_id == SEND_QUEUE_ID)
-        {
-            MemCopy(g_send_queue, p_data + available, g_queue[queue_id].g_tail);
-        }
-        else
-        {
-            MemCopy(g_recv_queue, p_data + available, g_queue[queue_id].g_tail);
-        }
-    }
-    else
-    {
-        /* Copy data into the queue up to end of buffer */
-        if(queue_id == SEND_QUEUE_ID)
-        {
-           MemCopy(&g_send_queue[g_queue[queue_id].g_tail], p_data, len);
-        } 
-        else
-        {
-           MemCopy(&g_recv_queue[g_queue[queue_id].g_tail], p_data, len);
-        }
-
-        /* Update g_tail */
-        g_queue[queue_id].g_tail += len;
-    }
+    /* Copy up to the end of the buffer, then the rest from the start */
+    offset = QUEUE_OFFSET(queue_id, p_queue->g_tail);
+    first = QUEUE_CAPACITY(queue_id) - offset;
+    if (first > len)
+        first = len;
+
+    MemCopy(&p_queue->buffer[offset], p_data, first);
+    if (len > first)
+        MemCopy(p_queue->buffer, p_data + first, len - first);
+
+    /* Update g_tail */
+    p_queue->g_tail += len;
 }
 
 /*----------------------------------------------------------------------------*
@@ -203,91 +183,41 @@ static void copyIntoBuffer(const uint8 *p_data, uint16 len,uint8 queue_id)
  * PARAMETERS
  *      p_data [in]     Pointer to buffer to store read data in
  *      len    [in]     Number of bytes of data to peek
- *      queue_id [in]     Identifier of the Queue 
+ *      queue_id [in]     Identifier of the Queue
  *
  * RETURNS
  *      Number of bytes of data peeked.
  *----------------------------------------------------------------------------*/
 static uint16 peekBuffer(uint8 *p_data, uint16 len,uint8 queue_id)
 {
+    QUEUE_T *p_queue = &g_queue[queue_id];
     uint16 peeked = len;    /* Number of bytes of data peeked */
+    uint16 offset;
+    uint16 first;
 
-    /* Sanity check */
+    /* Sanity check; nothing is peeked, so nothing may be committed either */
     if ((len == 0) || (p_data == NULL))
+    {
+        p_queue->g_peek = p_queue->g_head;
         return 0;
+    }
 
     /* Cannot peek more data than is available */
-    if (peeked> QUEUE_LENGTH(queue_id))
-    {
-       peeked = QUEUE_LENGTH(queue_id);
-       
-       if(peeked > len)
-          peeked = len;
-    }
+    if (peeked > QUEUE_LENGTH(queue_id))
+        peeked = QUEUE_LENGTH(queue_id);
 
-    /* Check whether we're going past the end of the buffer */
-    if (g_queue[queue_id].g_head + peeked >= BUFFER_SIZE)
-    {
-        /* Calculate how much space there is till the end of the buffer */
-        const uint16 available = BUFFER_SIZE - g_queue[queue_id].g_head;
-
-        if(queue_id == SEND_QUEUE_ID)
-        {
-            if(available > len)
-            {
-              /* Copy data up to end of buffer */
-              MemCopy(p_data, &g_send_queue[g_queue[queue_id].g_head], len);
-            }
-            else
-            {
-              /* Copy data up to end of buffer */
-              MemCopy(p_data,&g_send_queue[g_queue[queue_id].g_head],available);
-            }
-        }
-        else
-        {
-            if(available>len)
-            {
-              /* Copy data up to end of buffer */
-              MemCopy(p_data, &g_recv_queue[g_queue[queue_id].g_head], len);
-            }
-            else
-            {
-              /* Copy data up to end of buffer */
-              MemCopy(p_data,&g_recv_queue[g_queue[queue_id].g_head],available);
-            }
-        }
-
-        /* Update g_peek */
-        g_queue[queue_id].g_peek = peeked - available;
-
-        if(queue_id == SEND_QUEUE_ID)
-        {
-            /* Copy data from start of buffer */
-            MemCopy(p_data + available,g_send_queue, g_queue[queue_id].g_peek);
-        }
-        else
-        {
-            /* Copy data from start of buffer */
-            MemCopy(p_data + available,g_recv_queue, g_queue[queue_id].g_peek);
-        }
-    }
-    else
-    {
-        if(queue_id == SEND_QUEUE_ID)
-        {
-            /* Peek data starting from the head of the queue */
-            MemCopy(p_data, &g_send_queue[g_queue[queue_id].g_head], peeked);
-        }
-        else
-        {
-            /* Peek data starting from the head of the queue */
-            MemCopy(p_data, &g_recv_queue[g_queue[queue_id].g_head], peeked);
-        }
-        
-        /* Update g_peek */
-        g_queue[queue_id].g_peek = g_queue[queue_id].g_head + peeked;
-    }
+    /* Copy up to the end of the buffer, then the rest from the start */
+    offset = QUEUE_OFFSET(queue_id, p_queue->g_head);
+    first = QUEUE_CAPACITY(queue_id) - offset;
+    if (first > peeked)
+        first = peeked;
+
+    MemCopy(p_data, &p_queue->buffer[offset], first);
+    if (peeked > first)
+        MemCopy(p_data + first, p_queue->buffer, peeked - first);
+
+    /* Update g_peek */
+    p_queue->g_peek = p_queue->g_head + peeked;
 
     return peeked;
 }
@@ -364,7 +294,7 @@ void BQForceQueueBytes(const uint8 *p_data, uint16 len,uint8 queue_id)
  *----------------------------------------------------------------------------*/
 uint16 BQGetBufferCapacity(uint8 queue_id)
 {
-    return BUFFER_LEN;
+    return QUEUE_CAPACITY(queue_id);
 }
 
 /*----------------------------------------------------------------------------*
@@ -496,3 +426,136 @@ void BQCommitLastPeek(uint8 queue_id)
     /* Update g_head to point to current g_peek location */
     g_queue[queue_id].g_head = g_queue[queue_id].g_peek;
 }
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BQGetReadSpan
+ *
+ *  DESCRIPTION
+ *      Return the longest contiguous run of queued data starting at the head
+ *      of the queue, so it can be consumed in place. If the queued data wraps
+ *      around the end of the buffer, a second call after BQCommitRead
+ *      returns the remainder.
+ *
+ * PARAMETERS
+ *      pp_data  [out]    Set to point at the first readable byte
+ *      queue_id [in]     Identifier of the Queue
+ *
+ * RETURNS
+ *      Number of contiguous bytes readable at *pp_data, 0 if the queue is
+ *      empty.
+ *----------------------------------------------------------------------------*/
+uint16 BQGetReadSpan(const uint8 **pp_data, uint8 queue_id)
+{
+    const uint16 offset = QUEUE_OFFSET(queue_id, g_queue[queue_id].g_head);
+    uint16 span = QUEUE_CAPACITY(queue_id) - offset;
+
+    if (span > QUEUE_LENGTH(queue_id))
+        span = QUEUE_LENGTH(queue_id);
+
+    *pp_data = &g_queue[queue_id].buffer[offset];
+    return span;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BQCommitRead
+ *
+ *  DESCRIPTION
+ *      Remove the given number of bytes from the head of the queue, after
+ *      they have been consumed through BQGetReadSpan.
+ *
+ * PARAMETERS
+ *      len      [in]     Number of bytes consumed
+ *      queue_id [in]     Identifier of the Queue
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void BQCommitRead(uint16 len, uint8 queue_id)
+{
+    if (len > QUEUE_LENGTH(queue_id))
+        len = QUEUE_LENGTH(queue_id);
+
+    g_queue[queue_id].g_head += len;
+    g_queue[queue_id].g_peek = g_queue[queue_id].g_head;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BQGetWriteSpan
+ *
+ *  DESCRIPTION
+ *      Return the longest contiguous run of free space starting at the tail
+ *      of the queue, so data can be produced in place. Nothing is added to
+ *      the queue until BQCommitWrite is called.
+ *
+ * PARAMETERS
+ *      pp_data  [out]    Set to point at the first writable byte
+ *      queue_id [in]     Identifier of the Queue
+ *
+ * RETURNS
+ *      Number of contiguous bytes writable at *pp_data, 0 if the queue is
+ *      full.
+ *----------------------------------------------------------------------------*/
+uint16 BQGetWriteSpan(uint8 **pp_data, uint8 queue_id)
+{
+    const uint16 offset = QUEUE_OFFSET(queue_id, g_queue[queue_id].g_tail);
+    uint16 span = QUEUE_CAPACITY(queue_id) - offset;
+
+    if (span > QUEUE_FREE(queue_id))
+        span = QUEUE_FREE(queue_id);
+
+    *pp_data = &g_queue[queue_id].buffer[offset];
+    return span;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BQPokeByte
+ *
+ *  DESCRIPTION
+ *      Write one byte into the free space at the given distance past the tail
+ *      of the queue, wrapping around the end of the buffer as needed. Lets a
+ *      frame be serialized straight into the queue without it having to fit
+ *      in one contiguous span. Nothing is added to the queue until
+ *      BQCommitWrite is called.
+ *
+ * PARAMETERS
+ *      offset   [in]     Distance from the tail, less than BQGetAvailableSize
+ *      byte     [in]     Byte to write
+ *      queue_id [in]     Identifier of the Queue
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void BQPokeByte(uint16 offset, uint8 byte, uint8 queue_id)
+{
+    if (offset >= QUEUE_FREE(queue_id))
+        return;
+
+    g_queue[queue_id].buffer[
+        QUEUE_OFFSET(queue_id, g_queue[queue_id].g_tail + offset)] = byte;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BQCommitWrite
+ *
+ *  DESCRIPTION
+ *      Append to the queue the given number of bytes written through
+ *      BQGetWriteSpan or BQPokeByte.
+ *
+ * PARAMETERS
+ *      len      [in]     Number of bytes written
+ *      queue_id [in]     Identifier of the Queue
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void BQCommitWrite(uint16 len, uint8 queue_id)
+{
+    if (len > QUEUE_FREE(queue_id))
+        len = QUEUE_FREE(queue_id);
+
+    g_queue[queue_id].g_tail += len;
+}
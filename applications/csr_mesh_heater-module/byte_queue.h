@@ -23,8 +23,11 @@
 /*============================================================================*
  *  Public definitions
  *============================================================================*/
-#define SEND_QUEUE_ID            (0)
-#define RECV_QUEUE_ID            (1)
+/* The receive queue is the only queue; it buffers frames for the UART TX */
+#define RECV_QUEUE_ID            (0)
+
+/* Size of the queue in bytes, must be a power of two */
+#define RECV_QUEUE_SIZE          (256)
 
 /*============================================================================*
  *  Public functions prototypes
@@ -71,4 +74,27 @@ extern uint16 BQPeekBytes(uint8 *p_data, uint16 len,uint8 queueid);
  */
 extern void BQCommitLastPeek(uint8 queueid);
 
+/* Function that returns the longest contiguous run of queued data at the head
+ * of the queue, so it can be consumed without copying it out.
+ */
+extern uint16 BQGetReadSpan(const uint8 **pp_data, uint8 queueid);
+
+/* Function that removes from the queue data consumed through BQGetReadSpan. */
+extern void BQCommitRead(uint16 len, uint8 queueid);
+
+/* Function that returns the longest contiguous run of free space at the tail
+ * of the queue, so data can be written into it directly.
+ */
+extern uint16 BQGetWriteSpan(uint8 **pp_data, uint8 queueid);
+
+/* Function that writes one byte into the free space past the tail of the
+ * queue, wrapping around the end of the buffer.
+ */
+extern void BQPokeByte(uint16 offset, uint8 byte, uint8 queueid);
+
+/* Function that appends to the queue data written through BQGetWriteSpan or
+ * BQPokeByte.
+ */
+extern void BQCommitWrite(uint16 len, uint8 queueid);
+
 #endif /* __BYTE_QUEUE_H__ */
@@ -0,0 +1,79 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      crc16.c
+ *
+ *  DESCRIPTION
+ *      Table driven CRC-16/CCITT. The table is indexed by nibble, so it
+ *      costs 16 words instead of 256 and a byte takes two lookups.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "crc16.h"
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* CRC of each nibble value shifted into the top of the register */
+static const uint16 g_crc16_table[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CRC16Update
+ *
+ *  DESCRIPTION
+ *      Fold one byte into a CRC, high nibble first.
+ *
+ * PARAMETERS
+ *      crc     [in]    CRC so far, CRC16_INIT for the first byte
+ *      byte    [in]    Byte, only the low 8 bits are used
+ *
+ * RETURNS
+ *      Updated CRC
+ *----------------------------------------------------------------------------*/
+uint16 CRC16Update(uint16 crc, uint8 byte)
+{
+    crc = (uint16)(crc << 4) ^
+          g_crc16_table[((crc >> 12) ^ (byte >> 4)) & 0x0F];
+    crc = (uint16)(crc << 4) ^
+          g_crc16_table[((crc >> 12) ^ byte) & 0x0F];
+
+    return crc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CRC16Block
+ *
+ *  DESCRIPTION
+ *      Fold a block of bytes into a CRC.
+ *
+ * PARAMETERS
+ *      crc     [in]    CRC so far, CRC16_INIT for a new block
+ *      p_data  [in]    Bytes
+ *      len     [in]    Number of bytes
+ *
+ * RETURNS
+ *      Updated CRC
+ *----------------------------------------------------------------------------*/
+uint16 CRC16Block(uint16 crc, const uint8 *p_data, uint16 len)
+{
+    uint16 i;
+
+    for (i = 0; i < len; i++)
+        crc = CRC16Update(crc, p_data[i]);
+
+    return crc;
+}
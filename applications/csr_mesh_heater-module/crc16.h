@@ -0,0 +1,45 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      crc16.h
+ *
+ *  DESCRIPTION
+ *      Interface to the CRC-16/CCITT used to check v2 Wi-Fi frames
+ *      (polynomial 0x1021, initial value 0xFFFF, no reflection).
+ *
+ *****************************************************************************/
+
+#ifndef __CRC16_H__
+#define __CRC16_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Value to start a CRC from */
+#define CRC16_INIT                   (0xFFFF)
+
+/* Value of the CRC run over a block followed by its own CRC, high byte
+ * first. A receiver can feed the CRC bytes in with the rest of the frame and
+ * compare against this instead of extracting them.
+ */
+#define CRC16_RESIDUE                (0x0000)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that folds one byte into a CRC. */
+extern uint16 CRC16Update(uint16 crc, uint8 byte);
+
+/* Function that folds a block of bytes into a CRC. */
+extern uint16 CRC16Block(uint16 crc, const uint8 *p_data, uint16 len);
+
+#endif /* __CRC16_H__ */
@@ -76,8 +76,15 @@ INPUTS=\
       app_mesh_handler.c\
       app_mesh_model_handler.c\
       byte_queue.c\
+      frame_queue.c\
+      app_event.c\
+      crc16.c\
+      wifi_link.c\
+      msg_cache.c\
+      mesh_fanout.c\
+      mesh_delta.c\
       label.c\
-      time_uart.c\
+      timer_wheel.c\
       uart_time.c\
       Flash_Run.c\
       $(DBS)
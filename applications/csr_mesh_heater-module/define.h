@@ -27,25 +27,19 @@
 /*1msʱ*/
 
 #define SERIAL_RX_DATA_LENGTH           (30)
-#define C_T_OnTimeWait3s                                     (0x4000+3)
-#define C_T_WifiSendData                                     (0x4000+3) 
-#define C_T_WifiTwoByteSentTime                              (0x4000+2) 
-#define C_T_wifitsrxcyc                                      (0x4000+40)  /*ݺ󣬵ȴ300ms,ղݣ·*/
-#define C_T_wifitstxcyc                                      (0x4000+1)
-#define C_T_Wifi2mscyc                                       (0x4000+4)
-#define C_T_tWifitsfrmwt                                     (0x4000+5)
-#define C_T_tHeartPack5s                                    (0x4000+30)
-#define C_T_tUartWait10ms                                    (0x4000+20)
-#define C_T_tSendWait800ms                                   (0x4000+8)
-#define C_T_tPanic2Min                                       (0x4000+60)
-#define C_T_tBleReset3Min                                    (0x4000+180)
-#define C_T_tAdvUUID3Min                                     (0x4000+180) 
-#define C_T_tMeshTimeOut2s                                   (0x4000+2) 
-#define C_T_tmeshfinishdataWait100ms                         (0x4000+1) 
-#define C_T_tRxMeshTimeOut2s                                 (0x4000+2) 
-#define C_T_tmfTxdataWait100ms                               (0x4000+1) 
-#define C_T_tWriteFlashDelay                                 (0x4000+5)
-#define C_T_tRstWait500ms                                    (0x4000+5)
+/* Software timer timeouts, in timer wheel ticks */
+#define C_T_OnTimeWait3s                                     TW_TICKS_1S(3)
+#define C_T_WifiSendData                                     TW_TICKS_100MS(3) 
+#define C_T_tHeartPack5s                                     TW_TICKS_1S(30)
+#define C_T_tSendWait800ms                                   TW_TICKS_100MS(8)
+#define C_T_tPanic2Min                                       TW_TICKS_1S(60)
+#define C_T_tBleReset3Min                                    TW_TICKS_1S(180)
+#define C_T_tAdvUUID3Min                                     TW_TICKS_1S(180) 
+#define C_T_tMeshTimeOut2s                                   TW_TICKS_1S(2) 
+#define C_T_tmeshfinishdataWait100ms                         TW_TICKS_100MS(1) 
+#define C_T_tWriteFlashDelay                                 TW_TICKS_100MS(5)
+#define C_T_tRstWait500ms                                    TW_TICKS_100MS(5)
+#define C_T_tWifiBatch50ms                                   TW_TICKS_10MS(5)
 
 
 #define CSR1010_KFCFG_ADDR       500
@@ -59,10 +53,39 @@
 #define cTxd                 (1)  
 #define cTxdEnd              (2) 
 
-#define cRxdPrepare          (0)
-#define cRxdWait             (1)
-#define cRxd                 (2)   
-#define cRxdEnd              (3)
+/* Wi-Fi frame receive parser states */
+#define cRxdHuntHead         (0)  /* waiting for the first EE */
+#define cRxdHuntType         (1)  /* waiting for the EE/AA frame type */
+#define cRxdHeader           (2)  /* message ID, mesh ID and length */
+#define cRxdBody             (3)  /* data bytes and trailing BCC */
+
+/* Wi-Fi frame sizes: EE | type | msg id | mesh id (2) | len | data | bcc */
+#define WIFI_FRAME_HEADER_LENGTH  (6)
+#define WIFI_FRAME_MAX_LENGTH     (40)
+
+/* Frame type of a command for several heaters and of its report, see
+ * mesh_fanout.h
+ */
+#define WIFI_FRAME_TYPE_FANOUT    (0xEF)
+
+/* Batch frame: E2 | BB | 00 00 00 | len | records | seq | ack | check, each
+ * record is EE/AA | msg id | mesh id (2) | n | n data bytes. Records are
+ * sent once this many bytes are waiting or C_T_tWifiBatch50ms after the
+ * first one, whichever comes first.
+ */
+#define WIFI_BATCH_MAX_LENGTH     (WIFI_FRAME_MAX_LENGTH - 7)
+#define WIFI_BATCH_FLUSH_LENGTH   (24)
+
+/* Longest mesh frame (7E/E7 | msg id | len | data | xor) that BLE_TX_DATA
+ * and BLE_RX_DATA hold and DataBlockSend segments, at most 255.
+ */
+#define MESH_DATA_MAX_LENGTH      (64)
+
+/* Mesh transmit queue: frames from the Wi-Fi module that can wait for the
+ * mesh, and how many of them have their segments sent at the same time.
+ */
+#define MESH_TX_QUEUE_DEPTH       (4)
+#define MESH_TX_IN_FLIGHT         (2)
 
 
 #define Mesh_ununited         (0) /*MESHδ*/
@@ -0,0 +1,229 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      frame_queue.c
+ *
+ *  DESCRIPTION
+ *      Bounded queue of complete Wi-Fi frames. The UART receive parser
+ *      assembles each frame directly in a free slot and commits it once the
+ *      BCC has been verified, the mesh sender drains the queue one frame at
+ *      a time as it becomes free.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "frame_queue.h"
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Frame queue data structure */
+typedef struct _FRAME_QUEUE_T
+{
+    /* Frame slots */
+    uint8 slot[FRAME_QUEUE_DEPTH][FRAME_QUEUE_SLOT_SIZE];
+
+    /* Length of the frame held in each slot */
+    uint16 len[FRAME_QUEUE_DEPTH];
+
+    /* Index of the oldest frame */
+    uint16 head;
+
+    /* Number of frames in the queue */
+    uint16 count;
+
+    /* Frames dropped because the queue was full */
+    uint16 dropped;
+
+    /* Largest number of frames queued at once */
+    uint16 high_water;
+}FRAME_QUEUE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static FRAME_QUEUE_T g_frame_queue;
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Index of the slot the next frame is written to */
+#define FRAME_QUEUE_TAIL \
+  ((g_frame_queue.head + g_frame_queue.count) % FRAME_QUEUE_DEPTH)
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQInit
+ *
+ *  DESCRIPTION
+ *      Empty the queue and clear the statistics counters.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void FQInit(void)
+{
+    MemSet(&g_frame_queue, 0, sizeof(g_frame_queue));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQGetFreeSlot
+ *
+ *  DESCRIPTION
+ *      Return the slot the next frame can be assembled in. The slot only
+ *      becomes part of the queue when FQCommitSlot is called, so a frame that
+ *      fails its checksum is simply overwritten by the next one.
+ *
+ * RETURNS
+ *      Pointer to FRAME_QUEUE_SLOT_SIZE bytes, or NULL if the queue is full.
+ *----------------------------------------------------------------------------*/
+uint8 *FQGetFreeSlot(void)
+{
+    if (g_frame_queue.count >= FRAME_QUEUE_DEPTH)
+        return NULL;
+
+    return g_frame_queue.slot[FRAME_QUEUE_TAIL];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQCommitSlot
+ *
+ *  DESCRIPTION
+ *      Append the frame assembled in the slot returned by FQGetFreeSlot.
+ *
+ * PARAMETERS
+ *      len    [in]     Length of the frame in bytes
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void FQCommitSlot(uint16 len)
+{
+    if (g_frame_queue.count >= FRAME_QUEUE_DEPTH)
+        return;
+
+    g_frame_queue.len[FRAME_QUEUE_TAIL] = len;
+    g_frame_queue.count++;
+
+    if (g_frame_queue.count > g_frame_queue.high_water)
+        g_frame_queue.high_water = g_frame_queue.count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQRecordOverflow
+ *
+ *  DESCRIPTION
+ *      Count a complete frame that was dropped because no slot was free.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void FQRecordOverflow(void)
+{
+    if (g_frame_queue.dropped < 0xFFFF)
+        g_frame_queue.dropped++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQPeekFrame
+ *
+ *  DESCRIPTION
+ *      Return the oldest frame in the queue without removing it.
+ *
+ * PARAMETERS
+ *      p_len  [out]    Length of the returned frame in bytes
+ *
+ * RETURNS
+ *      Pointer to the frame, or NULL if the queue is empty.
+ *----------------------------------------------------------------------------*/
+const uint8 *FQPeekFrame(uint16 *p_len)
+{
+    if (g_frame_queue.count == 0)
+        return NULL;
+
+    *p_len = g_frame_queue.len[g_frame_queue.head];
+    return g_frame_queue.slot[g_frame_queue.head];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQPopFrame
+ *
+ *  DESCRIPTION
+ *      Remove the oldest frame from the queue.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void FQPopFrame(void)
+{
+    if (g_frame_queue.count == 0)
+        return;
+
+    g_frame_queue.head = (g_frame_queue.head + 1) % FRAME_QUEUE_DEPTH;
+    g_frame_queue.count--;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQGetFrameCount
+ *
+ *  DESCRIPTION
+ *      Return the number of frames currently in the queue.
+ *
+ * RETURNS
+ *      Number of frames
+ *----------------------------------------------------------------------------*/
+uint16 FQGetFrameCount(void)
+{
+    return g_frame_queue.count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQGetDroppedCount
+ *
+ *  DESCRIPTION
+ *      Return the number of complete frames dropped because the queue was
+ *      full.
+ *
+ * RETURNS
+ *      Number of dropped frames
+ *----------------------------------------------------------------------------*/
+uint16 FQGetDroppedCount(void)
+{
+    return g_frame_queue.dropped;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FQGetHighWaterMark
+ *
+ *  DESCRIPTION
+ *      Return the largest number of frames that were queued at once.
+ *
+ * RETURNS
+ *      Number of frames
+ *----------------------------------------------------------------------------*/
+uint16 FQGetHighWaterMark(void)
+{
+    return g_frame_queue.high_water;
+}
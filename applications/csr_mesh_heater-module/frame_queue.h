@@ -0,0 +1,71 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      frame_queue.h
+ *
+ *  DESCRIPTION
+ *      Interface to the queue of complete, checksum verified Wi-Fi frames
+ *      waiting to be relayed into the mesh.
+ *
+ *****************************************************************************/
+
+#ifndef __FRAME_QUEUE_H__
+#define __FRAME_QUEUE_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Number of complete frames that can wait for the mesh sender */
+#define FRAME_QUEUE_DEPTH            (8)
+
+/* Size of each frame slot, large enough for the longest Wi-Fi frame */
+#define FRAME_QUEUE_SLOT_SIZE        (40)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that empties the queue and clears the statistics counters. */
+extern void FQInit(void);
+
+/* Function that returns the free slot the next frame can be assembled in, or
+ * NULL if the queue is full.
+ */
+extern uint8 *FQGetFreeSlot(void);
+
+/* Function that appends the frame assembled in the slot returned by the last
+ * call to FQGetFreeSlot.
+ */
+extern void FQCommitSlot(uint16 len);
+
+/* Function that records a complete frame that was dropped because the queue
+ * was full.
+ */
+extern void FQRecordOverflow(void);
+
+/* Function that returns the oldest frame in the queue without removing it, or
+ * NULL if the queue is empty.
+ */
+extern const uint8 *FQPeekFrame(uint16 *p_len);
+
+/* Function that removes the oldest frame from the queue. */
+extern void FQPopFrame(void);
+
+/* Function that returns the number of frames currently in the queue. */
+extern uint16 FQGetFrameCount(void);
+
+/* Function that returns the number of frames dropped on overflow. */
+extern uint16 FQGetDroppedCount(void);
+
+/* Function that returns the largest number of frames queued at once. */
+extern uint16 FQGetHighWaterMark(void);
+
+#endif /* __FRAME_QUEUE_H__ */
@@ -0,0 +1,429 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      bench_data_model.c
+ *
+ *  DESCRIPTION
+ *      Benchmark of data_model_handler.c on the simulated mesh. For every
+ *      frame length, node count and loss rate a batch of frames is sent
+ *      either from node 0, the gateway, to the other nodes in turn
+ *      (fan-out) or from every other node to the gateway (fan-in). Senders
+ *      offer their next frame to DataSend() as soon as it is taken, so the
+ *      figures are those of a saturated sender:
+ *
+ *          latency   time from DataSend() taking a frame until the
+ *                    receiver passes it to the application (mean and max)
+ *          goodput   frame bytes delivered per second of the batch
+ *          loss      frames taken by DataSend() but never delivered
+ *
+ *      followed by the segment, resend, failure, pacing and queue wait
+ *      counters of node 0 (fan-out) or node 1 (fan-in), and the frames all
+ *      receivers dropped incomplete or answered busy.
+ *
+ *      bench_data_model [-n frames] [-s seed] [-d duplicate %]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "define.h"
+#include "label.h"
+#include "data_model_handler.h"
+#include "host_sdk.h"
+#include "mesh_sim.h"
+#include "node_app.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Largest batch of frames */
+#define BENCH_MAX_FRAMES             (1000)
+
+/* Longest a batch may take */
+#define BENCH_TIME_LIMIT             (600 * SECOND)
+
+/* Time after which a sender that was refused tries again, as the
+ * application tick would
+ */
+#define BENCH_RETRY_TIME             (50 * MILLISECOND)
+
+/* Group all nodes listen to */
+#define BENCH_GROUP_ID               (0x0001)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Frame of a batch */
+typedef struct
+{
+    uint16 sender;
+    uint16 dest;
+    bool sent;          /* DataSend() took the frame */
+    uint32 taken;       /* Time DataSend() took it */
+    uint32 delivered;   /* Time it was first delivered */
+    uint16 copies;      /* Times it was delivered */
+}BENCH_FRAME_T;
+
+/* Results of a batch */
+typedef struct
+{
+    uint16 taken;
+    uint16 delivered;
+    uint16 copies;
+    uint32 latency_sum;
+    uint32 latency_max;
+    uint32 bytes;
+    uint32 duration;
+    uint16 rx_dropped;  /* Frames receivers dropped incomplete */
+    uint16 rx_refused;  /* Frames receivers answered busy */
+}BENCH_RESULT_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static BENCH_FRAME_T g_frames[BENCH_MAX_FRAMES];
+static uint16 g_frame_count;
+static uint16 g_frame_len;
+static uint16 g_node_count;
+
+/* Next frame of each node to offer */
+static uint16 g_next[HOST_MAX_NODES];
+
+/* TRUE while a retry of the node is scheduled */
+static bool g_retry[HOST_MAX_NODES];
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void benchOffer(void *p_arg);
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchBuildFrame
+ *
+ *  DESCRIPTION
+ *      Builds frame n: 7E | message ID | length | frame number | data |
+ *      XOR check, as processMeshData() would queue it.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchBuildFrame(uint16 n, uint8 *p_frame)
+{
+    uint8 check = 0;
+    uint16 i;
+
+    p_frame[0] = 0x7E;
+    p_frame[1] = (uint8)n;
+    p_frame[2] = (uint8)(g_frame_len - 2);
+    p_frame[3] = (uint8)(n >> 8);
+    p_frame[4] = (uint8)n;
+    for(i = 5;i < g_frame_len - 1;i++)
+    {
+        p_frame[i] = (uint8)(n * 7 + i);
+    }
+    for(i = 1;i < g_frame_len - 1;i++)
+    {
+        check ^= p_frame[i];
+    }
+    p_frame[g_frame_len - 1] = check;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchOffer
+ *
+ *  DESCRIPTION
+ *      Offers the frames of the selected node to DataSend() until one is
+ *      refused.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchOffer(void *p_arg)
+{
+    const uint16 node = HostNodeCurrent();
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    BENCH_FRAME_T *p_frame;
+
+    g_retry[node] = FALSE;
+    while(g_next[node] < g_frame_count)
+    {
+        p_frame = &g_frames[g_next[node]];
+        if(p_frame->sender != node)
+        {
+            g_next[node]++;
+            continue;
+        }
+        benchBuildFrame(g_next[node], frame);
+        if(!DataSend(MESH_SIM_NODE_ID(p_frame->dest), frame, g_frame_len))
+        {
+            if(!g_retry[node])
+            {
+                g_retry[node] = TRUE;
+                HostPost(BENCH_RETRY_TIME, node, benchOffer, NULL);
+            }
+            return;
+        }
+        p_frame->sent = TRUE;
+        p_frame->taken = TimeGet32();
+        g_next[node]++;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchRun
+ *
+ *  DESCRIPTION
+ *      Sends a batch of frames and collects the results.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchRun(const MESH_SIM_CONFIG_T *p_config, uint16 nodes,
+                     bool fan_in, uint16 frames, uint16 len,
+                     BENCH_RESULT_T *p_result)
+{
+    uint16 groups[1] = {BENCH_GROUP_ID};
+    bool started = FALSE;
+    uint32 first = 0, last = 0;
+    uint16 i, peer, refused;
+
+    g_node_count = nodes;
+    g_frame_count = frames;
+    g_frame_len = len;
+    memset(g_frames, 0, sizeof(g_frames));
+    memset(g_next, 0, sizeof(g_next));
+    memset(g_retry, 0, sizeof(g_retry));
+    for(i = 0;i < frames;i++)
+    {
+        peer = 1 + i % (nodes - 1);
+        g_frames[i].sender = fan_in ? peer : 0;
+        g_frames[i].dest = fan_in ? 0 : peer;
+    }
+
+    MSInit(p_config, nodes);
+    for(i = 0;i < nodes;i++)
+    {
+        HostNodeSelect(i);
+        NodeAppInit(groups, 1);
+    }
+    for(i = 0;i < nodes;i++)
+    {
+        HostPost(0, i, benchOffer, NULL);
+    }
+    while(HostPendingCount() != 0 && TimeGet32() < BENCH_TIME_LIMIT)
+    {
+        HostRunUntil(TimeGet32() + 10 * MILLISECOND);
+    }
+
+    memset(p_result, 0, sizeof(*p_result));
+    for(i = 0;i < frames;i++)
+    {
+        if(!g_frames[i].sent)
+        {
+            continue;
+        }
+        p_result->taken++;
+        p_result->copies += g_frames[i].copies;
+        if(g_frames[i].copies == 0)
+        {
+            continue;
+        }
+        p_result->delivered++;
+        p_result->bytes += len;
+        p_result->latency_sum += g_frames[i].delivered - g_frames[i].taken;
+        if(g_frames[i].delivered - g_frames[i].taken >
+           p_result->latency_max)
+        {
+            p_result->latency_max =
+                                g_frames[i].delivered - g_frames[i].taken;
+        }
+        if(!started || g_frames[i].taken < first)
+        {
+            started = TRUE;
+            first = g_frames[i].taken;
+        }
+        if(g_frames[i].delivered > last)
+        {
+            last = g_frames[i].delivered;
+        }
+    }
+    p_result->duration = last - first;
+
+    for(i = 0;i < nodes;i++)
+    {
+        HostNodeSelect(i);
+        p_result->rx_dropped += DataBlockRxGetDropped(&refused);
+        p_result->rx_refused += refused;
+    }
+
+    /* Leave a sender selected for its counters */
+    HostNodeSelect(fan_in ? 1 : 0);
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostAppEvent
+ *
+ *  DESCRIPTION
+ *      Application events of the selected node. A received frame is
+ *      matched to the batch by the frame number it carries.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostAppEvent(APP_EVENT_ID_T id, uint16 arg)
+{
+    const uint16 node = HostNodeCurrent();
+    const uint8 *p_data;
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    uint16 src_id, n;
+
+    if(id == AE_MESH_TX_READY)
+    {
+        HostPost(0, node, benchOffer, NULL);
+        return;
+    }
+    if(id != AE_MESH_FRAME_RECEIVED)
+    {
+        return;
+    }
+
+    p_data = NodeAppRxFrame(&src_id);
+    n = (uint16)(p_data[3] << 8) | p_data[4];
+    if(n >= g_frame_count || g_frames[n].dest != node ||
+       src_id != MESH_SIM_NODE_ID(g_frames[n].sender))
+    {
+        fprintf(stderr, "bench: node %u got a stray frame\n", node);
+        exit(1);
+    }
+    benchBuildFrame(n, frame);
+    if(memcmp(frame, p_data, g_frame_len) != 0)
+    {
+        fprintf(stderr, "bench: frame %u corrupted\n", n);
+        exit(1);
+    }
+    if(g_frames[n].copies++ == 0)
+    {
+        g_frames[n].delivered = TimeGet32();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      main
+ *
+ *----------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    static const uint16 lengths[] = {8, 16, 24, 32, 48, 64};
+    static const uint16 node_counts[] = {2, 4, 8};
+    static const uint16 losses[] = {0, 10, 30};
+    MESH_SIM_CONFIG_T config;
+    BENCH_RESULT_T result;
+    uint16 frames = 48;
+    uint16 fan_in, l, n, p;
+    uint16 segments, resent, failed, pace, queued_max;
+    int opt;
+
+    memset(&config, 0, sizeof(config));
+    config.latency = 5 * MILLISECOND;
+    config.jitter = 10 * MILLISECOND;
+    config.duplicate = 5;
+    config.seed = 1;
+    config.tx_queue_size = 6;
+    config.repeat_count = 3;
+    config.adv_interval = 10 * MILLISECOND;
+
+    while((opt = getopt(argc, argv, "n:s:d:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': frames = (uint16)atoi(optarg); break;
+            case 's': config.seed = (uint32)strtoul(optarg, NULL, 0); break;
+            case 'd': config.duplicate = (uint16)atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-n frames] [-s seed] "
+                                "[-d duplicate %%]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(frames == 0 || frames > BENCH_MAX_FRAMES)
+    {
+        fprintf(stderr, "bench: 1 to %u frames\n", BENCH_MAX_FRAMES);
+        return 2;
+    }
+
+#ifdef ENABLE_DATA_BLOCK_ACK
+    printf("data model, acknowledged blocks");
+#else
+    printf("data model, unacknowledged blocks");
+#endif /* ENABLE_DATA_BLOCK_ACK */
+    printf(": %u frames a batch, latency %lu+%lu ms, %u%% duplicated, "
+           "queue %u, %u repeats every %lu ms, seed %lu\n\n", frames,
+           (unsigned long)(config.latency / MILLISECOND),
+           (unsigned long)(config.jitter / MILLISECOND), config.duplicate,
+           config.tx_queue_size, config.repeat_count,
+           (unsigned long)(config.adv_interval / MILLISECOND),
+           (unsigned long)config.seed);
+    printf("%-7s %5s %4s %5s | %5s %5s %6s | %8s %8s | %9s | "
+           "%5s %6s %5s %6s %5s | %6s %5s\n",
+           "mode", "nodes", "len", "loss%", "taken", "lost", "loss%",
+           "mean_ms", "max_ms", "goodput", "segs", "resent", "fail",
+           "pace", "qmax", "rxdrop", "busy");
+
+    for(fan_in = 0;fan_in < 2;fan_in++)
+    {
+        for(n = 0;n < sizeof(node_counts) / sizeof(node_counts[0]);n++)
+        {
+            for(l = 0;l < sizeof(lengths) / sizeof(lengths[0]);l++)
+            {
+                for(p = 0;p < sizeof(losses) / sizeof(losses[0]);p++)
+                {
+                    config.loss = losses[p];
+                    benchRun(&config, node_counts[n], fan_in, frames,
+                             lengths[l], &result);
+
+                    segments = DataBlockTxGetSegments(&resent);
+                    (void)DataBlockTxGetDelivered(&failed, NULL);
+                    pace = DataBlockTxGetPacing(NULL);
+                    (void)DataBlockTxGetQueuedTime(&queued_max);
+                    printf("%-7s %5u %4u %5u | %5u %5u %6.1f | %8.1f %8.1f | "
+                           "%9.1f | %5u %6u %5u %6u %5u | %6u %5u\n",
+                           fan_in ? "fan-in" : "fan-out", node_counts[n],
+                           lengths[l], losses[p], result.taken,
+                           result.taken - result.delivered,
+                           result.taken ? 100.0 * (result.taken -
+                                          result.delivered) / result.taken
+                                        : 0.0,
+                           result.delivered ? (double)result.latency_sum /
+                                  result.delivered / MILLISECOND : 0.0,
+                           (double)result.latency_max / MILLISECOND,
+                           result.duration ? (double)result.bytes * SECOND /
+                                             result.duration : 0.0,
+                           segments, resent, failed, pace, queued_max,
+                           result.rx_dropped, result.rx_refused);
+                    if(result.copies != result.delivered)
+                    {
+                        fprintf(stderr, "bench: %u duplicate frames "
+                                "reached the application\n",
+                                result.copies - result.delivered);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,475 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      host_sdk.c
+ *
+ *  DESCRIPTION
+ *      Simulated clock, timers, event queue and node images for the host
+ *      build, see host_sdk.h.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "host_sdk.h"
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Timer or posted event */
+typedef struct
+{
+    /* Time the event is due */
+    uint32 due;
+
+    /* Order in which the event was queued, breaks ties */
+    uint32 seq;
+
+    /* Node the event runs on */
+    uint16 node;
+
+    /* Timer reference, TIMER_INVALID for a posted event */
+    timer_id tid;
+
+    /* Expiry callback of a timer */
+    timer_callback_arg timer_handler;
+
+    /* Handler and argument of a posted event */
+    HOST_EVENT_HANDLER_T handler;
+    void *p_arg;
+}HOST_EVENT_T;
+
+/* Saved data of a node */
+typedef struct
+{
+    char *p_data;
+    char *p_bss;
+}HOST_NODE_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Data of the node objects, see the makefile. Weak so that programs without
+ * node objects link as well.
+ */
+extern char __start_host_node_data[] __attribute__((weak));
+extern char __stop_host_node_data[] __attribute__((weak));
+extern char __start_host_node_bss[] __attribute__((weak));
+extern char __stop_host_node_bss[] __attribute__((weak));
+
+/* Simulated time in microseconds */
+static uint32 g_now;
+
+/* Pending events, unordered */
+static HOST_EVENT_T *g_events;
+static uint16 g_event_count;
+static uint16 g_event_size;
+static uint32 g_event_seq;
+
+/* Last timer reference handed out */
+static timer_id g_last_tid;
+
+/* Node images and the selected node */
+static HOST_NODE_T g_node[HOST_MAX_NODES];
+static uint16 g_node_count;
+static uint16 g_node_current = HOST_NODE_NONE;
+
+/* Node data as it was before any node ran */
+static HOST_NODE_T g_node_reset;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hostDataSize, hostBssSize
+ *
+ *  DESCRIPTION
+ *      Size of the node data and bss sections.
+ *
+ *----------------------------------------------------------------------------*/
+static size_t hostDataSize(void)
+{
+    return (size_t)(__stop_host_node_data - __start_host_node_data);
+}
+
+static size_t hostBssSize(void)
+{
+    return (size_t)(__stop_host_node_bss - __start_host_node_bss);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hostQueue
+ *
+ *  DESCRIPTION
+ *      Adds an event to the queue and returns it.
+ *
+ *----------------------------------------------------------------------------*/
+static HOST_EVENT_T *hostQueue(uint32 delay, uint16 node)
+{
+    HOST_EVENT_T *p_event;
+
+    if(g_event_count == g_event_size)
+    {
+        g_event_size = g_event_size ? g_event_size * 2 : 64;
+        g_events = realloc(g_events, g_event_size * sizeof(HOST_EVENT_T));
+        if(g_events == NULL)
+        {
+            fprintf(stderr, "host: out of memory\n");
+            exit(1);
+        }
+    }
+    p_event = &g_events[g_event_count++];
+    memset(p_event, 0, sizeof(*p_event));
+    p_event->due = g_now + delay;
+    p_event->seq = g_event_seq++;
+    p_event->node = node;
+    p_event->tid = TIMER_INVALID;
+    return p_event;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hostNextDue
+ *
+ *  DESCRIPTION
+ *      Returns the index of the earliest event, or g_event_count if the
+ *      queue is empty.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 hostNextDue(void)
+{
+    uint16 next = g_event_count;
+    uint16 i;
+
+    for(i = 0;i < g_event_count;i++)
+    {
+        if(next == g_event_count ||
+           TimeSub(g_events[i].due, g_events[next].due) < 0 ||
+           (g_events[i].due == g_events[next].due &&
+            g_events[i].seq < g_events[next].seq))
+        {
+            next = i;
+        }
+    }
+    return next;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hostRun
+ *
+ *  DESCRIPTION
+ *      Takes an event off the queue, moves the clock to it and runs it.
+ *
+ *----------------------------------------------------------------------------*/
+static void hostRun(uint16 next)
+{
+    HOST_EVENT_T event = g_events[next];
+
+    g_events[next] = g_events[--g_event_count];
+    if(TimeSub(event.due, g_now) > 0)
+    {
+        g_now = event.due;
+    }
+    if(event.node != HOST_NODE_NONE)
+    {
+        HostNodeSelect(event.node);
+    }
+    if(event.tid != TIMER_INVALID)
+    {
+        event.timer_handler(event.tid);
+    }
+    else
+    {
+        event.handler(event.p_arg);
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimeGet32, TimeGet16
+ *
+ *  DESCRIPTION
+ *      Simulated system time.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint32 TimeGet32(void)
+{
+    return g_now;
+}
+
+extern uint16 TimeGet16(void)
+{
+    return (uint16)g_now;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerCreate
+ *
+ *  DESCRIPTION
+ *      Starts a one-shot timer of the selected node.
+ *
+ *----------------------------------------------------------------------------*/
+extern timer_id TimerCreate(uint32 const time, bool const relative,
+                            timer_callback_arg handler)
+{
+    HOST_EVENT_T *p_event;
+
+    p_event = hostQueue(relative ? time : (uint32)(time - g_now),
+                        g_node_current);
+    do
+    {
+        g_last_tid++;
+    }while(g_last_tid == TIMER_INVALID);
+    p_event->tid = g_last_tid;
+    p_event->timer_handler = handler;
+    return p_event->tid;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerDelete
+ *
+ *  DESCRIPTION
+ *      Stops a timer, does nothing if it is not running.
+ *
+ *----------------------------------------------------------------------------*/
+extern void TimerDelete(timer_id const tid)
+{
+    uint16 i;
+
+    if(tid == TIMER_INVALID)
+    {
+        return;
+    }
+    for(i = 0;i < g_event_count;i++)
+    {
+        if(g_events[i].tid == tid)
+        {
+            g_events[i] = g_events[--g_event_count];
+            return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BufReadUint8, BufReadUint16, BufReadUint32
+ *
+ *  DESCRIPTION
+ *      Read a little endian value and move the buffer pointer past it, as
+ *      buf_utils.h does.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint8 BufReadUint8(uint8 **buf)
+{
+    return *(*buf)++;
+}
+
+extern uint16 BufReadUint16(uint8 **buf)
+{
+    uint16 val = BufReadUint8(buf);
+
+    return val | ((uint16)BufReadUint8(buf) << 8);
+}
+
+extern uint32 BufReadUint32(uint8 **buf)
+{
+    uint32 val = BufReadUint16(buf);
+
+    return val | ((uint32)BufReadUint16(buf) << 16);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostReset
+ *
+ *  DESCRIPTION
+ *      Sets the clock to 0 and drops all timers and events.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostReset(void)
+{
+    uint16 i;
+
+    g_now = 0;
+    g_event_count = 0;
+    g_event_seq = 0;
+    g_last_tid = TIMER_INVALID;
+    for(i = 0;i < g_node_count;i++)
+    {
+        free(g_node[i].p_data);
+        free(g_node[i].p_bss);
+    }
+    g_node_count = 0;
+    g_node_current = HOST_NODE_NONE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostPost
+ *
+ *  DESCRIPTION
+ *      Queues handler to run delay microseconds from now on node.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostPost(uint32 delay, uint16 node,
+                     HOST_EVENT_HANDLER_T handler, void *p_arg)
+{
+    HOST_EVENT_T *p_event = hostQueue(delay, node);
+
+    p_event->handler = handler;
+    p_event->p_arg = p_arg;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostRunUntil
+ *
+ *  DESCRIPTION
+ *      Runs the events due up to time, earliest first.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostRunUntil(uint32 time)
+{
+    uint16 next;
+
+    for(;;)
+    {
+        next = hostNextDue();
+        if(next == g_event_count || TimeSub(g_events[next].due, time) > 0)
+        {
+            break;
+        }
+        hostRun(next);
+    }
+    g_now = time;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostRunNext
+ *
+ *  DESCRIPTION
+ *      Runs the earliest event.
+ *
+ *----------------------------------------------------------------------------*/
+extern bool HostRunNext(void)
+{
+    uint16 next = hostNextDue();
+
+    if(next == g_event_count)
+    {
+        return FALSE;
+    }
+    hostRun(next);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostPendingCount
+ *
+ *  DESCRIPTION
+ *      Returns the number of timers and events pending.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 HostPendingCount(void)
+{
+    return g_event_count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostNodesInit
+ *
+ *  DESCRIPTION
+ *      Makes count node images from the node data as it was before any
+ *      node ran and selects node 0.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostNodesInit(uint16 count)
+{
+    uint16 i;
+
+    if(count > HOST_MAX_NODES || (count > 1 && hostDataSize() +
+                                   hostBssSize() == 0))
+    {
+        fprintf(stderr, "host: cannot simulate %u nodes\n", count);
+        exit(1);
+    }
+    if(g_node_reset.p_data == NULL)
+    {
+        g_node_reset.p_data = malloc(hostDataSize() + 1);
+        g_node_reset.p_bss = malloc(hostBssSize() + 1);
+        memcpy(g_node_reset.p_data, __start_host_node_data, hostDataSize());
+        memcpy(g_node_reset.p_bss, __start_host_node_bss, hostBssSize());
+    }
+    memcpy(__start_host_node_data, g_node_reset.p_data, hostDataSize());
+    memcpy(__start_host_node_bss, g_node_reset.p_bss, hostBssSize());
+    for(i = 0;i < count;i++)
+    {
+        g_node[i].p_data = malloc(hostDataSize() + 1);
+        g_node[i].p_bss = malloc(hostBssSize() + 1);
+        memcpy(g_node[i].p_data, __start_host_node_data, hostDataSize());
+        memcpy(g_node[i].p_bss, __start_host_node_bss, hostBssSize());
+    }
+    g_node_count = count;
+    g_node_current = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostNodeSelect
+ *
+ *  DESCRIPTION
+ *      Swaps the data of node in.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostNodeSelect(uint16 node)
+{
+    if(node == g_node_current)
+    {
+        return;
+    }
+    if(node >= g_node_count || g_node_current == HOST_NODE_NONE)
+    {
+        fprintf(stderr, "host: no node %u\n", node);
+        exit(1);
+    }
+    memcpy(g_node[g_node_current].p_data, __start_host_node_data,
+           hostDataSize());
+    memcpy(g_node[g_node_current].p_bss, __start_host_node_bss,
+           hostBssSize());
+    memcpy(__start_host_node_data, g_node[node].p_data, hostDataSize());
+    memcpy(__start_host_node_bss, g_node[node].p_bss, hostBssSize());
+    g_node_current = node;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostNodeCurrent
+ *
+ *  DESCRIPTION
+ *      Returns the selected node.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 HostNodeCurrent(void)
+{
+    return g_node_current;
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      host_sdk.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the parts of the firmware library the application
+ *      uses: a simulated microsecond clock (TimeGet32), one-shot timers
+ *      (TimerCreate, TimerDelete), the buf_utils.h readers and a queue of
+ *      events run in time order. Nothing runs on its own, the test or
+ *      benchmark advances the clock with HostRunUntil() or HostRunNext(),
+ *      so every run is repeatable.
+ *
+ *      Several nodes can run the same firmware in one process. The static
+ *      data of the node objects is linked into the host_node_data and
+ *      host_node_bss sections (see the makefile); each node keeps its own
+ *      copy and HostNodeSelect() swaps it in before code of that node runs.
+ *      Timers and events remember the node that created them.
+ *
+ *****************************************************************************/
+
+#ifndef __HOST_SDK_H__
+#define __HOST_SDK_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+#include <time.h>
+#include <timer.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Most nodes that can be simulated */
+#define HOST_MAX_NODES               (16)
+
+/* Node of code that does not belong to any node */
+#define HOST_NODE_NONE               (0xFFFF)
+
+/* Function run for a posted event, in the context of its node */
+typedef void (*HOST_EVENT_HANDLER_T)(void *p_arg);
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that sets the clock to 0 and drops all timers and events. */
+extern void HostReset(void);
+
+/* Function that runs handler with p_arg delay microseconds from now, with
+ * node selected. Events due at the same time run in the order posted.
+ */
+extern void HostPost(uint32 delay, uint16 node,
+                     HOST_EVENT_HANDLER_T handler, void *p_arg);
+
+/* Function that runs the events and timers due up to time and leaves the
+ * clock at time.
+ */
+extern void HostRunUntil(uint32 time);
+
+/* Function that moves the clock to the earliest timer or event and runs
+ * it. Returns FALSE if none is pending.
+ */
+extern bool HostRunNext(void);
+
+/* Function that returns the number of timers and events pending. */
+extern uint16 HostPendingCount(void);
+
+/* Function that makes count node images out of the node data as it was
+ * when the function was first called, before any node code ran.
+ */
+extern void HostNodesInit(uint16 count);
+
+/* Function that saves the data of the selected node and loads that of
+ * node. Code of a node may only run while it is selected.
+ */
+extern void HostNodeSelect(uint16 node);
+
+/* Function that returns the selected node, HOST_NODE_NONE before
+ * HostNodesInit().
+ */
+extern uint16 HostNodeCurrent(void);
+
+#endif /* __HOST_SDK_H__ */
@@ -0,0 +1,168 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      host_uart.c
+ *
+ *  DESCRIPTION
+ *      UART driver stand-in for the host build, see host_uart.h.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <uart.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "host_uart.h"
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Callbacks of the firmware */
+static uart_data_in_fn g_rx_handler;
+static uart_data_out_fn g_tx_handler;
+
+/* Bytes written and not yet taken */
+static uint8 g_tx[HOST_UART_TX_SIZE];
+static uint16 g_tx_len;
+
+/* TRUE while writes are refused */
+static bool g_tx_stall;
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      UartInit, UartEnable, UartConfig, UartRead
+ *
+ *  DESCRIPTION
+ *      Only the callbacks are kept, everything is received.
+ *
+ *----------------------------------------------------------------------------*/
+extern void UartInit(uart_data_in_fn data_in_clbk,
+                     uart_data_out_fn data_out_clbk,
+                     uint16* rx_buffer, uart_buf_size_bytes rx_size_bytes,
+                     uint16* tx_buffer, uart_buf_size_bytes tx_size_bytes,
+                     uart_data_mode new_data_mode)
+{
+    g_rx_handler = data_in_clbk;
+    g_tx_handler = data_out_clbk;
+}
+
+extern void UartEnable(bool enable)
+{
+}
+
+extern void UartConfig(uint16 baud_rate_enum, uint16 config)
+{
+}
+
+extern bool UartRead(uint16 length, uint32 timeout)
+{
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      UartWrite
+ *
+ *  DESCRIPTION
+ *      Collects the bytes for the test, unless writes are stalled.
+ *
+ *----------------------------------------------------------------------------*/
+extern bool UartWrite(const void *data, uint16 length)
+{
+    if(g_tx_stall)
+    {
+        return FALSE;
+    }
+    if(g_tx_len + length > HOST_UART_TX_SIZE)
+    {
+        fprintf(stderr, "host: UART output not taken\n");
+        exit(1);
+    }
+    memcpy(&g_tx[g_tx_len], data, length);
+    g_tx_len += length;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostUartReset
+ *
+ *  DESCRIPTION
+ *      Drops the bytes written and ends a stall.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostUartReset(void)
+{
+    g_tx_len = 0;
+    g_tx_stall = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostUartRx
+ *
+ *  DESCRIPTION
+ *      Passes bytes to the receive callback.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostUartRx(const uint8 *p_data, uint16 length)
+{
+    uint16 more;
+
+    if(g_rx_handler != NULL)
+    {
+        (void)g_rx_handler((void *)p_data, length, &more);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostUartTxTake
+ *
+ *  DESCRIPTION
+ *      Moves the oldest bytes written to p_data.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 HostUartTxTake(uint8 *p_data, uint16 length)
+{
+    if(length > g_tx_len)
+    {
+        length = g_tx_len;
+    }
+    memcpy(p_data, g_tx, length);
+    memmove(g_tx, &g_tx[length], g_tx_len - length);
+    g_tx_len -= length;
+    return length;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostUartTxStall
+ *
+ *  DESCRIPTION
+ *      Starts or ends refusing writes.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostUartTxStall(bool stall)
+{
+    g_tx_stall = stall;
+    if(!stall && g_tx_handler != NULL)
+    {
+        g_tx_handler();
+    }
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      host_uart.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the UART driver (UartInit, UartWrite, ...), the
+ *      Wi-Fi module side of the link for tests of uart_time.c. Bytes the
+ *      firmware writes are collected until the test takes them, bytes the
+ *      test sends are passed to the receive callback of the firmware in one
+ *      block, the way the driver hands over what it has buffered.
+ *
+ *****************************************************************************/
+
+#ifndef __HOST_UART_H__
+#define __HOST_UART_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Most bytes written and not yet taken by the test */
+#define HOST_UART_TX_SIZE            (4096)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that drops the bytes written and lets writes through again. */
+extern void HostUartReset(void);
+
+/* Function that passes bytes to the receive callback of the firmware. */
+extern void HostUartRx(const uint8 *p_data, uint16 length);
+
+/* Function that moves up to length of the bytes written, oldest first, to
+ * p_data and returns their number.
+ */
+extern uint16 HostUartTxTake(uint8 *p_data, uint16 length);
+
+/* Function that makes UartWrite() refuse all data while stall is TRUE, as
+ * it does when the transmit buffer is full. Once the stall ends the
+ * transmit callback of the firmware is run.
+ */
+extern void HostUartTxStall(bool stall);
+
+#endif /* __HOST_UART_H__ */
@@ -0,0 +1,73 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      host_typedef.h
+ *
+ *  DESCRIPTION
+ *      Host version of typedef.h, included ahead of every source by the host
+ *      makefile. typedef.h declares bit fields wider than a host byte
+ *      (count in TIME16 has 14 bits), here they are declared on unsigned
+ *      int. The TYPEDEF_H guard keeps the original from being read.
+ *
+ *****************************************************************************/
+
+#ifndef TYPEDEF_H
+#define TYPEDEF_H
+
+#include <types.h>
+
+typedef struct{
+  unsigned int fover: 1;
+  unsigned int frequest: 1;
+  unsigned int count: 14;
+}TIME16;
+
+typedef union{
+  uint16 word;
+  TIME16 time;
+}UTIME16;
+
+struct FLAG
+{
+  unsigned int bit15: 1;
+  unsigned int bit14: 1;
+  unsigned int bit13: 1;
+  unsigned int bit12: 1;
+  unsigned int bit11: 1;
+  unsigned int bit10: 1;
+  unsigned int bit9: 1;
+  unsigned int bit8: 1;
+  unsigned int bit7: 1;
+  unsigned int bit6: 1;
+  unsigned int bit5: 1;
+  unsigned int bit4: 1;
+  unsigned int bit3: 1;
+  unsigned int bit2: 1;
+  unsigned int bit1: 1;
+  unsigned int bit0: 1;
+};
+
+union FLAGS
+{
+   uint16 byte;
+   struct FLAG bit;
+};
+
+typedef struct{
+  unsigned char b7: 1;
+  unsigned char b6: 1;
+  unsigned char b5: 1;
+  unsigned char b4: 1;
+  unsigned char b3: 1;
+  unsigned char b2: 1;
+  unsigned char b1: 1;
+  unsigned char b0: 1;
+}BYTE_FIELD;
+
+typedef union{
+  unsigned char byte;
+  BYTE_FIELD bit;
+}TYPE_BYTE;
+
+#endif /* TYPEDEF_H */
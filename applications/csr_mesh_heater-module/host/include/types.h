@@ -0,0 +1,45 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      types.h
+ *
+ *  DESCRIPTION
+ *      Host replacement of the SDK types.h. It is found before the SDK
+ *      header so that the firmware sources build with gcc on Linux. uint8 is
+ *      a byte here while it is a 16 bit word on the XAP, which is why the
+ *      firmware masks bytes with 0x00FF. It has the guard of the SDK
+ *      header, so SDK headers that include "types.h" from their own
+ *      directory get this one.
+ *
+ *****************************************************************************/
+
+#ifndef TYPES_H
+#define TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+/* Declared before macros.h defines min, max and abs */
+#include <stdlib.h>
+
+typedef uint8_t         uint8;
+typedef uint16_t        uint16;
+typedef uint32_t        uint24;
+typedef uint32_t        uint32;
+typedef int8_t          int8;
+typedef int16_t         int16;
+typedef int32_t         int32;
+
+typedef unsigned int    bool;
+
+#ifndef FALSE
+#define FALSE           (0)
+#endif
+#ifndef TRUE
+#define TRUE            (1)
+#endif
+
+#include "macros.h"
+#include "status.h"
+
+#endif /* TYPES_H */
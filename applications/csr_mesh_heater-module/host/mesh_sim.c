@@ -0,0 +1,462 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_sim.c
+ *
+ *  DESCRIPTION
+ *      Simulated CSRmesh bearer and data model library, see mesh_sim.h.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*============================================================================*
+ *  CSRmesh Header Files
+ *============================================================================*/
+
+#include <csr_mesh.h>
+#include <csr_sched.h>
+#include <data_server.h>
+#include <data_client.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "mesh_sim.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Groups of a node the data model listens to */
+#define MESH_SIM_MAX_GROUPS          (8)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Data model message */
+typedef struct
+{
+    CSRMESH_MODEL_EVENT_T code;
+    uint16 src_id;
+    uint16 dest_id;
+    uint32 seq_num;
+    union
+    {
+        CSRMESH_DATA_STREAM_FLUSH_T flush;
+        CSRMESH_DATA_STREAM_SEND_T send;
+        CSRMESH_DATA_STREAM_RECEIVED_T received;
+        CSRMESH_DATA_BLOCK_SEND_T block;
+    }param;
+}MESH_SIM_MSG_T;
+
+/* Message in a scheduler transmit queue */
+typedef struct
+{
+    MESH_SIM_MSG_T msg;
+
+    /* Adverts of the message still to send */
+    uint16 repeats;
+
+    /* Nodes the message was passed to */
+    uint16 received;
+}MESH_SIM_TX_T;
+
+/* Simulated node */
+typedef struct
+{
+    /* Scheduler transmit queue */
+    MESH_SIM_TX_T queue[MESH_SIM_MAX_QUEUE];
+    uint16 head;
+    uint16 count;
+
+    /* TRUE while adverts are being sent */
+    bool advertising;
+
+    /* MCP sequence number of the next message */
+    uint32 seq_num;
+
+    /* Data model registered by the node */
+    CSRMESH_MODEL_CALLBACK_T server;
+    CSRMESH_MODEL_CALLBACK_T client;
+    uint16 groups[MESH_SIM_MAX_GROUPS];
+    uint16 num_groups;
+}MESH_SIM_NODE_T;
+
+/* Message on its way to a receiver */
+typedef struct
+{
+    MESH_SIM_MSG_T msg;
+    uint16 node;
+}MESH_SIM_RX_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static MESH_SIM_CONFIG_T g_config;
+static MESH_SIM_STATS_T g_stats;
+static MESH_SIM_NODE_T g_nodes[HOST_MAX_NODES];
+static uint16 g_node_count;
+static uint32 g_random;
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void msAdvert(void *p_arg);
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range (xorshift32).
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 msRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return (range == 0) ? 0 : g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msAddressed
+ *
+ *  DESCRIPTION
+ *      Returns TRUE if node listens to dest_id.
+ *
+ *----------------------------------------------------------------------------*/
+static bool msAddressed(uint16 node, uint16 dest_id)
+{
+    const MESH_SIM_NODE_T *p_node = &g_nodes[node];
+    uint16 i;
+
+    if(dest_id == 0 || dest_id == MESH_SIM_NODE_ID(node))
+    {
+        return TRUE;
+    }
+    for(i = 0;i < p_node->num_groups;i++)
+    {
+        if(p_node->groups[i] == dest_id)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msQueue
+ *
+ *  DESCRIPTION
+ *      Puts a message of the selected node in its scheduler transmit queue.
+ *
+ *----------------------------------------------------------------------------*/
+static CSRmeshResult msQueue(CSRMESH_MODEL_EVENT_T code, uint16 dest_id,
+                             const void *p_param, uint16 param_len)
+{
+    const uint16 node = HostNodeCurrent();
+    MESH_SIM_NODE_T *p_node = &g_nodes[node];
+    MESH_SIM_TX_T *p_tx;
+
+    if(node >= g_node_count)
+    {
+        return CSR_MESH_RESULT_FAILURE;
+    }
+    if(p_node->count >= g_config.tx_queue_size)
+    {
+        g_stats.refused++;
+        return CSR_MESH_RESULT_RADIO_BUSY;
+    }
+    p_tx = &p_node->queue[(p_node->head + p_node->count) %
+                          MESH_SIM_MAX_QUEUE];
+    p_node->count++;
+    memset(p_tx, 0, sizeof(*p_tx));
+    p_tx->msg.code = code;
+    p_tx->msg.src_id = MESH_SIM_NODE_ID(node);
+    p_tx->msg.dest_id = dest_id;
+    p_tx->msg.seq_num = p_node->seq_num++;
+    memcpy(&p_tx->msg.param, p_param, param_len);
+    p_tx->repeats = g_config.repeat_count;
+    g_stats.sent++;
+
+    if(!p_node->advertising)
+    {
+        p_node->advertising = TRUE;
+        HostPost(0, node, msAdvert, p_node);
+    }
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msDeliver
+ *
+ *  DESCRIPTION
+ *      Passes a received message to the data model of the selected node.
+ *      Stream messages are answered with DATA_STREAM_RECEIVED when the
+ *      model asks for it.
+ *
+ *----------------------------------------------------------------------------*/
+static void msDeliver(void *p_arg)
+{
+    MESH_SIM_RX_T *p_rx = (MESH_SIM_RX_T *)p_arg;
+    const MESH_SIM_NODE_T *p_node = &g_nodes[p_rx->node];
+    CSRMESH_DATA_STREAM_RECEIVED_T received;
+    CSRMESH_EVENT_DATA_T event;
+    CsrBool allow_relay = FALSE;
+    void *p_state = NULL;
+
+    memset(&event, 0, sizeof(event));
+    event.seq_num = p_rx->msg.seq_num;
+    event.src_id = p_rx->msg.src_id;
+    event.dst_id = p_rx->msg.dest_id;
+    event.rx_ttl = CSR_MESH_DEFAULT_TTL;
+    event.rsp_ttl = CSR_MESH_DEFAULT_TTL;
+    event.allow_relay = &allow_relay;
+    event.data = &p_rx->msg.param;
+
+    if(p_rx->msg.code == CSRMESH_DATA_STREAM_RECEIVED)
+    {
+        if(p_node->client != NULL)
+        {
+            p_node->client(p_rx->msg.code, &event,
+                           sizeof(CSRMESH_DATA_STREAM_RECEIVED_T), &p_state);
+        }
+    }
+    else if(p_node->server != NULL)
+    {
+        p_node->server(p_rx->msg.code, &event, 0, &p_state);
+        if(p_state != NULL && p_rx->msg.code != CSRMESH_DATA_BLOCK_SEND)
+        {
+            received.streamnesn = *(CsrUint16 *)p_state;
+            (void)msQueue(CSRMESH_DATA_STREAM_RECEIVED, p_rx->msg.src_id,
+                          &received, sizeof(received));
+        }
+    }
+    free(p_rx);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msReceive
+ *
+ *  DESCRIPTION
+ *      Schedules the delivery of a message to node.
+ *
+ *----------------------------------------------------------------------------*/
+static void msReceive(const MESH_SIM_MSG_T *p_msg, uint16 node, uint32 delay)
+{
+    MESH_SIM_RX_T *p_rx = malloc(sizeof(MESH_SIM_RX_T));
+
+    if(p_rx == NULL)
+    {
+        fprintf(stderr, "mesh_sim: out of memory\n");
+        exit(1);
+    }
+    p_rx->msg = *p_msg;
+    p_rx->node = node;
+    HostPost(delay, node, msDeliver, p_rx);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      msAdvert
+ *
+ *  DESCRIPTION
+ *      Sends one advert of the message at the head of a node's transmit
+ *      queue and schedules the next advert.
+ *
+ *----------------------------------------------------------------------------*/
+static void msAdvert(void *p_arg)
+{
+    MESH_SIM_NODE_T *p_node = (MESH_SIM_NODE_T *)p_arg;
+    const uint16 sender = (uint16)(p_node - g_nodes);
+    MESH_SIM_TX_T *p_tx = &p_node->queue[p_node->head];
+    uint16 node;
+    uint32 delay;
+
+    g_stats.adverts++;
+    for(node = 0;node < g_node_count;node++)
+    {
+        if(node == sender || !msAddressed(node, p_tx->msg.dest_id) ||
+           (p_tx->received & (1 << node)) != 0 ||
+           msRandom(100) < g_config.loss)
+        {
+            continue;
+        }
+        p_tx->received |= (1 << node);
+        delay = g_config.latency + msRandom(g_config.jitter + 1);
+        msReceive(&p_tx->msg, node, delay);
+        g_stats.received++;
+        if(msRandom(100) < g_config.duplicate)
+        {
+            msReceive(&p_tx->msg, node,
+                      delay + g_config.adv_interval +
+                      msRandom(g_config.jitter + 1));
+            g_stats.received++;
+            g_stats.duplicated++;
+        }
+    }
+
+    if(--p_tx->repeats == 0)
+    {
+        for(node = 0;node < g_node_count;node++)
+        {
+            if(node != sender && msAddressed(node, p_tx->msg.dest_id) &&
+               (p_tx->received & (1 << node)) == 0)
+            {
+                g_stats.lost++;
+            }
+        }
+        p_node->head = (p_node->head + 1) % MESH_SIM_MAX_QUEUE;
+        p_node->count--;
+    }
+    if(p_node->count == 0)
+    {
+        p_node->advertising = FALSE;
+        return;
+    }
+    HostPost(g_config.adv_interval, HOST_NODE_NONE, msAdvert, p_node);
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MSInit
+ *
+ *  DESCRIPTION
+ *      Resets the host and the bearer and makes the nodes.
+ *
+ *----------------------------------------------------------------------------*/
+extern void MSInit(const MESH_SIM_CONFIG_T *p_config, uint16 node_count)
+{
+    HostReset();
+    g_config = *p_config;
+    if(g_config.tx_queue_size == 0 ||
+       g_config.tx_queue_size > MESH_SIM_MAX_QUEUE)
+    {
+        g_config.tx_queue_size = MESH_SIM_MAX_QUEUE;
+    }
+    if(g_config.repeat_count == 0)
+    {
+        g_config.repeat_count = 1;
+    }
+    g_random = (g_config.seed != 0) ? g_config.seed : 1;
+    memset(&g_stats, 0, sizeof(g_stats));
+    memset(g_nodes, 0, sizeof(g_nodes));
+    g_node_count = node_count;
+    HostNodesInit(node_count);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MSGetStats
+ *
+ *  DESCRIPTION
+ *      Returns the bearer counters.
+ *
+ *----------------------------------------------------------------------------*/
+extern void MSGetStats(MESH_SIM_STATS_T *p_stats)
+{
+    *p_stats = g_stats;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DataModelInit, DataModelClientInit
+ *
+ *  DESCRIPTION
+ *      Register the data model server and client of the selected node.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult DataModelInit(CsrUint8 nw_id, CsrUint16 *group_id_list,
+                                   CsrUint16 num_groups,
+                                   CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    MESH_SIM_NODE_T *p_node;
+
+    if(HostNodeCurrent() >= g_node_count || num_groups > MESH_SIM_MAX_GROUPS)
+    {
+        return CSR_MESH_RESULT_FAILURE;
+    }
+    p_node = &g_nodes[HostNodeCurrent()];
+    p_node->server = app_callback;
+    memcpy(p_node->groups, group_id_list, num_groups * sizeof(uint16));
+    p_node->num_groups = num_groups;
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+extern CSRmeshResult DataModelClientInit(CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    if(HostNodeCurrent() >= g_node_count)
+    {
+        return CSR_MESH_RESULT_FAILURE;
+    }
+    g_nodes[HostNodeCurrent()].client = app_callback;
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DataStreamFlush, DataStreamSend, DataBlockSend
+ *
+ *  DESCRIPTION
+ *      Queue a data model message of the selected node.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult DataStreamFlush(CsrUint8 nw_id, CsrUint16 dest_id,
+                                     CsrUint8 ttl,
+                                     CSRMESH_DATA_STREAM_FLUSH_T *p_params)
+{
+    return msQueue(CSRMESH_DATA_STREAM_FLUSH, dest_id, p_params,
+                   sizeof(*p_params));
+}
+
+extern CSRmeshResult DataStreamSend(CsrUint8 nw_id, CsrUint16 dest_id,
+                                    CsrUint8 ttl,
+                                    CSRMESH_DATA_STREAM_SEND_T *p_params)
+{
+    return msQueue(CSRMESH_DATA_STREAM_SEND, dest_id, p_params,
+                   sizeof(*p_params));
+}
+
+extern CSRmeshResult DataBlockSend(CsrUint8 nw_id, CsrUint16 dest_id,
+                                   CsrUint8 ttl,
+                                   CSRMESH_DATA_BLOCK_SEND_T *p_params)
+{
+    return msQueue(CSRMESH_DATA_BLOCK_SEND, dest_id, p_params,
+                   sizeof(*p_params));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CSRSchedGetConfigParams
+ *
+ *  DESCRIPTION
+ *      Returns the simulated scheduler settings.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRSchedResult CSRSchedGetConfigParams(CSR_SCHED_LE_PARAMS_T *le_params)
+{
+    memset(le_params, 0, sizeof(*le_params));
+    le_params->mesh_le_param.is_le_bearer_ready = TRUE;
+    le_params->mesh_le_param.tx_param.tx_queue_size =
+                                          (CsrUint8)g_config.tx_queue_size;
+    le_params->mesh_le_param.tx_param.device_repeat_count =
+                                          (CsrUint8)g_config.repeat_count;
+    le_params->generic_le_param.advertising_interval = g_config.adv_interval;
+    return CSR_SCHED_RESULT_SUCCESS;
+}
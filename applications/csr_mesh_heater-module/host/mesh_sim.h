@@ -0,0 +1,104 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_sim.h
+ *
+ *  DESCRIPTION
+ *      Simulated CSRmesh bearer for the host build. It takes the place of
+ *      the data model of the CSRmesh library (DataModelInit, DataBlockSend,
+ *      DataStreamSend, DataStreamFlush) and of CSRSchedGetConfigParams.
+ *
+ *      Each node has a scheduler transmit queue of tx_queue_size messages.
+ *      A send is refused when the queue is full. The message at the head of
+ *      the queue is advertised repeat_count times, one advert every
+ *      adv_interval, and then leaves the queue. Every node in range receives
+ *      each advert with probability 100 - loss percent, latency plus up to
+ *      jitter microseconds after it was sent; like the CSRmesh stack it
+ *      passes a message to the model once however many of its adverts
+ *      arrive. With probability duplicate percent a received message is
+ *      passed on a second time, as a relayed copy would be. All nodes are
+ *      in range of each other and nothing is relayed.
+ *
+ *      The random numbers come from a generator seeded from the
+ *      configuration, so a run can be repeated exactly.
+ *
+ *****************************************************************************/
+
+#ifndef __MESH_SIM_H__
+#define __MESH_SIM_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "host_sdk.h"
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Longest scheduler transmit queue that can be simulated */
+#define MESH_SIM_MAX_QUEUE           (32)
+
+/* Device ID of simulated node n */
+#define MESH_SIM_NODE_ID(n)          ((uint16)(0x8001 + (n)))
+
+/* Bearer settings */
+typedef struct
+{
+    /* Time from an advert to its reception, and random extra time */
+    uint32 latency;
+    uint32 jitter;
+
+    /* Percentage of adverts each receiver misses */
+    uint16 loss;
+
+    /* Percentage of received messages passed on twice */
+    uint16 duplicate;
+
+    /* Seed of the random numbers */
+    uint32 seed;
+
+    /* Scheduler settings, see CSR_SCHED_LE_PARAMS_T */
+    uint16 tx_queue_size;
+    uint16 repeat_count;
+    uint32 adv_interval;
+}MESH_SIM_CONFIG_T;
+
+/* Bearer counters */
+typedef struct
+{
+    /* Messages queued and refused because the queue was full */
+    uint32 sent;
+    uint32 refused;
+
+    /* Adverts sent */
+    uint32 adverts;
+
+    /* Messages passed to a receiver, copies among them, and messages one
+     * of their receivers never got
+     */
+    uint32 received;
+    uint32 duplicated;
+    uint32 lost;
+}MESH_SIM_STATS_T;
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that resets the host and makes node_count nodes out of the
+ * current node data, node 0 selected. The data model of each node is
+ * registered when its code calls DataModelInit() and DataModelClientInit().
+ */
+extern void MSInit(const MESH_SIM_CONFIG_T *p_config, uint16 node_count);
+
+/* Function that returns the bearer counters. */
+extern void MSGetStats(MESH_SIM_STATS_T *p_stats);
+
+#endif /* __MESH_SIM_H__ */
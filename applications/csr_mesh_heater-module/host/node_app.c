@@ -0,0 +1,161 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      node_app.c
+ *
+ *  DESCRIPTION
+ *      Application side of a simulated node, see node_app.h. It is linked
+ *      into the node objects, so each node has its own copy of the data.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <time.h>
+#include <timer.h>
+/*============================================================================*
+ *  CSRmesh Header Files
+ *============================================================================*/
+
+#include <csr_mesh.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "label.h"
+#include "define.h"
+#include "msg_cache.h"
+#include "mesh_delta.h"
+#include "data_model_handler.h"
+#include "node_app.h"
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+/* Globals the data model handler shares with the application, see
+ * label.h
+ */
+uint8 BLE_RX_DATA[MESH_DATA_MAX_LENGTH];
+uint16 RX_MESH_ID;
+uint8 Rx_MessageID;
+uint8 MeshNowBuffer;
+volatile union FLAGS flag5;
+volatile union FLAGS flag7;
+volatile union FLAGS flag9;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Timer standing in for TM_MESH_FINISH_DATA_WAIT */
+static timer_id finish_wait_tid = TIMER_INVALID;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nodeAppFinishWait
+ *
+ *  DESCRIPTION
+ *      End of the wait after a frame was passed to the application, as
+ *      handled by appTickHandler() in main_app.c.
+ *
+ *----------------------------------------------------------------------------*/
+static void nodeAppFinishWait(timer_id tid)
+{
+    if(tid == finish_wait_tid)
+    {
+        finish_wait_tid = TIMER_INVALID;
+        f_Block_Buffer_Empty = ON;
+        DataBlockRxDeliver();
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AEPost
+ *
+ *  DESCRIPTION
+ *      Passes the event straight to the program.
+ *
+ *----------------------------------------------------------------------------*/
+extern bool AEPost(APP_EVENT_ID_T id, uint16 arg)
+{
+    HostAppEvent(id, arg);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWStart
+ *
+ *  DESCRIPTION
+ *      Only TM_MESH_FINISH_DATA_WAIT has an effect on the data model, the
+ *      other timers are not simulated.
+ *
+ *----------------------------------------------------------------------------*/
+extern void TWStart(TW_TIMER_ID_T id, uint32 ticks)
+{
+    if(id == TM_MESH_FINISH_DATA_WAIT)
+    {
+        TimerDelete(finish_wait_tid);
+        finish_wait_tid = TimerCreate(ticks * TW_TICK_MS * MILLISECOND, TRUE,
+                                      nodeAppFinishWait);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppGetCurrentTTL
+ *
+ *  DESCRIPTION
+ *      TTL of the messages sent, not used by the simulated bearer.
+ *
+ *----------------------------------------------------------------------------*/
+extern uint8 AppGetCurrentTTL(void)
+{
+    return DEFAULT_TTL_VALUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NodeAppInit
+ *
+ *  DESCRIPTION
+ *      Initialises the selected node the way srf_init() and the mesh
+ *      start-up of main_app.c do.
+ *
+ *----------------------------------------------------------------------------*/
+extern void NodeAppInit(uint16 groups[], uint16 num_groups)
+{
+    MCInit();
+#ifdef ENABLE_MESH_DELTA
+    MDInit();
+#endif /* ENABLE_MESH_DELTA */
+    finish_wait_tid = TIMER_INVALID;
+    f_Block_Buffer_Empty = ON;
+    DataModelHandlerInit(CSR_MESH_DEFAULT_NETID, groups, num_groups);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NodeAppRxFrame
+ *
+ *  DESCRIPTION
+ *      Returns BLE_RX_DATA and RX_MESH_ID of the selected node.
+ *
+ *----------------------------------------------------------------------------*/
+extern const uint8 *NodeAppRxFrame(uint16 *p_src_id)
+{
+    if(p_src_id != NULL)
+    {
+        *p_src_id = RX_MESH_ID;
+    }
+    return BLE_RX_DATA;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      node_app.h
+ *
+ *  DESCRIPTION
+ *      The part of the application a simulated node runs around the data
+ *      model handler: the globals the handler shares with main_app.c, the
+ *      application event and timer wheel calls it makes, and the 100 ms
+ *      wait after which main_app.c takes the next reassembled frame.
+ *
+ *****************************************************************************/
+
+#ifndef __NODE_APP_H__
+#define __NODE_APP_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_event.h"
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that initialises the application state and the data model
+ * handler of the selected node, listening to num_groups groups.
+ */
+extern void NodeAppInit(uint16 groups[], uint16 num_groups);
+
+/* Function that returns the frame last passed to the application of the
+ * selected node (BLE_RX_DATA) and its sender.
+ */
+extern const uint8 *NodeAppRxFrame(uint16 *p_src_id);
+
+/* Function the program provides, called for every event the selected node
+ * posts with AEPost().
+ */
+extern void HostAppEvent(APP_EVENT_ID_T id, uint16 arg);
+
+#endif /* __NODE_APP_H__ */
@@ -0,0 +1,618 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_action_heap.c
+ *
+ *  DESCRIPTION
+ *      Random test of the action table of action_model_handler.c: the
+ *      action ID lookup, the free slot list and the expiry heap. Actions
+ *      are added, replaced and deleted, the time is synced forwards and the
+ *      action timer is run, in random order, and after every step the table
+ *      is checked against a plain model of the actions:
+ *
+ *          - the heap is ordered and every action knows its heap position
+ *          - every stored action has the fire time the model expects and
+ *            is found by its ID, the free list holds the other slots
+ *          - actions are sent exactly when they are due, in time order,
+ *            and none is left in the heap past its fire time
+ *
+ *      The handler source is included so its private data can be checked.
+ *      NVM is not simulated: the handler counts NVM lengths with sizeof,
+ *      which is in words on the XAP and in bytes on the host.
+ *
+ *      test_action_heap [-n steps] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "host_sdk.h"
+#include "action_model_handler.c"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Reference time the test starts at, in seconds */
+#define TEST_START_TIME              (100000UL)
+
+/* Target device of the message of an action, tells the actions apart */
+#define TEST_TARGET_ID(id)           ((uint16)(0x8100 + (id)))
+
+/* Action IDs most test steps use, a few more than there are slots as far as
+ * the 5 bit IDs allow
+ */
+#if (MAX_ACTIONS_SUPPORTED + 2 < ACTION_ID_MAX)
+#define TEST_ACTION_IDS              (MAX_ACTIONS_SUPPORTED + 2)
+#else
+#define TEST_ACTION_IDS              (ACTION_ID_MAX)
+#endif
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Model of an action */
+typedef struct
+{
+    bool stored;
+    uint32 start_time;
+    uint32 repeat_time;
+    uint16 num_repeats;
+    uint32 next_fire_time;
+}TEST_ACTION_T;
+
+/* Counters of a run */
+typedef struct
+{
+    uint32 added;
+    uint32 refused;
+    uint32 deleted;
+    uint32 synced;
+    uint32 sent;
+}TEST_STATS_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static TEST_ACTION_T g_model[ACTION_ID_MAX];
+static TEST_STATS_T g_stats;
+static uint16 g_errors;
+static uint32 g_random;
+
+/* Reference time is TEST_START_TIME plus the time synced forwards plus
+ * the simulated time passed
+ */
+static uint32 g_synced;
+static uint32 g_seconds;
+static uint32 g_micros;
+static uint32 g_last_clock;
+
+/* Time the last action was sent */
+static uint32 g_last_sent;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_action_heap: ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testActionId
+ *
+ *  DESCRIPTION
+ *      Returns a random action ID. Most are from TEST_ACTION_IDS, so that
+ *      the table is often full.
+ *
+ *----------------------------------------------------------------------------*/
+static uint8 testActionId(void)
+{
+    return (uint8)testRandom(testRandom(4) ? TEST_ACTION_IDS : ACTION_ID_MAX);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testNow
+ *
+ *  DESCRIPTION
+ *      Returns the reference time in seconds. The simulated clock wraps
+ *      after 71 minutes, so it is read at least that often.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testNow(void)
+{
+    uint32 clock = TimeGet32();
+
+    g_micros += clock - g_last_clock;
+    g_last_clock = clock;
+    while(g_micros >= SECOND)
+    {
+        g_micros -= SECOND;
+        g_seconds++;
+    }
+    return TEST_START_TIME + g_synced + g_seconds;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testNextFireTime
+ *
+ *  DESCRIPTION
+ *      Time a modelled action is due next after now.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testNextFireTime(const TEST_ACTION_T *p_action, uint32 now)
+{
+    if(p_action->start_time > now)
+    {
+        return p_action->start_time;
+    }
+    if(p_action->repeat_time != 0)
+    {
+        return p_action->start_time + ((now - p_action->start_time) /
+                        p_action->repeat_time + 1) * p_action->repeat_time;
+    }
+    return ACTION_TIME_NONE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testAdd
+ *
+ *  DESCRIPTION
+ *      Passes a set action message to the handler, the way
+ *      actionModelEventHandler() does once all its parts arrived.
+ *
+ *----------------------------------------------------------------------------*/
+static void testAdd(uint8 action_id, uint8 time_type, uint32 start_time,
+                    uint32 repeat_time, uint16 num_repeats)
+{
+    uint8 *p = action_hdlr_priv_data.pkt_assembly;
+    TEST_ACTION_T *p_action = &g_model[action_id];
+    bool repeats = (time_type == 0x03 || time_type == 0x05);
+    uint32 now = testNow();
+    uint8 index;
+
+    *p++ = ACTION_TYPE_MCP;
+    *p++ = 2;
+    *p++ = TEST_TARGET_ID(action_id) & 0xFF;
+    *p++ = TEST_TARGET_ID(action_id) >> 8;
+    *p++ = action_id;
+    *p++ = 0xA5;
+    *p++ = time_type;
+    *p++ = start_time & 0xFF;
+    *p++ = (start_time >> 8) & 0xFF;
+    *p++ = (start_time >> 16) & 0xFF;
+    *p++ = start_time >> 24;
+    if(repeats)
+    {
+        *p++ = repeat_time & 0xFF;
+        *p++ = (repeat_time >> 8) & 0xFF;
+        *p++ = (repeat_time >> 16) & 0xFF;
+        *p++ = num_repeats & 0xFF;
+        *p++ = num_repeats >> 8;
+    }
+    action_hdlr_priv_data.assembly_action_id = action_id;
+
+    index = getActionIdIndex(action_id);
+    decodeActionPktRecvd(action_id);
+    if(index == ACTION_INDEX_INVALID)
+    {
+        g_stats.refused++;
+        if(p_action->stored ||
+           action_hdlr_priv_data.free_count != 0)
+        {
+            testError("action %u refused with a free slot", action_id);
+        }
+        return;
+    }
+
+    g_stats.added++;
+    p_action->stored = TRUE;
+    p_action->start_time = start_time;
+    if(time_type == 0x04 || time_type == 0x05)
+    {
+        p_action->start_time += now;
+    }
+    p_action->repeat_time = repeats ? repeat_time : 0;
+    p_action->num_repeats = repeats ? num_repeats : 0;
+    p_action->next_fire_time = testNextFireTime(p_action, now);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testDelete
+ *
+ *  DESCRIPTION
+ *      Deletes the actions of a bitmask.
+ *
+ *----------------------------------------------------------------------------*/
+static void testDelete(uint32 actions_bitmask)
+{
+    uint8 action_id;
+
+    deleteActions(actions_bitmask);
+    for(action_id = 0; action_id < ACTION_ID_MAX; action_id++)
+    {
+        if((actions_bitmask & ((uint32)1 << action_id)) &&
+           g_model[action_id].stored)
+        {
+            g_model[action_id].stored = FALSE;
+            g_stats.deleted++;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSync
+ *
+ *  DESCRIPTION
+ *      Moves the time forwards by seconds and syncs the handler to it.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSync(uint32 seconds)
+{
+    TEST_ACTION_T *p_action;
+    uint8 current_time[6];
+    int8 timezone;
+    uint32 now;
+
+    g_synced += seconds;
+    now = testNow();
+    (void)TimeModelGetUTC(current_time, &timezone);
+    ActionModelSyncCurrentTime(current_time);
+    g_stats.synced++;
+
+    for(p_action = g_model; p_action < &g_model[ACTION_ID_MAX]; p_action++)
+    {
+        if(p_action->stored)
+        {
+            if(p_action->repeat_time == 0 && now > p_action->start_time)
+            {
+                p_action->stored = FALSE;
+            }
+            else
+            {
+                p_action->next_fire_time = testNextFireTime(p_action, now);
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCheck
+ *
+ *  DESCRIPTION
+ *      Checks the action table against the model.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCheck(void)
+{
+    ACTION_HANDLER_DATA_T *p_data = &action_hdlr_priv_data;
+    bool is_free[MAX_ACTIONS_SUPPORTED];
+    uint8 stored = 0, scheduled = 0;
+    uint8 action_id, index, pos;
+    uint32 now = testNow();
+
+    for(pos = 0; pos < p_data->heap_count; pos++)
+    {
+        if(pos > 0 && actionHeapFireTime((pos - 1) / 2) >
+                      actionHeapFireTime(pos))
+        {
+            testError("heap out of order at %u", pos);
+        }
+        if(p_data->actions[p_data->heap[pos]].heap_pos != pos)
+        {
+            testError("heap position %u of slot %u wrong", pos,
+                      p_data->heap[pos]);
+        }
+    }
+
+    for(action_id = 0; action_id < ACTION_ID_MAX; action_id++)
+    {
+        const TEST_ACTION_T *p_action = &g_model[action_id];
+
+        index = p_data->id_index[action_id];
+        if(((p_data->id_bitmask >> action_id) & 1) != p_action->stored)
+        {
+            testError("action %u wrongly in the bitmask", action_id);
+        }
+        if(!p_action->stored)
+        {
+            if(index != ACTION_INDEX_INVALID)
+            {
+                testError("deleted action %u still found", action_id);
+            }
+            continue;
+        }
+        stored++;
+        if(index >= MAX_ACTIONS_SUPPORTED ||
+           p_data->actions[index].action_id != action_id)
+        {
+            testError("action %u not found", action_id);
+            continue;
+        }
+        if(p_data->actions[index].next_fire_time != p_action->next_fire_time)
+        {
+            testError("action %u due at %lu, expected %lu", action_id,
+                      (unsigned long)p_data->actions[index].next_fire_time,
+                      (unsigned long)p_action->next_fire_time);
+        }
+        if(p_action->next_fire_time != ACTION_TIME_NONE)
+        {
+            scheduled++;
+            if(p_action->next_fire_time <= now)
+            {
+                testError("action %u not sent at %lu", action_id,
+                          (unsigned long)p_action->next_fire_time);
+            }
+        }
+    }
+    if(scheduled != p_data->heap_count)
+    {
+        testError("%u actions in the heap, expected %u", p_data->heap_count,
+                  scheduled);
+    }
+
+    if(p_data->free_count != MAX_ACTIONS_SUPPORTED - stored)
+    {
+        testError("%u free slots, expected %u", p_data->free_count,
+                  MAX_ACTIONS_SUPPORTED - stored);
+    }
+    for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+    {
+        is_free[index] = FALSE;
+    }
+    for(pos = 0; pos < p_data->free_count && pos < MAX_ACTIONS_SUPPORTED;
+        pos++)
+    {
+        index = p_data->free_index[pos];
+        if(index >= MAX_ACTIONS_SUPPORTED || is_free[index] ||
+           p_data->actions[index].action_id != ACTION_ID_INVALID)
+        {
+            testError("free slot %u not free", index);
+            continue;
+        }
+        is_free[index] = TRUE;
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ActionSendMessage
+ *
+ *  DESCRIPTION
+ *      Checks that the action sent is due and moves its model on, the way
+ *      nextActionTimerHandler() should.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult ActionSendMessage(CsrUint8 nw_id, CsrUint16 dest_id,
+                                       CsrUint8 ttl, CsrUint8 *msg,
+                                       CsrUint8 len)
+{
+    uint8 action_id = (uint8)(dest_id - TEST_TARGET_ID(0));
+    TEST_ACTION_T *p_action;
+    uint32 now = testNow();
+
+    g_stats.sent++;
+    if(action_id >= ACTION_ID_MAX || len != 2 || msg[0] != action_id)
+    {
+        testError("message of no action sent to 0x%04x", dest_id);
+        return CSR_MESH_RESULT_SUCCESS;
+    }
+    p_action = &g_model[action_id];
+    if(!p_action->stored || p_action->next_fire_time != now)
+    {
+        testError("action %u sent at %lu, due at %lu", action_id,
+                  (unsigned long)now,
+                  (unsigned long)p_action->next_fire_time);
+    }
+    if(now < g_last_sent)
+    {
+        testError("action %u sent after a later one", action_id);
+    }
+    g_last_sent = now;
+
+    if(p_action->repeat_time == 0 ||
+       (p_action->num_repeats != ACTION_REPEAT_FOREVER &&
+        (now - p_action->start_time) / p_action->repeat_time >
+                                                    p_action->num_repeats))
+    {
+        p_action->stored = FALSE;
+    }
+    else
+    {
+        p_action->next_fire_time = testNextFireTime(p_action, now);
+    }
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimeModelGetUTC
+ *
+ *  DESCRIPTION
+ *      Returns the reference time as a UTC time in milliseconds.
+ *
+ *----------------------------------------------------------------------------*/
+extern bool TimeModelGetUTC(uint8 current_time[], CsrInt8 *timezone)
+{
+    /* 1st jan 2015, as in getCurrentRefTime() */
+    static const uint8 ref_time[] = {0x40, 0x90, 0x9C, 0xA1, 0x4A, 0x01};
+    unsigned long long millis = 0;
+    uint8 index;
+
+    for(index = 6; index > 0; index--)
+    {
+        millis = (millis << 8) | ref_time[index - 1];
+    }
+    millis += (unsigned long long)testNow() * 1000;
+    for(index = 0; index < 6; index++)
+    {
+        current_time[index] = millis & 0xFF;
+        millis >>= 8;
+    }
+    *timezone = 0;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ActionModelInit, AppGetCurrentTTL, Nvm_Read, Nvm_Write
+ *
+ *  DESCRIPTION
+ *      Not used by the test. NVM reads as erased; the handler reads with
+ *      sizeof only, so length is in bytes here.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult ActionModelInit(CsrUint8 nw_id, CsrUint16 *group_id_list,
+                                     CsrUint16 num_groups,
+                                     CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+extern uint8 AppGetCurrentTTL(void)
+{
+    return DEFAULT_TTL_VALUE;
+}
+
+extern void Nvm_Read(uint16* buffer, uint16 length, uint16 offset)
+{
+    memset(buffer, 0xFF, length);
+}
+
+extern void Nvm_Write(uint16* buffer, uint16 length, uint16 offset)
+{
+}
+
+int main(int argc, char *argv[])
+{
+    uint32 steps = 300000, step, r;
+    uint32 seed = 1;
+    uint32 now, start_time, repeat_time;
+    uint16 num_repeats;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': steps = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n steps] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    HostReset();
+    ActionModelDataInit();
+    testSync(0);
+
+    for(step = 0; step < steps && g_errors < TEST_MAX_ERRORS; step++)
+    {
+        now = testNow();
+        r = testRandom(20);
+        if(r < 8)
+        {
+            /* Absolute start times from a little in the past, relative
+             * ones from now
+             */
+            start_time = testRandom(8) ? testRandom(200) : 0 - testRandom(50);
+            repeat_time = 1 + testRandom(50);
+            num_repeats = testRandom(2) ? ACTION_REPEAT_FOREVER : testRandom(5);
+            switch(testRandom(4))
+            {
+                case 0:
+                    testAdd(testActionId(), 0x02, now + start_time, 0, 0);
+                    break;
+                case 1:
+                    testAdd(testActionId(), 0x03, now + start_time,
+                            repeat_time, num_repeats);
+                    break;
+                case 2:
+                    testAdd(testActionId(), 0x04, testRandom(200), 0, 0);
+                    break;
+                default:
+                    testAdd(testActionId(), 0x05, testRandom(200),
+                            repeat_time, num_repeats);
+                    break;
+            }
+        }
+        else if(r < 10)
+        {
+            testDelete(testRandom(4) ? (uint32)1 << testActionId()
+                                     : g_random);
+        }
+        else if(r == 10 && testRandom(10) == 0)
+        {
+            testSync(testRandom(500));
+        }
+        else
+        {
+            (void)HostRunNext();
+        }
+        testCheck();
+    }
+
+    printf("action heap, %u slots: %lu steps, %lu added, %lu refused, "
+           "%lu deleted, %lu synced, %lu sent, %u errors\n",
+           MAX_ACTIONS_SUPPORTED, (unsigned long)step,
+           (unsigned long)g_stats.added, (unsigned long)g_stats.refused,
+           (unsigned long)g_stats.deleted, (unsigned long)g_stats.synced,
+           (unsigned long)g_stats.sent, g_errors);
+    return g_errors ? 1 : 0;
+}
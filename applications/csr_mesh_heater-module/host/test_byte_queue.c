@@ -0,0 +1,763 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_byte_queue.c
+ *
+ *  DESCRIPTION
+ *      Test of byte_queue.c. A few fixed cases check the span and poke
+ *      access where the ring wraps, then random steps queue, force, pop,
+ *      peek, poke and read and write through spans, checked after every
+ *      step against a plain FIFO of the same capacity. The steps run far
+ *      enough for the free running head and tail indexes to wrap as well.
+ *
+ *      With -b it is instead a throughput benchmark of the queue against the
+ *      queue it replaced, a copy of which is kept here: frames of a few
+ *      lengths are queued and popped again, by the old queue, by the new
+ *      one and by the new one through its write and read spans, and the
+ *      bytes each moves per second are printed side by side.
+ *
+ *      test_byte_queue [-b] [-n steps] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include <mem.h>
+#include "byte_queue.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Queue under test */
+#define TEST_QUEUE                   (RECV_QUEUE_ID)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+
+/* Bytes each queue moves per frame length in the benchmark */
+#define BENCH_BYTES                  (16UL * 1024 * 1024)
+
+/* Size and queue IDs of the old queue, which had a send queue as well */
+#define OLD_BUFFER_SIZE              (256)
+#define OLD_BUFFER_LEN               (OLD_BUFFER_SIZE - 1)
+#define OLD_SEND_QUEUE_ID            (0)
+#define OLD_RECV_QUEUE_ID            (1)
+
+/* Length of data held in and free space left in the old queue */
+#define OLD_QUEUE_LENGTH(id) \
+  ((g_old_queue[id].g_tail >= g_old_queue[id].g_head) ? \
+  g_old_queue[id].g_tail - g_old_queue[id].g_head \
+  : OLD_BUFFER_SIZE - g_old_queue[id].g_head + g_old_queue[id].g_tail)
+
+#define OLD_QUEUE_FREE(id) \
+  ((g_old_queue[id].g_tail >= g_old_queue[id].g_head) ? \
+  OLD_BUFFER_LEN - g_old_queue[id].g_tail + g_old_queue[id].g_head \
+  : g_old_queue[id].g_head - g_old_queue[id].g_tail - 1)
+
+/* Public functions of the old queue are neither inlined nor specialised */
+#define OLD_API                      __attribute__((noipa))
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Indexes of a queue of the old byte_queue.c */
+typedef struct
+{
+    uint16 g_head;
+    uint16 g_peek;
+    uint16 g_tail;
+}OLD_QUEUE_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Model of the queue, oldest byte first */
+static uint8 g_model[RECV_QUEUE_SIZE];
+static uint16 g_model_len;
+
+/* Next byte value to queue */
+static uint8 g_next_byte;
+
+static uint16 g_errors;
+static uint32 g_random;
+
+/* Queues and buffers of the old byte_queue.c */
+static OLD_QUEUE_T g_old_queue[2];
+static uint8 g_old_send_queue[OLD_BUFFER_SIZE];
+static uint8 g_old_recv_queue[OLD_BUFFER_SIZE];
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_byte_queue: ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testMakeData
+ *
+ *  DESCRIPTION
+ *      Fills p_data with the next len byte values.
+ *
+ *----------------------------------------------------------------------------*/
+static void testMakeData(uint8 *p_data, uint16 len)
+{
+    while(len-- > 0)
+    {
+        *p_data++ = g_next_byte++;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testModelPush, testModelPop
+ *
+ *  DESCRIPTION
+ *      Add data to the tail of the model, dropping the oldest bytes when it
+ *      is full, and remove data from its head.
+ *
+ *----------------------------------------------------------------------------*/
+static void testModelPush(const uint8 *p_data, uint16 len)
+{
+    uint16 drop;
+
+    if(len > RECV_QUEUE_SIZE)
+    {
+        p_data += len - RECV_QUEUE_SIZE;
+        len = RECV_QUEUE_SIZE;
+    }
+    if(g_model_len + len > RECV_QUEUE_SIZE)
+    {
+        drop = g_model_len + len - RECV_QUEUE_SIZE;
+        memmove(g_model, g_model + drop, g_model_len - drop);
+        g_model_len -= drop;
+    }
+    memcpy(g_model + g_model_len, p_data, len);
+    g_model_len += len;
+}
+
+static void testModelPop(uint16 len)
+{
+    memmove(g_model, g_model + len, g_model_len - len);
+    g_model_len -= len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCheckData
+ *
+ *  DESCRIPTION
+ *      Checks data read from the queue against the model, from offset on.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCheckData(const char *p_what, const uint8 *p_data,
+                          uint16 offset, uint16 len)
+{
+    if(offset + len > g_model_len ||
+       memcmp(p_data, g_model + offset, len) != 0)
+    {
+        testError("%s: %u bytes at %u differ from the model", p_what, len,
+                  offset);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCheck
+ *
+ *  DESCRIPTION
+ *      Checks the queue sizes and its whole content against the model,
+ *      without changing the queue.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCheck(void)
+{
+    uint8 data[RECV_QUEUE_SIZE];
+    uint16 len;
+
+    if(BQGetBufferCapacity(TEST_QUEUE) != RECV_QUEUE_SIZE ||
+       BQGetDataSize(TEST_QUEUE) != g_model_len ||
+       BQGetAvailableSize(TEST_QUEUE) != RECV_QUEUE_SIZE - g_model_len)
+    {
+        testError("%u bytes queued and %u free, expected %u",
+                  BQGetDataSize(TEST_QUEUE), BQGetAvailableSize(TEST_QUEUE),
+                  g_model_len);
+        return;
+    }
+    len = BQPeekBytes(data, sizeof(data), TEST_QUEUE);
+    if(len != g_model_len)
+    {
+        testError("peeked %u bytes of %u", len, g_model_len);
+    }
+    testCheckData("peek", data, 0, len);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testWrapCases
+ *
+ *  DESCRIPTION
+ *      Fixed cases of span and poke access where the ring wraps.
+ *
+ *----------------------------------------------------------------------------*/
+static void testWrapCases(void)
+{
+    uint8 data[RECV_QUEUE_SIZE];
+    const uint8 *p_read;
+    uint8 *p_write;
+    uint16 len, i;
+
+    /* Move head and tail to 16 bytes before the end of the buffer */
+    BQClearBuffer(TEST_QUEUE);
+    g_model_len = 0;
+    testMakeData(data, RECV_QUEUE_SIZE - 16);
+    (void)BQSafeQueueBytes(data, RECV_QUEUE_SIZE - 16, TEST_QUEUE);
+    (void)BQPopBytes(data, RECV_QUEUE_SIZE - 16, TEST_QUEUE);
+
+    /* The write span ends at the end of the buffer */
+    len = BQGetWriteSpan(&p_write, TEST_QUEUE);
+    if(len != 16)
+    {
+        testError("write span of %u bytes before the end, expected 16", len);
+    }
+
+    /* Poke 40 bytes across the end; none is queued before the commit */
+    testMakeData(data, 40);
+    for(i = 0;i < 40;i++)
+    {
+        BQPokeByte(i, data[i], TEST_QUEUE);
+    }
+    if(BQGetDataSize(TEST_QUEUE) != 0)
+    {
+        testError("poked bytes queued before the commit");
+    }
+    BQCommitWrite(40, TEST_QUEUE);
+    testModelPush(data, 40);
+    testCheck();
+
+    /* The read span stops at the end of the buffer, the next one holds the
+     * rest
+     */
+    len = BQGetReadSpan(&p_read, TEST_QUEUE);
+    if(len != 16)
+    {
+        testError("read span of %u bytes before the end, expected 16", len);
+    }
+    testCheckData("read span", p_read, 0, len);
+    BQCommitRead(len, TEST_QUEUE);
+    testModelPop(len);
+    len = BQGetReadSpan(&p_read, TEST_QUEUE);
+    if(len != 24)
+    {
+        testError("read span of %u bytes after the end, expected 24", len);
+    }
+    testCheckData("read span", p_read, 0, len);
+    BQCommitRead(len, TEST_QUEUE);
+    testModelPop(len);
+
+    /* A full queue has no write span and takes no poke */
+    testMakeData(data, RECV_QUEUE_SIZE);
+    if(!BQSafeQueueBytes(data, RECV_QUEUE_SIZE, TEST_QUEUE))
+    {
+        testError("whole buffer not queued");
+    }
+    testModelPush(data, RECV_QUEUE_SIZE);
+    if(BQGetWriteSpan(&p_write, TEST_QUEUE) != 0)
+    {
+        testError("write span in a full queue");
+    }
+    BQPokeByte(0, 0xEE, TEST_QUEUE);
+    BQCommitWrite(1, TEST_QUEUE);
+    if(BQSafeQueueBytes(data, 1, TEST_QUEUE))
+    {
+        testError("byte queued in a full queue");
+    }
+    testCheck();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testStep
+ *
+ *  DESCRIPTION
+ *      Runs one random operation on the queue and the model.
+ *
+ *----------------------------------------------------------------------------*/
+static void testStep(void)
+{
+    static uint8 data[RECV_QUEUE_SIZE + 64];
+    const uint8 *p_read;
+    uint8 *p_write;
+    uint16 len, got, free_len, i;
+
+    free_len = RECV_QUEUE_SIZE - g_model_len;
+    switch(testRandom(9))
+    {
+        case 0:
+            /* Queued only if it fits */
+            len = testRandom(RECV_QUEUE_SIZE / 2);
+            testMakeData(data, len);
+            if(BQSafeQueueBytes(data, len, TEST_QUEUE) != (len <= free_len))
+            {
+                testError("%u bytes refused with %u free", len, free_len);
+            }
+            if(len <= free_len)
+            {
+                testModelPush(data, len);
+            }
+            break;
+
+        case 1:
+            /* Overwrites the oldest data, may be longer than the queue */
+            len = testRandom(testRandom(8) ? 64 : sizeof(data));
+            testMakeData(data, len);
+            BQForceQueueBytes(data, len, TEST_QUEUE);
+            testModelPush(data, len);
+            break;
+
+        case 2:
+            len = testRandom(RECV_QUEUE_SIZE / 2);
+            got = BQPopBytes(data, len, TEST_QUEUE);
+            if(got != (len < g_model_len ? len : g_model_len))
+            {
+                testError("popped %u bytes of %u", got, len);
+            }
+            testCheckData("pop", data, 0, got);
+            testModelPop(got);
+            break;
+
+        case 3:
+            /* Peek, then commit it or not */
+            len = testRandom(RECV_QUEUE_SIZE / 2);
+            got = BQPeekBytes(data, len, TEST_QUEUE);
+            testCheckData("peek", data, 0, got);
+            if(testRandom(2))
+            {
+                BQCommitLastPeek(TEST_QUEUE);
+                testModelPop(got);
+            }
+            break;
+
+        case 4:
+        case 5:
+            /* Consume part of the read span in place */
+            len = BQGetReadSpan(&p_read, TEST_QUEUE);
+            if(len == 0 && g_model_len != 0)
+            {
+                testError("no read span with %u bytes queued", g_model_len);
+            }
+            testCheckData("read span", p_read, 0, len);
+            len = testRandom(len + 1);
+            BQCommitRead(len, TEST_QUEUE);
+            testModelPop(len);
+            break;
+
+        case 6:
+            /* Produce part of the write span in place */
+            len = BQGetWriteSpan(&p_write, TEST_QUEUE);
+            if(len == 0 && free_len != 0)
+            {
+                testError("no write span with %u bytes free", free_len);
+            }
+            len = testRandom(len + 1);
+            testMakeData(p_write, len);
+            testModelPush(p_write, len);
+            BQCommitWrite(len, TEST_QUEUE);
+            break;
+
+        case 7:
+            /* Poke a frame across the free space, as uart_time.c does */
+            len = testRandom(free_len + 1);
+            testMakeData(data, len);
+            i = len;
+            while(i-- > 0)
+            {
+                BQPokeByte(i, data[i], TEST_QUEUE);
+            }
+            BQCommitWrite(len, TEST_QUEUE);
+            testModelPush(data, len);
+            break;
+
+        default:
+            if(testRandom(50) == 0)
+            {
+                BQClearBuffer(TEST_QUEUE);
+                g_model_len = 0;
+            }
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      oldCopyIntoBuffer, oldPeekBuffer
+ *
+ *  DESCRIPTION
+ *      Copies of copyIntoBuffer() and peekBuffer() of the old byte_queue.c,
+ *      which picked the buffer of the queue on every copy. The overwrite of
+ *      the oldest data, which the benchmark does not use, is left out.
+ *
+ *----------------------------------------------------------------------------*/
+static void oldCopyIntoBuffer(const uint8 *p_data, uint16 len,
+                              uint8 queue_id)
+{
+    if ((len == 0) || (p_data == NULL))
+        return;
+
+    if (g_old_queue[queue_id].g_tail + len >= OLD_BUFFER_SIZE)
+    {
+        const uint16 available = OLD_BUFFER_SIZE - g_old_queue[queue_id].g_tail;
+
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+            MemCopy(&g_old_send_queue[g_old_queue[queue_id].g_tail], p_data,
+                    available);
+        }
+        else
+        {
+            MemCopy(&g_old_recv_queue[g_old_queue[queue_id].g_tail], p_data,
+                    available);
+        }
+
+        g_old_queue[queue_id].g_tail = len - available;
+
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+            MemCopy(g_old_send_queue, p_data + available,
+                    g_old_queue[queue_id].g_tail);
+        }
+        else
+        {
+            MemCopy(g_old_recv_queue, p_data + available,
+                    g_old_queue[queue_id].g_tail);
+        }
+    }
+    else
+    {
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+           MemCopy(&g_old_send_queue[g_old_queue[queue_id].g_tail], p_data,
+                   len);
+        }
+        else
+        {
+           MemCopy(&g_old_recv_queue[g_old_queue[queue_id].g_tail], p_data,
+                   len);
+        }
+
+        g_old_queue[queue_id].g_tail += len;
+    }
+}
+
+static uint16 oldPeekBuffer(uint8 *p_data, uint16 len, uint8 queue_id)
+{
+    uint16 peeked = len;
+
+    if ((len == 0) || (p_data == NULL))
+        return 0;
+
+    if (peeked > OLD_QUEUE_LENGTH(queue_id))
+    {
+       peeked = OLD_QUEUE_LENGTH(queue_id);
+
+       if(peeked > len)
+          peeked = len;
+    }
+
+    if (g_old_queue[queue_id].g_head + peeked >= OLD_BUFFER_SIZE)
+    {
+        const uint16 available = OLD_BUFFER_SIZE - g_old_queue[queue_id].g_head;
+
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+            MemCopy(p_data, &g_old_send_queue[g_old_queue[queue_id].g_head],
+                    available > len ? len : available);
+        }
+        else
+        {
+            MemCopy(p_data, &g_old_recv_queue[g_old_queue[queue_id].g_head],
+                    available > len ? len : available);
+        }
+
+        g_old_queue[queue_id].g_peek = peeked - available;
+
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+            MemCopy(p_data + available, g_old_send_queue,
+                    g_old_queue[queue_id].g_peek);
+        }
+        else
+        {
+            MemCopy(p_data + available, g_old_recv_queue,
+                    g_old_queue[queue_id].g_peek);
+        }
+    }
+    else
+    {
+        if(queue_id == OLD_SEND_QUEUE_ID)
+        {
+            MemCopy(p_data, &g_old_send_queue[g_old_queue[queue_id].g_head],
+                    peeked);
+        }
+        else
+        {
+            MemCopy(p_data, &g_old_recv_queue[g_old_queue[queue_id].g_head],
+                    peeked);
+        }
+
+        g_old_queue[queue_id].g_peek = g_old_queue[queue_id].g_head + peeked;
+    }
+
+    return peeked;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      oldSafeQueueBytes, oldPopBytes
+ *
+ *  DESCRIPTION
+ *      Copies of BQSafeQueueBytes() and BQPopBytes() of the old
+ *      byte_queue.c. They are called through OLD_API, like the new ones
+ *      from their own file, so they are not inlined or specialised for the
+ *      queue ID the benchmark passes.
+ *
+ *----------------------------------------------------------------------------*/
+static OLD_API bool oldSafeQueueBytes(const uint8 *p_data, uint16 len,
+                                     uint8 queue_id)
+{
+    bool ret_val = (OLD_QUEUE_FREE(queue_id) >= len);
+
+    if (ret_val)
+    {
+        oldCopyIntoBuffer(p_data, len, queue_id);
+    }
+    return ret_val;
+}
+
+static OLD_API uint16 oldPopBytes(uint8 *p_data, uint16 len, uint8 queue_id)
+{
+    uint16 peeked = oldPeekBuffer(p_data, len, queue_id);
+
+    g_old_queue[queue_id].g_head = g_old_queue[queue_id].g_peek;
+    return peeked;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchTime
+ *
+ *  DESCRIPTION
+ *      Returns the time of day in seconds.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchTime(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchRun
+ *
+ *  DESCRIPTION
+ *      Moves BENCH_BYTES through a queue in frames of len bytes, each
+ *      queued and read out again, and returns the bytes moved per second.
+ *      Mode 0 pops the frames from the old queue and mode 1 from the new
+ *      one. Mode 2 writes them into the write spans of the new queue and
+ *      reads them where they are in its read spans, as uart_time.c hands
+ *      the read span to UartWrite(). The first and last byte of each frame
+ *      are summed into *p_sum, so the reads are not optimised away and the
+ *      modes can be checked against each other.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchRun(uint16 mode, uint16 len, uint32 *p_sum)
+{
+    const uint32 frames = BENCH_BYTES / len;
+    uint8 in[RECV_QUEUE_SIZE], out[RECV_QUEUE_SIZE];
+    const uint8 *p_read = NULL;
+    uint8 *p_write;
+    uint32 frame, sum = 0;
+    uint16 i, got, span = 0;
+    double start;
+
+    memset(g_old_queue, 0, sizeof(g_old_queue));
+    BQClearBuffer(TEST_QUEUE);
+    for(i = 0;i < len;i++)
+    {
+        in[i] = (uint8)(i * 7 + 1);
+    }
+
+    start = benchTime();
+    for(frame = 0;frame < frames;frame++)
+    {
+        in[0] = (uint8)frame;
+        if(mode == 0)
+        {
+            (void)oldSafeQueueBytes(in, len, OLD_RECV_QUEUE_ID);
+            got = oldPopBytes(out, len, OLD_RECV_QUEUE_ID);
+            sum += out[0] + out[got - 1];
+        }
+        else if(mode == 1)
+        {
+            (void)BQSafeQueueBytes(in, len, TEST_QUEUE);
+            got = BQPopBytes(out, len, TEST_QUEUE);
+            sum += out[0] + out[got - 1];
+        }
+        else
+        {
+            for(got = 0;got < len;got += span)
+            {
+                span = BQGetWriteSpan(&p_write, TEST_QUEUE);
+                if(span > len - got)
+                {
+                    span = len - got;
+                }
+                MemCopy(p_write, in + got, span);
+                BQCommitWrite(span, TEST_QUEUE);
+            }
+            for(got = 0;got < len;got += span)
+            {
+                span = BQGetReadSpan(&p_read, TEST_QUEUE);
+                if(span > len - got)
+                {
+                    span = len - got;
+                }
+                if(got == 0)
+                {
+                    sum += p_read[0];
+                }
+                BQCommitRead(span, TEST_QUEUE);
+            }
+            sum += p_read[span - 1];
+        }
+    }
+
+    *p_sum = sum;
+    return frames * (double)len / (benchTime() - start);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchQueues
+ *
+ *  DESCRIPTION
+ *      Runs the benchmark for each frame length and prints the throughput
+ *      of the old and new queues side by side.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchQueues(void)
+{
+    static const uint16 lens[] = {1, 8, 20, 64, 128, 200};
+    double rate[3];
+    uint32 sum[3];
+    uint16 i, mode;
+
+    printf("byte queue throughput, MB/s per frame length\n");
+    printf("%6s | %9s %9s %9s | %7s\n", "bytes", "old", "new", "spans",
+           "new/old");
+    for(i = 0;i < sizeof(lens) / sizeof(lens[0]);i++)
+    {
+        for(mode = 0;mode < 3;mode++)
+        {
+            rate[mode] = benchRun(mode, lens[i], &sum[mode]);
+        }
+        if(sum[1] != sum[0] || sum[2] != sum[0])
+        {
+            testError("%u byte frames: queues popped different data",
+                      lens[i]);
+        }
+        printf("%6u | %9.1f %9.1f %9.1f | %7.2f\n", lens[i], rate[0] / 1e6,
+               rate[1] / 1e6, rate[2] / 1e6, rate[1] / rate[0]);
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32 steps = 200000, step;
+    uint32 seed = 1;
+    bool bench = FALSE;
+    int opt;
+
+    while((opt = getopt(argc, argv, "bn:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': bench = TRUE; break;
+            case 'n': steps = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-b] [-n steps] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    if(bench)
+    {
+        benchQueues();
+        return g_errors ? 1 : 0;
+    }
+
+    testWrapCases();
+    for(step = 0;step < steps && g_errors < TEST_MAX_ERRORS;step++)
+    {
+        testStep();
+        testCheck();
+    }
+
+    printf("byte queue, %u bytes: %lu steps, %u errors\n", RECV_QUEUE_SIZE,
+           (unsigned long)step, g_errors);
+    return g_errors ? 1 : 0;
+}
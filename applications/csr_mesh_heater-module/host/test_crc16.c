@@ -0,0 +1,364 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_crc16.c
+ *
+ *  DESCRIPTION
+ *      Test of crc16.c. The CRC of "123456789" must be the 0x29B1 check
+ *      value of CRC-16/CCITT-FALSE. Random blocks are then checked against
+ *      a bit at a time CRC, a block followed by its own CRC, high byte
+ *      first, must leave CRC16_RESIDUE, and any single bit flipped in it
+ *      must not.
+ *
+ *      With -b it is instead a benchmark of the CRC against the XOR check it
+ *      replaced. Frames of a few lengths are checked a byte at a time, as
+ *      the receive parser does, and a block at a time, as a frame is sealed
+ *      on sending, and the bytes per second of each are printed side by
+ *      side.
+ *
+ *      test_crc16 [-b] [-n blocks] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "crc16.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* CRC-16/CCITT-FALSE of the ASCII digits "123456789" */
+#define TEST_CHECK_VALUE             (0x29B1)
+
+/* Longest random block, CRC included */
+#define TEST_MAX_BLOCK               (64)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+
+/* Bytes each check runs over per frame length in the benchmark */
+#define BENCH_BYTES                  (16UL * 1024 * 1024)
+
+/* The XOR check is neither inlined nor specialised, like the CRC in its
+ * own file
+ */
+#define OLD_API                      __attribute__((noipa))
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static uint16 g_errors;
+static uint32 g_random;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_crc16: ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testBitCrc
+ *
+ *  DESCRIPTION
+ *      Returns the CRC of a block worked out one bit at a time.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 testBitCrc(const uint8 *p_data, uint16 len)
+{
+    uint16 crc = CRC16_INIT;
+    uint16 i, bit;
+
+    for(i = 0;i < len;i++)
+    {
+        crc ^= (uint16)p_data[i] << 8;
+        for(bit = 0;bit < 8;bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16)((crc << 1) ^ 0x1021) :
+                                   (uint16)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      oldXorUpdate, oldXorBlock
+ *
+ *  DESCRIPTION
+ *      The XOR check the CRC replaced, folding in one byte as the receive
+ *      parser did and a block as WifiTxGetBcc() did.
+ *
+ *----------------------------------------------------------------------------*/
+static OLD_API uint8 oldXorUpdate(uint8 bcc, uint8 byte)
+{
+    return bcc ^ byte;
+}
+
+static OLD_API uint8 oldXorBlock(uint8 bcc, const uint8 *p_data, uint16 len)
+{
+    uint16 i;
+
+    for(i = 0;i < len;i++)
+    {
+        bcc ^= p_data[i];
+    }
+    return bcc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testBlock
+ *
+ *  DESCRIPTION
+ *      Checks the CRC of one random block, and the block with its CRC
+ *      appended.
+ *
+ *----------------------------------------------------------------------------*/
+static void testBlock(void)
+{
+    uint8 data[TEST_MAX_BLOCK];
+    const uint16 len = testRandom(TEST_MAX_BLOCK - 1);
+    uint16 crc, i, bit;
+
+    for(i = 0;i < len;i++)
+    {
+        data[i] = testRandom(256);
+    }
+
+    crc = CRC16Block(CRC16_INIT, data, len);
+    if(crc != testBitCrc(data, len))
+    {
+        testError("CRC of %u bytes is %04X, %04X bit by bit", len, crc,
+                  testBitCrc(data, len));
+    }
+
+    /* The CRC also comes out when the block is fed in two parts */
+    i = testRandom(len + 1);
+    if(CRC16Block(CRC16Block(CRC16_INIT, data, i), &data[i], len - i) != crc)
+    {
+        testError("CRC of %u bytes differs when split at %u", len, i);
+    }
+
+    data[len] = (crc >> 8) & 0xFF;
+    data[len + 1] = crc & 0xFF;
+    if(CRC16Block(CRC16_INIT, data, len + 2) != CRC16_RESIDUE)
+    {
+        testError("%u bytes with their CRC leave %04X", len,
+                  CRC16Block(CRC16_INIT, data, len + 2));
+    }
+
+    i = testRandom(len + 2);
+    bit = testRandom(8);
+    data[i] ^= 1 << bit;
+    if(CRC16Block(CRC16_INIT, data, len + 2) == CRC16_RESIDUE)
+    {
+        testError("bit %u of byte %u of %u flipped and not detected", bit, i,
+                  len + 2);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchTime
+ *
+ *  DESCRIPTION
+ *      Returns the time of day in seconds.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchTime(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchRun
+ *
+ *  DESCRIPTION
+ *      Runs a check over BENCH_BYTES in frames of len bytes and returns the
+ *      bytes checked per second. Mode 0 is the XOR check a byte at a time,
+ *      1 a block at a time, 2 the CRC a byte at a time and 3 a block at a
+ *      time. The checks are summed into *p_sum so they are not optimised
+ *      away.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchRun(uint16 mode, const uint8 *p_data, uint16 len,
+                       uint32 *p_sum)
+{
+    const uint32 frames = BENCH_BYTES / len;
+    uint32 frame, sum = 0;
+    uint16 check, i;
+    double start;
+
+    start = benchTime();
+    for(frame = 0;frame < frames;frame++)
+    {
+        switch(mode)
+        {
+            case 0:
+                check = 0;
+                for(i = 0;i < len;i++)
+                {
+                    check = oldXorUpdate((uint8)check, p_data[i]);
+                }
+                break;
+
+            case 1:
+                check = oldXorBlock(0, p_data, len);
+                break;
+
+            case 2:
+                check = CRC16_INIT;
+                for(i = 0;i < len;i++)
+                {
+                    check = CRC16Update(check, p_data[i]);
+                }
+                break;
+
+            default:
+                check = CRC16Block(CRC16_INIT, p_data, len);
+                break;
+        }
+        sum += check;
+    }
+
+    *p_sum += sum;
+    return frames * (double)len / (benchTime() - start);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchChecks
+ *
+ *  DESCRIPTION
+ *      Runs the benchmark for each frame length and prints the throughput
+ *      of the XOR check and the CRC side by side.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchChecks(void)
+{
+    static const uint16 lens[] = {8, 20, 40, 64, 255};
+    uint8 data[256];
+    double rate[4];
+    uint32 sum = 0;
+    uint16 i, mode;
+
+    for(i = 0;i < sizeof(data);i++)
+    {
+        data[i] = testRandom(256);
+    }
+
+    printf("crc16 throughput, MB/s per frame length, and crc/xor\n");
+    printf("%6s | %9s %9s | %9s %9s | %6s %6s\n", "bytes", "xor byte",
+           "xor block", "crc byte", "crc block", "byte", "block");
+    for(i = 0;i < sizeof(lens) / sizeof(lens[0]);i++)
+    {
+        for(mode = 0;mode < 4;mode++)
+        {
+            rate[mode] = benchRun(mode, data, lens[i], &sum);
+        }
+        printf("%6u | %9.1f %9.1f | %9.1f %9.1f | %6.2f %6.2f\n", lens[i],
+               rate[0] / 1e6, rate[1] / 1e6, rate[2] / 1e6, rate[3] / 1e6,
+               rate[2] / rate[0], rate[3] / rate[1]);
+    }
+    printf("check sum %08lX\n", (unsigned long)sum);
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static const uint8 check[] = "123456789";
+    uint32 blocks = 100000, block;
+    uint32 seed = 1;
+    uint16 crc;
+    bool bench = FALSE;
+    int opt;
+
+    while((opt = getopt(argc, argv, "bn:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': bench = TRUE; break;
+            case 'n': blocks = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-b] [-n blocks] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    if(bench)
+    {
+        benchChecks();
+        return 0;
+    }
+
+    crc = CRC16Block(CRC16_INIT, check, sizeof(check) - 1);
+    if(crc != TEST_CHECK_VALUE)
+    {
+        testError("CRC of \"123456789\" is %04X, not %04X", crc,
+                  TEST_CHECK_VALUE);
+    }
+
+    for(block = 0;block < blocks && g_errors < TEST_MAX_ERRORS;block++)
+    {
+        testBlock();
+    }
+
+    printf("crc16: check value %04X, %lu blocks, %u errors\n", crc,
+           (unsigned long)block, g_errors);
+    return g_errors ? 1 : 0;
+}
@@ -0,0 +1,384 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_data_model.c
+ *
+ *  DESCRIPTION
+ *      Test of data_model_handler.c under contention on the simulated mesh
+ *      without loss. Saturated senders send batches of frames from the
+ *      gateway to one or more nodes (fan-out) and from several nodes to the
+ *      gateway (fan-in), so receivers run out of reassembly slots and frames
+ *      of 32 bytes and more, sent as streams, wait for the one stream each
+ *      receiver takes at a time. Every frame DataSend() takes must reach
+ *      the application of its receiver exactly once, intact and in the order
+ *      it was sent to that receiver, and no sender or receiver may count a
+ *      frame as failed or dropped.
+ *      Built with ENABLE_DATA_BLOCK_ACK, as test_data_model_ack, the frames
+ *      are sent in acknowledged mode.
+ *
+ *      test_data_model[_ack] [-n frames] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "define.h"
+#include "label.h"
+#include "data_model_handler.h"
+#include "host_sdk.h"
+#include "mesh_sim.h"
+#include "node_app.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Name of the test in its messages */
+#ifdef ENABLE_DATA_BLOCK_ACK
+#define TEST_NAME                    "test_data_model_ack"
+#else
+#define TEST_NAME                    "test_data_model"
+#endif /* ENABLE_DATA_BLOCK_ACK */
+
+/* Largest batch of frames */
+#define TEST_MAX_FRAMES              (500)
+
+/* Longest a batch may take */
+#define TEST_TIME_LIMIT              (300 * SECOND)
+
+/* Time after which a refused sender tries again */
+#define TEST_RETRY_TIME              (50 * MILLISECOND)
+
+/* Group all nodes listen to */
+#define TEST_GROUP_ID                (0x0001)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Frame of a batch */
+typedef struct
+{
+    uint16 sender;
+    uint16 dest;
+    bool sent;          /* DataSend() took the frame */
+    uint16 copies;      /* Times it was delivered */
+}TEST_FRAME_T;
+
+/* Batch sent in one run */
+typedef struct
+{
+    uint16 nodes;
+    bool fan_in;
+    uint16 len;
+}TEST_BATCH_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static TEST_FRAME_T g_frames[TEST_MAX_FRAMES];
+static uint16 g_frame_count;
+static uint16 g_frame_len;
+static uint16 g_errors;
+
+/* Next frame of each node to offer */
+static uint16 g_next[HOST_MAX_NODES];
+
+/* TRUE while a retry of the node is scheduled */
+static bool g_retry[HOST_MAX_NODES];
+
+/* Last frame each node received from each sender, plus one */
+static uint16 g_last[HOST_MAX_NODES][HOST_MAX_NODES];
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void testOffer(void *p_arg);
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, TEST_NAME ": ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testBuildFrame
+ *
+ *  DESCRIPTION
+ *      Builds frame n: 7E | message ID | length | frame number | data |
+ *      XOR check.
+ *
+ *----------------------------------------------------------------------------*/
+static void testBuildFrame(uint16 n, uint8 *p_frame)
+{
+    uint8 check = 0;
+    uint16 i;
+
+    p_frame[0] = 0x7E;
+    p_frame[1] = (uint8)n;
+    p_frame[2] = (uint8)(g_frame_len - 2);
+    p_frame[3] = (uint8)(n >> 8);
+    p_frame[4] = (uint8)n;
+    for(i = 5;i < g_frame_len - 1;i++)
+    {
+        p_frame[i] = (uint8)(n * 11 + i);
+    }
+    for(i = 1;i < g_frame_len - 1;i++)
+    {
+        check ^= p_frame[i];
+    }
+    p_frame[g_frame_len - 1] = check;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testOffer
+ *
+ *  DESCRIPTION
+ *      Offers the frames of the selected node to DataSend() until one is
+ *      refused.
+ *
+ *----------------------------------------------------------------------------*/
+static void testOffer(void *p_arg)
+{
+    const uint16 node = HostNodeCurrent();
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    TEST_FRAME_T *p_frame;
+
+    g_retry[node] = FALSE;
+    while(g_next[node] < g_frame_count)
+    {
+        p_frame = &g_frames[g_next[node]];
+        if(p_frame->sender != node)
+        {
+            g_next[node]++;
+            continue;
+        }
+        testBuildFrame(g_next[node], frame);
+        if(!DataSend(MESH_SIM_NODE_ID(p_frame->dest), frame, g_frame_len))
+        {
+            if(!g_retry[node])
+            {
+                g_retry[node] = TRUE;
+                HostPost(TEST_RETRY_TIME, node, testOffer, NULL);
+            }
+            return;
+        }
+        p_frame->sent = TRUE;
+        g_next[node]++;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testBatch
+ *
+ *  DESCRIPTION
+ *      Sends a batch of frames and checks every frame was delivered once.
+ *
+ *----------------------------------------------------------------------------*/
+static void testBatch(const MESH_SIM_CONFIG_T *p_config,
+                      const TEST_BATCH_T *p_batch, uint16 frames)
+{
+    const char *p_mode = p_batch->fan_in ? "fan-in" : "fan-out";
+    uint16 groups[1] = {TEST_GROUP_ID};
+    uint16 i, peer, failed, dropped;
+
+    g_frame_count = frames;
+    g_frame_len = p_batch->len;
+    memset(g_frames, 0, sizeof(g_frames));
+    memset(g_next, 0, sizeof(g_next));
+    memset(g_retry, 0, sizeof(g_retry));
+    memset(g_last, 0, sizeof(g_last));
+    for(i = 0;i < frames;i++)
+    {
+        peer = 1 + i % (p_batch->nodes - 1);
+        g_frames[i].sender = p_batch->fan_in ? peer : 0;
+        g_frames[i].dest = p_batch->fan_in ? 0 : peer;
+    }
+
+    MSInit(p_config, p_batch->nodes);
+    for(i = 0;i < p_batch->nodes;i++)
+    {
+        HostNodeSelect(i);
+        NodeAppInit(groups, 1);
+    }
+    for(i = 0;i < p_batch->nodes;i++)
+    {
+        HostPost(0, i, testOffer, NULL);
+    }
+    while(HostPendingCount() != 0 && TimeGet32() < TEST_TIME_LIMIT)
+    {
+        HostRunUntil(TimeGet32() + 10 * MILLISECOND);
+    }
+
+    for(i = 0;i < frames && g_errors < TEST_MAX_ERRORS;i++)
+    {
+        if(!g_frames[i].sent)
+        {
+            testError("%s %u nodes, %u bytes: frame %u was never taken",
+                      p_mode, p_batch->nodes, p_batch->len, i);
+        }
+        else if(g_frames[i].copies != 1)
+        {
+            testError("%s %u nodes, %u bytes: frame %u delivered %u times",
+                      p_mode, p_batch->nodes, p_batch->len, i,
+                      g_frames[i].copies);
+        }
+    }
+    for(i = 0;i < p_batch->nodes;i++)
+    {
+        HostNodeSelect(i);
+        (void)DataBlockTxGetDelivered(&failed, NULL);
+        dropped = DataBlockRxGetDropped(NULL);
+        if(failed != 0 || dropped != 0)
+        {
+            testError("%s %u nodes, %u bytes: node %u failed %u frames "
+                      "and dropped %u", p_mode, p_batch->nodes,
+                      p_batch->len, i, failed, dropped);
+        }
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HostAppEvent
+ *
+ *  DESCRIPTION
+ *      Application events of the selected node. A received frame is
+ *      matched to the batch by the frame number it carries and checked.
+ *
+ *----------------------------------------------------------------------------*/
+extern void HostAppEvent(APP_EVENT_ID_T id, uint16 arg)
+{
+    const uint16 node = HostNodeCurrent();
+    const uint8 *p_data;
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    uint16 src_id, n;
+
+    if(id == AE_MESH_TX_READY)
+    {
+        HostPost(0, node, testOffer, NULL);
+        return;
+    }
+    if(id != AE_MESH_FRAME_RECEIVED || g_errors >= TEST_MAX_ERRORS)
+    {
+        return;
+    }
+
+    p_data = NodeAppRxFrame(&src_id);
+    n = (uint16)(p_data[3] << 8) | p_data[4];
+    if(n >= g_frame_count || g_frames[n].dest != node ||
+       src_id != MESH_SIM_NODE_ID(g_frames[n].sender))
+    {
+        testError("node %u got a stray frame from %04X", node, src_id);
+        return;
+    }
+    testBuildFrame(n, frame);
+    if(memcmp(frame, p_data, g_frame_len) != 0)
+    {
+        testError("frame %u corrupted", n);
+    }
+    if(n + 1 <= g_last[node][g_frames[n].sender])
+    {
+        testError("frame %u from node %u arrived after frame %u", n,
+                  g_frames[n].sender, g_last[node][g_frames[n].sender] - 1);
+    }
+    else
+    {
+        g_last[node][g_frames[n].sender] = n + 1;
+    }
+    g_frames[n].copies++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      main
+ *
+ *----------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    static const TEST_BATCH_T batches[] =
+    {
+        {2, FALSE, 8}, {2, FALSE, 16}, {2, FALSE, 24}, {2, FALSE, 48},
+        {8, FALSE, 8}, {8, FALSE, 24}, {8, FALSE, 32}, {8, FALSE, 64},
+        {4, TRUE, 8}, {4, TRUE, 16}, {4, TRUE, 24}, {4, TRUE, 48},
+        {8, TRUE, 8}, {8, TRUE, 16}, {8, TRUE, 24}, {8, TRUE, 32},
+        {8, TRUE, 64}
+    };
+    MESH_SIM_CONFIG_T config;
+    uint16 frames = 48;
+    uint16 i;
+    int opt;
+
+    memset(&config, 0, sizeof(config));
+    config.latency = 5 * MILLISECOND;
+    config.jitter = 10 * MILLISECOND;
+    config.duplicate = 5;
+    config.seed = 1;
+    config.tx_queue_size = 6;
+    config.repeat_count = 3;
+    config.adv_interval = 10 * MILLISECOND;
+
+    while((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': frames = (uint16)atoi(optarg); break;
+            case 's': config.seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n frames] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if(frames == 0 || frames > TEST_MAX_FRAMES)
+    {
+        fprintf(stderr, TEST_NAME ": 1 to %u frames\n", TEST_MAX_FRAMES);
+        return 2;
+    }
+
+    for(i = 0;i < sizeof(batches) / sizeof(batches[0]) &&
+              g_errors < TEST_MAX_ERRORS;i++)
+    {
+        testBatch(&config, &batches[i], frames);
+    }
+
+    printf(TEST_NAME ": %u batches of %u frames, seed %lu, %u errors\n",
+           i, frames, (unsigned long)config.seed, g_errors);
+    return g_errors ? 1 : 0;
+}
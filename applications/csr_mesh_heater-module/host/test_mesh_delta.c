@@ -0,0 +1,452 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_mesh_delta.c
+ *
+ *  DESCRIPTION
+ *      Round trip test of mesh_delta.c. Frames to a few destinations are
+ *      encoded with MDTxEncode and decoded with MDRxFrame, each frame a few
+ *      bytes off the last one sent to its destination, a new length now and
+ *      then and some too long to keep. Some acknowledgements are lost, so
+ *      the two ends then disagree on the reference. Checked are:
+ *          - a delta frame is shorter than the frame and decodes to it
+ *          - a delta frame only fails to decode after a lost
+ *            acknowledgement, and the frame MDTxRestore returns then
+ *            decodes whole
+ *
+ *      Hand built delta frames then check that a reference mismatch and
+ *      changes running past the end of the reference frame are refused,
+ *      and that the reference is forgotten after either.
+ *
+ *      test_mesh_delta [-n frames] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "define.h"
+#include "mesh_delta.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Destinations of the random frames, one more than the sender keeps */
+#define TEST_NODES                   (MESH_DELTA_TX_NODES + 1)
+
+/* Device ID of the first destination */
+#define TEST_NODE_ID(node)           ((uint16)(0x8001 + (node)))
+
+/* Device ID the hand built frames come from */
+#define TEST_SRC_ID                  ((uint16)0x8100)
+
+/* Frame marker */
+#define TEST_MARKER                  (0x7E)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Last frame sent to each destination */
+static uint8 g_last[TEST_NODES][MESH_DATA_MAX_LENGTH];
+static uint16 g_last_len[TEST_NODES];
+
+/* TRUE if the acknowledgement of the last frame to a destination was lost */
+static bool g_ack_lost[TEST_NODES];
+
+static uint16 g_errors;
+static uint32 g_random;
+static uint8 g_msg_id;
+
+/* Counters of a run */
+static uint32 g_deltas;
+static uint32 g_restored;
+static uint32 g_delta_bytes;
+static uint32 g_frame_bytes;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_mesh_delta: ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSetXor
+ *
+ *  DESCRIPTION
+ *      Sets the length byte and the trailing xor of a frame of len bytes.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSetXor(uint8 *p_frame, uint16 len)
+{
+    uint8 check = 0;
+    uint16 i;
+
+    p_frame[2] = (uint8)(len - 2);
+    for(i = 1;i < len - 1;i++)
+    {
+        check ^= p_frame[i];
+    }
+    p_frame[len - 1] = check;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testNextFrame
+ *
+ *  DESCRIPTION
+ *      Makes the next frame to a destination in p_frame and returns its
+ *      length. Most are the last frame with a few bytes changed.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 testNextFrame(uint16 node, uint8 *p_frame)
+{
+    uint16 len = g_last_len[node];
+    uint16 changes, i;
+
+    if(len == 0 || testRandom(16) == 0)
+    {
+        /* A new length, now and then too long to keep as a reference */
+        len = testRandom(8) ? 4 + testRandom(MESH_DELTA_FRAME_LENGTH - 3)
+                            : 4 + testRandom(MESH_DATA_MAX_LENGTH - 3);
+        for(i = 3;i < len - 1;i++)
+        {
+            p_frame[i] = (uint8)testRandom(256);
+        }
+    }
+    else
+    {
+        memcpy(p_frame, g_last[node], len);
+        changes = (len == 4) ? 0 : testRandom(4) ? testRandom(4) :
+                                                   testRandom(len);
+        for(i = 0;i < changes;i++)
+        {
+            p_frame[3 + testRandom(len - 4)] = (uint8)testRandom(256);
+        }
+    }
+
+    p_frame[0] = TEST_MARKER;
+    p_frame[1] = g_msg_id++;
+    testSetXor(p_frame, len);
+
+    memcpy(g_last[node], p_frame, len);
+    g_last_len[node] = len;
+    return len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSend
+ *
+ *  DESCRIPTION
+ *      Sends the next frame to a random destination through the encoder and
+ *      the decoder, and acknowledges it unless the acknowledgement is lost.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSend(void)
+{
+    const uint16 node = (uint16)testRandom(TEST_NODES);
+    const uint16 node_id = TEST_NODE_ID(node);
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    uint16 len, sent_len;
+    bool delta;
+
+    len = testNextFrame(node, frame);
+    sent_len = len;
+    delta = MDTxEncode(node_id, frame, &sent_len);
+
+    if(delta)
+    {
+        g_deltas++;
+        g_delta_bytes += sent_len;
+        g_frame_bytes += len;
+
+        if(sent_len >= len)
+        {
+            testError("frame %u of %u bytes encoded to %u", g_last[node][1],
+                      len, sent_len);
+        }
+    }
+    else if(sent_len != len || memcmp(frame, g_last[node], len) != 0)
+    {
+        testError("frame %u changed though not encoded", g_last[node][1]);
+    }
+
+    if(!MDRxFrame(node_id, frame, delta))
+    {
+        if(!delta || !g_ack_lost[node])
+        {
+            testError("frame %u not decoded with an agreed reference",
+                      g_last[node][1]);
+        }
+
+        /* The receiver asks for the whole frame */
+        g_restored++;
+        sent_len = MDTxRestore(node_id, frame);
+        if(sent_len != len)
+        {
+            testError("frame %u restored with %u bytes, not %u",
+                      g_last[node][1], sent_len, len);
+            return;
+        }
+        if(!MDRxFrame(node_id, frame, FALSE))
+        {
+            testError("whole frame %u refused", g_last[node][1]);
+        }
+    }
+
+    if(memcmp(frame, g_last[node], len) != 0)
+    {
+        testError("frame %u of %u bytes decoded wrongly", g_last[node][1],
+                  len);
+    }
+
+    g_ack_lost[node] = (testRandom(16) == 0);
+    if(!g_ack_lost[node])
+    {
+        MDTxAcked(node_id, g_last[node][1]);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testDelta
+ *
+ *  DESCRIPTION
+ *      Builds a delta frame against the reference frame with ref_id out of
+ *      a skip and a run of changed bytes, optionally claiming more changed
+ *      bytes than it holds. Returns its length.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 testDelta(uint8 *p_frame, uint8 ref_id, uint16 skip,
+                        uint16 run, uint16 claimed)
+{
+    uint16 len = 4, i;
+
+    p_frame[0] = TEST_MARKER;
+    p_frame[1] = g_msg_id++;
+    p_frame[3] = ref_id;
+    p_frame[len++] = (uint8)skip;
+    p_frame[len++] = (uint8)claimed;
+    for(i = 0;i < run;i++)
+    {
+        p_frame[len++] = (uint8)(0xA0 + i);
+    }
+    len++;
+    testSetXor(p_frame, len);
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testReference
+ *
+ *  DESCRIPTION
+ *      Makes a whole frame of len bytes the reference for TEST_SRC_ID and
+ *      returns its message ID.
+ *
+ *----------------------------------------------------------------------------*/
+static uint8 testReference(uint8 *p_base, uint16 len)
+{
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    uint16 i;
+
+    p_base[0] = TEST_MARKER;
+    p_base[1] = g_msg_id++;
+    for(i = 3;i < len - 1;i++)
+    {
+        p_base[i] = (uint8)i;
+    }
+    testSetXor(p_base, len);
+
+    memcpy(frame, p_base, len);
+    if(!MDRxFrame(TEST_SRC_ID, frame, FALSE))
+    {
+        testError("whole reference frame refused");
+    }
+
+    return p_base[1];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRefused
+ *
+ *  DESCRIPTION
+ *      Checks that a delta frame is refused, and that the reference is then
+ *      forgotten so a delta frame that fits it is refused as well.
+ *
+ *----------------------------------------------------------------------------*/
+static void testRefused(const char *p_what, uint8 *p_frame, uint8 ref_id)
+{
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+
+    if(MDRxFrame(TEST_SRC_ID, p_frame, TRUE))
+    {
+        testError("delta frame with %s decoded", p_what);
+    }
+
+    testDelta(frame, ref_id, 0, 1, 1);
+    if(MDRxFrame(TEST_SRC_ID, frame, TRUE))
+    {
+        testError("reference kept after a delta frame with %s", p_what);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testBadDeltas
+ *
+ *  DESCRIPTION
+ *      Checks the decoding of hand built delta frames: changes that end on
+ *      the last byte of the reference body are taken, a reference mismatch
+ *      and changes running past the end of the reference frame are not.
+ *
+ *----------------------------------------------------------------------------*/
+static void testBadDeltas(void)
+{
+    const uint16 base_len = 12;
+    const uint16 body = base_len - 4;
+    uint8 base[MESH_DATA_MAX_LENGTH];
+    uint8 frame[MESH_DATA_MAX_LENGTH];
+    uint8 ref_id;
+
+    /* The last run ends on the last body byte */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, ref_id, body - 2, 2, 2);
+    if(!MDRxFrame(TEST_SRC_ID, frame, TRUE))
+    {
+        testError("delta frame up to the end of its reference refused");
+    }
+    else
+    {
+        base[body + 1] = 0xA0;
+        base[body + 2] = 0xA1;
+        base[1] = frame[1];
+        testSetXor(base, base_len);
+        if(memcmp(frame, base, base_len) != 0)
+        {
+            testError("delta frame up to the end of its reference wrong");
+        }
+    }
+
+    /* Reference mismatch, as after a lost acknowledgement */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, (uint8)(ref_id - 1), 0, 1, 1);
+    testRefused("another reference", frame, ref_id);
+
+    /* A run one byte past the body of the reference */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, ref_id, body - 1, 2, 2);
+    testRefused("a run past the reference", frame, ref_id);
+
+    /* A skip past the body of the reference */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, ref_id, body + 1, 0, 0);
+    testRefused("a skip past the reference", frame, ref_id);
+
+    /* A run longer than the delta frame holds */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, ref_id, 0, 2, 3);
+    testRefused("a run past its end", frame, ref_id);
+
+    /* A varint that does not end before the xor */
+    ref_id = testReference(base, base_len);
+    testDelta(frame, ref_id, 0, 0, 0x80);
+    testRefused("an unterminated varint", frame, ref_id);
+
+    /* A delta frame from a source with no reference */
+    MDInit();
+    testDelta(frame, ref_id, 0, 1, 1);
+    if(MDRxFrame(TEST_SRC_ID, frame, TRUE))
+    {
+        testError("delta frame without a reference decoded");
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32 frames = 100000, frame;
+    uint32 seed = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': frames = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n frames] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    MDInit();
+    testBadDeltas();
+
+    for(frame = 0;frame < frames && g_errors < TEST_MAX_ERRORS;frame++)
+    {
+        testSend();
+    }
+
+    printf("mesh delta: %lu frames, %lu deltas of %lu%% their size, "
+           "%lu restored, %u errors\n", (unsigned long)frame,
+           (unsigned long)g_deltas,
+           (unsigned long)(g_frame_bytes ? 100 * g_delta_bytes /
+                                           g_frame_bytes : 0),
+           (unsigned long)g_restored, g_errors);
+    return g_errors ? 1 : 0;
+}
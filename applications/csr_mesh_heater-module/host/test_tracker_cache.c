@@ -0,0 +1,1211 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_tracker_cache.c
+ *
+ *  DESCRIPTION
+ *      Replay of asset adverts through tracker_model_handler.c, as a
+ *      tracker in a busy warehouse hears them: far more assets than either
+ *      cache holds, announcing at random, with now and then a report from
+ *      another tracker, a find or a cache clear, while the pending and
+ *      asset cache timers run. After every step the caches are checked
+ *      against a plain model kept as arrays in least recently heard order:
+ *
+ *          - both caches hold the assets of the model, in the same order
+ *            on the age list and with the same fields
+ *          - every asset is found through the hash index at its slot, the
+ *            index holds nothing else, the free list holds the other slots
+ *          - the reports sent and the finds answered are those the model
+ *            expects, including the refresh of an asset whose zone did not
+ *            change and the report of one another tracker stopped
+ *            reporting
+ *
+ *      The handler source is included so its private data can be checked,
+ *      its timers are run through the test so the model follows them.
+ *
+ *      With -b it is instead a benchmark of the cache lookups. The same
+ *      adverts, mostly from the busy assets or from all assets evenly, are
+ *      replayed through copies of the linear scans the hash index replaced
+ *      and through the index, each looking the asset up in the pending and
+ *      the asset cache and storing it in place of the least recently heard
+ *      if it is not there, and the lookups per second of both are printed.
+ *
+ *      test_tracker_cache [-b] [-n steps] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include <timer.h>
+#include "host_sdk.h"
+
+/* Refresh and forget within the delete interval of the test */
+#define TRACKER_REPORT_REFRESH       (8)
+
+/* The timers of the handler are created through the test */
+static timer_id testTimerCreate(uint32 const time, bool const relative,
+                                timer_callback_arg handler);
+#define TimerCreate testTimerCreate
+#include "tracker_model_handler.c"
+#undef TimerCreate
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Assets heard by the tracker */
+#define TEST_ASSETS                  (3 * TRACKER_MAX_CACHED_ASSETS)
+
+/* Device ID of the first of the assets commissioned in a run */
+#define TEST_FIRST_DEV_ID            (0x8000)
+
+/* Assets that announce more often than the rest */
+#define TEST_BUSY_ASSETS             (TRACKER_MAX_PENDING_ASSETS)
+
+/* Seconds before an asset that is no longer heard is deleted */
+#define TEST_DELETE_INTERVAL         (20)
+
+/* Most reports a timer expiry can send */
+#define TEST_MAX_REPORTS             (TRACKER_MAX_PENDING_ASSETS)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+
+/* Adverts replayed by the benchmark */
+#define BENCH_ADVERTS                (1000000)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Model of a cached asset */
+typedef struct
+{
+    uint16 dev_id;
+    int8 rssi;
+    uint16 effects;
+    uint32 heard;
+
+    /* Pending: delay timer count it is reported at. Asset cache: second it
+     * is deleted at
+     */
+    uint32 due;
+
+    /* Pending: heard more strongly by another tracker */
+    bool marked;
+
+    /* Asset cache: zone last reported, MARK_FOR_DELETE if none yet */
+    uint8 zone;
+
+    /* Asset cache: strongest RSSI another tracker reported, 0 if none, and
+     * the second it was reported at
+     */
+    int8 elsewhere;
+    uint32 elsewhere_time;
+
+    /* Asset cache: second the asset was last reported at */
+    uint32 reported;
+}TEST_ASSET_T;
+
+/* Model of a cache, least recently heard first */
+typedef struct
+{
+    TEST_ASSET_T asset[TRACKER_MAX_CACHED_ASSETS];
+    uint16 count;
+    uint16 capacity;
+}TEST_CACHE_T;
+
+/* Counters of a run */
+typedef struct
+{
+    uint32 adverts;
+    uint32 reports_in;
+    uint32 finds;
+    uint32 found;
+    uint32 clears;
+    uint32 evicted;
+    uint32 reports_out;
+}TEST_STATS_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Device IDs of the assets */
+static uint16 g_dev_ids[TEST_ASSETS];
+
+/* Model of the pending and asset caches */
+static TEST_CACHE_T g_pending;
+static TEST_CACHE_T g_tracker;
+
+/* Model of the timers and their counts */
+static bool g_pending_timer;
+static bool g_asset_timer;
+static uint32 g_delay_count;
+static uint32 g_sec_count;
+
+/* Reports the model expects from the running timer expiry */
+static CSRMESH_TRACKER_REPORT_T g_reports[TEST_MAX_REPORTS];
+static uint16 g_report_count;
+static uint16 g_report_next;
+
+static TEST_STATS_T g_stats;
+static uint16 g_errors;
+static uint32 g_random;
+
+/* Device IDs of the adverts the benchmark replays */
+static uint16 g_bench_dev_ids[BENCH_ADVERTS];
+
+/* Caches of the old scans */
+static ASSET_INFO_T g_old_pending[TRACKER_MAX_PENDING_ASSETS];
+static ASSET_INFO_T g_old_tracker[TRACKER_MAX_CACHED_ASSETS];
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_tracker_cache: %lu ms: ",
+            (unsigned long)(TimeGet32() / MILLISECOND));
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testDevId
+ *
+ *  DESCRIPTION
+ *      Returns the device ID of a random asset, mostly a busy one.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 testDevId(void)
+{
+    return g_dev_ids[testRandom(2) ? testRandom(TEST_BUSY_ASSETS) :
+                                     testRandom(TEST_ASSETS)];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCacheFind
+ *
+ *  DESCRIPTION
+ *      Returns the model of an asset in a model cache, NULL if not cached.
+ *
+ *----------------------------------------------------------------------------*/
+static TEST_ASSET_T *testCacheFind(TEST_CACHE_T *p_cache, uint16 dev_id)
+{
+    uint16 i;
+
+    for(i = 0;i < p_cache->count;i++)
+    {
+        if(p_cache->asset[i].dev_id == dev_id)
+        {
+            return &p_cache->asset[i];
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCacheRemove
+ *
+ *  DESCRIPTION
+ *      Removes an asset from a model cache.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCacheRemove(TEST_CACHE_T *p_cache, TEST_ASSET_T *p_asset)
+{
+    const uint16 i = p_asset - p_cache->asset;
+
+    memmove(p_asset, p_asset + 1,
+            (p_cache->count - i - 1) * sizeof(TEST_ASSET_T));
+    p_cache->count--;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCacheAdd
+ *
+ *  DESCRIPTION
+ *      Adds an asset to a model cache as the most recently heard, in place
+ *      of the least recently heard if the cache is full.
+ *
+ *----------------------------------------------------------------------------*/
+static TEST_ASSET_T *testCacheAdd(TEST_CACHE_T *p_cache, uint16 dev_id)
+{
+    TEST_ASSET_T *p_asset;
+
+    if(p_cache->count == p_cache->capacity)
+    {
+        testCacheRemove(p_cache, &p_cache->asset[0]);
+        g_stats.evicted++;
+    }
+    p_asset = &p_cache->asset[p_cache->count++];
+    memset(p_asset, 0, sizeof(TEST_ASSET_T));
+    p_asset->dev_id = dev_id;
+    return p_asset;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCacheTouch
+ *
+ *  DESCRIPTION
+ *      Makes an asset the most recently heard of a model cache.
+ *
+ *----------------------------------------------------------------------------*/
+static TEST_ASSET_T *testCacheTouch(TEST_CACHE_T *p_cache,
+                                    TEST_ASSET_T *p_asset)
+{
+    const TEST_ASSET_T asset = *p_asset;
+
+    testCacheRemove(p_cache, p_asset);
+    p_cache->asset[p_cache->count] = asset;
+    return &p_cache->asset[p_cache->count++];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testZone
+ *
+ *  DESCRIPTION
+ *      Returns the zone of an RSSI with the default thresholds.
+ *
+ *----------------------------------------------------------------------------*/
+static uint8 testZone(int8 rssi)
+{
+    if(rssi >= DEFAULT_ZONE0_THRESHOLD)
+    {
+        return 0;
+    }
+    if(rssi >= DEFAULT_ZONE1_THRESHOLD)
+    {
+        return 1;
+    }
+    return 2;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCheckCache
+ *
+ *  DESCRIPTION
+ *      Checks a cache of the handler against its model.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCheckCache(const char *p_name, ASSET_CACHE_T *cache,
+                           TEST_CACHE_T *p_model, bool pending)
+{
+    uint16 index, older = TRACKER_NO_SLOT, i = 0, used = 0, free = 0;
+    const TEST_ASSET_T *p_asset;
+    const ASSET_INFO_T *asset;
+
+    if(cache->count != p_model->count)
+    {
+        testError("%s cache holds %u assets, %u expected", p_name,
+                  cache->count, p_model->count);
+        return;
+    }
+
+    for(index = cache->oldest; index != TRACKER_NO_SLOT && i < p_model->count;
+        index = asset->newer, i++)
+    {
+        asset = &cache->asset[index];
+        p_asset = &p_model->asset[i];
+        if(asset->older != older)
+        {
+            testError("%s slot %u links back to %u, not %u", p_name, index,
+                      asset->older, older);
+        }
+        older = index;
+
+        if(asset->dev_id != p_asset->dev_id)
+        {
+            testError("%s asset %u is %04X, %04X expected", p_name, i,
+                      asset->dev_id, p_asset->dev_id);
+            return;
+        }
+        if(trackerFindAssetInCache(asset->dev_id, cache) != index)
+        {
+            testError("%s asset %04X not found at slot %u", p_name,
+                      asset->dev_id, index);
+        }
+        if(asset->rssi != p_asset->rssi || asset->effects != p_asset->effects ||
+           asset->timeLastHeard != p_asset->heard ||
+           asset->deleteCount != p_asset->due)
+        {
+            testError("%s asset %04X: rssi %d effects %04X heard %lu due %lu,"
+                      " %d %04X %lu %lu expected", p_name, asset->dev_id,
+                      asset->rssi, asset->effects,
+                      (unsigned long)asset->timeLastHeard,
+                      (unsigned long)asset->deleteCount, p_asset->rssi,
+                      p_asset->effects, (unsigned long)p_asset->heard,
+                      (unsigned long)p_asset->due);
+        }
+        if(pending ? ((asset->proximity == MARK_FOR_DELETE) !=
+                      p_asset->marked) :
+                     (asset->proximity != p_asset->zone ||
+                      asset->rssiElsewhere != p_asset->elsewhere))
+        {
+            testError("%s asset %04X: zone %u elsewhere %d, %u %d expected",
+                      p_name, asset->dev_id, asset->proximity,
+                      asset->rssiElsewhere, p_asset->zone,
+                      p_asset->elsewhere);
+        }
+    }
+    if(index != TRACKER_NO_SLOT || i != p_model->count ||
+       cache->newest != older)
+    {
+        testError("%s age list does not hold the %u assets", p_name,
+                  p_model->count);
+    }
+
+    /* The hash index holds the assets only, the free list the rest */
+    for(index = 0;index <= cache->hashMask;index++)
+    {
+        used += (cache->hash[index] != 0);
+    }
+    for(index = cache->free;index != TRACKER_NO_SLOT && free <= cache->capacity;
+        index = cache->asset[index].older)
+    {
+        if(cache->asset[index].dev_id != 0)
+        {
+            testError("%s free slot %u holds %04X", p_name, index,
+                      cache->asset[index].dev_id);
+        }
+        free++;
+    }
+    if(used != p_model->count || free != cache->capacity - p_model->count)
+    {
+        testError("%s cache has %u hashed and %u free slots, %u assets",
+                  p_name, used, free, p_model->count);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testCheck
+ *
+ *  DESCRIPTION
+ *      Checks the handler against the model.
+ *
+ *----------------------------------------------------------------------------*/
+static void testCheck(void)
+{
+    const uint16 dev_id = testDevId();
+
+    testCheckCache("pending", &tracker_hdlr_data.pending, &g_pending, TRUE);
+    testCheckCache("tracker", &tracker_hdlr_data.tracker, &g_tracker, FALSE);
+
+    if((trackerFindAssetInCache(dev_id, &tracker_hdlr_data.tracker) != 0xFFFF)
+       != (testCacheFind(&g_tracker, dev_id) != NULL))
+    {
+        testError("asset %04X found in the asset cache wrongly", dev_id);
+    }
+
+    if((pending_cache_timer_tid != TIMER_INVALID) != g_pending_timer ||
+       (asset_cache_timer_tid != TIMER_INVALID) != g_asset_timer)
+    {
+        testError("timers running %u %u, %u %u expected",
+                  pending_cache_timer_tid != TIMER_INVALID,
+                  asset_cache_timer_tid != TIMER_INVALID, g_pending_timer,
+                  g_asset_timer);
+    }
+    if((g_pending_timer &&
+        tracker_hdlr_data.delayFactorTimerCount != g_delay_count) ||
+       (g_asset_timer && tracker_hdlr_data.secTimerCount != g_sec_count))
+    {
+        testError("timer counts %lu %lu, %lu %lu expected",
+                  (unsigned long)tracker_hdlr_data.delayFactorTimerCount,
+                  (unsigned long)tracker_hdlr_data.secTimerCount,
+                  (unsigned long)g_delay_count, (unsigned long)g_sec_count);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testPendingTick
+ *
+ *  DESCRIPTION
+ *      Pending cache timer. Moves the assets due in the model, the way
+ *      pendingCacheTimerHandler() should, then runs the handler.
+ *
+ *----------------------------------------------------------------------------*/
+static void testPendingTick(timer_id const tid)
+{
+    TEST_ASSET_T *p_asset, *p_cached;
+    CSRMESH_TRACKER_REPORT_T *p_report;
+    uint16 i = 0;
+    uint8 zone;
+
+    if(tid != pending_cache_timer_tid)
+    {
+        pendingCacheTimerHandler(tid);
+        return;
+    }
+
+    g_delay_count++;
+    g_report_count = 0;
+    g_report_next = 0;
+    while(i < g_pending.count)
+    {
+        p_asset = &g_pending.asset[i];
+        if(p_asset->due != g_delay_count)
+        {
+            i++;
+            continue;
+        }
+        if(!p_asset->marked)
+        {
+            p_cached = testCacheFind(&g_tracker, p_asset->dev_id);
+            if(p_cached == NULL)
+            {
+                p_cached = testCacheAdd(&g_tracker, p_asset->dev_id);
+                p_cached->heard = p_asset->heard;
+                p_cached->zone = MARK_FOR_DELETE;
+            }
+
+            zone = testZone(p_asset->rssi);
+            if(!((p_cached->elsewhere != 0 &&
+                  p_asset->rssi <= p_cached->elsewhere) ||
+                 (p_cached->elsewhere == 0 && p_cached->zone == zone &&
+                  p_cached->effects == p_asset->effects &&
+                  g_sec_count - p_cached->reported <
+                  TRACKER_REPORT_REFRESH)))
+            {
+                p_report = &g_reports[g_report_count++];
+                p_report->assetdeviceid = p_asset->dev_id;
+                p_report->sideeffects = p_asset->effects;
+                p_report->rssi = p_asset->rssi;
+                p_report->zone = zone;
+                p_report->ageseconds = (g_sec_count >= p_cached->heard) ?
+                    (g_sec_count - p_cached->heard) :
+                    ((0xFFFF - p_cached->heard) + g_sec_count);
+                p_cached->zone = zone;
+                p_cached->elsewhere = 0;
+                p_cached->reported = g_sec_count;
+            }
+            p_cached->effects = p_asset->effects;
+            p_cached->rssi = p_asset->rssi;
+            p_cached->due = g_sec_count + TEST_DELETE_INTERVAL;
+        }
+        testCacheRemove(&g_pending, p_asset);
+    }
+    g_pending_timer = (g_pending.count != 0);
+
+    pendingCacheTimerHandler(tid);
+    if(g_report_next != g_report_count)
+    {
+        testError("%u reports sent, %u expected", g_report_next,
+                  g_report_count);
+    }
+    g_report_count = 0;
+    testCheck();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testAssetTick
+ *
+ *  DESCRIPTION
+ *      Asset cache timer. Deletes the assets due in the model and forgets
+ *      old reports of other trackers, the way assetCacheTimerHandler()
+ *      should, then runs the handler.
+ *
+ *----------------------------------------------------------------------------*/
+static void testAssetTick(timer_id const tid)
+{
+    uint16 i = 0;
+
+    if(tid != asset_cache_timer_tid)
+    {
+        assetCacheTimerHandler(tid);
+        return;
+    }
+
+    g_sec_count++;
+    while(i < g_tracker.count)
+    {
+        if(g_tracker.asset[i].due == g_sec_count)
+        {
+            testCacheRemove(&g_tracker, &g_tracker.asset[i]);
+            continue;
+        }
+        if(g_tracker.asset[i].elsewhere != 0 &&
+           g_sec_count - g_tracker.asset[i].elsewhere_time >=
+           TRACKER_ELSEWHERE_TIMEOUT)
+        {
+            g_tracker.asset[i].elsewhere = 0;
+        }
+        i++;
+    }
+    if(g_pending.count == 0 && g_tracker.count == 0)
+    {
+        g_asset_timer = FALSE;
+        g_sec_count = 0;
+    }
+
+    assetCacheTimerHandler(tid);
+    testCheck();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testTimerCreate
+ *
+ *  DESCRIPTION
+ *      Creates a timer of the handler that runs through the test.
+ *
+ *----------------------------------------------------------------------------*/
+static timer_id testTimerCreate(uint32 const time, bool const relative,
+                                timer_callback_arg handler)
+{
+    return TimerCreate(time, relative,
+                       (handler == pendingCacheTimerHandler) ?
+                       testPendingTick : testAssetTick);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testEvent
+ *
+ *  DESCRIPTION
+ *      Passes a model message to the handler.
+ *
+ *----------------------------------------------------------------------------*/
+static void *testEvent(CSRMESH_MODEL_EVENT_T event_code, uint16 src_id,
+                       int8 rssi, void *p_data)
+{
+    CSRMESH_EVENT_DATA_T data;
+    void *state_data = NULL;
+
+    memset(&data, 0, sizeof(data));
+    data.src_id = src_id;
+    data.rx_rssi = rssi;
+    data.data = p_data;
+    trackerModelEventHandler(event_code, &data, 0, &state_data);
+    return state_data;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testAdvert
+ *
+ *  DESCRIPTION
+ *      Replays an asset advert, at times out of the RSSI range the handler
+ *      keeps to.
+ *
+ *----------------------------------------------------------------------------*/
+static void testAdvert(void)
+{
+    CSRMESH_ASSET_ANNOUNCE_T announce;
+    const uint16 dev_id = testDevId();
+    const int8 rx_rssi = -125 + (int8)testRandom(100);
+    const int8 rssi = (rx_rssi < ASSET_MIN_RSSI) ? ASSET_MIN_RSSI :
+                      (rx_rssi > ASSET_MAX_RSSI) ? ASSET_MAX_RSSI : rx_rssi;
+    TEST_ASSET_T *p_asset;
+
+    memset(&announce, 0, sizeof(announce));
+    announce.sideeffects = testRandom(8) ? 0 : testRandom(4);
+
+    p_asset = testCacheFind(&g_pending, dev_id);
+    if(p_asset != NULL)
+    {
+        p_asset = testCacheTouch(&g_pending, p_asset);
+        p_asset->rssi = rssi;
+        p_asset->heard = g_sec_count;
+    }
+    else
+    {
+        p_asset = testCacheAdd(&g_pending, dev_id);
+        p_asset->effects = announce.sideeffects;
+        p_asset->rssi = rssi;
+        if(!g_pending_timer)
+        {
+            g_pending_timer = TRUE;
+            g_delay_count = 0;
+        }
+        if(!g_asset_timer)
+        {
+            g_asset_timer = TRUE;
+            g_sec_count = 0;
+        }
+        p_asset->heard = g_sec_count;
+        p_asset->due = g_delay_count + (DEFAULT_DELAY_OFFSET - rssi);
+    }
+
+    p_asset = testCacheFind(&g_tracker, dev_id);
+    if(p_asset != NULL)
+    {
+        p_asset = testCacheTouch(&g_tracker, p_asset);
+        p_asset->heard = g_sec_count;
+        p_asset->rssi = rssi;
+        p_asset->effects = announce.sideeffects;
+        p_asset->due = g_sec_count + TEST_DELETE_INTERVAL;
+    }
+
+    g_stats.adverts++;
+    (void)testEvent(CSRMESH_ASSET_ANNOUNCE, dev_id, rx_rssi, &announce);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testReportIn
+ *
+ *  DESCRIPTION
+ *      Passes on a report of another tracker.
+ *
+ *----------------------------------------------------------------------------*/
+static void testReportIn(void)
+{
+    CSRMESH_TRACKER_REPORT_T report;
+    TEST_ASSET_T *p_asset;
+    int8 rssi;
+
+    memset(&report, 0, sizeof(report));
+    report.assetdeviceid = testDevId();
+    report.rssi = -110 + (int8)testRandom(70);
+    rssi = (int8)(0xFF00 | report.rssi);
+
+    p_asset = testCacheFind(&g_pending, report.assetdeviceid);
+    if(p_asset != NULL && rssi > p_asset->rssi)
+    {
+        p_asset->marked = TRUE;
+    }
+    p_asset = testCacheFind(&g_tracker, report.assetdeviceid);
+    if(p_asset != NULL && rssi > p_asset->rssi &&
+       (p_asset->elsewhere == 0 || rssi >= p_asset->elsewhere))
+    {
+        p_asset->elsewhere = rssi;
+        p_asset->elsewhere_time = g_sec_count;
+    }
+
+    g_stats.reports_in++;
+    (void)testEvent(CSRMESH_TRACKER_REPORT, 0x0001, -60, &report);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testFind
+ *
+ *  DESCRIPTION
+ *      Asks for an asset and checks the answer.
+ *
+ *----------------------------------------------------------------------------*/
+static void testFind(void)
+{
+    CSRMESH_TRACKER_FIND_T find;
+    const CSRMESH_TRACKER_FOUND_T *p_found;
+    const TEST_ASSET_T *p_asset;
+
+    find.assetdeviceid = testDevId();
+    find.tid = testRandom(256);
+    p_asset = testCacheFind(&g_tracker, find.assetdeviceid);
+    if(p_asset != NULL && p_asset->elsewhere != 0)
+    {
+        p_asset = NULL;
+    }
+
+    g_stats.finds++;
+    p_found = testEvent(CSRMESH_TRACKER_FIND, 0x0001, -60, &find);
+    if((p_found != NULL) != (p_asset != NULL))
+    {
+        testError("find of %04X answered %u, %u expected",
+                  find.assetdeviceid, p_found != NULL, p_asset != NULL);
+    }
+    else if(p_found != NULL)
+    {
+        g_stats.found++;
+        if(p_found->assetdeviceid != find.assetdeviceid ||
+           p_found->tid != find.tid || p_found->rssi != p_asset->rssi ||
+           p_found->zone != p_asset->zone ||
+           p_found->sideeffects != p_asset->effects)
+        {
+            testError("find of %04X answered wrongly", find.assetdeviceid);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testClear
+ *
+ *  DESCRIPTION
+ *      Clears both caches.
+ *
+ *----------------------------------------------------------------------------*/
+static void testClear(void)
+{
+    g_pending.count = 0;
+    g_tracker.count = 0;
+    g_stats.clears++;
+    (void)testEvent(CSRMESH_TRACKER_CLEAR_CACHE, 0x0001, -60, NULL);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testInitDevIds
+ *
+ *  DESCRIPTION
+ *      Picks the device IDs of the assets: a run of consecutive IDs, as a
+ *      commissioned site has, and random ones, some of which share the low
+ *      byte with others.
+ *
+ *----------------------------------------------------------------------------*/
+static void testInitDevIds(void)
+{
+    uint16 i, j, dev_id;
+
+    for(i = 0;i < TEST_ASSETS;i++)
+    {
+        do
+        {
+            if(i % 3 == 0)
+            {
+                dev_id = TEST_FIRST_DEV_ID + i;
+            }
+            else if(i % 3 == 1)
+            {
+                dev_id = (testRandom(0xFF) + 1) << 8 |
+                         (g_dev_ids[i - 1] & 0xFF);
+            }
+            else
+            {
+                dev_id = testRandom(0xFFFE) + 1;
+            }
+            for(j = 0;j < i && g_dev_ids[j] != dev_id;j++)
+            {
+            }
+
+            /* The run is kept for the consecutive IDs still to come */
+            if(i % 3 != 0 &&
+               (uint16)(dev_id - TEST_FIRST_DEV_ID) < TEST_ASSETS)
+            {
+                j = 0;
+            }
+        }while(j < i);
+        g_dev_ids[i] = dev_id;
+    }
+
+    /* The busy assets are spread over the kinds */
+    for(i = 0;i < TEST_ASSETS;i++)
+    {
+        j = testRandom(TEST_ASSETS);
+        dev_id = g_dev_ids[i];
+        g_dev_ids[i] = g_dev_ids[j];
+        g_dev_ids[j] = dev_id;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      oldFindAssetInCache, oldFindFreeSlotInCache
+ *
+ *  DESCRIPTION
+ *      Copies of the linear scans of the handler before the hash index. The
+ *      time now is passed in place of tracker_hdlr_data.secTimerCount.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 oldFindAssetInCache(uint16 device_id, ASSET_INFO_T asset_cache[],
+                                  uint16 asset_count)
+{
+    uint16 index;
+
+    for(index = 0; index < asset_count; index++)
+    {
+        if(asset_cache[index].dev_id == device_id)
+        {
+            return index;
+        }
+    }
+    return 0xFFFF;
+}
+
+static uint16 oldFindFreeSlotInCache(ASSET_INFO_T asset_cache[],
+                                     uint16 asset_count, uint32 now)
+{
+    uint16 index;
+    uint16 oldest_index=0, max_age_seconds=0, age_seconds;
+
+    for(index = 0; index < asset_count; index++)
+    {
+        if(asset_cache[index].dev_id == 0x00)
+        {
+            return index;
+        }
+    }
+
+    for(index = 0; index < asset_count; index++)
+    {
+        age_seconds = (now > asset_cache[index].timeLastHeard) ?
+                        (now - asset_cache[index].timeLastHeard) :
+                        ((0xFFFF - asset_cache[index].timeLastHeard) + now);
+
+        if(age_seconds > max_age_seconds)
+        {
+            max_age_seconds = age_seconds;
+            oldest_index = index;
+        }
+    }
+    return oldest_index;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchTime
+ *
+ *  DESCRIPTION
+ *      Returns the time of day in seconds.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchTime(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchOld, benchNew
+ *
+ *  DESCRIPTION
+ *      Replay the adverts of the benchmark through the old scans or the
+ *      hash index of the handler, with the advert number as the time each
+ *      asset is heard, and return the lookups per second. The lookups that
+ *      found the asset are counted in *p_hits.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchOld(uint32 *p_hits)
+{
+    uint32 advert, hits = 0;
+    uint16 dev_id, index;
+    double start;
+
+    memset(g_old_pending, 0, sizeof(g_old_pending));
+    memset(g_old_tracker, 0, sizeof(g_old_tracker));
+
+    start = benchTime();
+    for(advert = 1;advert <= BENCH_ADVERTS;advert++)
+    {
+        dev_id = g_bench_dev_ids[advert - 1];
+
+        index = oldFindAssetInCache(dev_id, g_old_pending,
+                                    TRACKER_MAX_PENDING_ASSETS);
+        if(index != 0xFFFF)
+        {
+            hits++;
+        }
+        else
+        {
+            index = oldFindFreeSlotInCache(g_old_pending,
+                                           TRACKER_MAX_PENDING_ASSETS,
+                                           advert);
+            g_old_pending[index].dev_id = dev_id;
+        }
+        g_old_pending[index].timeLastHeard = advert;
+
+        index = oldFindAssetInCache(dev_id, g_old_tracker,
+                                    TRACKER_MAX_CACHED_ASSETS);
+        if(index != 0xFFFF)
+        {
+            hits++;
+        }
+        else
+        {
+            index = oldFindFreeSlotInCache(g_old_tracker,
+                                           TRACKER_MAX_CACHED_ASSETS,
+                                           advert);
+            g_old_tracker[index].dev_id = dev_id;
+        }
+        g_old_tracker[index].timeLastHeard = advert;
+    }
+
+    *p_hits = hits;
+    return 2.0 * BENCH_ADVERTS / (benchTime() - start);
+}
+
+static double benchNew(uint32 *p_hits)
+{
+    ASSET_CACHE_T *const p_pending = &tracker_hdlr_data.pending;
+    ASSET_CACHE_T *const p_tracker = &tracker_hdlr_data.tracker;
+    uint32 advert, hits = 0;
+    uint16 dev_id, index;
+    double start;
+
+    trackerClearCache(p_pending);
+    trackerClearCache(p_tracker);
+
+    start = benchTime();
+    for(advert = 1;advert <= BENCH_ADVERTS;advert++)
+    {
+        dev_id = g_bench_dev_ids[advert - 1];
+
+        index = trackerFindAssetInCache(dev_id, p_pending);
+        if(index != 0xFFFF)
+        {
+            hits++;
+            trackerTouchAssetInCache(p_pending, index);
+        }
+        else
+        {
+            index = trackerAddAssetToCache(dev_id, p_pending);
+        }
+        p_pending->asset[index].timeLastHeard = advert;
+
+        index = trackerFindAssetInCache(dev_id, p_tracker);
+        if(index != 0xFFFF)
+        {
+            hits++;
+            trackerTouchAssetInCache(p_tracker, index);
+        }
+        else
+        {
+            index = trackerAddAssetToCache(dev_id, p_tracker);
+        }
+        p_tracker->asset[index].timeLastHeard = advert;
+    }
+
+    *p_hits = hits;
+    return 2.0 * BENCH_ADVERTS / (benchTime() - start);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchLookups
+ *
+ *  DESCRIPTION
+ *      Replays adverts mostly from the busy assets, then from all assets
+ *      evenly, and prints the lookups per second of the old scans and the
+ *      hash index side by side.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchLookups(void)
+{
+    static const char *const names[] = {"busy", "even"};
+    double old_rate, new_rate;
+    uint32 old_hits, new_hits, i;
+    uint16 mix;
+
+    printf("tracker cache replay, %u assets %u pending, %u adverts from %u "
+           "assets\n", TRACKER_MAX_CACHED_ASSETS, TRACKER_MAX_PENDING_ASSETS,
+           BENCH_ADVERTS, TEST_ASSETS);
+    printf("%5s %5s | %9s %9s | %7s\n", "mix", "hits", "old M/s",
+           "new M/s", "new/old");
+    for(mix = 0;mix < 2;mix++)
+    {
+        for(i = 0;i < BENCH_ADVERTS;i++)
+        {
+            g_bench_dev_ids[i] = (mix == 0) ? testDevId() :
+                                 g_dev_ids[testRandom(TEST_ASSETS)];
+        }
+        old_rate = benchOld(&old_hits);
+        new_rate = benchNew(&new_hits);
+        if(old_hits != new_hits)
+        {
+            testError("%s adverts: %lu lookups hit with the scans, %lu with "
+                      "the index", names[mix], (unsigned long)old_hits,
+                      (unsigned long)new_hits);
+        }
+        printf("%5s %4lu%% | %9.2f %9.2f | %7.2f\n", names[mix],
+               (unsigned long)(new_hits / (2 * BENCH_ADVERTS / 100)),
+               old_rate / 1e6, new_rate / 1e6, new_rate / old_rate);
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TrackerReport
+ *
+ *  DESCRIPTION
+ *      Checks a report sent against the ones the model expects.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult TrackerReport(CsrUint8 nw_id, CsrUint16 dest_id,
+                                   CsrUint8 ttl,
+                                   CSRMESH_TRACKER_REPORT_T *p_params)
+{
+    const CSRMESH_TRACKER_REPORT_T *p_report = &g_reports[g_report_next];
+
+    g_stats.reports_out++;
+    if(g_report_next >= g_report_count)
+    {
+        testError("report of %04X sent, none expected",
+                  p_params->assetdeviceid);
+        return CSR_MESH_RESULT_SUCCESS;
+    }
+    g_report_next++;
+    if(p_params->assetdeviceid != p_report->assetdeviceid ||
+       p_params->sideeffects != p_report->sideeffects ||
+       p_params->rssi != p_report->rssi || p_params->zone != p_report->zone ||
+       p_params->ageseconds != p_report->ageseconds ||
+       dest_id != MESH_BROADCAST_ID)
+    {
+        testError("report of %04X zone %u rssi %d age %u sent, %04X %u %d %u"
+                  " expected", p_params->assetdeviceid, p_params->zone,
+                  p_params->rssi, p_params->ageseconds,
+                  p_report->assetdeviceid, p_report->zone, p_report->rssi,
+                  p_report->ageseconds);
+    }
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TrackerModelInit, TrackerModelClientInit, AssetModelClientInit,
+ *      AppGetCurrentTTL, Nvm_Read, Nvm_Write
+ *
+ *  DESCRIPTION
+ *      Not used by the test.
+ *
+ *----------------------------------------------------------------------------*/
+extern CSRmeshResult TrackerModelInit(CsrUint8 nw_id, CsrUint16 *group_id_list,
+                                      CsrUint16 num_groups,
+                                      CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+extern CSRmeshResult TrackerModelClientInit(
+                                       CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+extern CSRmeshResult AssetModelClientInit(
+                                       CSRMESH_MODEL_CALLBACK_T app_callback)
+{
+    return CSR_MESH_RESULT_SUCCESS;
+}
+
+extern uint8 AppGetCurrentTTL(void)
+{
+    return DEFAULT_TTL_VALUE;
+}
+
+extern void Nvm_Read(uint16* buffer, uint16 length, uint16 offset)
+{
+    memset(buffer, 0xFF, length);
+}
+
+extern void Nvm_Write(uint16* buffer, uint16 length, uint16 offset)
+{
+}
+
+int main(int argc, char *argv[])
+{
+    uint32 steps = 300000, step, r;
+    uint32 seed = 1;
+    bool bench = FALSE;
+    int opt;
+
+    while((opt = getopt(argc, argv, "bn:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': bench = TRUE; break;
+            case 'n': steps = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-b] [-n steps] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    HostReset();
+    TrackerModelDataInit();
+    tracker_hdlr_data.assetDeleteInterval = TEST_DELETE_INTERVAL;
+    g_pending.capacity = TRACKER_MAX_PENDING_ASSETS;
+    g_tracker.capacity = TRACKER_MAX_CACHED_ASSETS;
+    testInitDevIds();
+    testCheck();
+
+    if(bench)
+    {
+        benchLookups();
+        return g_errors ? 1 : 0;
+    }
+
+    for(step = 0;step < steps && g_errors < TEST_MAX_ERRORS;step++)
+    {
+        r = testRandom(1000);
+        if(r < 850)
+        {
+            testAdvert();
+        }
+        else if(r < 920)
+        {
+            testReportIn();
+        }
+        else if(r < 999)
+        {
+            testFind();
+        }
+        else
+        {
+            testClear();
+        }
+        testCheck();
+
+        /* Adverts come in bursts, with quiet spells now and then */
+        HostRunUntil(TimeGet32() + (testRandom(50) ?
+                                    testRandom(40 * MILLISECOND) :
+                                    testRandom(30 * SECOND)));
+    }
+
+    printf("tracker cache, %u assets %u pending: %lu steps, %lu adverts, "
+           "%lu reports in, %lu sent, %lu of %lu finds answered, %lu evicted,"
+           " %lu clears, %u errors\n", TRACKER_MAX_CACHED_ASSETS,
+           TRACKER_MAX_PENDING_ASSETS, (unsigned long)step,
+           (unsigned long)g_stats.adverts, (unsigned long)g_stats.reports_in,
+           (unsigned long)g_stats.reports_out, (unsigned long)g_stats.found,
+           (unsigned long)g_stats.finds, (unsigned long)g_stats.evicted,
+           (unsigned long)g_stats.clears, g_errors);
+    return g_errors ? 1 : 0;
+}
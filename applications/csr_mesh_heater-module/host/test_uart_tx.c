@@ -0,0 +1,535 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_uart_tx.c
+ *
+ *  DESCRIPTION
+ *      Test of the Wi-Fi frame serializer of uart_time.c. Random EE EE,
+ *      EE AA and DD frames are sent through processuartdata() on a v1 link
+ *      and the bytes written to the UART are compared with the frames the
+ *      old builder made from the same data, a copy of which is kept here:
+ *      it filled the WifiTxData[] array, appended the BCC and queued the
+ *      frame whole if the transmit queue had room for it.
+ *
+ *      Part of the time the UART refuses data, so frames pile up in the
+ *      transmit queue, wrap around its end and are dropped once it is full,
+ *      as they were by the old builder. Frames longer than the 40 byte
+ *      array of the old builder, which it overran, must be dropped.
+ *
+ *      With -b it instead times each frame type and length sent the old way
+ *      and the new way and prints the time per frame side by side. The old
+ *      way is the old builder queued whole as SendDataToUart() did, after
+ *      processuartdata() ran with no frame to send, the new way is
+ *      processuartdata() sending the frame. Both drain the queue into the
+ *      UART, and the bytes they write must be the same.
+ *
+ *      test_uart_tx [-b] [-n frames] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include <uart.h>
+#include "user_config.h"
+#include "define.h"
+#include "label.h"
+#include "app_event.h"
+#include "timer_wheel.h"
+#include "byte_queue.h"
+#include "host_sdk.h"
+#include "host_uart.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Size of WifiTxData[] of the old builder */
+#define TEST_OLD_FRAME_SIZE          (40)
+
+/* Longest mesh message length field that fits the old builder */
+#define TEST_MAX_MESSAGE_LENGTH      (TEST_OLD_FRAME_SIZE - 5)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+
+/* Frames of each type and length the benchmark times */
+#define BENCH_FRAMES                 (500000)
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Frames the old builder would have queued and the test has not yet taken
+ * from the UART, the bytes in the transmit queue once it has
+ */
+static uint8 g_expected[HOST_UART_TX_SIZE];
+static uint16 g_expected_len;
+
+/* Frames the old builder would not have queued */
+static uint32 g_dropped;
+
+static uint16 g_errors;
+static uint32 g_random;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_uart_tx: ");
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testOldFrame
+ *
+ *  DESCRIPTION
+ *      Builds a frame from BLE_RX_DATA and the status globals the way the
+ *      old WifiTxDataEEEE(), WifiTxDataEEAA() and WifiTxDataDD() did, with
+ *      WifiTxGetBcc() and the length SendDataToUart() queued. Returns the
+ *      frame length.
+ *
+ *----------------------------------------------------------------------------*/
+static uint16 testOldFrame(uint8 type, uint8 *p_frame)
+{
+    TYPE_BYTE WifiTxData[TEST_OLD_FRAME_SIZE];
+    uint8 size_val = 0;
+    uint8 bcc = 0;
+    uint8 i;
+
+    memset(WifiTxData, 0, sizeof(WifiTxData));
+    if(type == 0xDD)
+    {
+        WifiTxData[0].byte = 0xDD;
+        WifiTxData[1].byte = 0xDD;
+        WifiTxData[2].byte = 0x00;
+        WifiTxData[3].byte = 0x0A;
+        WifiTxData[4].byte = 0x01;
+        WifiTxData[5].byte = Signal_Intensity;
+        WifiTxData[6].byte = Mesh_status;
+        WifiTxData[7].byte = Con_Mobile_Num;
+        WifiTxData[8].byte = (Local_MESH_ID >> 8) & 0xff;
+        WifiTxData[9].byte = Local_MESH_ID & 0xff;
+        WifiTxData[10].byte = (Gateway_MsgID >> 8) & 0xff;
+        WifiTxData[11].byte = Gateway_MsgID & 0xff;
+    }
+    else
+    {
+        WifiTxData[0].byte = 0xEE;
+        WifiTxData[1].byte = type;
+        WifiTxData[2].byte = BLE_RX_DATA[1];
+        WifiTxData[4].byte = RX_MESH_ID & 0x00FF;
+        WifiTxData[3].byte = (RX_MESH_ID >> 8) & 0x00FF;
+        WifiTxData[5].byte = BLE_RX_DATA[2] + 2;
+        for(i = 6;i < (WifiTxData[5].byte + 2);i++)
+        {
+            WifiTxData[i].byte = BLE_RX_DATA[i-3];
+        }
+    }
+
+    /* WifiTxGetBcc() */
+    if(WifiTxData[1].byte == 0xEE || WifiTxData[1].byte == 0xAA)
+        size_val = WifiTxData[5].byte + 2;
+    else if(WifiTxData[0].byte == 0xDD && WifiTxData[1].byte == 0xDD)
+        size_val = WifiTxData[3].byte + 2;
+    for(i = 2;i < size_val;i++)
+    {
+        bcc ^= WifiTxData[i].byte;
+    }
+    WifiTxData[size_val].byte = bcc;
+
+    /* SendDataToUart() */
+    for(i = 0;i < size_val + 1;i++)
+    {
+        p_frame[i] = WifiTxData[i].byte;
+    }
+    return size_val + 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testTakeOutput
+ *
+ *  DESCRIPTION
+ *      Compares the bytes written to the UART with the expected frames.
+ *
+ *----------------------------------------------------------------------------*/
+static void testTakeOutput(void)
+{
+    uint8 data[HOST_UART_TX_SIZE];
+    uint16 len;
+
+    len = HostUartTxTake(data, sizeof(data));
+    if(len > g_expected_len)
+    {
+        testError("%u bytes written, %u expected", len, g_expected_len);
+        len = g_expected_len;
+    }
+    if(memcmp(data, g_expected, len) != 0)
+    {
+        testError("bytes written differ from the old builder");
+    }
+    memmove(g_expected, &g_expected[len], g_expected_len - len);
+    g_expected_len -= len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testFrame
+ *
+ *  DESCRIPTION
+ *      Sends one random frame of type, with a mesh message length field of
+ *      up to max_len.
+ *
+ *----------------------------------------------------------------------------*/
+static void testFrame(uint8 type, uint16 max_len)
+{
+    uint8 frame[TEST_OLD_FRAME_SIZE];
+    uint16 len = 0, i;
+
+    if(type == 0xDD)
+    {
+        Signal_Intensity = testRandom(256);
+        Mesh_status = testRandom(256);
+        Con_Mobile_Num = testRandom(256);
+        Local_MESH_ID = testRandom(0x10000);
+        Gateway_MsgID = testRandom(256);
+    }
+    else
+    {
+        memset(BLE_RX_DATA, 0, sizeof(BLE_RX_DATA));
+        BLE_RX_DATA[0] = 0x7E;
+        BLE_RX_DATA[1] = testRandom(256);
+        BLE_RX_DATA[2] = 2 + testRandom(max_len - 1);
+        for(i = 3;i < BLE_RX_DATA[2] + 2;i++)
+        {
+            BLE_RX_DATA[i] = testRandom(256);
+        }
+        RX_MESH_ID = testRandom(0x10000);
+    }
+
+    if(type != 0xDD && BLE_RX_DATA[2] > TEST_MAX_MESSAGE_LENGTH)
+    {
+        g_dropped++;
+    }
+    else
+    {
+        len = testOldFrame(type, frame);
+        if(len <= RECV_QUEUE_SIZE - g_expected_len)
+        {
+            memcpy(&g_expected[g_expected_len], frame, len);
+            g_expected_len += len;
+        }
+        else
+        {
+            g_dropped++;
+        }
+    }
+
+    UartTxDataType = type;
+    processuartdata();
+    if(UartTxDataType != CLEAR)
+    {
+        testError("frame %02X not taken", type);
+    }
+    if(type != 0xDD && RX_MESH_ID != CLEAR)
+    {
+        testError("RX_MESH_ID not cleared");
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testTick
+ *
+ *  DESCRIPTION
+ *      Tick handler, the test calls processuartdata() itself.
+ *
+ *----------------------------------------------------------------------------*/
+static bool testTick(void)
+{
+    AEDispatch();
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchTime
+ *
+ *  DESCRIPTION
+ *      Returns the time of day in seconds.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchTime(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchOldSend
+ *
+ *  DESCRIPTION
+ *      Sends the frame in BLE_RX_DATA and the status globals the old way:
+ *      built by the old builder, cleared up after as the old WifiTxDataEEEE()
+ *      and WifiTxDataEEAA() did, queued whole if there is room and drained
+ *      into the UART as SendDataToUart() does.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchOldSend(uint8 type)
+{
+    uint8 frame[TEST_OLD_FRAME_SIZE];
+    const uint8 *p_data;
+    uint16 len, i;
+
+    len = testOldFrame(type, frame);
+    if(type == 0xEE)
+    {
+        TWStart(TM_SEND_EE_WAIT, C_T_tSendWait800ms);
+    }
+    if(type != 0xDD)
+    {
+        RX_MESH_ID = CLEAR;
+        for(i = 0;i < sizeof(BLE_RX_DATA);i++)
+        {
+            BLE_RX_DATA[i] = 0;
+        }
+    }
+    (void)BQSafeQueueBytes(frame, len, RECV_QUEUE_ID);
+
+    while((len = BQGetReadSpan(&p_data, RECV_QUEUE_ID)) > 0)
+    {
+        if(len > SERIAL_RX_DATA_LENGTH)
+        {
+            len = SERIAL_RX_DATA_LENGTH;
+        }
+        if(!UartWrite(p_data, len))
+        {
+            break;
+        }
+        BQCommitRead(len, RECV_QUEUE_ID);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchRun
+ *
+ *  DESCRIPTION
+ *      Sends BENCH_FRAMES frames of type with a mesh message length field of
+ *      msg_len, the old way or the new, and returns the time per frame in
+ *      nanoseconds. The bytes written to the UART are summed into *p_sum.
+ *
+ *----------------------------------------------------------------------------*/
+static double benchRun(bool old, uint8 type, uint8 msg_len, uint32 *p_sum)
+{
+    uint8 data[HOST_UART_TX_SIZE];
+    uint32 frame, sum = 0;
+    uint16 len, i;
+    double start;
+
+    start = benchTime();
+    for(frame = 0;frame < BENCH_FRAMES;frame++)
+    {
+        if(type == 0xDD)
+        {
+            Local_MESH_ID = (uint16)frame;
+        }
+        else
+        {
+            BLE_RX_DATA[0] = 0x7E;
+            BLE_RX_DATA[1] = (uint8)frame;
+            BLE_RX_DATA[2] = msg_len;
+            for(i = 3;i < msg_len + 2;i++)
+            {
+                BLE_RX_DATA[i] = (uint8)(frame + i);
+            }
+            RX_MESH_ID = (uint16)frame;
+        }
+
+        if(old)
+        {
+            processuartdata();
+            benchOldSend(type);
+        }
+        else
+        {
+            UartTxDataType = type;
+            processuartdata();
+        }
+
+        len = HostUartTxTake(data, sizeof(data));
+        for(i = 0;i < len;i++)
+        {
+            sum += data[i];
+        }
+    }
+
+    *p_sum = sum;
+    return (benchTime() - start) * 1e9 / BENCH_FRAMES;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchFrames
+ *
+ *  DESCRIPTION
+ *      Times every frame type and a few message lengths and prints the time
+ *      per frame of the old and new way side by side.
+ *
+ *----------------------------------------------------------------------------*/
+static void benchFrames(void)
+{
+    static const uint8 types[] = {0xEE, 0xAA, 0xDD};
+    static const uint8 lens[] = {2, 16, TEST_MAX_MESSAGE_LENGTH};
+    double old_ns, new_ns;
+    uint32 old_sum, new_sum;
+    uint16 t, l;
+
+    printf("uart tx, ns per frame\n");
+    printf("%5s %6s | %8s %8s | %7s\n", "frame", "length", "old", "new",
+           "old/new");
+    for(t = 0;t < sizeof(types);t++)
+    {
+        for(l = 0;l < sizeof(lens);l++)
+        {
+            /* A DD frame has no message, one length is enough */
+            if(types[t] == 0xDD && l != 0)
+            {
+                break;
+            }
+            old_ns = benchRun(TRUE, types[t], lens[l], &old_sum);
+            new_ns = benchRun(FALSE, types[t], lens[l], &new_sum);
+            if(old_sum != new_sum)
+            {
+                testError("%02X frames of %u: bytes written differ",
+                          types[t], lens[l]);
+            }
+            printf("%5X %6u | %8.1f %8.1f | %7.2f\n", types[t],
+                   types[t] == 0xDD ? 0x0A : lens[l], old_ns, new_ns,
+                   old_ns / new_ns);
+        }
+    }
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static const uint8 types[] = {0xEE, 0xAA, 0xDD};
+    uint32 frames = 20000, frame;
+    uint32 seed = 1;
+    bool bench = FALSE;
+    int opt;
+
+    while((opt = getopt(argc, argv, "bn:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': bench = TRUE; break;
+            case 'n': frames = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-b] [-n frames] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    /* Start up as main_app.c does and wait until frames may be sent */
+    HostReset();
+    HostUartReset();
+    TWInit();
+    AEInit();
+    InitUart();
+    TWStartTick(testTick);
+    HostRunUntil(C_T_OnTimeWait3s * TW_TICK_MS * MILLISECOND + SECOND);
+    processuartdata();
+
+    if(bench)
+    {
+        benchFrames();
+        return g_errors ? 1 : 0;
+    }
+
+    for(frame = 0;frame < frames && g_errors < TEST_MAX_ERRORS;frame++)
+    {
+        /* Stall the UART now and then, so frames queue up */
+        if(testRandom(20) == 0)
+        {
+            HostUartTxStall(TRUE);
+        }
+        else if(testRandom(4) == 0)
+        {
+            HostUartTxStall(FALSE);
+        }
+        testTakeOutput();
+
+        if(testRandom(50) == 0)
+        {
+            /* Too long for the old builder and for a frame */
+            testFrame(types[testRandom(2)], MESH_DATA_MAX_LENGTH - 3);
+        }
+        else
+        {
+            testFrame(types[testRandom(3)], TEST_MAX_MESSAGE_LENGTH);
+        }
+        testTakeOutput();
+    }
+    HostUartTxStall(FALSE);
+    testTakeOutput();
+    if(g_expected_len != 0)
+    {
+        testError("%u bytes never written", g_expected_len);
+    }
+
+    printf("uart tx: %lu frames, %lu dropped, %u errors\n",
+           (unsigned long)frame, (unsigned long)g_dropped, g_errors);
+    return g_errors ? 1 : 0;
+}
@@ -0,0 +1,754 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      test_wifi_batch.c
+ *
+ *  DESCRIPTION
+ *      Test of the BB batch frames of uart_time.c and wifi_link.c. The test
+ *      plays the Wi-Fi module: it opens v2 with a hello offering random
+ *      capabilities, acknowledges the frames it receives and now and then
+ *      stops answering, so the link falls back to v1 after its resends, or
+ *      sends a v1 frame, which makes it fall back at once. Bursts of random
+ *      mesh messages are sent meanwhile.
+ *
+ *      Every message must reach the module once, in order, as a record of a
+ *      batch frame or as a frame of its own. Batch frames must only be sent
+ *      over v2 with the batch capability agreed, must hold no more than
+ *      WIFI_BATCH_MAX_LENGTH bytes of records and must only go out short of
+ *      WIFI_BATCH_FLUSH_LENGTH if the next message does not fit or the first
+ *      record has waited for the batch timer. While the module answers a
+ *      message has to arrive within the batch timer and a few ticks.
+ *
+ *      test_wifi_batch [-n messages] [-s seed]
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Host Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "define.h"
+#include "label.h"
+#include "app_event.h"
+#include "timer_wheel.h"
+#include "frame_queue.h"
+#include "wifi_link.h"
+#include "crc16.h"
+#include "host_sdk.h"
+#include "host_uart.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Messages sent and not yet received by the module */
+#define TEST_MAX_PENDING             (64)
+
+/* Longest mesh message length field sent, the longest a frame can carry */
+#define TEST_MAX_MESSAGE_LENGTH      (WIFI_FRAME_MAX_LENGTH - 5)
+
+/* Bytes of a batch record ahead of the message data */
+#define TEST_RECORD_HEADER           (5)
+
+/* Time a batch may wait before it is sent, one tick short of the batch
+ * timer as the timer starts part way through a tick
+ */
+#define TEST_BATCH_WAIT              ((C_T_tWifiBatch50ms - 1) * \
+                                      TW_TICK_MS * MILLISECOND)
+
+/* Longest time a message may take to reach the module while it answers */
+#define TEST_MAX_LATENCY             ((C_T_tWifiBatch50ms + 3) * \
+                                      TW_TICK_MS * MILLISECOND)
+
+/* Errors after which the test stops */
+#define TEST_MAX_ERRORS              (10)
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Mesh message sent to the module */
+typedef struct
+{
+    uint8 type;
+    uint8 msg_id;
+    uint16 mesh_id;
+    uint8 n;
+    uint8 data[TEST_MAX_MESSAGE_LENGTH];
+
+    /* Time the message was handed to uart_time.c */
+    uint32 time;
+
+    /* TRUE if it must arrive within TEST_MAX_LATENCY */
+    bool timed;
+}TEST_MESSAGE_T;
+
+/* Module side of the link */
+typedef enum
+{
+    /* v1, no hello sent yet or fallen back */
+    TEST_LINK_V1,
+
+    /* Hello sent, waiting for the answer */
+    TEST_LINK_HELLO,
+
+    /* v2 open, frames are acknowledged */
+    TEST_LINK_V2,
+
+    /* v2 open, frames are ignored as if lost */
+    TEST_LINK_SILENT
+}TEST_LINK_T;
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Messages not yet received, oldest first */
+static TEST_MESSAGE_T g_pending[TEST_MAX_PENDING];
+static uint16 g_pending_head;
+static uint16 g_pending_count;
+
+/* Bytes written by the firmware and not yet parsed */
+static uint8 g_rx[HOST_UART_TX_SIZE];
+static uint16 g_rx_len;
+
+/* Module state */
+static TEST_LINK_T g_link;
+static uint8 g_offered;
+static uint8 g_caps;
+static uint8 g_rx_seq;
+
+/* Counts for the summary */
+static uint32 g_batches;
+static uint32 g_records;
+static uint32 g_frames;
+static uint32 g_fallbacks;
+static uint32 g_max_latency;
+
+static uint16 g_errors;
+static uint32 g_random;
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testError
+ *
+ *  DESCRIPTION
+ *      Reports an error.
+ *
+ *----------------------------------------------------------------------------*/
+static void testError(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    fprintf(stderr, "test_wifi_batch: %lu ms: ",
+            (unsigned long)(TimeGet32() / MILLISECOND));
+    vfprintf(stderr, p_format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    g_errors++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRandom
+ *
+ *  DESCRIPTION
+ *      Returns a random number below range.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 testRandom(uint32 range)
+{
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random % range;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testPending
+ *
+ *  DESCRIPTION
+ *      Returns the i-th message not yet received, NULL if there is none.
+ *
+ *----------------------------------------------------------------------------*/
+static TEST_MESSAGE_T *testPending(uint16 i)
+{
+    if(i >= g_pending_count)
+    {
+        return NULL;
+    }
+    return &g_pending[(g_pending_head + i) % TEST_MAX_PENDING];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSendFrame
+ *
+ *  DESCRIPTION
+ *      Appends the check to a frame from the module and passes it to the
+ *      firmware. A hello is always checked by BCC.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSendFrame(uint8 *p_frame, uint16 len, bool crc)
+{
+    uint8 bcc = 0;
+    uint16 i;
+
+    if(crc)
+    {
+        const uint16 value = CRC16Block(CRC16_INIT, &p_frame[2], len - 2);
+
+        p_frame[len++] = (value >> 8) & 0xFF;
+        p_frame[len++] = value & 0xFF;
+    }
+    else
+    {
+        for(i = 2;i < len;i++)
+        {
+            bcc ^= p_frame[i];
+        }
+        p_frame[len++] = bcc;
+    }
+    HostUartRx(p_frame, len);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSendAck
+ *
+ *  DESCRIPTION
+ *      Acknowledges the frames received so far.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSendAck(void)
+{
+    uint8 frame[10] = {WIFI_LINK_FRAME_V2, WIFI_LINK_TYPE_ACK, 0x00, 0x00,
+                       0x00, 0x04, 0x00};
+
+    frame[7] = g_rx_seq;
+    testSendFrame(frame, 8, (g_caps & WIFI_LINK_CAP_CRC16) != 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSendHello
+ *
+ *  DESCRIPTION
+ *      Opens v2 with random capabilities and a random first sequence number.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSendHello(void)
+{
+    static const uint8 offers[] = {0x00, WIFI_LINK_CAP_CRC16,
+                                   WIFI_LINK_CAP_BATCH, WIFI_LINK_CAP_BATCH,
+                                   WIFI_LINK_CAPS, WIFI_LINK_CAPS, 0xFF};
+    uint8 frame[10] = {WIFI_LINK_FRAME_V2, WIFI_LINK_TYPE_ACK,
+                       WIFI_LINK_ACK_HELLO, 0x00, 0x00, 0x05};
+
+    g_offered = offers[testRandom(sizeof(offers))];
+    g_rx_seq = testRandom(256);
+    frame[6] = g_offered;
+    frame[7] = 0x00;
+    frame[8] = g_rx_seq;
+    g_link = TEST_LINK_HELLO;
+    g_caps = 0;
+    testSendFrame(frame, 9, FALSE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSendLegacy
+ *
+ *  DESCRIPTION
+ *      Sends a v1 frame, as a module restarted as a v1 one would.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSendLegacy(void)
+{
+    uint8 frame[8] = {0xEE, 0xEE, 0x00, 0x00, 0x01, 0x04};
+
+    g_link = TEST_LINK_V1;
+    g_caps = 0;
+    g_fallbacks++;
+    testSendFrame(frame, 6, FALSE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testReceive
+ *
+ *  DESCRIPTION
+ *      Checks one message received by the module against the oldest one
+ *      sent.
+ *
+ *----------------------------------------------------------------------------*/
+static void testReceive(uint8 type, uint8 msg_id, uint16 mesh_id, uint8 n,
+                        const uint8 *p_data)
+{
+    TEST_MESSAGE_T *p_message = testPending(0);
+    const uint32 latency = (p_message != NULL) ?
+                           TimeGet32() - p_message->time : 0;
+
+    if(p_message == NULL)
+    {
+        testError("message %02X from %04X received, none sent", msg_id,
+                  mesh_id);
+        return;
+    }
+    if(type != p_message->type || msg_id != p_message->msg_id ||
+       mesh_id != p_message->mesh_id || n != p_message->n ||
+       memcmp(p_data, p_message->data, n) != 0)
+    {
+        testError("message %02X %02X from %04X, %u bytes received, "
+                  "%02X %02X from %04X, %u bytes sent", type, msg_id,
+                  mesh_id, n, p_message->type, p_message->msg_id,
+                  p_message->mesh_id, p_message->n);
+    }
+    if(p_message->timed && latency > TEST_MAX_LATENCY)
+    {
+        testError("message %02X received after %lu ms", msg_id,
+                  (unsigned long)(latency / MILLISECOND));
+    }
+    if(p_message->timed && latency > g_max_latency)
+    {
+        g_max_latency = latency;
+    }
+    g_pending_head = (g_pending_head + 1) % TEST_MAX_PENDING;
+    g_pending_count--;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testReceiveBatch
+ *
+ *  DESCRIPTION
+ *      Checks the records of a batch frame and whether it was full enough
+ *      to be sent.
+ *
+ *----------------------------------------------------------------------------*/
+static void testReceiveBatch(const uint8 *p_frame)
+{
+    const uint16 end = p_frame[5] + 2;
+    const uint16 bytes = p_frame[5] - 4;
+    const TEST_MESSAGE_T *p_first = testPending(0);
+    const TEST_MESSAGE_T *p_next;
+    uint32 waited;
+    uint16 i, records = 0;
+
+    if((g_caps & WIFI_LINK_CAP_BATCH) == 0)
+    {
+        testError("batch frame without the batch capability");
+    }
+    if(bytes > WIFI_BATCH_MAX_LENGTH)
+    {
+        testError("batch frame of %u bytes", bytes);
+    }
+    if(p_first == NULL)
+    {
+        testError("batch frame received, no message sent");
+        return;
+    }
+    waited = TimeGet32() - p_first->time;
+
+    for(i = 6;i + TEST_RECORD_HEADER <= end &&
+              i + TEST_RECORD_HEADER + p_frame[i + 4] <= end;
+        i += TEST_RECORD_HEADER + p_frame[i + 4])
+    {
+        testReceive(p_frame[i], p_frame[i + 1],
+                    (p_frame[i + 2] << 8) | p_frame[i + 3], p_frame[i + 4],
+                    &p_frame[i + TEST_RECORD_HEADER]);
+        records++;
+    }
+    if(i != end || records == 0)
+    {
+        testError("batch frame with %u records ends at %u of %u", records,
+                  i, end);
+    }
+
+    /* Sent short only if the next message would not have fitted, or the
+     * batch timer ran out
+     */
+    p_next = testPending(0);
+    if(bytes < WIFI_BATCH_FLUSH_LENGTH && waited < TEST_BATCH_WAIT &&
+       (p_next == NULL || bytes + TEST_RECORD_HEADER + p_next->n <=
+                          WIFI_BATCH_MAX_LENGTH))
+    {
+        testError("batch frame of %u bytes sent after %lu ms", bytes,
+                  (unsigned long)(waited / MILLISECOND));
+    }
+    g_batches++;
+    g_records += records;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testReceiveFrame
+ *
+ *  DESCRIPTION
+ *      Handles one verified frame from the firmware.
+ *
+ *----------------------------------------------------------------------------*/
+static void testReceiveFrame(const uint8 *p_frame, uint16 len)
+{
+    const bool crc = (g_caps & WIFI_LINK_CAP_CRC16) != 0;
+
+    if(p_frame[0] == 0xEE)
+    {
+        /* The firmware fell back to v1 */
+        if(g_link == TEST_LINK_V2 || g_link == TEST_LINK_SILENT)
+        {
+            g_fallbacks++;
+        }
+        g_link = TEST_LINK_V1;
+        g_caps = 0;
+        if(p_frame[1] == WIFI_LINK_TYPE_BATCH)
+        {
+            testError("batch frame sent over v1");
+            return;
+        }
+        testReceive(p_frame[1], p_frame[2], (p_frame[3] << 8) | p_frame[4],
+                    p_frame[5] - 4, &p_frame[6]);
+        g_frames++;
+        return;
+    }
+
+    if(p_frame[1] == WIFI_LINK_TYPE_ACK)
+    {
+        if(p_frame[2] == WIFI_LINK_ACK_HELLO_REPLY)
+        {
+            if(g_link != TEST_LINK_HELLO)
+            {
+                testError("hello answered twice");
+            }
+            g_caps = p_frame[6];
+            if(g_caps != (g_offered & WIFI_LINK_CAPS) ||
+               p_frame[8] != 0x00)
+            {
+                testError("hello answered with %02X, %02X offered", g_caps,
+                          g_offered);
+            }
+            g_link = TEST_LINK_V2;
+        }
+        return;
+    }
+
+    if(g_link == TEST_LINK_HELLO)
+    {
+        testError("v2 frame before the hello was answered");
+        return;
+    }
+    if(g_link != TEST_LINK_V2)
+    {
+        return;
+    }
+
+    /* Resent frames are acknowledged again, only the next one is new */
+    if(p_frame[len - (crc ? 2 : 1) - 2] == g_rx_seq)
+    {
+        g_rx_seq = (g_rx_seq + 1) & 0xFF;
+        if(p_frame[1] == WIFI_LINK_TYPE_BATCH)
+        {
+            testReceiveBatch(p_frame);
+        }
+        else
+        {
+            testReceive(p_frame[1], p_frame[2],
+                        (p_frame[3] << 8) | p_frame[4], p_frame[5] - 4,
+                        &p_frame[6]);
+            g_frames++;
+        }
+    }
+    testSendAck();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testTakeOutput
+ *
+ *  DESCRIPTION
+ *      Parses the frames the firmware has written.
+ *
+ *----------------------------------------------------------------------------*/
+static void testTakeOutput(void)
+{
+    uint16 len, i;
+    bool crc;
+    uint8 bcc;
+
+    g_rx_len += HostUartTxTake(&g_rx[g_rx_len], sizeof(g_rx) - g_rx_len);
+    while(g_rx_len >= WIFI_FRAME_HEADER_LENGTH && g_errors < TEST_MAX_ERRORS)
+    {
+        len = g_rx[5] + 3;
+        crc = FALSE;
+        if(g_rx[0] == WIFI_LINK_FRAME_V2)
+        {
+            len += WIFI_LINK_TRAILER_LENGTH;
+            crc = (g_caps & WIFI_LINK_CAP_CRC16) != 0 &&
+                  !(g_rx[1] == WIFI_LINK_TYPE_ACK &&
+                    g_rx[2] == WIFI_LINK_ACK_HELLO_REPLY);
+            len += crc ? 1 : 0;
+        }
+        else if(g_rx[0] != 0xEE)
+        {
+            testError("frame starts with %02X", g_rx[0]);
+            g_rx_len = 0;
+            break;
+        }
+        if(g_rx_len < len)
+        {
+            break;
+        }
+
+        if(crc)
+        {
+            if(CRC16Block(CRC16_INIT, &g_rx[2], len - 2) != CRC16_RESIDUE)
+            {
+                testError("frame %02X %02X fails its CRC", g_rx[0], g_rx[1]);
+            }
+        }
+        else
+        {
+            bcc = 0;
+            for(i = 2;i + 1 < len;i++)
+            {
+                bcc ^= g_rx[i];
+            }
+            if(bcc != g_rx[len - 1])
+            {
+                testError("frame %02X %02X fails its BCC", g_rx[0], g_rx[1]);
+            }
+        }
+
+        testReceiveFrame(g_rx, len);
+        memmove(g_rx, &g_rx[len], g_rx_len - len);
+        g_rx_len -= len;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testRunFor
+ *
+ *  DESCRIPTION
+ *      Runs the firmware for a time, handling its frames tick by tick.
+ *
+ *----------------------------------------------------------------------------*/
+static void testRunFor(uint32 time)
+{
+    const uint32 end = TimeGet32() + time;
+    uint32 now;
+
+    testTakeOutput();
+    while((now = TimeGet32()) != end && g_errors < TEST_MAX_ERRORS)
+    {
+        if(end - now > TW_TICK_MS * MILLISECOND)
+        {
+            now += TW_TICK_MS * MILLISECOND;
+        }
+        else
+        {
+            now = end;
+        }
+        HostRunUntil(now);
+        testTakeOutput();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testSendMessage
+ *
+ *  DESCRIPTION
+ *      Hands a random mesh message to uart_time.c, mostly short ones that
+ *      can share a batch frame.
+ *
+ *----------------------------------------------------------------------------*/
+static void testSendMessage(void)
+{
+    TEST_MESSAGE_T *p_message;
+    uint16 i;
+
+    if(g_pending_count >= TEST_MAX_PENDING)
+    {
+        return;
+    }
+    p_message = &g_pending[(g_pending_head + g_pending_count) %
+                           TEST_MAX_PENDING];
+    g_pending_count++;
+
+    p_message->type = testRandom(2) ? 0xEE : 0xAA;
+    p_message->msg_id = testRandom(256);
+    p_message->mesh_id = testRandom(0x10000);
+    p_message->n = testRandom(8) ? testRandom(10) :
+                                   testRandom(TEST_MAX_MESSAGE_LENGTH - 1);
+    for(i = 0;i < p_message->n;i++)
+    {
+        p_message->data[i] = testRandom(256);
+    }
+    p_message->time = TimeGet32();
+    p_message->timed = (g_link == TEST_LINK_V1 || g_link == TEST_LINK_V2);
+
+    memset(BLE_RX_DATA, 0, sizeof(BLE_RX_DATA));
+    BLE_RX_DATA[0] = 0x7E;
+    BLE_RX_DATA[1] = p_message->msg_id;
+    BLE_RX_DATA[2] = p_message->n + 2;
+    memcpy(&BLE_RX_DATA[3], p_message->data, p_message->n);
+    RX_MESH_ID = p_message->mesh_id;
+
+    /* As appMeshFrameEvent() does */
+    UartTxDataType = p_message->type;
+    processuartdata();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testStep
+ *
+ *  DESCRIPTION
+ *      Changes the module behaviour now and then, sends a message once the
+ *      last one has been taken and lets time pass.
+ *
+ *----------------------------------------------------------------------------*/
+static void testStep(void)
+{
+    uint16 i;
+
+    switch(g_link)
+    {
+        case TEST_LINK_V1:
+            if(testRandom(200) == 0)
+            {
+                testSendHello();
+            }
+        break;
+        case TEST_LINK_V2:
+            if(testRandom(400) == 0)
+            {
+                /* Messages not yet received wait for the fall back */
+                g_link = TEST_LINK_SILENT;
+                for(i = 0;i < g_pending_count;i++)
+                {
+                    testPending(i)->timed = FALSE;
+                }
+            }
+        break;
+        case TEST_LINK_SILENT:
+            if(testRandom(100) == 0)
+            {
+                testSendLegacy();
+            }
+        break;
+        default:
+        break;
+    }
+
+    if(UartTxDataType == CLEAR)
+    {
+        testSendMessage();
+    }
+    testRunFor(testRandom(4) ? testRandom(5 * MILLISECOND) :
+                               testRandom(100 * MILLISECOND));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testWifiFrameEvent
+ *
+ *  DESCRIPTION
+ *      AE_WIFI_FRAME_RECEIVED handler, drops the frames from the module.
+ *
+ *----------------------------------------------------------------------------*/
+static void testWifiFrameEvent(uint16 arg)
+{
+    while(FQGetFrameCount() != 0)
+    {
+        FQPopFrame();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      testTick
+ *
+ *  DESCRIPTION
+ *      Tick handler, the UART part of appTickHandler().
+ *
+ *----------------------------------------------------------------------------*/
+static bool testTick(void)
+{
+    processuartdata();
+    AEDispatch();
+    return (UartTxDataType != CLEAR) || WLAckPending();
+}
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32 messages = 20000, message;
+    uint32 seed = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': messages = (uint32)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n messages] [-s seed]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    g_random = seed ? seed : 1;
+
+    /* Start up as main_app.c does and wait until frames may be sent */
+    HostReset();
+    HostUartReset();
+    TWInit();
+    AEInit();
+    AERegister(AE_WIFI_FRAME_RECEIVED, testWifiFrameEvent);
+    InitUart();
+    TWStartTick(testTick);
+    HostRunUntil(C_T_OnTimeWait3s * TW_TICK_MS * MILLISECOND + SECOND);
+    testSendHello();
+
+    for(message = 0;message < messages && g_errors < TEST_MAX_ERRORS;
+        message++)
+    {
+        testStep();
+    }
+
+    /* Answer again and let everything through */
+    if(g_link == TEST_LINK_SILENT)
+    {
+        testSendLegacy();
+    }
+    testRunFor(5 * SECOND);
+    if(g_pending_count != 0)
+    {
+        testError("%u messages never received", g_pending_count);
+    }
+
+    printf("wifi batch: %lu messages, %lu batch frames with %lu records, "
+           "%lu single frames, %lu fallbacks, %lu ms latency, %u errors\n",
+           (unsigned long)message, (unsigned long)g_batches,
+           (unsigned long)g_records, (unsigned long)g_frames,
+           (unsigned long)g_fallbacks,
+           (unsigned long)(g_max_latency / MILLISECOND), g_errors);
+    return g_errors ? 1 : 0;
+}
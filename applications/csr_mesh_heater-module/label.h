@@ -22,17 +22,16 @@
 #include <sys_events.h>
 #include <timer.h>
 #include "typedef.h"
+#include "timer_wheel.h"
+#include "define.h"
 /*============================================================================*
  *  variable INIT
  *============================================================================*/
 
-extern void timer_RBINT(void);
-extern void timer_10ms_RBINT(void);
-extern void timer_100ms_RBINT(void);
-extern void timer_1s_RBINT(void);
 extern void time_main(void);
 extern void InitUart(void);
 extern void processuartdata(void);
+extern void WifiRxFrameDispatch(void);
 extern void processMeshData(void);
 extern void srf_init(void);
 /*extern void endStream(void);*/
@@ -43,14 +42,21 @@ extern void flash_run(void);
 extern void HandlePIOChangedEvent(pio_changed_data *pio_data);
 extern void handleExtraLongButtonPress(timer_id tid);
 extern void Reset_BLE_Module(void);
-extern void StartBlockSendData(uint16 dest_id);
+extern uint16 DataBlockTxGetQueueDepth(void);
+extern uint16 DataBlockTxGetHighWaterMark(void);
+extern uint16 DataBlockTxGetQueuedTime(uint16 *p_max_ms);
+extern uint16 DataBlockTxGetPacing(uint16 *p_occupancy);
+extern uint16 DataBlockTxGetDelivered(uint16 *p_failed, uint32 *p_bytes);
+extern uint16 DataBlockTxGetDeliveryTime(uint16 *p_max_ms);
+extern uint16 DataBlockTxGetSegments(uint16 *p_resent);
+extern uint16 DataBlockRxGetDropped(uint16 *p_refused);
+extern void DataBlockRxDeliver(void);
 extern uint8 timer250us;
 extern uint8 MTimer;
 extern uint8 m4msCount;
 extern uint8 m100msCount;
 extern uint8 m1sCount;
 extern uint8 CommState;
-extern uint8 CommRxState;
 extern uint8 UartTxDataType;
 extern uint8 WifiNowBuffer;
 extern uint8 MeshNowBuffer;
@@ -111,8 +117,8 @@ extern uint8 BLE_TX_DATA_LENGTH;
 extern uint8 WifiTxDataEEEECount;
 extern uint8 WifiTxDataEEAACount;
 extern uint8 WifiTxData82Count;
-extern uint8 BLE_RX_DATA[40];
-extern uint8 BLE_TX_DATA[40];
+extern uint8 BLE_RX_DATA[MESH_DATA_MAX_LENGTH];
+extern uint8 BLE_TX_DATA[MESH_DATA_MAX_LENGTH];
 extern uint16 RX_MESH_ID;
 extern uint16 TX_MESH_ID;
 extern uint16 Local_MESH_ID;
@@ -145,10 +151,6 @@ extern volatile union FLAGS flag2;
 #define f_SetOnOff           flag2.bit.bit7  /*it is use*/
 
 extern volatile union FLAGS flag3;
-#define f_rxmeshdata01            flag3.bit.bit0  
-#define f_rxmeshdata02            flag3.bit.bit1  
-#define f_rxmeshdata03            flag3.bit.bit2  
-#define f_rxmeshdata04            flag3.bit.bit3  
 /*
 extern volatile union FLAGS flag4;
 #define f_SwingAct               flag4.bit.bit0 
@@ -166,7 +168,6 @@ extern volatile union FLAGS flag5;
 #define f_BleOnOff               flag5.bit.bit3 
 #define f_BleReset               flag5.bit.bit4 /*it is use*/ 
 #define f_Mesh_Tx_Ready          flag5.bit.bit5
-#define f_Mesh_First_Send        flag5.bit.bit6
 #define f_Block_Buffer_Empty     flag5.bit.bit7
 
 extern volatile union FLAGS flag6;
@@ -177,10 +178,8 @@ extern volatile union FLAGS flag6;
 #define f_DefModeV9_1            flag6.bit.bit4 
 #define f_FirstOnTime            flag6.bit.bit5 */
 #define f_meshrxdataOK           flag6.bit.bit6
-#define f_rxdataOK               flag6.bit.bit7
 
 extern volatile union FLAGS flag7;
-#define f_WifiRxdCheckOk         flag7.bit.bit0
 #define f_Uart_TxRxError         flag7.bit.bit1
 #define f_MeshRxdCheckOk         flag7.bit.bit2
 /*#define f_Repeat_Send            flag7.bit.bit2
@@ -266,61 +265,6 @@ extern volatile union FLAGS WifiRxIr_u;
 #define f_WifiRxIrFmEn             WifiRxIr_u.bit.bit6
 #define f_WifiRxIrEn               WifiRxIr_u.bit.bit7
 */
-/*============================================================================*
- *  TIME INIT
- *============================================================================*/
-typedef struct {
-  UTIME16 tWifitsfrmwt;
-  UTIME16 tBle10msFlushWait;
-  UTIME16 tUartWait10ms;
-  UTIME16 tWifiTwoByteSentTime;
-  UTIME16 tWifi2mscyc;
-  UTIME16 tWifi5mscyc;
-}_tm_1ms;
-extern _tm_1ms tm_1ms;
-
-typedef struct {
-  UTIME16 tWifiTwoByte;
-  UTIME16 twifitsrxcyc;   
-  UTIME16 tWifi20mscyc;
-  UTIME16 twifitstxcyc; 
-}_tm_4ms;
-extern _tm_4ms tm_4ms;
-
-typedef struct {
-  UTIME16 tWifiSendData1;
-
-}_tm_10ms;
-extern _tm_10ms tm_10ms;
-
-typedef struct {
-  UTIME16 tWifiSendData;
-  UTIME16 tSend91Wait800ms;
-  UTIME16 tSend82Wait800ms;
-  UTIME16 tSendEEWait800ms;
-  UTIME16 tSendEAWait800ms;
-  UTIME16 tmeshfinishdataWait100ms;
-  UTIME16 tmfTxdataWait100ms;
-  UTIME16 tWriteFlashDelay;
-  UTIME16 tRstWait500ms;
-}_tm_100ms;
-extern _tm_100ms tm_100ms;
-
-typedef struct {
-  UTIME16 tOnTimeWait3s;
-  UTIME16 tHeartPack30s;
-  UTIME16 tSenHbData25s;
-  UTIME16 tGetIndoorInf2s;
-  UTIME16 tPanic2Min;
-  UTIME16 tBleReset3Min;
-  UTIME16 tAdvUUID3Min;
-  UTIME16 tHeartPack5s;
-  UTIME16 tMeshTimeOut2s;
-  UTIME16 tRxMeshTimeOut2s;
-  UTIME16 tPoweronWait3s;
-}_tm_1s;
-extern _tm_1s tm_1s;
-
 typedef struct
 {
 
@@ -330,6 +274,4 @@ typedef struct
 }APP_HW_DATA_T;
 extern APP_HW_DATA_T            g_app_hw_data;
 
-extern volatile union FLAGS WifiTxData[40];
-extern volatile union FLAGS WifiRxData[40];
 #endif /* __SECURITY_TAG_H__ */
@@ -62,6 +62,12 @@
 #include "define.h"
 #include "app_mesh_handler.h"
 #include "iot_hw.h"
+#include "frame_queue.h"
+#include "app_event.h"
+#include "msg_cache.h"
+#include "mesh_fanout.h"
+#include "mesh_delta.h"
+#include "wifi_link.h"
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
@@ -78,21 +84,12 @@
 #endif /* !CSR101x_A05 */
 
 
-/*add by cdy 2016-12-30*/
-timer_id t_1ms_id;
-timer_id t_10ms_id;
-timer_id t_100ms_id;
-timer_id t_1s_id;
-//uint8 TIME10MS = 0;
-#define TIME1MS (1*MILLISECOND)
-#define TIME10MS (10*MILLISECOND)
-#define TIME100MS (100*MILLISECOND)
-#define TIME1S (1*SECOND)
 /*extern void startStream(uint16 dest_id);*/
-void time1mshandle(timer_id tid);
-void time10mshandle(timer_id tid);
-void time100mshandle(timer_id tid);
-void time1shandle(timer_id tid);
+static bool appTickHandler(void);
+static void appMeshSendGate(void);
+static void appWifiFrameEvent(uint16 arg);
+static void appMeshTxReadyEvent(uint16 arg);
+static void appMeshFrameEvent(uint16 arg);
 /*============================================================================*
  *  Private Data
  *===========================================================================*/
@@ -322,78 +319,140 @@ extern void AppDataInit(void)
     /* Initialize the Mesh Control Service Data Structure */
     MeshControlServiceDataInit();
 }
-void time1mshandle(timer_id tid)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appMeshSendGate
+ *
+ *  DESCRIPTION
+ *      Hands the frame in BLE_TX_DATA to the mesh sender when it can take
+ *      it, then releases the next queued Wi-Fi frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void appMeshSendGate(void)
 {
-     if (tid == t_1ms_id)
+    if(f_Mesh_Tx_Ready == ON &&
+       DataSend(TX_MESH_ID, BLE_TX_DATA, BLE_TX_DATA_LENGTH))
     {
-        t_1ms_id = TIMER_INVALID;
-        if(tm_100ms.tmeshfinishdataWait100ms.fov == ON || tm_1s.tRxMeshTimeOut2s.fov == ON)
-        {
-             tm_100ms.tmeshfinishdataWait100ms.word = CLEAR;
-             tm_1s.tRxMeshTimeOut2s.word = CLEAR;
-             f_Block_Buffer_Empty = ON;
-        }
-        timer_RBINT(); 
-        processuartdata();
-        t_1ms_id = TimerCreate(TIME1MS, TRUE, time1mshandle);
+         f_Mesh_Tx_Ready = OFF;
+         f_meshrxdataOK = OFF;/*ǰһݷɱ־*/
+         if(FQGetFrameCount() != 0)
+         {
+              AEPost(AE_WIFI_FRAME_RECEIVED, 0);
+         }
     }
-       
 }
-void time10mshandle(timer_id tid)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appWifiFrameEvent
+ *
+ *  DESCRIPTION
+ *      AE_WIFI_FRAME_RECEIVED handler.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void appWifiFrameEvent(uint16 arg)
 {
-     if (tid == t_10ms_id)
-    {
-        t_10ms_id = TIMER_INVALID;
-        timer_10ms_RBINT(); 
-        if(f_Mesh_Tx_Ready == ON && (f_Mesh_First_Send == OFF ||tm_100ms.tmfTxdataWait100ms.fov == ON || tm_1s.tMeshTimeOut2s.fov == ON))
-        {
-             f_Mesh_Tx_Ready = OFF;
-             f_Mesh_First_Send = ON;
-             f_meshrxdataOK = OFF;/*ǰһݷɱ־*/
-             tm_100ms.tmfTxdataWait100ms.word = CLEAR;
-             tm_1s.tMeshTimeOut2s.word = CLEAR;
-             StartBlockSendData(TX_MESH_ID);
-        }
-        flash_run(); 
-        t_10ms_id = TimerCreate(TIME10MS, TRUE, time10mshandle);
-    }
-       
+    WifiRxFrameDispatch();
 }
-void time100mshandle(timer_id tid)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appMeshTxReadyEvent
+ *
+ *  DESCRIPTION
+ *      AE_MESH_TX_READY handler.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void appMeshTxReadyEvent(uint16 arg)
 {
+    appMeshSendGate();
+}
 
-     if (tid == t_100ms_id)
-     {
-          t_100ms_id = TIMER_INVALID; 
-          timer_100ms_RBINT();
-          t_100ms_id = TimerCreate(TIME100MS, TRUE, time100mshandle);
-      }
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appMeshFrameEvent
+ *
+ *  DESCRIPTION
+ *      AE_MESH_FRAME_RECEIVED handler, sends the mesh frame to the Wi-Fi
+ *      module straight away unless the UART is still starting up. The frame
+ *      counts as a reply if it answers a fan-out command.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void appMeshFrameEvent(uint16 arg)
+{
+    MFRxReply(RX_MESH_ID, BLE_RX_DATA[1]);
+    UartTxDataType = (uint8)arg;
+    processuartdata();
 }
-void time1shandle(timer_id tid)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appTickHandler
+ *
+ *  DESCRIPTION
+ *      Application work run from the tick. The tick wakes the chip when a
+ *      software timer expires, when an event is posted or when this function
+ *      asks to run again. Timer driven work is checked here, everything else
+ *      arrives as events.
+ *
+ *  RETURNS
+ *      TRUE if it needs to run again on the next tick.
+ *
+ *---------------------------------------------------------------------------*/
+static bool appTickHandler(void)
 {
+    if(TWExpired(TM_MESH_FINISH_DATA_WAIT))
+    {
+         TWStop(TM_MESH_FINISH_DATA_WAIT);
+         f_Block_Buffer_Empty = ON;
+         /* һķְ֡ */
+         DataBlockRxDeliver();
+    }
+    processuartdata();
+    appMeshSendGate();
+    flash_run(); 
+    AEDispatch();
 
-     if (tid == t_1s_id)
-     {
-          t_1s_id = TIMER_INVALID; 
-          timer_1s_RBINT();
-          t_1s_id = TimerCreate(TIME1S, TRUE, time1shandle);
-      }
+    /* A mesh frame or an ACK for the UART waits until the UART has started
+     * up, or until the v2 window has room
+     */
+    return (UartTxDataType != CLEAR) || WLAckPending();
 }
 void srf_init(void)
 {
-     f_Mesh_First_Send = CLEAR;
+     TWInit();
+     AEInit();
+     MCInit();
+     MFInit();
+#ifdef ENABLE_MESH_DELTA
+     MDInit();
+#endif /* ENABLE_MESH_DELTA */
+     AERegister(AE_WIFI_FRAME_RECEIVED, appWifiFrameEvent);
+     AERegister(AE_MESH_TX_READY, appMeshTxReadyEvent);
+     AERegister(AE_MESH_FRAME_RECEIVED, appMeshFrameEvent);
      g_trigger_write_callback = FALSE;
-     tm_1ms.tUartWait10ms.word = C_T_tUartWait10ms;
-     tm_1s.tPanic2Min.word = C_T_tPanic2Min;
+     TWStart(TM_PANIC, C_T_tPanic2Min);
      f_Block_Buffer_Empty = ON;
      FlashRead = ON;
-     tm_1s.tHeartPack5s.word = 0x4000+3;
-     tm_1s.tPoweronWait3s.word = 0x4000+3;
+     TWStart(TM_HEART_PACK, TW_TICKS_1S(3));
+     TWStart(TM_POWERON_WAIT, TW_TICKS_1S(3));
 }
 void Reset_BLE_Module(void)
 {
      f_Ble_Reset = OFF;
-     tm_1s.tBleReset3Min.word = C_T_tBleReset3Min;
+     TWStart(TM_BLE_RESET, C_T_tBleReset3Min);
      RemoveAssociation();     
      Panic(1);    
 }
@@ -424,10 +483,7 @@ void AppInit(sleep_state last_sleep_state)
     /*****************************************/
     TimerInit(MAX_APP_TIMERS, (void*)app_timers);
     /*add by cdy 2016-12-30*/
-    t_1ms_id = TimerCreate(TIME1MS, TRUE, time1mshandle);
-    t_10ms_id = TimerCreate(TIME10MS, TRUE, time10mshandle);
-    t_100ms_id = TimerCreate(TIME100MS, TRUE, time100mshandle);
-    t_1s_id = TimerCreate(TIME1S, TRUE, time1shandle);    
+    TWStartTick(appTickHandler);
     /*****************************************/
 #ifdef DEBUG_ENABLE
     /*DebugInit(0, NULL, NULL);*/
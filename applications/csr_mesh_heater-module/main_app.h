@@ -22,6 +22,7 @@
  *  Local Header Files
  *============================================================================*/
 #include "user_config.h"
+#include "define.h"
 
 /*============================================================================*
  *  CSR Mesh Header Files
@@ -91,12 +92,20 @@
                                          NVM_TIME_INTERVAL_SIZE))
 
 #ifdef ENABLE_ACTION_MODEL
-#define ACTION_SIZE                    (16)
-#define NVM_ACTIONS_SIZE               (MAX_ACTIONS_SUPPORTED * ACTION_SIZE)
-
-/* Get NVM Offset of a specific action from its index. */
-#define GET_ACTION_NVM_OFFSET(idx)     (NVM_OFFSET_ACTION_MODEL_DATA + \
-                                       ((idx) * (ACTION_SIZE)))
+/* Earlier firmware stored its 6 actions here in records of 16 words. The
+ * area keeps that size, so the data stored after it stays where earlier
+ * firmware put it. Its first word now holds the format version of the action
+ * records, which have an area of their own after the BLE status block.
+ */
+#define ACTION_SIZE                    (15)
+#define ACTION_LEGACY_SIZE             (16)
+#define ACTION_LEGACY_COUNT            (6)
+#define NVM_ACTIONS_SIZE               (ACTION_LEGACY_COUNT * \
+                                        ACTION_LEGACY_SIZE)
+
+/* Get NVM Offset of an action stored by earlier firmware from its index. */
+#define GET_LEGACY_ACTION_NVM_OFFSET(idx) (NVM_OFFSET_ACTION_MODEL_DATA + \
+                                        ((idx) * (ACTION_LEGACY_SIZE)))
 #else
 #define NVM_ACTIONS_SIZE               (0)
 #endif
@@ -141,6 +150,35 @@
 #define NVM_MAX_APP_MEMORY_WORDS       (NVM_OFFSET_LOT_MODEL_GROUPS + \
                                         SIZEOF_LOT_MODEL_GROUPS)
 #define NVM_BLE_STATUS_MEMORY_WORDS    (NVM_MAX_APP_MEMORY_WORDS + 10)
+
+#ifdef ENABLE_ACTION_MODEL
+/* NVM Offset for the action records, after the BLE status block */
+#define NVM_OFFSET_ACTION_RECORDS      (NVM_BLE_STATUS_MEMORY_WORDS + \
+                                        NVM_BLOCK_SZ)
+#define NVM_ACTION_RECORDS_SIZE        (MAX_ACTIONS_SUPPORTED * ACTION_SIZE)
+
+/* Get NVM Offset of a specific action from its index. */
+#define GET_ACTION_NVM_OFFSET(idx)     (NVM_OFFSET_ACTION_RECORDS + \
+                                       ((idx) * (ACTION_SIZE)))
+#else
+#define NVM_ACTION_RECORDS_SIZE        (0)
+#endif
+
+/* Number of words used from the start of the NVM store */
+#define NVM_USED_MEMORY_WORDS          (NVM_BLE_STATUS_MEMORY_WORDS + \
+                                        NVM_BLOCK_SZ + \
+                                        NVM_ACTION_RECORDS_SIZE)
+
+/* Size of the NVM store in words. The BLE status block and the action records
+ * after the application data must end inside it.
+ */
+#ifdef CSR101x_A05
+/* &nvm_size in the .keyr */
+#define NVM_STORE_SIZE_WORDS           (0x100)
+#else
+/* The user store nvm_access.c creates on the serial flash */
+#define NVM_STORE_SIZE_WORDS           (USER_STORE_NVM_SIZE)
+#endif /* CSR101x_A05 */
 uint16                                  g_app_nvm_offset;
 bool                                    g_app_nvm_fresh;
 uint16                                  g_cskey_flags;
@@ -0,0 +1,541 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_delta.c
+ *
+ *  DESCRIPTION
+ *      Delta encoding of mesh frames against the last frame acknowledged by,
+ *      or received from, each node. The sender only takes a frame as the
+ *      reference once the receiver has acknowledged all of its segments, and
+ *      the receiver takes every frame it completes in acknowledged mode, so
+ *      both ends agree on the reference. When they do not, the receiver
+ *      cannot decode the delta frame and asks for the whole frame.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "mesh_delta.h"
+#include "define.h"
+
+#ifdef ENABLE_MESH_DELTA
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Destination of delta encoded frames */
+typedef struct _MD_TX_NODE_T
+{
+    /* TRUE if the entry is in use */
+    bool used;
+
+    /* Destination device ID */
+    uint16 node_id;
+
+    /* Value of g_md_stamp when the entry was last used */
+    uint16 stamp;
+
+    /* Last frame the destination acknowledged */
+    bool base_valid;
+    uint8 base[MESH_DELTA_FRAME_LENGTH];
+
+    /* Frame being sent, as it was before encoding */
+    bool pend_valid;
+    uint8 pend[MESH_DELTA_FRAME_LENGTH];
+}MD_TX_NODE_T;
+
+/* Sender of delta encoded frames */
+typedef struct _MD_RX_NODE_T
+{
+    /* TRUE if the entry holds a reference frame */
+    bool used;
+
+    /* Source device ID */
+    uint16 node_id;
+
+    /* Value of g_md_stamp when the entry was last used */
+    uint16 stamp;
+
+    /* Last frame received from the source */
+    uint8 base[MESH_DELTA_FRAME_LENGTH];
+}MD_RX_NODE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static MD_TX_NODE_T g_md_tx[MESH_DELTA_TX_NODES];
+static MD_RX_NODE_T g_md_rx[MESH_DELTA_RX_NODES];
+
+/* Counter the entries are stamped with, to find the least recently used */
+static uint16 g_md_stamp;
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Length of a frame from its length byte */
+#define MD_FRAME_LENGTH(p_frame)  (((p_frame)[2] & 0x00FF) + 2)
+
+/* Most unchanged bytes between two changes that are sent as one change,
+ * new change would cost more
+ */
+#define MD_MERGE_GAP              (2)
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mdSetXor
+ *
+ *  DESCRIPTION
+ *      Set the trailing xor of a frame.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void mdSetXor(uint8 *p_frame)
+{
+    const uint16 len = p_frame[2] & 0x00FF;
+    uint8 check = 0;
+    uint16 i;
+
+    for (i = 1; i <= len; i++)
+        check ^= p_frame[i];
+
+    p_frame[len + 1] = check & 0x00FF;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mdPutVarint
+ *
+ *  DESCRIPTION
+ *      Append a varint to a buffer.
+ *
+ * PARAMETERS
+ *      p_buf   [out]   Buffer
+ *      p_pos   [in/out] Position to write at, advanced past the varint
+ *      limit   [in]    Size of the buffer
+ *      value   [in]    Value
+ *
+ * RETURNS
+ *      FALSE if the buffer is too short.
+ *----------------------------------------------------------------------------*/
+static bool mdPutVarint(uint8 *p_buf, uint16 *p_pos, uint16 limit,
+                        uint16 value)
+{
+    do
+    {
+        if (*p_pos >= limit)
+            return FALSE;
+
+        p_buf[*p_pos] = (value & 0x7F) | ((value > 0x7F) ? 0x80 : 0x00);
+        (*p_pos)++;
+        value >>= 7;
+    } while (value != 0);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mdGetVarint
+ *
+ *  DESCRIPTION
+ *      Read a varint from a buffer.
+ *
+ * PARAMETERS
+ *      p_buf   [in]    Buffer
+ *      p_pos   [in/out] Position to read at, advanced past the varint
+ *      end     [in]    Position the buffer ends at
+ *      p_value [out]   Value
+ *
+ * RETURNS
+ *      FALSE if the varint runs past the end or does not fit 16 bits.
+ *----------------------------------------------------------------------------*/
+static bool mdGetVarint(const uint8 *p_buf, uint16 *p_pos, uint16 end,
+                        uint16 *p_value)
+{
+    uint16 shift = 0;
+    uint8 byte;
+
+    *p_value = 0;
+    do
+    {
+        if (*p_pos >= end || shift > 14)
+            return FALSE;
+
+        byte = p_buf[*p_pos] & 0x00FF;
+        (*p_pos)++;
+        *p_value |= (uint16)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) != 0);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mdTxNode
+ *
+ *  DESCRIPTION
+ *      Find the entry of a destination, or take the least recently used one
+ *      for it.
+ *
+ * PARAMETERS
+ *      node_id [in]    Destination
+ *      create  [in]    TRUE to take an entry if there is none
+ *
+ * RETURNS
+ *      The entry, or NULL if there is none and create is FALSE.
+ *----------------------------------------------------------------------------*/
+static MD_TX_NODE_T *mdTxNode(uint16 node_id, bool create)
+{
+    MD_TX_NODE_T *p_oldest = &g_md_tx[0];
+    MD_TX_NODE_T *p_node;
+    uint16 i;
+
+    for (i = 0; i < MESH_DELTA_TX_NODES; i++)
+    {
+        p_node = &g_md_tx[i];
+        if (p_node->used && p_node->node_id == node_id)
+        {
+            p_node->stamp = ++g_md_stamp;
+            return p_node;
+        }
+        if (p_oldest->used &&
+            (!p_node->used || (int16)(p_node->stamp - p_oldest->stamp) < 0))
+            p_oldest = p_node;
+    }
+
+    if (!create)
+        return NULL;
+
+    p_oldest->used = TRUE;
+    p_oldest->node_id = node_id;
+    p_oldest->stamp = ++g_md_stamp;
+    p_oldest->base_valid = FALSE;
+    p_oldest->pend_valid = FALSE;
+
+    return p_oldest;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mdRxNode
+ *
+ *  DESCRIPTION
+ *      Find the entry of a source, or take the least recently used one for
+ *      it.
+ *
+ * PARAMETERS
+ *      node_id [in]    Source
+ *      create  [in]    TRUE to take an entry if there is none
+ *
+ * RETURNS
+ *      The entry, or NULL if there is none and create is FALSE.
+ *----------------------------------------------------------------------------*/
+static MD_RX_NODE_T *mdRxNode(uint16 node_id, bool create)
+{
+    MD_RX_NODE_T *p_oldest = &g_md_rx[0];
+    MD_RX_NODE_T *p_node;
+    uint16 i;
+
+    for (i = 0; i < MESH_DELTA_RX_NODES; i++)
+    {
+        p_node = &g_md_rx[i];
+        if (p_node->used && p_node->node_id == node_id)
+        {
+            p_node->stamp = ++g_md_stamp;
+            return p_node;
+        }
+        if (p_oldest->used &&
+            (!p_node->used || (int16)(p_node->stamp - p_oldest->stamp) < 0))
+            p_oldest = p_node;
+    }
+
+    if (!create)
+        return NULL;
+
+    p_oldest->used = TRUE;
+    p_oldest->node_id = node_id;
+    p_oldest->stamp = ++g_md_stamp;
+
+    return p_oldest;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDInit
+ *
+ *  DESCRIPTION
+ *      Forget all reference frames.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MDInit(void)
+{
+    uint16 i;
+
+    for (i = 0; i < MESH_DELTA_TX_NODES; i++)
+        g_md_tx[i].used = FALSE;
+
+    for (i = 0; i < MESH_DELTA_RX_NODES; i++)
+        g_md_rx[i].used = FALSE;
+
+    g_md_stamp = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDTxEncode
+ *
+ *  DESCRIPTION
+ *      Keep the frame for MDTxAcked and MDTxRestore and, if dest_id has
+ *      acknowledged a frame of the same length, replace it by its changes
+ *      to that frame. Changed bytes with up to MD_MERGE_GAP unchanged bytes
+ *      between them are sent as one change. The frame is left whole if the
+ *      delta frame would not be shorter.
+ *
+ * PARAMETERS
+ *      dest_id [in]    Destination device
+ *      p_frame [in/out] Frame, replaced by the delta frame
+ *      p_len   [in/out] Length of the frame
+ *
+ * RETURNS
+ *      TRUE if the frame was replaced by a delta frame.
+ *----------------------------------------------------------------------------*/
+bool MDTxEncode(uint16 dest_id, uint8 *p_frame, uint16 *p_len)
+{
+    const uint16 len = *p_len;
+    const uint16 body_end = len - 1;
+    MD_TX_NODE_T *p_node = mdTxNode(dest_id, TRUE);
+    uint8 delta[MESH_DELTA_FRAME_LENGTH];
+    uint16 pos, last, start, end, i;
+
+    if (len < 4 || len > MESH_DELTA_FRAME_LENGTH ||
+        len != MD_FRAME_LENGTH(p_frame))
+    {
+        /* Too long to keep, the receiver forgets its reference as well */
+        p_node->base_valid = FALSE;
+        p_node->pend_valid = FALSE;
+        return FALSE;
+    }
+
+    MemCopy(p_node->pend, p_frame, len);
+    p_node->pend_valid = TRUE;
+
+    if (!p_node->base_valid || MD_FRAME_LENGTH(p_node->base) != len)
+        return FALSE;
+
+    delta[0] = p_frame[0];
+    delta[1] = p_frame[1];
+    delta[3] = p_node->base[1];
+    pos = 4;
+    last = 3;
+
+    for (i = 3; i < body_end; i++)
+    {
+        if (p_frame[i] == p_node->base[i])
+            continue;
+
+        start = i;
+        end = i + 1;
+        for (i = end; i < body_end && i - end <= MD_MERGE_GAP; i++)
+        {
+            if (p_frame[i] != p_node->base[i])
+                end = i + 1;
+        }
+
+        /* The delta frame and its xor have to be shorter than the frame */
+        if (!mdPutVarint(delta, &pos, len - 2, start - last) ||
+            !mdPutVarint(delta, &pos, len - 2, end - start) ||
+            pos + (end - start) > len - 2)
+            return FALSE;
+
+        MemCopy(&delta[pos], &p_frame[start], end - start);
+        pos += end - start;
+        last = end;
+        i = end - 1;
+    }
+
+    if (pos + 1 >= len)
+        return FALSE;
+
+    delta[2] = pos - 1;
+    mdSetXor(delta);
+    MemCopy(p_frame, delta, pos + 1);
+    *p_len = pos + 1;
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDTxAcked
+ *
+ *  DESCRIPTION
+ *      Take the frame last passed to MDTxEncode for dest_id as its reference
+ *      if it is the frame that was acknowledged.
+ *
+ * PARAMETERS
+ *      dest_id [in]    Destination device
+ *      msg_id  [in]    Message ID of the acknowledged frame
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MDTxAcked(uint16 dest_id, uint8 msg_id)
+{
+    MD_TX_NODE_T *p_node = mdTxNode(dest_id, FALSE);
+
+    if (p_node == NULL || !p_node->pend_valid ||
+        p_node->pend[1] != (msg_id & 0x00FF))
+        return;
+
+    MemCopy(p_node->base, p_node->pend, MESH_DELTA_FRAME_LENGTH);
+    p_node->base_valid = TRUE;
+    p_node->pend_valid = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDTxReset
+ *
+ *  DESCRIPTION
+ *      Forget the reference for dest_id.
+ *
+ * PARAMETERS
+ *      dest_id [in]    Destination device
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MDTxReset(uint16 dest_id)
+{
+    MD_TX_NODE_T *p_node = mdTxNode(dest_id, FALSE);
+
+    if (p_node != NULL)
+        p_node->base_valid = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDTxRestore
+ *
+ *  DESCRIPTION
+ *      Return the frame last passed to MDTxEncode for dest_id to what it was
+ *      before encoding, because the receiver could not decode it, and forget
+ *      the reference. The whole frame stays kept for MDTxAcked.
+ *
+ * PARAMETERS
+ *      dest_id [in]    Destination device
+ *      p_frame [out]   Frame
+ *
+ * RETURNS
+ *      Length of the frame, 0 if it is not kept.
+ *----------------------------------------------------------------------------*/
+uint16 MDTxRestore(uint16 dest_id, uint8 *p_frame)
+{
+    MD_TX_NODE_T *p_node = mdTxNode(dest_id, FALSE);
+
+    if (p_node == NULL || !p_node->pend_valid)
+        return 0;
+
+    p_node->base_valid = FALSE;
+    MemCopy(p_frame, p_node->pend, MD_FRAME_LENGTH(p_node->pend));
+
+    return MD_FRAME_LENGTH(p_node->pend);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MDRxFrame
+ *
+ *  DESCRIPTION
+ *      Apply the changes of a delta frame to the reference for src_id, or
+ *      take a whole frame as the new reference. A delta frame whose
+ *      reference is not kept, or whose changes run past it, cannot be
+ *      decoded and the reference is forgotten, so the whole frame that is
+ *      sent instead becomes the new one.
+ *
+ * PARAMETERS
+ *      src_id  [in]    Source device
+ *      p_frame [in/out] Frame, replaced by the decoded frame
+ *      delta   [in]    TRUE if the frame is a delta frame
+ *
+ * RETURNS
+ *      FALSE if a delta frame cannot be decoded.
+ *----------------------------------------------------------------------------*/
+bool MDRxFrame(uint16 src_id, uint8 *p_frame, bool delta)
+{
+    const uint16 len = MD_FRAME_LENGTH(p_frame);
+    MD_RX_NODE_T *p_node = mdRxNode(src_id, !delta);
+    uint8 frame[MESH_DELTA_FRAME_LENGTH];
+    uint16 pos, at, skip, run, base_end;
+
+    if (!delta)
+    {
+        if (len <= MESH_DELTA_FRAME_LENGTH)
+            MemCopy(p_node->base, p_frame, len);
+        else
+            p_node->used = FALSE;
+
+        return TRUE;
+    }
+
+    if (p_node == NULL)
+        return FALSE;
+
+    if (len < 5 || len > MESH_DATA_MAX_LENGTH ||
+        p_node->base[1] != (p_frame[3] & 0x00FF))
+    {
+        p_node->used = FALSE;
+        return FALSE;
+    }
+
+    MemCopy(frame, p_node->base, MD_FRAME_LENGTH(p_node->base));
+    frame[0] = p_frame[0];
+    frame[1] = p_frame[1];
+    base_end = MD_FRAME_LENGTH(frame) - 1;
+    at = 3;
+    pos = 4;
+    while (pos < len - 1)
+    {
+        if (!mdGetVarint(p_frame, &pos, len - 1, &skip) ||
+            !mdGetVarint(p_frame, &pos, len - 1, &run) ||
+            at + skip + run > base_end || pos + run > len - 1)
+        {
+            p_node->used = FALSE;
+            return FALSE;
+        }
+        at += skip;
+        MemCopy(&frame[at], &p_frame[pos], run);
+        at += run;
+        pos += run;
+    }
+
+    mdSetXor(frame);
+    MemCopy(p_frame, frame, base_end + 1);
+    MemCopy(p_node->base, frame, base_end + 1);
+
+    return TRUE;
+}
+
+#endif /* ENABLE_MESH_DELTA */
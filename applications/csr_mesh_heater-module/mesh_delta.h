@@ -0,0 +1,86 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_delta.h
+ *
+ *  DESCRIPTION
+ *      Interface to the delta encoding of mesh frames. A frame sent to a
+ *      device in acknowledged block mode can be replaced by its differences
+ *      to the last frame that device acknowledged, which both ends keep:
+ *
+ *          7E/E7 | msg id | len | ref msg id | changes | xor
+ *
+ *      ref msg id is the message ID of the frame the changes apply to. Each
+ *      change is a varint count of unchanged bytes to skip, a varint count of
+ *      changed bytes and the changed bytes. Varints hold 7 bits per byte, low
+ *      bits first, with bit 7 set in every byte but the last. The changes
+ *      cover the bytes from the command up to the xor, which is recomputed
+ *      after decoding. Delta frames are flagged in the block segment header,
+ *      the frame keeps its own message ID and decodes to the same length as
+ *      the reference frame.
+ *
+ *****************************************************************************/
+
+#ifndef __MESH_DELTA_H__
+#define __MESH_DELTA_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Longest frame body (command to last data byte) kept as a reference */
+#define MESH_DELTA_BASE_LENGTH       (28)
+
+/* Longest frame kept as a reference: marker | msg id | len | body | xor */
+#define MESH_DELTA_FRAME_LENGTH      (MESH_DELTA_BASE_LENGTH + 4)
+
+/* Destinations whose last acknowledged frame is kept */
+#define MESH_DELTA_TX_NODES          (2)
+
+/* Senders whose last received frame is kept */
+#define MESH_DELTA_RX_NODES          (6)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that forgets all reference frames. */
+extern void MDInit(void);
+
+/* Function that replaces the frame, in place, by its changes to the last
+ * frame dest_id acknowledged if that is shorter. The frame is kept until
+ * MDTxAcked or MDTxRestore. Returns TRUE if the frame is now a delta frame.
+ */
+extern bool MDTxEncode(uint16 dest_id, uint8 *p_frame, uint16 *p_len);
+
+/* Function that makes the frame last passed to MDTxEncode for dest_id the
+ * reference, once dest_id has acknowledged the frame with msg_id.
+ */
+extern void MDTxAcked(uint16 dest_id, uint8 msg_id);
+
+/* Function that forgets the reference for dest_id, so its next frame is
+ * sent whole.
+ */
+extern void MDTxReset(uint16 dest_id);
+
+/* Function that copies the frame last passed to MDTxEncode for dest_id,
+ * as it was before encoding, into p_frame and forgets the reference.
+ * Returns its length, or 0 if it is not kept.
+ */
+extern uint16 MDTxRestore(uint16 dest_id, uint8 *p_frame);
+
+/* Function that decodes a delta frame from src_id in place, p_frame holding
+ * MESH_DATA_MAX_LENGTH bytes, and keeps the result or a whole frame as the
+ * reference for src_id. Returns FALSE if a delta frame cannot be decoded
+ * because its reference is not kept.
+ */
+extern bool MDRxFrame(uint16 src_id, uint8 *p_frame, bool delta);
+
+#endif /* __MESH_DELTA_H__ */
@@ -0,0 +1,340 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_fanout.c
+ *
+ *  DESCRIPTION
+ *      Collects the replies to fan-out commands. Each command in progress
+ *      remembers its targets and which of them have replied. TM_MESH_FANOUT
+ *      is kept running for the command that finishes first, so the UART
+ *      side is woken when a report is due.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "mesh_fanout.h"
+#include "timer_wheel.h"
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Fan-out command waiting for replies */
+typedef struct _MESH_FANOUT_T
+{
+    /* TRUE if the entry holds a command */
+    bool active;
+
+    /* Message ID of the command, and of the replies */
+    uint8 msg_id;
+
+    /* Group the command was sent to */
+    uint16 group_id;
+
+    /* Targets of the command */
+    uint16 target[MESH_FANOUT_MAX_TARGETS];
+    uint16 count;
+
+    /* Bit i is set once target i has replied */
+    uint16 replied;
+
+    /* Time the command was sent */
+    uint32 start_time;
+}MESH_FANOUT_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static MESH_FANOUT_T g_mesh_fanout[MESH_FANOUT_DEPTH];
+
+/* Entry of the report returned by the last MFGetReport, NULL if none */
+static MESH_FANOUT_T *g_mf_report = NULL;
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Value of replied once all targets of an entry have replied */
+#define MF_ALL_REPLIED(p_mf)  ((uint16)(((uint32)1 << (p_mf)->count) - 1))
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mfIsFinished
+ *
+ *  DESCRIPTION
+ *      Check if a command can be reported on.
+ *
+ * PARAMETERS
+ *      p_mf    [in]    Command
+ *      now     [in]    Current time
+ *
+ * RETURNS
+ *      TRUE if all targets replied or the reply time is over.
+ *----------------------------------------------------------------------------*/
+static bool mfIsFinished(const MESH_FANOUT_T *p_mf, uint32 now)
+{
+    return p_mf->replied == MF_ALL_REPLIED(p_mf) ||
+           TimeSub(now, p_mf->start_time) >= (int32)MESH_FANOUT_WAIT;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mfArmTimer
+ *
+ *  DESCRIPTION
+ *      Run TM_MESH_FANOUT until the next report is due, or stop it if no
+ *      command is in progress.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void mfArmTimer(void)
+{
+    const uint32 now = TimeGet32();
+    int32 wait = -1;
+    int32 left;
+    uint16 i;
+
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+    {
+        const MESH_FANOUT_T *p_mf = &g_mesh_fanout[i];
+
+        if (!p_mf->active)
+            continue;
+
+        left = mfIsFinished(p_mf, now) ? 0 :
+               (int32)MESH_FANOUT_WAIT - TimeSub(now, p_mf->start_time);
+        if (wait < 0 || left < wait)
+            wait = left;
+    }
+
+    if (wait < 0)
+        TWStop(TM_MESH_FANOUT);
+    else
+        TWStart(TM_MESH_FANOUT,
+                (uint32)wait / ((uint32)TW_TICK_MS * MILLISECOND) + 1);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFInit
+ *
+ *  DESCRIPTION
+ *      Stop collecting replies for all fan-out commands.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MFInit(void)
+{
+    uint16 i;
+
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+        g_mesh_fanout[i].active = FALSE;
+
+    g_mf_report = NULL;
+    TWStop(TM_MESH_FANOUT);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFIsFull
+ *
+ *  DESCRIPTION
+ *      Check if another fan-out command can be tracked.
+ *
+ * RETURNS
+ *      TRUE if all entries are in use.
+ *----------------------------------------------------------------------------*/
+bool MFIsFull(void)
+{
+    uint16 i;
+
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+    {
+        if (!g_mesh_fanout[i].active)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFStart
+ *
+ *  DESCRIPTION
+ *      Start collecting the replies to a fan-out command. Targets beyond
+ *      MESH_FANOUT_MAX_TARGETS are ignored, and so is the command if all
+ *      entries are in use.
+ *
+ * PARAMETERS
+ *      msg_id    [in]    Message ID of the command
+ *      group_id  [in]    Group the command is sent to
+ *      p_targets [in]    Target IDs, high byte first
+ *      count     [in]    Number of target IDs
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MFStart(uint8 msg_id, uint16 group_id,
+             const uint8 *p_targets, uint16 count)
+{
+    MESH_FANOUT_T *p_mf = NULL;
+    uint16 i;
+
+    if (count == 0)
+        return;
+
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+    {
+        if (!g_mesh_fanout[i].active)
+        {
+            p_mf = &g_mesh_fanout[i];
+            break;
+        }
+    }
+    if (p_mf == NULL)
+        return;
+
+    if (count > MESH_FANOUT_MAX_TARGETS)
+        count = MESH_FANOUT_MAX_TARGETS;
+
+    for (i = 0; i < count; i++)
+    {
+        p_mf->target[i] = ((uint16)(p_targets[2 * i] & 0x00FF) << 8) |
+                          (p_targets[2 * i + 1] & 0x00FF);
+    }
+    p_mf->count = count;
+    p_mf->msg_id = msg_id & 0x00FF;
+    p_mf->group_id = group_id;
+    p_mf->replied = 0;
+    p_mf->start_time = TimeGet32();
+    p_mf->active = TRUE;
+
+    mfArmTimer();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFRxReply
+ *
+ *  DESCRIPTION
+ *      Mark src_id as replied in the commands with the message ID of the
+ *      frame it sent. A command all targets have replied to is reported
+ *      on the next tick.
+ *
+ * PARAMETERS
+ *      src_id  [in]    Sender of the mesh frame
+ *      msg_id  [in]    Message ID of the mesh frame
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MFRxReply(uint16 src_id, uint8 msg_id)
+{
+    MESH_FANOUT_T *p_mf;
+    uint16 i, j;
+
+    msg_id &= 0x00FF;
+
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+    {
+        p_mf = &g_mesh_fanout[i];
+        if (!p_mf->active || p_mf->msg_id != msg_id)
+            continue;
+
+        for (j = 0; j < p_mf->count; j++)
+        {
+            if (p_mf->target[j] == src_id)
+            {
+                p_mf->replied |= (uint16)1 << j;
+                if (p_mf->replied == MF_ALL_REPLIED(p_mf))
+                    mfArmTimer();
+                break;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFGetReport
+ *
+ *  DESCRIPTION
+ *      Build the report of the oldest finished command. If none is finished
+ *      the timer is run on until the next one is.
+ *
+ * PARAMETERS
+ *      p_report [out]  At least MESH_FANOUT_REPORT_LENGTH bytes for the
+ *                      report: msg id | group id (2) | n | bitmap
+ *
+ * RETURNS
+ *      Length of the report, 0 if no report is finished.
+ *----------------------------------------------------------------------------*/
+uint16 MFGetReport(uint8 *p_report)
+{
+    const uint32 now = TimeGet32();
+    MESH_FANOUT_T *p_mf;
+    uint16 i, map_bytes;
+
+    g_mf_report = NULL;
+    for (i = 0; i < MESH_FANOUT_DEPTH; i++)
+    {
+        p_mf = &g_mesh_fanout[i];
+        if (p_mf->active && mfIsFinished(p_mf, now) &&
+            (g_mf_report == NULL ||
+             TimeSub(p_mf->start_time, g_mf_report->start_time) < 0))
+        {
+            g_mf_report = p_mf;
+        }
+    }
+
+    if (g_mf_report == NULL)
+    {
+        mfArmTimer();
+        return 0;
+    }
+
+    p_mf = g_mf_report;
+    map_bytes = (p_mf->count + 7) / 8;
+    p_report[0] = p_mf->msg_id;
+    p_report[1] = (p_mf->group_id >> 8) & 0x00FF;
+    p_report[2] = p_mf->group_id & 0x00FF;
+    p_report[3] = p_mf->count;
+    for (i = 0; i < map_bytes; i++)
+        p_report[4 + i] = (p_mf->replied >> (8 * i)) & 0x00FF;
+
+    return 4 + map_bytes;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MFReportSent
+ *
+ *  DESCRIPTION
+ *      Free the command reported by the last MFGetReport.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MFReportSent(void)
+{
+    if (g_mf_report == NULL)
+        return;
+
+    g_mf_report->active = FALSE;
+    g_mf_report = NULL;
+    mfArmTimer();
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      mesh_fanout.h
+ *
+ *  DESCRIPTION
+ *      Interface to the status collection of fan-out frames. A fan-out frame
+ *      from the Wi-Fi module carries one command for several heaters, which
+ *      is sent into the mesh once, to a group the heaters are members of:
+ *
+ *          EE | EF | msg id | group id (2) | len | n | n target IDs (2) |
+ *          data | bcc
+ *
+ *      The replies of the n targets are passed on to the Wi-Fi module as
+ *      usual. Once all targets have replied, or MESH_FANOUT_WAIT after the
+ *      command was sent, the module gets a report of who replied:
+ *
+ *          EE | EF | msg id | group id (2) | len | n | bitmap | bcc
+ *
+ *      Bit i % 8 of bitmap byte i / 8 is set if target i replied. A fan-out
+ *      frame without targets is sent to the group and not reported on.
+ *
+ *****************************************************************************/
+
+#ifndef __MESH_FANOUT_H__
+#define __MESH_FANOUT_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Most targets a fan-out frame can list, limited by the Wi-Fi frame size */
+#define MESH_FANOUT_MAX_TARGETS      (12)
+
+/* Number of fan-out commands whose replies can be collected at once */
+#define MESH_FANOUT_DEPTH            (2)
+
+/* Time the targets have to reply */
+#define MESH_FANOUT_WAIT             (2 * SECOND)
+
+/* Bytes of the bitmap in a report */
+#define MESH_FANOUT_MAP_BYTES        ((MESH_FANOUT_MAX_TARGETS + 7) / 8)
+
+/* Longest report: msg id | group id (2) | n | bitmap */
+#define MESH_FANOUT_REPORT_LENGTH    (4 + MESH_FANOUT_MAP_BYTES)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that stops collecting replies for all fan-out commands. */
+extern void MFInit(void);
+
+/* Function that returns TRUE if no more fan-out commands can be tracked. */
+extern bool MFIsFull(void);
+
+/* Function that starts collecting the replies to a fan-out command. The
+ * target IDs are byte pairs, high byte first, as in the fan-out frame.
+ */
+extern void MFStart(uint8 msg_id, uint16 group_id,
+                    const uint8 *p_targets, uint16 count);
+
+/* Function that records a mesh frame from src_id, which is a reply if it
+ * carries the message ID of a fan-out command src_id was a target of.
+ */
+extern void MFRxReply(uint16 src_id, uint8 msg_id);
+
+/* Function that copies the oldest finished report into p_report and returns
+ * its length, or returns 0 if no report is finished. The report stays
+ * until MFReportSent is called.
+ */
+extern uint16 MFGetReport(uint8 *p_report);
+
+/* Function that removes the report returned by the last MFGetReport. */
+extern void MFReportSent(void);
+
+#endif /* __MESH_FANOUT_H__ */
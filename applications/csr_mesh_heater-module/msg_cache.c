@@ -0,0 +1,173 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      msg_cache.c
+ *
+ *  DESCRIPTION
+ *      Cache of the mesh frames recently sent to the Wi-Fi module, keyed by
+ *      source ID, message ID and a CRC-16 of the frame. Message IDs wrap and
+ *      are reused, so an entry only matches for MSG_CACHE_AGE and the CRC
+ *      tells a new frame with a reused ID from a copy. When the cache is full
+ *      the oldest entry is replaced.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "msg_cache.h"
+#include "crc16.h"
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Recently seen frame */
+typedef struct _MSG_CACHE_ENTRY_T
+{
+    /* Sender of the frame */
+    uint16 src_id;
+
+    /* Message ID of the frame */
+    uint8 msg_id;
+
+    /* CRC-16 of the frame */
+    uint16 crc;
+
+    /* Time the frame was first seen */
+    uint32 time;
+
+    /* TRUE if the entry holds a frame */
+    bool used;
+}MSG_CACHE_ENTRY_T;
+
+/* Message cache data structure */
+typedef struct _MSG_CACHE_T
+{
+    MSG_CACHE_ENTRY_T entry[MSG_CACHE_SIZE];
+
+    /* Duplicates dropped */
+    uint16 suppressed;
+
+    /* Frame bytes of the dropped duplicates */
+    uint32 suppressed_bytes;
+}MSG_CACHE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static MSG_CACHE_T g_msg_cache;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MCInit
+ *
+ *  DESCRIPTION
+ *      Forget all frames and clear the statistics counters.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void MCInit(void)
+{
+    MemSet(&g_msg_cache, 0, sizeof(g_msg_cache));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MCIsDuplicate
+ *
+ *  DESCRIPTION
+ *      Look the frame up in the cache. A frame that is not found, or was
+ *      last seen more than MSG_CACHE_AGE ago, is stored in the entry of the
+ *      oldest frame.
+ *
+ * PARAMETERS
+ *      src_id  [in]    Sender of the frame
+ *      msg_id  [in]    Message ID of the frame
+ *      p_frame [in]    Frame bytes
+ *      len     [in]    Number of frame bytes
+ *
+ * RETURNS
+ *      TRUE if the frame is a duplicate and has to be dropped.
+ *----------------------------------------------------------------------------*/
+bool MCIsDuplicate(uint16 src_id, uint8 msg_id,
+                   const uint8 *p_frame, uint16 len)
+{
+    const uint32 now = TimeGet32();
+    const uint16 crc = CRC16Block(CRC16_INIT, p_frame, len);
+    MSG_CACHE_ENTRY_T *p_oldest = &g_msg_cache.entry[0];
+    MSG_CACHE_ENTRY_T *p_entry;
+    uint16 i;
+
+    msg_id &= 0x00FF;
+
+    for (i = 0; i < MSG_CACHE_SIZE; i++)
+    {
+        p_entry = &g_msg_cache.entry[i];
+
+        if (p_entry->used &&
+            TimeSub(now, p_entry->time) > (int32)MSG_CACHE_AGE)
+            p_entry->used = FALSE;
+
+        if (!p_entry->used)
+        {
+            if (p_oldest->used)
+                p_oldest = p_entry;
+            continue;
+        }
+
+        if (p_entry->src_id == src_id && p_entry->msg_id == msg_id &&
+            p_entry->crc == crc)
+        {
+            if (g_msg_cache.suppressed < 0xFFFF)
+                g_msg_cache.suppressed++;
+            g_msg_cache.suppressed_bytes += len;
+
+            return TRUE;
+        }
+
+        if (p_oldest->used && TimeSub(p_entry->time, p_oldest->time) < 0)
+            p_oldest = p_entry;
+    }
+
+    p_oldest->src_id = src_id;
+    p_oldest->msg_id = msg_id;
+    p_oldest->crc = crc;
+    p_oldest->time = now;
+    p_oldest->used = TRUE;
+
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MCGetSuppressedCount
+ *
+ *  DESCRIPTION
+ *      Return the number of duplicates dropped since MCInit.
+ *
+ * PARAMETERS
+ *      p_bytes [out]   Frame bytes the duplicates would have taken on the
+ *                      UART, may be NULL
+ *
+ * RETURNS
+ *      Number of dropped duplicates
+ *----------------------------------------------------------------------------*/
+uint16 MCGetSuppressedCount(uint32 *p_bytes)
+{
+    if (p_bytes != NULL)
+        *p_bytes = g_msg_cache.suppressed_bytes;
+
+    return g_msg_cache.suppressed;
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      msg_cache.h
+ *
+ *  DESCRIPTION
+ *      Interface to the cache of mesh frames recently sent to the Wi-Fi
+ *      module. Relaying and flooding deliver the same frame several times,
+ *      the cache lets the copies be dropped before they reach the UART.
+ *
+ *****************************************************************************/
+
+#ifndef __MSG_CACHE_H__
+#define __MSG_CACHE_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Number of recent frames remembered */
+#define MSG_CACHE_SIZE               (8)
+
+/* Time after which a frame with the same source, message ID and payload is
+ * taken to be a new one
+ */
+#define MSG_CACHE_AGE                (5 * SECOND)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that forgets all frames and clears the statistics counters. */
+extern void MCInit(void);
+
+/* Function that returns TRUE if the frame is a copy of one seen less than
+ * MSG_CACHE_AGE ago, otherwise it remembers the frame and returns FALSE.
+ */
+extern bool MCIsDuplicate(uint16 src_id, uint8 msg_id,
+                          const uint8 *p_frame, uint16 len);
+
+/* Function that returns the number of duplicates dropped and the number of
+ * frame bytes they would have taken on the UART.
+ */
+extern uint16 MCGetSuppressedCount(uint32 *p_bytes);
+
+#endif /* __MSG_CACHE_H__ */
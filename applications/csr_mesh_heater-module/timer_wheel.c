@@ -0,0 +1,820 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      timer_wheel.c
+ *
+ *  DESCRIPTION
+ *      Application software timers kept in a three level hierarchical timing
+ *      wheel. Each tick only visits the timers due in the current slot, and
+ *      once every 32 ticks the timers of one coarser slot are spread down to
+ *      the level below, so the work per tick no longer grows with the number
+ *      of timers.
+ *
+ *      The tick is not free running. A single firmware timer is armed for the
+ *      next tick that has work to do, either a timer expiring or the
+ *      application asking to run again, and the wheel catches up on the
+ *      ticks it slept through when it wakes. A bitmap of the slots in use on
+ *      each level lets both find the next slot with timers without visiting
+ *      the empty ones, so neither depends on the number of timers or on how
+ *      long the wheel slept.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <time.h>
+#include <timer.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "timer_wheel.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Each level has 2^TW_SLOT_BITS slots */
+#define TW_SLOT_BITS                 (5)
+#define TW_SLOTS                     (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK                 (TW_SLOTS - 1)
+
+/* Level 0 slots are one tick, level 1 slots 32 ticks, level 2 slots 1024
+ * ticks wide
+ */
+#define TW_LEVELS                    (3)
+
+/* Marks the end of a slot list and a timer that is not in the wheel */
+#define TW_NONE                      (0xFF)
+
+/* Slot of the given level a timer expiring at the given tick is kept in */
+#define TW_SLOT(level, expires) \
+  ((uint16)((level) * TW_SLOTS + \
+            (((expires) >> ((level) * TW_SLOT_BITS)) & TW_SLOT_MASK)))
+
+/* Ticks spanned by one slot of the given level */
+#define TW_SLOT_TICKS(level)         ((uint32)1 << ((level) * TW_SLOT_BITS))
+
+/* Period of one tick in microseconds */
+#define TW_TICK_US                   ((uint32)TW_TICK_MS * MILLISECOND)
+
+/* Shortest delay the firmware timer is armed for */
+#define TW_MIN_DELAY                 (1 * MILLISECOND)
+
+/* Timer states */
+#define TW_IDLE                      (0)
+#define TW_RUNNING                   (1)
+#define TW_EXPIRED                   (2)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Software timer */
+typedef struct _TW_TIMER_T
+{
+    /* Tick the timer expires on */
+    uint32 expires;
+
+    /* Next and previous timers in the same slot */
+    uint8 next;
+    uint8 prev;
+
+    /* Slot the timer is linked into, TW_NONE if it is not running */
+    uint8 slot;
+
+    /* TW_IDLE, TW_RUNNING or TW_EXPIRED */
+    uint8 state;
+}TW_TIMER_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Application timers */
+static TW_TIMER_T g_tw_timer[TM_COUNT];
+
+/* First timer in each slot of each level */
+static uint8 g_tw_slot[TW_LEVELS * TW_SLOTS];
+
+/* Slots of each level that hold timers, bit n for slot n */
+static uint32 g_tw_used[TW_LEVELS];
+
+/* Tick processed by the next call to twTick */
+static uint32 g_tw_now;
+
+/* Time of the tick boundary the wheel was last advanced to */
+static uint32 g_tw_tick_time;
+
+/* Application work run on every wakeup, NULL until TWStartTick */
+static TW_TICK_HANDLER_T g_tw_handler = NULL;
+
+/* Firmware timer for the next wakeup */
+static timer_id g_tw_tid = TIMER_INVALID;
+
+/* TRUE while the application tick handler runs */
+static bool g_tw_in_handler = FALSE;
+
+/* TRUE when the handler is to run on the next tick boundary */
+static bool g_tw_rerun = FALSE;
+
+/* TRUE when the handler is to run as soon as possible */
+static bool g_tw_kicked = FALSE;
+
+/* Total number of wakeups */
+static uint32 g_tw_wakeups;
+
+/* Start of the current wakeup rate window and wakeups counted in it */
+static uint32 g_tw_window_start;
+static uint16 g_tw_window_wakeups;
+
+/* Wakeups per second measured over the last complete window */
+static uint16 g_tw_wakeups_per_sec;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Add a running timer to the slot matching its expiry tick */
+static void twLink(uint8 id);
+
+/* Remove a timer from its slot */
+static void twUnlink(uint8 id);
+
+/* Move all timers of a slot down to the level below */
+static uint16 twCascade(uint16 level, uint16 index);
+
+/* First slot of a level in use at or after the given index */
+static uint16 twNextSlot(uint16 level, uint16 index);
+
+/* First tick a slot of a level is processed or cascaded on */
+static uint32 twNextSlotTick(uint16 level, uint16 *p_slot);
+
+/* Number of ticks the wheel can skip without missing any work */
+static uint32 twQuietTicks(uint32 limit);
+
+/* Advance the wheel by one tick */
+static bool twTick(void);
+
+/* Advance the wheel over the ticks that have elapsed */
+static void twCatchUp(void);
+
+/* Number of ticks until the next timer expires */
+static uint32 twNextDeadline(void);
+
+/* Arm the firmware timer for the next wakeup */
+static void twSchedule(void);
+
+/* Update the wakeup counters */
+static void twCountWakeup(void);
+
+/* Firmware timer expiry handler */
+static void twTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twLink
+ *
+ *  DESCRIPTION
+ *      Add a running timer to the finest level whose span still covers its
+ *      expiry tick.
+ *
+ * PARAMETERS
+ *      id     [in]     Timer to add
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twLink(uint8 id)
+{
+    TW_TIMER_T *p_timer = &g_tw_timer[id];
+    const uint32 delta = p_timer->expires - g_tw_now;
+    uint16 slot;
+
+    if (delta < TW_SLOTS)
+        slot = TW_SLOT(0, p_timer->expires);
+    else if (delta < ((uint32)1 << (2 * TW_SLOT_BITS)))
+        slot = TW_SLOT(1, p_timer->expires);
+    else
+        slot = TW_SLOT(2, p_timer->expires);
+
+    p_timer->slot = slot;
+    p_timer->prev = TW_NONE;
+    p_timer->next = g_tw_slot[slot];
+
+    if (p_timer->next != TW_NONE)
+        g_tw_timer[p_timer->next].prev = id;
+
+    g_tw_slot[slot] = id;
+    g_tw_used[slot >> TW_SLOT_BITS] |= (uint32)1 << (slot & TW_SLOT_MASK);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twUnlink
+ *
+ *  DESCRIPTION
+ *      Remove a timer from its slot, if it is in one.
+ *
+ * PARAMETERS
+ *      id     [in]     Timer to remove
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twUnlink(uint8 id)
+{
+    TW_TIMER_T *p_timer = &g_tw_timer[id];
+
+    if (p_timer->slot == TW_NONE)
+        return;
+
+    if (p_timer->prev != TW_NONE)
+        g_tw_timer[p_timer->prev].next = p_timer->next;
+    else
+        g_tw_slot[p_timer->slot] = p_timer->next;
+
+    if (p_timer->next != TW_NONE)
+        g_tw_timer[p_timer->next].prev = p_timer->prev;
+
+    if (g_tw_slot[p_timer->slot] == TW_NONE)
+        g_tw_used[p_timer->slot >> TW_SLOT_BITS] &=
+            ~((uint32)1 << (p_timer->slot & TW_SLOT_MASK));
+
+    p_timer->slot = TW_NONE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twCascade
+ *
+ *  DESCRIPTION
+ *      Relink all timers of a slot, which now all expire within the span of
+ *      the level below.
+ *
+ * PARAMETERS
+ *      level  [in]     Level of the slot
+ *      index  [in]     Index of the slot within the level
+ *
+ * RETURNS
+ *      The slot index, so the caller knows when the next level is due.
+ *----------------------------------------------------------------------------*/
+static uint16 twCascade(uint16 level, uint16 index)
+{
+    uint8 id = g_tw_slot[level * TW_SLOTS + index];
+
+    g_tw_slot[level * TW_SLOTS + index] = TW_NONE;
+    g_tw_used[level] &= ~((uint32)1 << index);
+
+    while (id != TW_NONE)
+    {
+        const uint8 next = g_tw_timer[id].next;
+
+        twLink(id);
+        id = next;
+    }
+
+    return index;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twNextSlot
+ *
+ *  DESCRIPTION
+ *      Find the first slot of a level that holds timers, going round the
+ *      level from the given index.
+ *
+ * PARAMETERS
+ *      level  [in]     Level to search
+ *      index  [in]     Index of the slot to start at
+ *
+ * RETURNS
+ *      Index of the slot within the level, TW_NONE if the level is empty.
+ *----------------------------------------------------------------------------*/
+static uint16 twNextSlot(uint16 level, uint16 index)
+{
+    uint32 used = g_tw_used[level];
+    uint16 skip = 0;
+
+    if (used == 0)
+        return TW_NONE;
+
+    /* Rotate the slot at index down to bit 0 */
+    if (index != 0)
+        used = (used >> index) | (used << (TW_SLOTS - index));
+
+    while ((used & 0xFF) == 0)
+    {
+        used >>= 8;
+        skip += 8;
+    }
+    while ((used & 1) == 0)
+    {
+        used >>= 1;
+        skip++;
+    }
+
+    return (uint16)((index + skip) & TW_SLOT_MASK);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twNextSlotTick
+ *
+ *  DESCRIPTION
+ *      Find the first slot of a level in use that the wheel reaches: on
+ *      level 0 the next slot a tick processes, on the coarser levels the
+ *      next slot cascaded down. Slots of a level are reached in order from
+ *      the one at the next tick boundary of the level, the slot of the
+ *      current index having been cascaded already if the boundary passed.
+ *
+ * PARAMETERS
+ *      level  [in]     Level to search
+ *      p_slot [out]    Slot found, TW_NONE if the level is empty
+ *
+ * RETURNS
+ *      Number of ticks from g_tw_now to the tick the slot is reached on.
+ *----------------------------------------------------------------------------*/
+static uint32 twNextSlotTick(uint16 level, uint16 *p_slot)
+{
+    const uint32 width = TW_SLOT_TICKS(level);
+    const uint32 boundary = (g_tw_now + width - 1) & ~(width - 1);
+    const uint16 index =
+        (uint16)((boundary >> (level * TW_SLOT_BITS)) & TW_SLOT_MASK);
+    const uint16 slot = twNextSlot(level, index);
+
+    *p_slot = slot;
+    if (slot == TW_NONE)
+        return 0;
+
+    return boundary - g_tw_now +
+           (uint32)((slot - index) & TW_SLOT_MASK) * width;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twQuietTicks
+ *
+ *  DESCRIPTION
+ *      Count the ticks from g_tw_now on that would neither expire a timer
+ *      nor cascade one, which the wheel can skip in one step.
+ *
+ * PARAMETERS
+ *      limit  [in]     Most ticks to count
+ *
+ * RETURNS
+ *      Number of ticks, at most limit.
+ *----------------------------------------------------------------------------*/
+static uint32 twQuietTicks(uint32 limit)
+{
+    uint32 quiet = limit;
+    uint16 level, slot;
+
+    for (level = 0; level < TW_LEVELS; level++)
+    {
+        const uint32 ticks = twNextSlotTick(level, &slot);
+
+        if (slot != TW_NONE && ticks < quiet)
+            quiet = ticks;
+    }
+
+    return quiet;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twTick
+ *
+ *  DESCRIPTION
+ *      Advance the wheel by one tick. When the level 0 index wraps, the next
+ *      level 1 slot (and, when that wraps too, the next level 2 slot) is
+ *      cascaded down first, then every timer in the current level 0 slot is
+ *      marked expired.
+ *
+ * RETURNS
+ *      TRUE if any timer expired
+ *----------------------------------------------------------------------------*/
+static bool twTick(void)
+{
+    const uint16 index = (uint16)(g_tw_now & TW_SLOT_MASK);
+    uint8 id;
+    bool expired;
+
+    if (index == 0 &&
+        twCascade(1, TW_SLOT(1, g_tw_now) - TW_SLOTS) == 0)
+    {
+        twCascade(2, TW_SLOT(2, g_tw_now) - 2 * TW_SLOTS);
+    }
+
+    id = g_tw_slot[index];
+    g_tw_slot[index] = TW_NONE;
+    g_tw_used[0] &= ~((uint32)1 << index);
+    expired = (id != TW_NONE);
+
+    while (id != TW_NONE)
+    {
+        g_tw_timer[id].slot = TW_NONE;
+        g_tw_timer[id].state = TW_EXPIRED;
+        id = g_tw_timer[id].next;
+    }
+
+    g_tw_now++;
+
+    return expired;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twCatchUp
+ *
+ *  DESCRIPTION
+ *      Advance the wheel over every whole tick that has elapsed since it was
+ *      last advanced. Runs of ticks with no timer to expire or cascade are
+ *      skipped in one step, so a long sleep costs a few steps per slot in
+ *      use rather than one per tick. Timers that expire outside the tick
+ *      handler make the handler run as soon as possible so it can act on
+ *      them.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twCatchUp(void)
+{
+    uint32 ticks, quiet;
+
+    if (g_tw_handler == NULL)
+        return;
+
+    ticks = (uint32)TimeSub(TimeGet32(), g_tw_tick_time) / TW_TICK_US;
+    g_tw_tick_time += ticks * TW_TICK_US;
+
+    while (ticks != 0)
+    {
+        quiet = twQuietTicks(ticks);
+        g_tw_now += quiet;
+        ticks -= quiet;
+
+        if (ticks != 0)
+        {
+            ticks--;
+            if (twTick() && !g_tw_in_handler)
+                g_tw_kicked = TRUE;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twNextDeadline
+ *
+ *  DESCRIPTION
+ *      Find the running timer that expires first. On each level it can only
+ *      be in the first slot in use the wheel reaches, as the timers of later
+ *      slots expire later, so only the timers of those slots are visited.
+ *
+ * RETURNS
+ *      Number of ticks until it expires, 0 if no timer is running.
+ *----------------------------------------------------------------------------*/
+static uint32 twNextDeadline(void)
+{
+    uint32 next = 0;
+    uint16 level, slot;
+    uint8 id;
+
+    for (level = 0; level < TW_LEVELS; level++)
+    {
+        (void)twNextSlotTick(level, &slot);
+        if (slot == TW_NONE)
+            continue;
+
+        for (id = g_tw_slot[level * TW_SLOTS + slot]; id != TW_NONE;
+             id = g_tw_timer[id].next)
+        {
+            /* The timer is expired by the tick that processes its slot */
+            const uint32 ticks = g_tw_timer[id].expires - g_tw_now + 1;
+
+            if (next == 0 || ticks < next)
+                next = ticks;
+        }
+    }
+
+    return next;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twSchedule
+ *
+ *  DESCRIPTION
+ *      Re-arm the firmware timer for the next wakeup: as soon as possible if
+ *      the handler was kicked, otherwise on the earlier of the next tick (if
+ *      the handler asked to run again) and the tick the next timer expires
+ *      on. With nothing pending no timer is armed and the chip sleeps until
+ *      the handler is kicked. If no firmware timer is free the wheel is left
+ *      unarmed, and the next TWStart or TWKick tries again.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twSchedule(void)
+{
+    int32 delay;
+
+    /* The handler re-arms the timer itself once it returns */
+    if (g_tw_handler == NULL || g_tw_in_handler)
+        return;
+
+    if (g_tw_tid != TIMER_INVALID)
+    {
+        TimerDelete(g_tw_tid);
+        g_tw_tid = TIMER_INVALID;
+    }
+
+    if (g_tw_kicked)
+    {
+        delay = TW_MIN_DELAY;
+    }
+    else
+    {
+        uint32 ticks = twNextDeadline();
+
+        if (g_tw_rerun && (ticks == 0 || ticks > 1))
+            ticks = 1;
+
+        if (ticks == 0)
+            return;
+
+        delay = TimeSub(g_tw_tick_time + ticks * TW_TICK_US, TimeGet32());
+        if (delay < TW_MIN_DELAY)
+            delay = TW_MIN_DELAY;
+    }
+
+    g_tw_tid = TimerCreate((uint32)delay, TRUE, twTimerHandler);
+    if (g_tw_tid == TIMER_INVALID)
+    {
+        /* Run the handler as soon as a timer can be armed, as it may have
+         * missed a deadline by then
+         */
+        g_tw_kicked = TRUE;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twCountWakeup
+ *
+ *  DESCRIPTION
+ *      Count a wakeup, and once a second has passed since the rate window
+ *      started, latch the wakeup rate over that window and start a new one.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twCountWakeup(void)
+{
+    const uint32 now = TimeGet32();
+    const uint32 window_ms = (uint32)TimeSub(now, g_tw_window_start) /
+                             MILLISECOND;
+
+    g_tw_wakeups++;
+    g_tw_window_wakeups++;
+
+    if (window_ms >= 1000)
+    {
+        g_tw_wakeups_per_sec =
+            (uint16)(((uint32)g_tw_window_wakeups * 1000 + window_ms / 2) /
+                     window_ms);
+        g_tw_window_wakeups = 0;
+        g_tw_window_start = now;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      twTimerHandler
+ *
+ *  DESCRIPTION
+ *      Bring the wheel up to date, run the application tick handler and arm
+ *      the firmware timer for the next wakeup.
+ *
+ * PARAMETERS
+ *      tid    [in]     Firmware timer that expired
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void twTimerHandler(timer_id tid)
+{
+    if (tid != g_tw_tid)
+        return;
+
+    g_tw_tid = TIMER_INVALID;
+    twCountWakeup();
+
+    g_tw_in_handler = TRUE;
+    twCatchUp();
+    g_tw_kicked = FALSE;
+    g_tw_rerun = FALSE;
+
+    if (g_tw_handler())
+        g_tw_rerun = TRUE;
+
+    g_tw_in_handler = FALSE;
+    twSchedule();
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWInit
+ *
+ *  DESCRIPTION
+ *      Stop all timers and empty the wheel.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void TWInit(void)
+{
+    uint16 i;
+
+    for (i = 0; i < TW_LEVELS * TW_SLOTS; i++)
+        g_tw_slot[i] = TW_NONE;
+
+    for (i = 0; i < TW_LEVELS; i++)
+        g_tw_used[i] = 0;
+
+    for (i = 0; i < TM_COUNT; i++)
+    {
+        g_tw_timer[i].slot = TW_NONE;
+        g_tw_timer[i].state = TW_IDLE;
+    }
+
+    g_tw_now = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWStart
+ *
+ *  DESCRIPTION
+ *      Start a timer, or restart it if it is already running or expired. The
+ *      timer expires on the given tick counting the next one as the first,
+ *      the same as arming one of the old polled TIME16 counters, and the
+ *      firmware timer is re-armed if the new timer is due first.
+ *
+ * PARAMETERS
+ *      id     [in]     Timer to start
+ *      ticks  [in]     Timeout in ticks, clamped to TW_MAX_TICKS
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void TWStart(TW_TIMER_ID_T id, uint32 ticks)
+{
+    /* Count from the current tick, not the one the wheel last woke on */
+    twCatchUp();
+    twUnlink(id);
+
+    if (ticks > TW_MAX_TICKS)
+        ticks = TW_MAX_TICKS;
+    else if (ticks == 0)
+        ticks = 1;
+
+    g_tw_timer[id].expires = g_tw_now + ticks - 1;
+    g_tw_timer[id].state = TW_RUNNING;
+    twLink(id);
+
+    /* The new timer may be due before the armed wakeup */
+    twSchedule();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWStop
+ *
+ *  DESCRIPTION
+ *      Stop a timer and clear its expired state.
+ *
+ * PARAMETERS
+ *      id     [in]     Timer to stop
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void TWStop(TW_TIMER_ID_T id)
+{
+    twUnlink(id);
+    g_tw_timer[id].state = TW_IDLE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWExpired
+ *
+ *  DESCRIPTION
+ *      Check whether a timer has expired.
+ *
+ * PARAMETERS
+ *      id     [in]     Timer to check
+ *
+ * RETURNS
+ *      TRUE if the timer has expired and not been stopped or restarted since
+ *----------------------------------------------------------------------------*/
+bool TWExpired(TW_TIMER_ID_T id)
+{
+    return (g_tw_timer[id].state == TW_EXPIRED);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWStartTick
+ *
+ *  DESCRIPTION
+ *      Start driving the wheel and the application tick handler from the
+ *      firmware timer. Must be called after TimerInit. The handler first runs
+ *      one tick later and after that whenever a timer expires, it returns
+ *      TRUE or TWKick is called.
+ *
+ * PARAMETERS
+ *      handler [in]    Application work run on each wakeup
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void TWStartTick(TW_TICK_HANDLER_T handler)
+{
+    g_tw_handler = handler;
+    g_tw_tick_time = TimeGet32();
+    g_tw_window_start = g_tw_tick_time;
+    g_tw_rerun = TRUE;
+
+    twSchedule();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWKick
+ *
+ *  DESCRIPTION
+ *      Ask for the tick handler to run because there is new work for it.
+ *      Called from inside the handler it runs again on the next tick,
+ *      otherwise it runs as soon as possible. The firmware timer is armed
+ *      again if it could not be before.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void TWKick(void)
+{
+    if (g_tw_in_handler)
+    {
+        g_tw_rerun = TRUE;
+    }
+    else if (!g_tw_kicked || g_tw_tid == TIMER_INVALID)
+    {
+        g_tw_kicked = TRUE;
+        twSchedule();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWGetWakeupCount
+ *
+ *  DESCRIPTION
+ *      Return the number of times the tick has woken the application.
+ *
+ * RETURNS
+ *      Number of wakeups
+ *----------------------------------------------------------------------------*/
+uint32 TWGetWakeupCount(void)
+{
+    return g_tw_wakeups;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TWGetWakeupsPerSecond
+ *
+ *  DESCRIPTION
+ *      Return the wakeup rate measured over the last complete window of at
+ *      least one second. An idle heater that wakes less than once every two
+ *      seconds reads 0, use TWGetWakeupCount for long term averages.
+ *
+ * RETURNS
+ *      Wakeups per second
+ *----------------------------------------------------------------------------*/
+uint16 TWGetWakeupsPerSecond(void)
+{
+    return g_tw_wakeups_per_sec;
+}
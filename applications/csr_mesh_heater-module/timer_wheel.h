@@ -0,0 +1,100 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      timer_wheel.h
+ *
+ *  DESCRIPTION
+ *      Interface to the application software timers, kept in a hierarchical
+ *      timing wheel, and to the tickless application tick that drives them.
+ *
+ *****************************************************************************/
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* Period of one wheel tick in milliseconds */
+#define TW_TICK_MS                   (10)
+
+/* Convert a timeout to wheel ticks */
+#define TW_TICKS_10MS(n)             ((uint32)(n))
+#define TW_TICKS_100MS(n)            ((uint32)(n) * 10)
+#define TW_TICKS_1S(n)               ((uint32)(n) * 100)
+
+/* Longest timeout the wheel can hold, about 5 minutes. Longer timeouts are
+ * clamped to this.
+ */
+#define TW_MAX_TICKS                 ((uint32)0x7FFF)
+
+/* Application timers */
+typedef enum
+{
+    TM_WIFI_SEND_DATA = 0,
+    TM_SEND_EE_WAIT,
+    TM_MESH_FINISH_DATA_WAIT,
+    TM_WRITE_FLASH_DELAY,
+    TM_RST_WAIT,
+    TM_ON_TIME_WAIT,
+    TM_HEART_PACK,
+    TM_PANIC,
+    TM_BLE_RESET,
+    TM_ADV_UUID,
+    TM_MESH_TIMEOUT,
+    TM_POWERON_WAIT,
+    TM_WIFI_LINK_RETX,
+    TM_WIFI_BATCH,
+    TM_MESH_FANOUT,
+
+    TM_COUNT
+}TW_TIMER_ID_T;
+
+/* Application work run on each wakeup of the tick. Returns TRUE if it has
+ * more work to do and needs to run again on the next tick.
+ */
+typedef bool (*TW_TICK_HANDLER_T)(void);
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that stops all timers and empties the wheel. */
+extern void TWInit(void);
+
+/* Function that (re)starts a timer to expire after the given number of
+ * ticks. A timeout of 0 or 1 expires on the next tick.
+ */
+extern void TWStart(TW_TIMER_ID_T id, uint32 ticks);
+
+/* Function that stops a timer and clears its expired state. */
+extern void TWStop(TW_TIMER_ID_T id);
+
+/* Function that returns TRUE once a timer has expired, until it is stopped
+ * or restarted.
+ */
+extern bool TWExpired(TW_TIMER_ID_T id);
+
+/* Function that starts the tick, which wakes the application only when a
+ * timer expires or the handler has work pending. Called after TimerInit.
+ */
+extern void TWStartTick(TW_TICK_HANDLER_T handler);
+
+/* Function that makes the tick handler run soon because there is new work. */
+extern void TWKick(void);
+
+/* Function that returns the total number of tick wakeups. */
+extern uint32 TWGetWakeupCount(void);
+
+/* Function that returns the tick wakeups per second over the last second. */
+extern uint16 TWGetWakeupsPerSecond(void);
+
+#endif /* __TIMER_WHEEL_H__ */
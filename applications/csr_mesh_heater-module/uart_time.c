@@ -18,6 +18,11 @@
 
 #include "define.h"
 #include "byte_queue.h"
+#include "frame_queue.h"
+#include "app_event.h"
+#include "wifi_link.h"
+#include "crc16.h"
+#include "mesh_fanout.h"
 #include "app_debug.h"
 #include "app_mesh_handler.h"
 /*#include "debug_interface.h"*/  
@@ -28,28 +33,40 @@
 #define HIGH_BAUD_RATE                   (0x00eb) /* 57600*/
 /*#define HIGH_BAUD_RATE                   (0x01d9)  115200*/
 #define TIME30S (30*SECOND)
+/* Maximum gap between two bytes of the same Wi-Fi frame. A longer gap means
+ * the frame was truncated and the parser hunts for a new header.
+ */
+#define WIFI_RX_FRAME_GAP                (5 * MILLISECOND)
 static uint16 uartRxDataCallback(void   *p_rx_buffer,
                                  uint16  length,
                                  uint16 *p_req_data_length);
 
 static void uartTxDataCallback(void);
-static void WifiRxdCheck_New(void);
+static void wifiRxParseReset(void);
+static void wifiRxParseBytes(const uint8 *p_data, uint16 length);
+static void wifiRxFrameComplete(void);
 static void sendPendingData(void);
-static void WifiTxDataClear(void);
-static void WifiTxGetBcc(void);
-static void WifiRxdDataDo_New(void);
+static bool wifiTxFrameBegin(uint16 frame_len);
+static void wifiTxFramePut(uint8 byte);
+static void wifiTxFrameEnd(void);
+static void wifiTxRecordFrame(const uint8 *p_record);
+static bool wifiTxBatchFits(void);
+static bool wifiTxBatchAdd(uint8 type);
+static bool wifiTxBatchFlush(void);
+static void WifiRxdDataDo_New(const uint8 *p_frame);
 void SendDataToUart(void);
 extern void AppGetState(void);
 
-void WifiRxDataClear(void);
 void processdata(void);
 /*extern void startStream(uint16 dest_id);*/
 static void WifiTxDataEEEE(void);
 static void WifiTxDataDD(void);
 static void CLEAR_BLE_RX_DATA(void);
-static void WifiRxDataEEAA(void);
-static void WifiRxDataEEEE(void);
+static void WifiRxDataEEAA(const uint8 *p_frame);
+static void WifiRxDataEEEE(const uint8 *p_frame);
 static void WifiTxDataEEAA(void);
+static void WifiRxDataFanout(const uint8 *p_frame);
+static bool WifiTxDataFanout(void);
 static void CLEAR_BLE_TX_DATA(void);
 
 /* Create 256-byte receive buffer for UART data */
@@ -57,6 +74,51 @@ UART_DECLARE_BUFFER(rx_buffer, UART_BUF_SIZE_BYTES_64);
 
 /* Create 256-byte transmit buffer for UART data */
 UART_DECLARE_BUFFER(tx_buffer, UART_BUF_SIZE_BYTES_64);
+
+/* Number of bytes of the outgoing frame written into the transmit queue */
+static uint16 tx_frame_pos = 0;
+
+/* Running XOR of the outgoing frame bytes, from byte 2 onwards */
+static uint8 tx_frame_bcc = 0;
+
+/* v2 window slot the outgoing frame is built in, NULL for a v1 frame */
+static uint8 *p_tx_frame = NULL;
+
+/* Free space past the tail of the transmit queue, up to the end of its
+ * buffer, that a v1 frame is written to directly
+ */
+static uint8 *p_tx_span = NULL;
+static uint16 tx_span_len = 0;
+
+/* Mesh messages waiting to go out together in one batch frame */
+static uint8 tx_batch[WIFI_BATCH_MAX_LENGTH];
+
+/* Number of bytes of records in tx_batch */
+static uint16 tx_batch_len = 0;
+
+/* Wi-Fi frame receive parser state */
+static uint8 rx_parse_state = cRxdHuntHead;
+
+/* Frame being assembled, a free frame queue slot or rx_overflow_frame */
+static uint8 *p_rx_frame = NULL;
+
+/* Scratch frame used to stay in sync while the frame queue is full */
+static uint8 rx_overflow_frame[WIFI_FRAME_MAX_LENGTH];
+
+/* Running XOR of the frame bytes received so far */
+static uint8 rx_frame_bcc = 0;
+
+/* CRC-16 of the frame bytes received so far, check included */
+static uint16 rx_frame_crc = CRC16_INIT;
+
+/* TRUE if the frame being received ends in a CRC-16 rather than a BCC */
+static bool rx_frame_uses_crc = FALSE;
+
+/* Length of the frame being received, known once its header is complete */
+static uint16 rx_frame_len = 0;
+
+/* Time the last byte was received from the Wi-Fi module */
+static uint32 rx_last_byte_time = 0;
 /*#define SERIAL_RX_DATA_LENGTH           (20)*/
 /*uint8 uart_rx_buffer[30];*/
 /*============================================================================*
@@ -64,104 +126,240 @@ UART_DECLARE_BUFFER(tx_buffer, UART_BUF_SIZE_BYTES_64);
  *============================================================================*/
 static void sendPendingData(void)
 {
-    uint16 length = BQGetDataSize(RECV_QUEUE_ID);
-    uint8  data[40]; 
+    const uint8 *p_data;
     uint16 size_val;
-     /* Loop until the byte queue is empty */ 
-    while (BQGetDataSize(RECV_QUEUE_ID) > 0)
-    {     
-        size_val = length > SERIAL_RX_DATA_LENGTH ?
-                   SERIAL_RX_DATA_LENGTH : length;
-         /* Read the next byte in the queue */
-        if (BQPeekBytes(data,size_val,RECV_QUEUE_ID) > 0)
+     /* Loop until the byte queue is empty, writing straight from the queue */
+    while ((size_val = BQGetReadSpan(&p_data, RECV_QUEUE_ID)) > 0)
+    {
+        if (size_val > SERIAL_RX_DATA_LENGTH)
+            size_val = SERIAL_RX_DATA_LENGTH;
+
+        if (!UartWrite(p_data, size_val))
         {
-            bool ok_to_commit = UartWrite( data,size_val);
-            if(!ok_to_commit)
-            {
-                /* exit on failure */
-                break;
-            }
-            else
-                 BQPopBytes(data, size_val,RECV_QUEUE_ID);
+            /* exit on failure */
+            break;
         }
+        BQCommitRead(size_val, RECV_QUEUE_ID);
     }
-    /*ɺ󣬵ȴ2ms*/
-    tm_1ms.tWifiTwoByteSentTime.word = C_T_WifiTwoByteSentTime;
-    /*160msʱ*/
-    
 }
 
 void SendDataToUart(void)
 {
-
-    uint16 size_val = 0;
-    uint8 txdata[40];
-    uint8 i =0;
-    if(WifiTxData[1].byte == 0xEE || WifiTxData[1].byte == 0xAA)
-         size_val = WifiTxData[5].byte+3;
-    else if(WifiTxData[0].byte == 0xDD && WifiTxData[1].byte == 0xDD)
-         size_val = WifiTxData[3].byte+3;
-    
-    /*ڷ4msʱ*/
-    tm_4ms.twifitstxcyc.word = C_T_wifitstxcyc;
-    while(i < 40)
-    {
-         txdata[i] = WifiTxData[i].byte;
-         i++;
-    }
-         /* First copy all the bytes received into the byte queue */
-    BQSafeQueueBytes(txdata, size_val,RECV_QUEUE_ID);
+    /* Frames are serialized straight into the byte queue, drain it */
     sendPendingData();
-
 }
 
-static uint16 uartRxDataCallback(void   *p_rx_buffer,
-                                 uint16  length,
-                                 uint16 *p_additional_req_data_length)
-{  
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiRxParseReset
+ *
+ *  DESCRIPTION
+ *      Drops any partially received frame and hunts for the next EE header.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void wifiRxParseReset(void)
+{
+     rx_parse_state = cRxdHuntHead;
+     WifiDataCount = CLEAR;
+}
 
-        if ( length > 0 && tm_1ms.tUartWait10ms.fov == ON)
-        {
-        /* First copy all the bytes received into the byte queue */
-        BQForceQueueBytes((const uint8 *)p_rx_buffer, length,SEND_QUEUE_ID);
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiRxParseBytes
+ *
+ *  DESCRIPTION
+ *      Runs the EE EE / EE AA frame parser over a block of received bytes,
+ *      v2 frames (E2 header, see wifi_link.h) and EE EF fan-out frames (see
+ *      mesh_fanout.h) are parsed alongside.
+ *      The frame is assembled straight into a free frame queue slot and the
+ *      BCC is accumulated as the bytes arrive, so a complete frame is verified
+ *      and queued for the mesh sender without a second pass over the data.
+ *      If the queue is full the frame is still parsed, to stay in sync, and
+ *      counted as dropped once complete.
+ *
+ *      Frame layout: EE | EE/AA | msg id | mesh id (2) | len | data | bcc
+ *      The BCC is the XOR of bytes 2 to len+1, the frame is len+3 bytes long.
+ *      A v2 frame carries sequence number and ACK before the BCC and is two
+ *      bytes longer. If CRC-16 has been negotiated the BCC of a v2 frame is
+ *      replaced by a two byte CRC. Both checks are accumulated byte by byte,
+ *      the CRC over the check bytes as well, so the frame is verified by a
+ *      single compare once its last byte arrives.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void wifiRxParseBytes(const uint8 *p_data, uint16 length)
+{
+     uint16 i;
+     uint8 byte;
 
-        }
-       
-    /* Send any pending data waiting to be sent */
-        while (BQGetDataSize(SEND_QUEUE_ID) > 0)
-        {
-            uint8 byte = '\0';        
-        /* Read the next byte in the queue */
-            if (BQPeekBytes(&byte, 1,SEND_QUEUE_ID) > 0)
-            {
-               WifiRxData[WifiDataCount].byte = byte;
-               if(WifiDataCount <= 5)WifiDataCount++;
-               else 
-               {
+     for(i = 0;i < length;i++)
+     {
+          byte = p_data[i] & 0x00ff;
+          switch(rx_parse_state)
+          {
+               case cRxdHuntHead:
+                    if(byte == 0xEE || byte == WIFI_LINK_FRAME_V2)
+                    {
+                         p_rx_frame = FQGetFreeSlot();
+                         if(p_rx_frame == NULL)
+                         {
+                              p_rx_frame = rx_overflow_frame;
+                         }
+                         p_rx_frame[0] = byte;
+                         WifiDataCount = 1;
+                         rx_parse_state = cRxdHuntType;
+                    }
+               break;
+               case cRxdHuntType:
+                    if(byte == 0xEE || byte == 0xAA ||
+                       byte == WIFI_FRAME_TYPE_FANOUT ||
+                       (byte == WIFI_LINK_TYPE_ACK &&
+                        p_rx_frame[0] == WIFI_LINK_FRAME_V2))
+                    {
+                         p_rx_frame[1] = byte;
+                         WifiDataCount = 2;
+                         rx_frame_bcc = 0;
+                         rx_frame_crc = CRC16_INIT;
+                         rx_parse_state = cRxdHeader;
+                    }
+                    else
+                    {
+                         wifiRxParseReset();
+                    }
+               break;
+               case cRxdHeader:
+                    p_rx_frame[WifiDataCount] = byte;
                     WifiDataCount++;
-                    if(WifiDataCount >= (WifiRxData[5].byte+3))
+                    rx_frame_bcc ^= byte;
+                    rx_frame_crc = CRC16Update(rx_frame_crc, byte);
+                    if(WifiDataCount >= WIFI_FRAME_HEADER_LENGTH)
                     {
-                         WifiDataCount = CLEAR;
-                         f_rxdataOK = ON;
-                         BLE_TX_DATA_LENGTH = WifiRxData[5].byte+3;
-                         tm_1ms.tUartWait10ms.word = C_T_tUartWait10ms;
+                         /* Byte 5 is the frame length, reject anything that
+                          * cannot hold the header or overruns a frame slot
+                          */
+                         rx_frame_len = byte + 3;
+                         rx_frame_uses_crc = WLFrameUsesCrc(p_rx_frame);
+                         if(p_rx_frame[0] == WIFI_LINK_FRAME_V2)
+                         {
+                              rx_frame_len += WIFI_LINK_TRAILER_LENGTH;
+                         }
+                         if(rx_frame_uses_crc)
+                         {
+                              rx_frame_len++;
+                         }
+                         if(byte < (WIFI_FRAME_HEADER_LENGTH - 2) ||
+                            rx_frame_len > WIFI_FRAME_MAX_LENGTH)
+                         {
+                              f_Uart_TxRxError = ON;
+                              wifiRxParseReset();
+                         }
+                         else
+                         {
+                              rx_parse_state = cRxdBody;
+                         }
                     }
-                }     
-                    
-               /*һֽں1msʱ*/
-               tm_1ms.tWifitsfrmwt.word = C_T_tWifitsfrmwt;
-               BQCommitLastPeek(SEND_QUEUE_ID);
-            }
-            else
-            {
                break;
-            }
-         }
-    
+               case cRxdBody:
+                    p_rx_frame[WifiDataCount] = byte;
+                    WifiDataCount++;
+                    rx_frame_crc = CRC16Update(rx_frame_crc, byte);
+                    if(WifiDataCount < rx_frame_len)
+                    {
+                         rx_frame_bcc ^= byte;
+                    }
+                    else
+                    {
+                         /* Last byte is the BCC of the frame, or the end of
+                          * the CRC which leaves the residue over the frame
+                          */
+                         if(rx_frame_uses_crc ?
+                            (rx_frame_crc != CRC16_RESIDUE) :
+                            (byte != rx_frame_bcc))
+                         {
+                              f_Uart_TxRxError = ON;
+                         }
+                         else
+                         {
+                              wifiRxFrameComplete();
+                         }
+                         wifiRxParseReset();
+                    }
+               break;
+               default:
+                    wifiRxParseReset();
+               break;
+          }
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiRxFrameComplete
+ *
+ *  DESCRIPTION
+ *      Queues a frame whose BCC has been verified for the mesh sender. A v2
+ *      frame is first run through the link layer, which only lets the next
+ *      data frame in sequence through, rewritten as a v1 frame. Frames the
+ *      queue has no room for are left for the Wi-Fi module to resend.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void wifiRxFrameComplete(void)
+{
+     const bool can_store = (p_rx_frame != rx_overflow_frame);
+     uint16 len = rx_frame_len;
+
+     if(p_rx_frame[0] == WIFI_LINK_FRAME_V2)
+     {
+          if(!WLRxFrame(p_rx_frame, &len, can_store))
+          {
+               return;
+          }
+     }
+     else
+     {
+          WLRxLegacyFrame();
+          if(!can_store)
+          {
+               FQRecordOverflow();
+               return;
+          }
+     }
+     FQCommitSlot(len);
+     AEPost(AE_WIFI_FRAME_RECEIVED, 0);
+}
+
+static uint16 uartRxDataCallback(void   *p_rx_buffer,
+                                 uint16  length,
+                                 uint16 *p_additional_req_data_length)
+{
+     const uint32 now = TimeGet32();
+
+     /* A frame that stalls for longer than the inter-byte gap is dropped */
+     if(rx_parse_state != cRxdHuntHead &&
+        TimeSub(now, rx_last_byte_time) > (int32)WIFI_RX_FRAME_GAP)
+     {
+          wifiRxParseReset();
+     }
+
+     if(length > 0)
+     {
+          /* Parse everything the driver has buffered in one pass */
+          wifiRxParseBytes((const uint8 *)p_rx_buffer, length);
+          rx_last_byte_time = now;
+     }
+
     /* Inform the UART driver that we'd like to receive another byte when it
      * becomes available
      */
-       *p_additional_req_data_length = (uint16)1;    
+       *p_additional_req_data_length = (uint16)1;
 
     /* Return the number of bytes that have been processed */
     return length;
@@ -187,6 +385,8 @@ void InitUart(void)
      UartEnable(TRUE);
 /* Read from UART */
      UartRead(1,0);
+     FQInit();
+     WLInit();
      /*ڲʹ
      const uint8 message[] = "\r\nType something: ";
      BQForceQueueBytes(message, sizeof(message)/sizeof(uint8));
@@ -195,69 +395,250 @@ void InitUart(void)
 /* Disable deep sleep, so characters dont go missing  */
      /*SleepModeChange(sleep_mode_never);*/
      /*ڳʼɹ󣬵ȴ3ʼշ*/
-     tm_1s.tOnTimeWait3s.word = C_T_OnTimeWait3s;
-     tm_100ms.tWifiSendData.word = C_T_WifiSendData;  
+     TWStart(TM_ON_TIME_WAIT, C_T_OnTimeWait3s);
+     TWStart(TM_WIFI_SEND_DATA, C_T_WifiSendData);  
 }
 
-static void WifiTxDataClear(void)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxFrameBegin
+ *
+ *  DESCRIPTION
+ *      Start serializing a Wi-Fi frame into the UART transmit queue. The
+ *      frame is only appended to the queue by wifiTxFrameEnd, so it is never
+ *      sent half built. Bytes that land in the free space before the end of
+ *      the queue buffer are stored directly, only those that wrap round to
+ *      its start are poked. Once the Wi-Fi module has opened v2 the frame is
+ *      built in a slot of the v2 window instead, which keeps it for resending
+ *      until it is acknowledged.
+ *
+ * PARAMETERS
+ *      frame_len [in]    Value of the frame length field
+ *
+ * RETURNS
+ *      TRUE if the queue or the window has room for the whole frame, FALSE
+ *      if the frame has to be dropped.
+ *----------------------------------------------------------------------------*/
+static bool wifiTxFrameBegin(uint16 frame_len)
+{
+    tx_frame_pos = 0;
+    tx_frame_bcc = 0;
+    p_tx_frame = NULL;
+    tx_span_len = 0;
+
+    if (frame_len + 3 > WIFI_FRAME_MAX_LENGTH)
+        return FALSE;
+
+    if (WLIsV2())
+    {
+        p_tx_frame = WLTxGetSlot();
+        return (p_tx_frame != NULL);
+    }
+
+    tx_span_len = BQGetWriteSpan(&p_tx_span, RECV_QUEUE_ID);
+    return (frame_len + 3 <= BQGetAvailableSize(RECV_QUEUE_ID));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxFramePut
+ *
+ *  DESCRIPTION
+ *      Append one byte to the frame being serialized, folding it into the
+ *      BCC if it is past the two header bytes. A v2 frame gets the E2 header
+ *      in place of the first byte.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wifiTxFramePut(uint8 byte)
+{
+    if (p_tx_frame != NULL)
+        p_tx_frame[tx_frame_pos] = (tx_frame_pos == 0) ? WIFI_LINK_FRAME_V2 :
+                                                         byte;
+    else if (tx_frame_pos < tx_span_len)
+        p_tx_span[tx_frame_pos] = byte;
+    else
+        BQPokeByte(tx_frame_pos, byte, RECV_QUEUE_ID);
+
+    if (tx_frame_pos >= 2)
+        tx_frame_bcc ^= byte;
+
+    tx_frame_pos++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxFrameEnd
+ *
+ *  DESCRIPTION
+ *      Append the BCC and hand the complete frame to the transmit queue. A
+ *      v2 frame is numbered, sealed and queued by the link layer.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wifiTxFrameEnd(void)
 {
-  unsigned char tempY = 0;
-  while(tempY < 40)
-  {
-    WifiTxData[tempY].byte = 0;
-    tempY++;
-   }
+    if (p_tx_frame != NULL)
+    {
+        WLTxCommit(tx_frame_pos);
+        p_tx_frame = NULL;
+        return;
+    }
+
+    if (tx_frame_pos < tx_span_len)
+        p_tx_span[tx_frame_pos] = tx_frame_bcc;
+    else
+        BQPokeByte(tx_frame_pos, tx_frame_bcc, RECV_QUEUE_ID);
+    BQCommitWrite(tx_frame_pos + 1, RECV_QUEUE_ID);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxRecordFrame
+ *
+ *  DESCRIPTION
+ *      Send one batch record as the EE EE or EE AA frame it stands for.
+ *
+ * PARAMETERS
+ *      p_record [in]    Record: EE/AA | msg id | mesh id (2) | n | data
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wifiTxRecordFrame(const uint8 *p_record)
+{
+    const uint16 len = p_record[4] + 4;
+    uint16 i;
+
+    if (!wifiTxFrameBegin(len))
+        return;
+
+    wifiTxFramePut(0xEE);
+    wifiTxFramePut(p_record[0]);
+    wifiTxFramePut(p_record[1]);
+    wifiTxFramePut(p_record[2]);
+    wifiTxFramePut(p_record[3]);
+    wifiTxFramePut(len);
+    for (i = 0; i < p_record[4]; i++)
+        wifiTxFramePut(p_record[5 + i]);
+    wifiTxFrameEnd();
 }
-void WifiRxDataClear(void)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxBatchFlush
+ *
+ *  DESCRIPTION
+ *      Send the waiting records as one batch frame. If the link has fallen
+ *      back to v1 since they were batched, each record is sent as its own
+ *      frame instead.
+ *
+ * RETURNS
+ *      TRUE if the batch is empty now, FALSE if the v2 window has no room
+ *      for it yet.
+ *----------------------------------------------------------------------------*/
+static bool wifiTxBatchFlush(void)
 {
-  unsigned char tempY = 0;
-  while(tempY < 40)
-  {
-    WifiRxData[tempY].byte = 0;
-    tempY++;
-   }
+    uint16 i;
+
+    if (tx_batch_len == 0)
+        return TRUE;
+
+    if (WLHasCap(WIFI_LINK_CAP_BATCH))
+    {
+        if (!wifiTxFrameBegin(tx_batch_len + 4))
+            return FALSE;
+
+        wifiTxFramePut(0xEE);
+        wifiTxFramePut(WIFI_LINK_TYPE_BATCH);
+        wifiTxFramePut(0x00);
+        wifiTxFramePut(0x00);
+        wifiTxFramePut(0x00);
+        wifiTxFramePut(tx_batch_len + 4);
+        for (i = 0; i < tx_batch_len; i++)
+            wifiTxFramePut(tx_batch[i]);
+        wifiTxFrameEnd();
+    }
+    else
+    {
+        for (i = 0; i < tx_batch_len; i += tx_batch[i + 4] + 5)
+            wifiTxRecordFrame(&tx_batch[i]);
+    }
+
+    tx_batch_len = 0;
+    TWStop(TM_WIFI_BATCH);
+    return TRUE;
 }
 
-static void WifiTxGetBcc(void)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxBatchFits
+ *
+ *  DESCRIPTION
+ *      Tell whether the mesh message in BLE_RX_DATA can join the batch. One
+ *      that cannot is sent as a frame of its own once the waiting records
+ *      have gone, so it does not overtake them.
+ *
+ * RETURNS
+ *      TRUE if the batch capability was agreed and the message fits a record
+ *----------------------------------------------------------------------------*/
+static bool wifiTxBatchFits(void)
 {
-  unsigned char tempY = 2;
-  uint8 size_val = 0;
-  WifiNowBuffer = 0;
-  if(WifiTxData[1].byte == 0xEE || WifiTxData[1].byte == 0xAA)
-         size_val = WifiTxData[5].byte+2;
-  else if(WifiTxData[0].byte == 0xDD && WifiTxData[1].byte == 0xDD)
-         size_val = WifiTxData[3].byte+2;
-  
-  while(tempY < size_val)
-  {
-    WifiNowBuffer ^= WifiTxData[tempY].byte;
-    tempY++;
-  }
-  WifiTxData[size_val].byte = WifiNowBuffer;
+    return WLHasCap(WIFI_LINK_CAP_BATCH) && BLE_RX_DATA[2] >= 2 &&
+           BLE_RX_DATA[2] - 2 + 5 <= WIFI_BATCH_MAX_LENGTH;
 }
 
-static void WifiRxdCheck_New(void)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wifiTxBatchAdd
+ *
+ *  DESCRIPTION
+ *      Add the mesh message in BLE_RX_DATA to the batch, if the Wi-Fi module
+ *      agreed to batch frames. The batch is sent once it holds
+ *      WIFI_BATCH_FLUSH_LENGTH bytes or its first record has waited
+ *      C_T_tWifiBatch50ms, so a burst of reports shares frame headers and
+ *      window slots while a lone report is only delayed briefly.
+ *
+ * PARAMETERS
+ *      type     [in]    EE or AA, the frame type the message would use
+ *
+ * RETURNS
+ *      TRUE if the message was batched, FALSE if it must be sent as a frame
+ *      of its own.
+ *----------------------------------------------------------------------------*/
+static bool wifiTxBatchAdd(uint8 type)
 {
-  uint8 tempY = 2;
-  WifiNowBuffer = 0;
-  while(tempY < (WifiRxData[5].byte + 2))
-  {
-    /*WifiNowBuffer = WifiNowBuffer + WifiRxData[tempY].byte;*/
-    WifiNowBuffer ^=  WifiRxData[tempY].byte;   
-    tempY++;
-  }
-  WifiNowBuffer = (WifiNowBuffer & 0x00ff);
-  if(WifiNowBuffer == WifiRxData[WifiRxData[5].byte + 2].byte
-    && ((WifiRxData[0].byte == 0xEE && WifiRxData[1].byte == 0xEE)
-        || (WifiRxData[0].byte == 0xEE && WifiRxData[1].byte == 0xAA)))
-  {
-     f_WifiRxdCheckOk = 1;
-   }
-  else
-  {
-    f_WifiRxdCheckOk = 0;
-  }
+    uint8 *p_record;
+    uint16 n;
+
+    if (!wifiTxBatchFits())
+        return FALSE;
+
+    n = BLE_RX_DATA[2] - 2;
+
+    if (tx_batch_len + n + 5 > WIFI_BATCH_MAX_LENGTH && !wifiTxBatchFlush())
+        return FALSE;
+
+    if (tx_batch_len == 0)
+        TWStart(TM_WIFI_BATCH, C_T_tWifiBatch50ms);
+
+    p_record = &tx_batch[tx_batch_len];
+    p_record[0] = type;
+    p_record[1] = BLE_RX_DATA[1];
+    p_record[2] = (RX_MESH_ID >> 8) & 0x00FF;
+    p_record[3] = RX_MESH_ID & 0x00FF;
+    p_record[4] = n;
+    MemCopy(&p_record[5], &BLE_RX_DATA[3], n);
+    tx_batch_len += n + 5;
+
+    if (tx_batch_len >= WIFI_BATCH_FLUSH_LENGTH || TWExpired(TM_WIFI_BATCH))
+        wifiTxBatchFlush();
+
+    return TRUE;
 }
+
 /*
 static void BLE_RX_GCC(void)
 {
@@ -283,56 +664,136 @@ static void BLE_TX_GCC(void)
      BLE_TX_DATA[BLE_TX_DATA[2]+1] = WifiNowBuffer;     
 }
 
-static void WifiRxDataEEEE(void)
+static void WifiRxDataEEEE(const uint8 *p_frame)
 {
      uint8 i = 0;
      BLE_TX_DATA[0] = 0x7E;
-     BLE_TX_DATA[1] = WifiRxData[2].byte;
-     /*Tx_MessageID = WifiRxData[2].byte;*/
+     BLE_TX_DATA[1] = p_frame[2];
+     /*Tx_MessageID = p_frame[2];*/
      TX_MESH_ID = 0x0000;
-     TX_MESH_ID = (((uint16)WifiRxData[3].byte << 8)|(uint16)WifiRxData[4].byte);
-     BLE_TX_DATA[2] = WifiRxData[5].byte - 2;
+     TX_MESH_ID = (((uint16)p_frame[3] << 8)|(uint16)p_frame[4]);
+     BLE_TX_DATA[2] = p_frame[5] - 2;
      for(i = 3;i <(BLE_TX_DATA[2] +1);i++)
      {
-          BLE_TX_DATA[i] = WifiRxData[i+3].byte;          
+          BLE_TX_DATA[i] = p_frame[i+3];          
      }
      /*UartTxDataType = 0xEA;  *//*յطϢøֵ */
      BLE_TX_GCC();
      BLE_TX_DATA_LENGTH = BLE_TX_DATA[2] + 2;
      /*BLE_TX_DATA_LENGTH = StrLen((char *)BLE_TX_DATA);*/
      f_Mesh_Tx_Ready = ON;  
+     AEPost(AE_MESH_TX_READY, 0);
 }
 
-static void WifiRxdDataDo_New(void)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WifiRxFrameDispatch
+ *
+ *  DESCRIPTION
+ *      Hands the oldest queued Wi-Fi frame to the mesh sender. Frames are
+ *      released one at a time: BLE_TX_DATA only becomes free again once the
+ *      mesh transmit queue has taken the previous frame and cleared
+ *      f_Mesh_Tx_Ready, so queued frames drain at mesh speed. A fan-out
+ *      frame with targets also waits until its replies can be collected.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+void WifiRxFrameDispatch(void)
+{
+     const uint8 *p_frame;
+     uint16 len;
+
+     if(f_Mesh_Tx_Ready == OFF)
+     {
+          p_frame = FQPeekFrame(&len);
+          if(p_frame != NULL && p_frame[1] == WIFI_FRAME_TYPE_FANOUT &&
+             p_frame[6] != 0 && MFIsFull())
+          {
+               return;
+          }
+          if(p_frame != NULL)
+          {
+               WifiRxdDataDo_New(p_frame);
+               FQPopFrame();
+          }
+     }
+}
+
+static void WifiRxdDataDo_New(const uint8 *p_frame)
 {         
-     if(WifiRxData[0].byte == 0xEE)
+     if(p_frame[0] == 0xEE)
+     {
+          if(p_frame[1] == 0xEE)WifiRxDataEEEE(p_frame);
+          if(p_frame[1] == 0xAA)WifiRxDataEEAA(p_frame);
+          if(p_frame[1] == WIFI_FRAME_TYPE_FANOUT)WifiRxDataFanout(p_frame);
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WifiRxDataFanout
+ *
+ *  DESCRIPTION
+ *      Sends the command of a fan-out frame into the mesh once, as a 7E
+ *      frame to the group in its mesh ID field, and starts collecting the
+ *      replies of the targets it lists. Frames whose target list does not
+ *      fit the frame are dropped.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void WifiRxDataFanout(const uint8 *p_frame)
+{
+     const uint16 count = p_frame[6] & 0x00FF;
+     const uint16 data_start = 7 + 2 * count;
+     const uint16 data_end = (p_frame[5] & 0x00FF) + 2; /*bccλ*/
+     uint16 i;
+
+     if(count > MESH_FANOUT_MAX_TARGETS || data_start >= data_end)
+     {
+          return;
+     }
+     CLEAR_BLE_TX_DATA();
+     BLE_TX_DATA[0] = 0x7E;
+     BLE_TX_DATA[1] = p_frame[2]; /*message ID*/
+     BLE_TX_DATA[2] = data_end - data_start + 2;
+     for(i = data_start;i < data_end;i++)
      {
-          if(WifiRxData[1].byte == 0xEE)WifiRxDataEEEE();
-          if(WifiRxData[1].byte == 0xAA)WifiRxDataEEAA();
+          BLE_TX_DATA[i - data_start + 3] = p_frame[i];
      }
+     BLE_TX_GCC();
+     BLE_TX_DATA_LENGTH = BLE_TX_DATA[2] + 2;
+     TX_MESH_ID = (((uint16)p_frame[3] << 8)|(uint16)p_frame[4]); /*ID*/
+     MFStart(p_frame[2], TX_MESH_ID, &p_frame[7], count);
+     f_Mesh_Tx_Ready = ON;
+     AEPost(AE_MESH_TX_READY, 0);
 }
-static void WifiRxDataEEAA(void)
+static void WifiRxDataEEAA(const uint8 *p_frame)
 {
      uint8 temp;
      CLEAR_BLE_TX_DATA();
      BLE_TX_DATA[0] = 0xE7;
-     BLE_TX_DATA[1] = WifiRxData[2].byte; /*message ID*/
-     BLE_TX_DATA[2] = WifiRxData[5].byte - 2;/*ûmesh id,˼2*/
-     BLE_TX_DATA[3] = WifiRxData[6].byte;/*command*/
-     BLE_TX_DATA[4] = WifiRxData[7].byte;/*command type*/
+     BLE_TX_DATA[1] = p_frame[2]; /*message ID*/
+     BLE_TX_DATA[2] = p_frame[5] - 2;/*ûmesh id,˼2*/
+     BLE_TX_DATA[3] = p_frame[6];/*command*/
+     BLE_TX_DATA[4] = p_frame[7];/*command type*/
      for(temp = 5;temp < (BLE_TX_DATA[2]+1);temp++)
      {
-          BLE_TX_DATA[temp] =  WifiRxData[temp+3].byte;              
+          BLE_TX_DATA[temp] =  p_frame[temp+3];              
      }
      BLE_TX_GCC();
      BLE_TX_DATA_LENGTH = BLE_TX_DATA[2] + 2;
      /*BLE_TX_DATA_LENGTH = StrLen((char *)BLE_TX_DATA);*/
      TX_MESH_ID = CLEAR;
-     TX_MESH_ID = (((uint16)WifiRxData[3].byte << 8)|(uint16)WifiRxData[4].byte);
+     TX_MESH_ID = (((uint16)p_frame[3] << 8)|(uint16)p_frame[4]);
      f_RxEEData = ON;
-     tm_100ms.tSendEEWait800ms.word = CLEAR;
+     TWStop(TM_SEND_EE_WAIT);
      WifiTxDataEEEECount = CLEAR;
      f_Mesh_Tx_Ready = ON; /*meshͱ־׼*/
+     AEPost(AE_MESH_TX_READY, 0);
 }
 
 static void CLEAR_BLE_TX_DATA(void)
@@ -344,6 +805,63 @@ static void CLEAR_BLE_TX_DATA(void)
          i++;
      }
 }
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WifiTxDataFanout
+ *
+ *  DESCRIPTION
+ *      Sends the report of a finished fan-out command, after the replies
+ *      still waiting in the batch so the module sees them first.
+ *
+ *  RETURNS
+ *      TRUE if a frame was queued for the UART.
+ *
+ *----------------------------------------------------------------------------*/
+static bool WifiTxDataFanout(void)
+{
+     uint8 report[MESH_FANOUT_REPORT_LENGTH];
+     uint16 len, i;
+
+     TWStop(TM_MESH_FANOUT);
+     len = MFGetReport(report);
+     if(len == 0)
+     {
+          return FALSE;
+     }
+     if(tx_batch_len != 0)
+     {
+          /* ȷ֡һη */
+          if(wifiTxBatchFlush())
+          {
+               TWStart(TM_MESH_FANOUT, 0);
+               return TRUE;
+          }
+     }
+     else if(wifiTxFrameBegin(len + 1))
+     {
+          wifiTxFramePut(0xEE);
+          wifiTxFramePut(WIFI_FRAME_TYPE_FANOUT);
+          wifiTxFramePut(report[0]); /*message ID*/
+          wifiTxFramePut(report[1]); /*ID*/
+          wifiTxFramePut(report[2]);
+          wifiTxFramePut(len + 1);
+          for(i = 3;i < len;i++)
+          {
+               wifiTxFramePut(report[i]);
+          }
+          wifiTxFrameEnd();
+          MFReportSent();
+          if(FQGetFrameCount() != 0)
+          {
+               AEPost(AE_WIFI_FRAME_RECEIVED, 0);
+          }
+          return TRUE;
+     }
+     /* ڶԺط */
+     TWStart(TM_MESH_FANOUT, TW_TICKS_10MS(1));
+     return FALSE;
+}
+
 static void CLEAR_BLE_RX_DATA(void)
 {
      uint8 i = 0;
@@ -356,176 +874,196 @@ static void CLEAR_BLE_RX_DATA(void)
 
 static void WifiTxDataDD(void)
 {
-     WifiTxData[0].byte = 0xDD;
-     WifiTxData[1].byte = 0xDD;
-     WifiTxData[2].byte = 0x00;
-     WifiTxData[3].byte = 0x0A; /*byte 2,byte3 Ϊ*/
-     WifiTxData[4].byte = 0x01; /*ָcommand*/
-     WifiTxData[5].byte = Signal_Intensity;/*źǿ*/
-     WifiTxData[6].byte = Mesh_status;/*mesh״̬*/
-     WifiTxData[7].byte = Con_Mobile_Num;/*ֻ*/
-     WifiTxData[8].byte = (Local_MESH_ID >> 8) & 0xff;/*mesh idλ*/
-     WifiTxData[9].byte = Local_MESH_ID & 0xff;/*mesh idλ*/
-     WifiTxData[10].byte = (Gateway_MsgID >> 8) & 0xff;/* mesh idλ*/
-     WifiTxData[11].byte = Gateway_MsgID & 0xff;/* mesh idλ*/
-     WifiTxGetBcc(); 
+     if(!wifiTxFrameBegin(0x0A))
+          return;
+     wifiTxFramePut(0xDD);
+     wifiTxFramePut(0xDD);
+     wifiTxFramePut(0x00);
+     wifiTxFramePut(0x0A); /*byte 2,byte3 Ϊ*/
+     wifiTxFramePut(0x01); /*ָcommand*/
+     wifiTxFramePut(Signal_Intensity);/*źǿ*/
+     wifiTxFramePut(Mesh_status);/*mesh״̬*/
+     wifiTxFramePut(Con_Mobile_Num);/*ֻ*/
+     wifiTxFramePut((Local_MESH_ID >> 8) & 0xff);/*mesh idλ*/
+     wifiTxFramePut(Local_MESH_ID & 0xff);/*mesh idλ*/
+     wifiTxFramePut((Gateway_MsgID >> 8) & 0xff);/* mesh idλ*/
+     wifiTxFramePut(Gateway_MsgID & 0xff);/* mesh idλ*/
+     wifiTxFrameEnd();
      
 }
 static void WifiTxDataEEAA(void)
 {
      uint8 i = 0;
-     WifiTxData[0].byte = 0xEE;
-     WifiTxData[1].byte = 0xAA; 
-     WifiTxData[2].byte = BLE_RX_DATA[1]; /*к*/
-     WifiTxData[4].byte = RX_MESH_ID & 0x00FF;
-     WifiTxData[3].byte = (RX_MESH_ID >> 8) & 0x00FF;/*MESH_ID*/
-     RX_MESH_ID = CLEAR; /*RX_MESH_ID*/
-     WifiTxData[5].byte = BLE_RX_DATA[2] + 2;/*MESH_IDΪBLE_RX_DATA[2]+2*/
-     for(i = 6;i< (WifiTxData[5].byte + 2);i ++)
+     const uint8 len = BLE_RX_DATA[2] + 2;/*MESH_IDΪBLE_RX_DATA[2]+2*/
+     if(wifiTxBatchAdd(0xAA))
      {
-         WifiTxData[i].byte = BLE_RX_DATA[i-3];               
+          /* Ѽ֡wifiTxBatchFlush */
+     }
+     else if(wifiTxFrameBegin(len))
+     {
+          wifiTxFramePut(0xEE);
+          wifiTxFramePut(0xAA);
+          wifiTxFramePut(BLE_RX_DATA[1]); /*к*/
+          wifiTxFramePut((RX_MESH_ID >> 8) & 0x00FF);/*MESH_ID*/
+          wifiTxFramePut(RX_MESH_ID & 0x00FF);
+          wifiTxFramePut(len);
+          for(i = 6;i< (len + 2);i ++)
+          {
+              wifiTxFramePut(BLE_RX_DATA[i-3]);
+          }
+          wifiTxFrameEnd();
      }
+     RX_MESH_ID = CLEAR; /*RX_MESH_ID*/
      CLEAR_BLE_RX_DATA();
-     WifiTxGetBcc();
 }
 static void WifiTxDataEEEE(void)
 {
      uint8 i = 0;
-     WifiTxData[0].byte = 0xEE;
-     WifiTxData[1].byte = 0xEE;
-     WifiTxData[2].byte = BLE_RX_DATA[1]; /*к*/
-     WifiTxData[4].byte = RX_MESH_ID & 0x00FF;
-     WifiTxData[3].byte = (RX_MESH_ID >> 8) & 0x00FF;/*MESH_ID*/
-     RX_MESH_ID = CLEAR; /*RX_MESH_ID*/
-     WifiTxData[5].byte = BLE_RX_DATA[2] + 2;/*MESH_IDΪBLE_RX_DATA[2]+2*/
-     for(i = 6;i< (WifiTxData[5].byte + 2);i ++)
+     const uint8 len = BLE_RX_DATA[2] + 2;/*MESH_IDΪBLE_RX_DATA[2]+2*/
+     if(wifiTxBatchAdd(0xEE))
+     {
+          /* Ѽ֡wifiTxBatchFlush */
+     }
+     else if(wifiTxFrameBegin(len))
      {
-         WifiTxData[i].byte = BLE_RX_DATA[i-3];               
+          wifiTxFramePut(0xEE);
+          wifiTxFramePut(0xEE);
+          wifiTxFramePut(BLE_RX_DATA[1]); /*к*/
+          wifiTxFramePut((RX_MESH_ID >> 8) & 0x00FF);/*MESH_ID*/
+          wifiTxFramePut(RX_MESH_ID & 0x00FF);
+          wifiTxFramePut(len);
+          for(i = 6;i< (len + 2);i ++)
+          {
+              wifiTxFramePut(BLE_RX_DATA[i-3]);
+          }
+          wifiTxFrameEnd();
      }
+     RX_MESH_ID = CLEAR; /*RX_MESH_ID*/
      CLEAR_BLE_RX_DATA();
-     WifiTxGetBcc();
      f_RxEEData = CLEAR; /*ձ־λ0*/
-     tm_100ms.tSendEEWait800ms.word = C_T_tSendWait800ms;/*800msʱ䶨ʱ */
+     TWStart(TM_SEND_EE_WAIT, C_T_tSendWait800ms);/*800msʱ䶨ʱ */
      WifiTxDataEEEECount++;/*20νձ־+1*/
 }
 
 void processuartdata(void)
 {
 	/*
-     if(tm_100ms.tSendEEWait800ms.fov == ON)
+     if(TWExpired(TM_SEND_EE_WAIT))
      {
          if(WifiTxDataEEEECount < 20)UartTxDataType = 0xEE;
          else
          {
               f_UartComErr = ON;
               WifiTxDataEEEECount = CLEAR;
-              tm_100ms.tSendEEWait800ms.word = CLEAR;
+              TWStop(TM_SEND_EE_WAIT);
          }
      }*/
      
-     if(tm_1s.tOnTimeWait3s.fov == ON)
+     /* v2: resend the window if its ACK is overdue */
+     if(WLService())
      {
-          if(tm_100ms.tWifiSendData.fov == ON)
+          SendDataToUart();
+     }
+
+     if(TWExpired(TM_ON_TIME_WAIT))
+     {
+          if(TWExpired(TM_WIFI_SEND_DATA))
           {
                CommState = cTxdPrepare;
-               CommRxState = cRxdPrepare;
-               tm_100ms.tWifiSendData.word = CLEAR;
+               TWStop(TM_WIFI_SEND_DATA);
           }
           else
           {
+               /* Received frames are parsed and dispatched from the UART
+                * callback, only the transmit side is serviced here. This is
+                * run from the 10ms tick, which already keeps frames further
+                * apart than the 2ms gap the Wi-Fi module needs.
+                */
                switch(CommState)
                {
                   case cTxdPrepare:
-                  WifiTxDataClear(); 
-                  if(UartTxDataType == 0xEE)
+                  if(UartTxDataType != CLEAR && WLIsV2() &&
+                     WLTxGetSlot() == NULL)
+                  {
+                           /* v2 window full or hello unanswered, the frame
+                            * waits, an ACK or hello answer still goes out
+                            */
+                           if(WLAckPending())
+                           {
+                                WLSendAck();
+                                CommState = cTxd;
+                           }
+                  }
+                  else if((UartTxDataType == 0xEE ||
+                           UartTxDataType == 0xAA) &&
+                          tx_batch_len != 0 && !wifiTxBatchFits())
                   {
-                           WifiTxDataEEEE();/*EEݰ*/   
-                           UartTxDataType = CLEAR;        
-                           CommState = cTxd;                         
+                           /* ȷ֡֡һη */
+                           if(wifiTxBatchFlush())
+                           {
+                                CommState = cTxd;
+                           }
+                  }
+                  else if(UartTxDataType == 0xEE)
+                  {
+                           WifiTxDataEEEE();/*EEݰ*/
+                           UartTxDataType = CLEAR;
+                           CommState = cTxd;
                   }
                   else if(UartTxDataType == 0xAA)
                   {
-                           WifiTxDataEEAA();/*AAݰ*/    
-                           UartTxDataType = CLEAR;        
-                           CommState = cTxd;                         
+                           WifiTxDataEEAA();/*AAݰ*/
+                           UartTxDataType = CLEAR;
+                           CommState = cTxd;
                   }
                   else if(UartTxDataType == 0xDD)
                   {
-                           WifiTxDataDD();/*DDݰ*/ 
-                           UartTxDataType = CLEAR;        
-                           CommState = cTxd;                        
+                           WifiTxDataDD();/*DDݰ*/
+                           UartTxDataType = CLEAR;
+                           CommState = cTxd;
                   }
-                  else if(tm_1s.tHeartPack5s.fov == ON)
+                  else if(TWExpired(TM_WIFI_BATCH))
                   {
-                           
-                           tm_1s.tHeartPack5s.word = C_T_tHeartPack5s;   
-                          WifiTxDataDD();/*DDݰ*/ 
-                           CommState = cTxd;                      
-                  }                      
-                  break;
-                  case cTxd:
-                    SendDataToUart();                   
-                    CommState = cTxdEnd;
-                  break;
-                  case cTxdEnd:
-                    if(tm_1ms.tWifiTwoByteSentTime.fov == ON || tm_4ms.twifitstxcyc.fov == ON)
-                    {
-                         CommState = cTxdPrepare;
-                    }
+                           /* ֡ȴʱ䵽ռļ¼ */
+                           if(wifiTxBatchFlush())
+                           {
+                                CommState = cTxd;
+                           }
+                  }
+                  else if(TWExpired(TM_MESH_FANOUT))
+                  {
+                           /* ȺӦռɣϱ */
+                           if(WifiTxDataFanout())
+                           {
+                                CommState = cTxd;
+                           }
+                  }
+                  else if(TWExpired(TM_HEART_PACK))
+                  {
+
+                           TWStart(TM_HEART_PACK, C_T_tHeartPack5s);
+                          WifiTxDataDD();/*DDݰ*/
+                           CommState = cTxd;
+                  }
+                  else if(WLAckPending())
+                  {
+                           /* û֡ӴACKʱACK֡ */
+                           WLSendAck();
+                           CommState = cTxd;
+                  }
+                  if(CommState == cTxd)
+                  {
+                           SendDataToUart();
+                           CommState = cTxdPrepare;
+                  }
                   break;
                   default:
+                           CommState = cTxdPrepare;
                   break;
-               } 
-               
-          switch(CommRxState)
-          {
-               case cRxdPrepare:
-                    WifiRxDataClear();
-                    WifiDataCount = CLEAR;
-                    tm_1ms.tWifitsfrmwt.word = CLEAR;
-                    /*tm_4ms.twifitsrxcyc.word = C_T_wifitsrxcyc;*/
-                    CommRxState = cRxdWait;
-               break;
-               case cRxdWait:
-                    if(f_rxdataOK == ON)
-                    {
-                         f_rxdataOK = OFF;
-                         CommRxState = cRxd;
-                    }                   
-                    else if((tm_1ms.tWifitsfrmwt.fov == ON)/* ||(tm_4ms.twifitsrxcyc.fov == ON)*/)
-                    {
-                         CommRxState = cRxdPrepare;
-                         /*f_Uart_TxRxError = ON;*/
-                    }         
-               break;
-               case cRxd:
-                    WifiRxdCheck_New();
-                    if(f_WifiRxdCheckOk)
-                    {
-                         f_WifiRxdCheckOk = OFF;
-                         tm_1ms.tWifi2mscyc.word = C_T_Wifi2mscyc;
-                         WifiRxdDataDo_New();
-                         CommRxState = cRxdEnd;
-                    }
-                    else
-                    {
-                         f_Uart_TxRxError = ON;
-                         CommRxState = cRxdPrepare;
-                    }
-               break;
-               case cRxdEnd:
-                    if(tm_1ms.tWifi2mscyc.fov == ON)
-                    {
-                         CommRxState = cRxdPrepare;
-                    }          
-               break;  
-               default:
-               break;
-          }     
-               
+               }
           }
-     }   
-     
+     }
+
 }
 
 
@@ -112,6 +112,23 @@
 /* Enable Data model support */
 #define ENABLE_DATA_MODEL
 
+/* Send data model block frames to a single device in acknowledged mode: the
+ * receiver answers with a bitmap of the segments it holds and only missing
+ * segments are resent. Needs receivers that support it, which all do from
+ * this version on.
+ */
+/* #define ENABLE_DATA_BLOCK_ACK */
+
+/* Send acknowledged frames as their changes to the last frame the receiver
+ * acknowledged, when that is shorter. Receivers that cannot decode such a
+ * frame ask for the whole frame. Needs ENABLE_DATA_BLOCK_ACK.
+ */
+/* #define ENABLE_MESH_DELTA */
+
+#if defined(ENABLE_MESH_DELTA) && !defined(ENABLE_DATA_BLOCK_ACK)
+#error "ENABLE_MESH_DELTA needs ENABLE_DATA_BLOCK_ACK"
+#endif
+
 
 #ifndef CSR101x_A05
 /* Battery threshold voltage */
@@ -135,11 +152,14 @@
 /* Enable Time model support 
 #define ENABLE_TIME_MODEL */
 
-/* Maximum Actions supported. Each action takes 24 bytes of data to be stored.
- * On increasing number of actions the NVM space for the same need to be 
- * increased accordingly.
+/* Maximum Actions supported. Each action takes 15 words of NVM to be stored,
+ * in an area after the BLE status block. On increasing number of actions the
+ * NVM space for the same need to be increased accordingly: the 1024 word
+ * user store also holds the mesh stack data, and the build fails once the
+ * layout no longer fits in NVM_STORE_SIZE_WORDS. Action IDs are 5 bits, so 32 is the most that can be
+ * addressed.
  */
-#define MAX_ACTIONS_SUPPORTED          (6)
+#define MAX_ACTIONS_SUPPORTED          (32)
 #endif /* ENABLE_ACTION_MODEL */
 #else
 /* This flag should be enabled for supporting OTA on CSR101x Devices */
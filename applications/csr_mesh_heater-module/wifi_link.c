@@ -0,0 +1,645 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      wifi_link.c
+ *
+ *  DESCRIPTION
+ *      v2 Wi-Fi link layer. Frames to the Wi-Fi module are kept in a window
+ *      until the module acknowledges them, so up to WIFI_LINK_WINDOW frames
+ *      can be on the wire at once instead of one frame per round trip. An
+ *      overdue ACK resends the whole window (go-back-N). Frames from the
+ *      module are accepted in sequence only and acknowledged cumulatively,
+ *      the ACK rides on the next outgoing frame when there is one. The
+ *      hello also settles whether frames are checked by BCC or CRC-16.
+ *
+ *****************************************************************************/
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "wifi_link.h"
+#include "byte_queue.h"
+#include "crc16.h"
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Sequence numbers are 8 bits wide, uint8 is not on the XAP */
+#define WL_SEQ(x)                    ((uint8)((x) & 0x00FF))
+
+/* Window slot of the i-th unacknowledged frame */
+#define WL_SLOT(i)                   ((g_wl.head + (i)) % WIFI_LINK_WINDOW)
+
+/* Longest ACK only frame: hello answer with capabilities, or ACK with CRC */
+#define WL_ACK_FRAME_LENGTH          (10)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Link state */
+typedef struct _WIFI_LINK_T
+{
+    /* Frames sent and not yet acknowledged */
+    uint8 slot[WIFI_LINK_WINDOW][WIFI_LINK_SLOT_SIZE];
+
+    /* Length of the frame held in each slot, up to and including the ACK */
+    uint16 len[WIFI_LINK_WINDOW];
+
+    /* Slot of the oldest unacknowledged frame */
+    uint16 head;
+
+    /* Number of unacknowledged frames */
+    uint16 count;
+
+    /* Sequence number of the oldest unacknowledged frame */
+    uint8 tx_base;
+
+    /* Sequence number of the next frame expected from the peer */
+    uint8 rx_seq;
+
+    /* Resends since the peer last acknowledged a frame */
+    uint16 retries;
+
+    /* TRUE once the peer has opened v2 */
+    bool v2;
+
+    /* TRUE if a frame from the peer has not been acknowledged yet */
+    bool ack_pending;
+
+    /* TRUE if a hello has not been answered yet */
+    bool hello_pending;
+
+    /* TRUE if frames are checked by CRC-16 instead of the BCC */
+    bool crc;
+
+    /* Capabilities agreed in the last hello */
+    uint8 caps;
+}WIFI_LINK_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static WIFI_LINK_T g_wl;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlBcc
+ *
+ *  DESCRIPTION
+ *      Compute the BCC of a frame, the XOR of every byte from byte 2 up to
+ *      the BCC itself.
+ *
+ * PARAMETERS
+ *      p_frame [in]    Frame
+ *      len     [in]    Length of the frame including the BCC
+ *
+ * RETURNS
+ *      BCC
+ *----------------------------------------------------------------------------*/
+static uint8 wlBcc(const uint8 *p_frame, uint16 len)
+{
+    uint8 bcc = 0;
+    uint16 i;
+
+    for (i = 2; i + 1 < len; i++)
+        bcc ^= p_frame[i];
+
+    return bcc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlAppendCheck
+ *
+ *  DESCRIPTION
+ *      Append the BCC, or the CRC-16 if it has been agreed, to a frame.
+ *
+ * PARAMETERS
+ *      p_frame [in]    Frame
+ *      len     [in]    Length of the frame without the check
+ *      crc     [in]    TRUE to append a CRC-16
+ *
+ * RETURNS
+ *      Length of the frame including the check
+ *----------------------------------------------------------------------------*/
+static uint16 wlAppendCheck(uint8 *p_frame, uint16 len, bool crc)
+{
+    if (crc)
+    {
+        const uint16 value = CRC16Block(CRC16_INIT, &p_frame[2], len - 2);
+
+        p_frame[len] = (value >> 8) & 0x00FF;
+        p_frame[len + 1] = value & 0x00FF;
+        return len + 2;
+    }
+
+    p_frame[len] = wlBcc(p_frame, len + 1);
+    return len + 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlToV1
+ *
+ *  DESCRIPTION
+ *      Rewrite a v2 frame in place as the equivalent v1 frame.
+ *
+ * PARAMETERS
+ *      p_frame [in]    Frame
+ *      len     [in]    Length of the v2 frame up to and including the ACK
+ *
+ * RETURNS
+ *      Length of the v1 frame
+ *----------------------------------------------------------------------------*/
+static uint16 wlToV1(uint8 *p_frame, uint16 len)
+{
+    p_frame[0] = (p_frame[1] == 0xDD) ? 0xDD : 0xEE;
+
+    return wlAppendCheck(p_frame, len - WIFI_LINK_TRAILER_LENGTH, FALSE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlQueueBatchV1
+ *
+ *  DESCRIPTION
+ *      Queue the records of a BB batch frame as the v1 EE EE or EE AA frames
+ *      they stand for, as a v1 module does not know the batch frame. A
+ *      record that does not fit in the transmit queue is dropped, like any
+ *      other frame requeued on fallback.
+ *
+ * PARAMETERS
+ *      p_frame [in]    Batch frame: header | len | records | seq | ack
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wlQueueBatchV1(const uint8 *p_frame)
+{
+    uint8 frame[WIFI_LINK_SLOT_SIZE];
+    /* The length field counts the records and the 4 header bytes after it */
+    const uint16 end = p_frame[5] + 2;
+    uint16 i;
+    uint16 n;
+
+    for (i = 6; i + 5 <= end; i += n + 5)
+    {
+        /* Record: EE/AA | msg id | mesh id (2) | n | n data bytes */
+        n = p_frame[i + 4];
+        if (i + 5 + n > end)
+            break;
+
+        frame[0] = 0xEE;
+        MemCopy(&frame[1], &p_frame[i], 4);
+        frame[5] = n + 4;
+        MemCopy(&frame[6], &p_frame[i + 5], n);
+
+        BQSafeQueueBytes(frame, wlAppendCheck(frame, n + 6, FALSE),
+                         RECV_QUEUE_ID);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlSeal
+ *
+ *  DESCRIPTION
+ *      Write the sequence number, the current ACK and the check into an
+ *      unacknowledged frame, so a resent frame carries an up to date ACK.
+ *
+ * PARAMETERS
+ *      i       [in]    Position of the frame in the window
+ *
+ * RETURNS
+ *      Length of the frame to send
+ *----------------------------------------------------------------------------*/
+static uint16 wlSeal(uint16 i)
+{
+    uint8 *p_frame = g_wl.slot[WL_SLOT(i)];
+    const uint16 len = g_wl.len[WL_SLOT(i)];
+
+    p_frame[len - 2] = WL_SEQ(g_wl.tx_base + i);
+    p_frame[len - 1] = g_wl.rx_seq;
+
+    return wlAppendCheck(p_frame, len, g_wl.crc);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlResend
+ *
+ *  DESCRIPTION
+ *      Queue every unacknowledged frame again and restart the ACK timer. A
+ *      frame that does not fit in the transmit queue waits for the next
+ *      resend.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wlResend(void)
+{
+    uint16 i;
+
+    for (i = 0; i < g_wl.count; i++)
+    {
+        const uint16 len = wlSeal(i);
+
+        if (BQSafeQueueBytes(g_wl.slot[WL_SLOT(i)], len, RECV_QUEUE_ID))
+            g_wl.ack_pending = FALSE;
+    }
+
+    if (g_wl.count != 0)
+        TWStart(TM_WIFI_LINK_RETX, WIFI_LINK_RETX_TICKS);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlRxAck
+ *
+ *  DESCRIPTION
+ *      Release the frames covered by a cumulative ACK from the peer. ACKs
+ *      that are stale or outside the window are ignored. Freeing slots kicks
+ *      the tick, as frames may be waiting for room in the window.
+ *
+ * PARAMETERS
+ *      ack     [in]    Sequence number of the next frame the peer expects
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wlRxAck(uint8 ack)
+{
+    const uint16 acked = WL_SEQ(ack - g_wl.tx_base);
+
+    if (acked == 0 || acked > g_wl.count)
+        return;
+
+    g_wl.head = WL_SLOT(acked);
+    g_wl.count -= acked;
+    g_wl.tx_base = ack;
+    g_wl.retries = 0;
+
+    if (g_wl.count == 0)
+        TWStop(TM_WIFI_LINK_RETX);
+    else
+        TWStart(TM_WIFI_LINK_RETX, WIFI_LINK_RETX_TICKS);
+
+    TWKick();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wlFallback
+ *
+ *  DESCRIPTION
+ *      Return the link to v1 framing. Unacknowledged frames are queued again
+ *      as v1 frames so their data still reaches a v1 module, a batch frame
+ *      as one frame per record.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wlFallback(void)
+{
+    uint16 i;
+
+    for (i = 0; i < g_wl.count; i++)
+    {
+        uint8 *p_frame = g_wl.slot[WL_SLOT(i)];
+
+        if (p_frame[1] == WIFI_LINK_TYPE_BATCH)
+            wlQueueBatchV1(p_frame);
+        else
+            BQSafeQueueBytes(p_frame, wlToV1(p_frame, g_wl.len[WL_SLOT(i)]),
+                             RECV_QUEUE_ID);
+    }
+
+    g_wl.v2 = FALSE;
+    g_wl.crc = FALSE;
+    g_wl.caps = 0;
+    g_wl.count = 0;
+    g_wl.ack_pending = FALSE;
+    g_wl.hello_pending = FALSE;
+    TWStop(TM_WIFI_LINK_RETX);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLInit
+ *
+ *  DESCRIPTION
+ *      Drop the window and return the link to v1 framing.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void WLInit(void)
+{
+    MemSet(&g_wl, 0, sizeof(g_wl));
+    TWStop(TM_WIFI_LINK_RETX);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLIsV2
+ *
+ *  DESCRIPTION
+ *      Return TRUE once the Wi-Fi module has opened v2 with a hello.
+ *
+ * RETURNS
+ *      TRUE if frames are sent in v2 framing
+ *----------------------------------------------------------------------------*/
+bool WLIsV2(void)
+{
+    return g_wl.v2;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLHasCap
+ *
+ *  DESCRIPTION
+ *      Return TRUE if v2 is open and the capability was agreed in the hello.
+ *
+ * PARAMETERS
+ *      cap     [in]    WIFI_LINK_CAP_ bit
+ *
+ * RETURNS
+ *      TRUE if the capability can be used
+ *----------------------------------------------------------------------------*/
+bool WLHasCap(uint8 cap)
+{
+    return g_wl.v2 && ((g_wl.caps & cap) != 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLFrameUsesCrc
+ *
+ *  DESCRIPTION
+ *      Tell from its first bytes how a frame is checked. A hello and its
+ *      answer are always checked by BCC, as they are what settles the check
+ *      for the frames after them.
+ *
+ * PARAMETERS
+ *      p_frame [in]    First 3 bytes of the frame
+ *
+ * RETURNS
+ *      TRUE if the frame ends in a CRC-16, FALSE if it ends in a BCC
+ *----------------------------------------------------------------------------*/
+bool WLFrameUsesCrc(const uint8 *p_frame)
+{
+    if (!g_wl.crc || p_frame[0] != WIFI_LINK_FRAME_V2)
+        return FALSE;
+
+    return !(p_frame[1] == WIFI_LINK_TYPE_ACK &&
+             (p_frame[2] == WIFI_LINK_ACK_HELLO ||
+              p_frame[2] == WIFI_LINK_ACK_HELLO_REPLY));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLRxFrame
+ *
+ *  DESCRIPTION
+ *      Handle the sequence number and ACK of a v2 frame whose check has been
+ *      verified. A hello (re)starts the link: the capabilities are settled
+ *      and, once the hello has been answered, the window is renumbered from
+ *      the ACK in the hello and resent. Data frames are acknowledged whether
+ *      or not they are new, so a lost ACK is recovered by the resend, but
+ *      only the next frame in sequence is accepted.
+ *
+ * PARAMETERS
+ *      p_frame   [in]     Frame
+ *      p_len     [in/out] Length of the frame, set to the v1 length if the
+ *                         frame is accepted
+ *      can_store [in]     FALSE if there is no room to keep the frame
+ *
+ * RETURNS
+ *      TRUE if the frame is the next data frame from the peer and has been
+ *      rewritten as a v1 frame.
+ *----------------------------------------------------------------------------*/
+bool WLRxFrame(uint8 *p_frame, uint16 *p_len, bool can_store)
+{
+    const uint16 len = *p_len - (WLFrameUsesCrc(p_frame) ? 2 : 1);
+    const uint8 seq = WL_SEQ(p_frame[len - 2]);
+    const uint8 ack = WL_SEQ(p_frame[len - 1]);
+
+    if (p_frame[1] == WIFI_LINK_TYPE_ACK && p_frame[2] == WIFI_LINK_ACK_HELLO)
+    {
+        /* Byte 5 is 5 if the hello carries the capabilities offered */
+        g_wl.caps = (p_frame[5] > 4) ? (p_frame[6] & WIFI_LINK_CAPS) : 0;
+        g_wl.crc = ((g_wl.caps & WIFI_LINK_CAP_CRC16) != 0);
+        g_wl.v2 = TRUE;
+        g_wl.rx_seq = seq;
+        g_wl.tx_base = ack;
+        g_wl.retries = 0;
+        g_wl.hello_pending = TRUE;
+        g_wl.ack_pending = TRUE;
+        TWStop(TM_WIFI_LINK_RETX);
+        TWKick();
+        return FALSE;
+    }
+
+    /* Until the hello arrives the sequence numbers mean nothing */
+    if (!g_wl.v2)
+        return FALSE;
+
+    wlRxAck(ack);
+
+    if (p_frame[1] == WIFI_LINK_TYPE_ACK)
+        return FALSE;
+
+    g_wl.ack_pending = TRUE;
+    TWKick();
+
+    if (seq != g_wl.rx_seq || !can_store)
+        return FALSE;
+
+    g_wl.rx_seq = WL_SEQ(seq + 1);
+    *p_len = wlToV1(p_frame, len);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLRxLegacyFrame
+ *
+ *  DESCRIPTION
+ *      A v1 frame from the Wi-Fi module means it has been replaced by, or
+ *      restarted as, a v1 module. Fall back to v1 framing at once.
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void WLRxLegacyFrame(void)
+{
+    if (g_wl.v2)
+        wlFallback();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLTxGetSlot
+ *
+ *  DESCRIPTION
+ *      Return the window slot the next v2 frame can be built in. No frame is
+ *      started while a hello is unanswered, as the peer only learns how it
+ *      is checked from the answer.
+ *
+ * RETURNS
+ *      Slot of WIFI_LINK_SLOT_SIZE bytes, NULL if the window is full
+ *----------------------------------------------------------------------------*/
+uint8 *WLTxGetSlot(void)
+{
+    if (g_wl.count >= WIFI_LINK_WINDOW || g_wl.hello_pending)
+        return NULL;
+
+    return g_wl.slot[WL_SLOT(g_wl.count)];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLTxCommit
+ *
+ *  DESCRIPTION
+ *      Add the frame built in the slot returned by WLTxGetSlot to the window,
+ *      number it and queue it for the UART. The ACK timer runs from the time
+ *      the window stops being empty.
+ *
+ * PARAMETERS
+ *      len     [in]    Length of the frame without trailer and check
+ *
+ * RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void WLTxCommit(uint16 len)
+{
+    const uint16 i = g_wl.count;
+
+    g_wl.len[WL_SLOT(i)] = len + WIFI_LINK_TRAILER_LENGTH;
+    g_wl.count++;
+    len = wlSeal(i);
+
+    if (BQSafeQueueBytes(g_wl.slot[WL_SLOT(i)], len, RECV_QUEUE_ID))
+        g_wl.ack_pending = FALSE;
+
+    if (g_wl.count == 1)
+    {
+        g_wl.retries = 0;
+        TWStart(TM_WIFI_LINK_RETX, WIFI_LINK_RETX_TICKS);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLAckPending
+ *
+ *  DESCRIPTION
+ *      Return TRUE if frames from the peer have not been acknowledged yet.
+ *
+ * RETURNS
+ *      TRUE if an ACK is owed to the peer
+ *----------------------------------------------------------------------------*/
+bool WLAckPending(void)
+{
+    return g_wl.ack_pending;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLSendAck
+ *
+ *  DESCRIPTION
+ *      Queue an ACK only frame for the UART, used when no data frame is
+ *      going out to carry the ACK. An unanswered hello is answered instead,
+ *      with the agreed capabilities, after which the window is resent with
+ *      its new numbers and check.
+ *
+ * RETURNS
+ *      TRUE if the frame was queued, FALSE if the transmit queue is full.
+ *----------------------------------------------------------------------------*/
+bool WLSendAck(void)
+{
+    uint8 frame[WL_ACK_FRAME_LENGTH];
+    uint16 len = 6;
+
+    frame[0] = WIFI_LINK_FRAME_V2;
+    frame[1] = WIFI_LINK_TYPE_ACK;
+    frame[2] = 0x00;
+    frame[3] = 0x00;
+    frame[4] = 0x00;
+    frame[5] = 0x04;
+    if (g_wl.hello_pending)
+    {
+        /* The answer gives the number the resent window starts from */
+        frame[2] = WIFI_LINK_ACK_HELLO_REPLY;
+        frame[5] = 0x05;
+        frame[len++] = g_wl.caps;
+        frame[len++] = g_wl.tx_base;
+    }
+    else
+    {
+        frame[len++] = WL_SEQ(g_wl.tx_base + g_wl.count);
+    }
+    frame[len++] = g_wl.rx_seq;
+    len = wlAppendCheck(frame, len, WLFrameUsesCrc(frame));
+
+    if (!BQSafeQueueBytes(frame, len, RECV_QUEUE_ID))
+        return FALSE;
+
+    g_wl.ack_pending = FALSE;
+    if (g_wl.hello_pending)
+    {
+        g_wl.hello_pending = FALSE;
+        wlResend();
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WLService
+ *
+ *  DESCRIPTION
+ *      Resend the window once its ACK is overdue. After WIFI_LINK_MAX_RETRIES
+ *      resends without an ACK the module is taken to be a v1 one and the
+ *      link falls back to v1 framing.
+ *
+ * RETURNS
+ *      TRUE if frames were queued for the UART
+ *----------------------------------------------------------------------------*/
+bool WLService(void)
+{
+    if (!TWExpired(TM_WIFI_LINK_RETX))
+        return FALSE;
+
+    TWStop(TM_WIFI_LINK_RETX);
+
+    if (g_wl.count == 0)
+        return FALSE;
+
+    if (++g_wl.retries > WIFI_LINK_MAX_RETRIES)
+        wlFallback();
+    else
+        wlResend();
+
+    return TRUE;
+}
@@ -0,0 +1,144 @@
+/******************************************************************************
+ *  Copyright (c) 2017 by donse young
+ *
+ *  FILE
+ *      wifi_link.h
+ *
+ *  DESCRIPTION
+ *      Interface to the v2 Wi-Fi link: sequence numbered frames, cumulative
+ *      ACKs and a window of unacknowledged frames in each direction. Until
+ *      the Wi-Fi module opens v2 with a hello the link uses the original
+ *      EE/AA/DD frames unchanged.
+ *
+ *      A v2 frame is the v1 frame with its first byte replaced by E2 and
+ *      the sequence number and cumulative ACK inserted before the BCC:
+ *
+ *          E2 | EE/AA/DD/AC | v1 bytes 2 .. len+1 | seq | ack | bcc
+ *
+ *      The length field is the same as in v1, the frame is two bytes longer
+ *      and the BCC also covers seq and ack. seq is the number of the frame,
+ *      ack the number of the next frame expected from the peer. An AC frame
+ *      carries no data (len 4) and only acknowledges.
+ *
+ *      An AC frame with message ID 01 is a hello: the sender (re)starts the
+ *      link with seq and ack as its next numbers and offers the capabilities
+ *      in its one data byte. The answer is an AC frame with message ID 02
+ *      carrying the capabilities both ends support. If CRC-16 is agreed,
+ *      every later frame except a hello or its answer ends in a CRC-16
+ *      (crc16.h) over the same bytes, high byte first, instead of the BCC.
+ *
+ *****************************************************************************/
+
+#ifndef __WIFI_LINK_H__
+#define __WIFI_LINK_H__
+
+/*============================================================================*
+ *  SDK Header includes
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "timer_wheel.h"
+
+/*============================================================================*
+ *  Public definitions
+ *============================================================================*/
+
+/* First byte of a v2 frame */
+#define WIFI_LINK_FRAME_V2           (0xE2)
+
+/* Frame type of an ACK only frame */
+#define WIFI_LINK_TYPE_ACK           (0xAC)
+
+/* Message ID of an ACK frame that (re)starts the link */
+#define WIFI_LINK_ACK_HELLO          (0x01)
+
+/* Message ID of the answer to a hello */
+#define WIFI_LINK_ACK_HELLO_REPLY    (0x02)
+
+/* Capability bit: frames are checked with CRC-16 instead of the BCC */
+#define WIFI_LINK_CAP_CRC16          (0x01)
+
+/* Capability bit: mesh messages may be packed into BB batch frames */
+#define WIFI_LINK_CAP_BATCH          (0x02)
+
+/* Capabilities this side agrees to when offered in a hello */
+#define WIFI_LINK_CAPS               (WIFI_LINK_CAP_CRC16 | WIFI_LINK_CAP_BATCH)
+
+/* Frame type of a batch of mesh messages */
+#define WIFI_LINK_TYPE_BATCH         (0xBB)
+
+/* Bytes added to a v1 frame: sequence number and ACK */
+#define WIFI_LINK_TRAILER_LENGTH     (2)
+
+/* Size of a window slot, large enough for the longest v2 frame with CRC */
+#define WIFI_LINK_SLOT_SIZE          (43)
+
+/* Number of frames that can be sent before the oldest one is acknowledged */
+#define WIFI_LINK_WINDOW             (4)
+
+/* Time to wait for an ACK before the unacknowledged frames are resent */
+#define WIFI_LINK_RETX_TICKS         TW_TICKS_100MS(3)
+
+/* Resends without an ACK after which the module is taken to be a v1 one */
+#define WIFI_LINK_MAX_RETRIES        (5)
+
+/*============================================================================*
+ *  Public functions prototypes
+ *============================================================================*/
+
+/* Function that drops the window and returns the link to v1 framing. */
+extern void WLInit(void);
+
+/* Function that returns TRUE once the Wi-Fi module has opened v2. */
+extern bool WLIsV2(void);
+
+/* Function that returns TRUE if v2 is open and the capability was agreed. */
+extern bool WLHasCap(uint8 cap);
+
+/* Function that returns TRUE if the frame starting with the given header
+ * (at least 3 bytes) ends in a CRC-16 rather than a BCC.
+ */
+extern bool WLFrameUsesCrc(const uint8 *p_frame);
+
+/* Function that handles the sequence number and ACK of a verified v2 frame.
+ * Returns TRUE if it carries the next data frame from the peer, which is
+ * then rewritten in place as the equivalent v1 frame. can_store is FALSE if
+ * there is no room to keep the frame, so it is left for the peer to resend.
+ */
+extern bool WLRxFrame(uint8 *p_frame, uint16 *p_len, bool can_store);
+
+/* Function that records a verified v1 frame from the Wi-Fi module, which
+ * means the module does not speak v2.
+ */
+extern void WLRxLegacyFrame(void);
+
+/* Function that returns the window slot the next v2 frame can be built in,
+ * or NULL if the window is full or the link is being restarted.
+ */
+extern uint8 *WLTxGetSlot(void);
+
+/* Function that numbers the frame built in the slot returned by the last
+ * call to WLTxGetSlot, appends the trailer and check and queues it for the
+ * UART. len is the length of the frame without trailer and check.
+ */
+extern void WLTxCommit(uint16 len);
+
+/* Function that returns TRUE if frames from the peer still need an ACK. */
+extern bool WLAckPending(void);
+
+/* Function that queues an ACK only frame, or the answer to a hello, for the
+ * UART. Returns FALSE if the transmit queue is full.
+ */
+extern bool WLSendAck(void);
+
+/* Function that resends the window when its ACK is overdue and falls back
+ * to v1 if the peer stops answering. Returns TRUE if frames were queued.
+ */
+extern bool WLService(void);
+
+#endif /* __WIFI_LINK_H__ */
@@ -33,7 +33,6 @@
 
 #define CSR_MESH_SEC_SANITY_MAGIC               (0x0060)
 #define NVM_MESH_SECURE_ID                      (4)
-#define USER_STORE_NVM_SIZE                     (1024)
 
 /*============================================================================*
  *  Local Definitions
@@ -146,6 +146,11 @@ typedef struct {
 #define NVM_PAD_ROUND_UP_TO_16(x) ((sizeof(nvm_versioned_header_t) + x + 15) & ~0x0f)
 #define NVM_PAD_ROUND_UP_TO_32(x) ((sizeof(nvm_versioned_header_t) + x + 31) & ~0x1f)
 
+#ifndef CSR101x_A05
+/*! \brief Size in words of the user store created on the serial flash */
+#define USER_STORE_NVM_SIZE                     (1024)
+#endif /* !CSR101x_A05 */
+
 
 /*============================================================================*
  *  Public Function Prototypes
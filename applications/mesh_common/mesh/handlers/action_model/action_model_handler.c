@@ -52,7 +52,19 @@
 #define ACTION_MSG_MAX_PARTS                   (4)
 #define ACTION_MSG_FULL_BITMASK                ((1 << ACTION_MSG_MAX_PARTS) - 1)
 
-/* Macros for NVM access */
+/* Version of the action record format below, stored in the first word of the
+ * area earlier firmware kept its actions in. Earlier firmware kept the id of
+ * its first action in that word, so the version must not look like an action
+ * id. Without the version the actions stored by earlier firmware are read and
+ * written in the format below.
+ */
+#define ACTION_NVM_VERSION                     (0xAC01)
+
+/* Macros for NVM access. Values of two words are stored low word first.
+ * The record header holds the action id in the low byte and the mcp packet
+ * length in the high byte. Repeat times are 24 bits, the time type is stored
+ * in the top byte.
+ */
 #define NVM_OFFSET_ACTION_ID                   (0)
 
 #define NVM_OFFSET_ACTION_START_TIME           (1)
@@ -60,9 +72,33 @@
 
 #define NVM_OFFSET_ACTION_NUM_REPEAT           (5)
 #define NVM_OFFSET_ACTION_MCP_TARGET_ID        (6)
-#define NVM_OFFSET_ACTION_TIME_TYPE            (7)
-#define NVM_OFFSET_ACTION_START_TIME_RECVD     (8)
-#define NVM_OFFSET_ACTION_MCP_PKT              (10)
+#define NVM_OFFSET_ACTION_START_TIME_RECVD     (7)
+#define NVM_OFFSET_ACTION_MCP_PKT              (9)
+#define ACTION_MCP_PKT_WORDS                   ((MAX_MCP_PKT_LEN + 1) / 2)
+
+#if ((NVM_OFFSET_ACTION_MCP_PKT + ACTION_MCP_PKT_WORDS) != ACTION_SIZE)
+#error "ACTION_SIZE does not match the action record"
+#endif
+
+/* Macros for the NVM access of the records of earlier firmware. The words up
+ * to the mcp target id are as above, the time type has a word of its own.
+ */
+#define NVM_OFFSET_LEGACY_ACTION_TIME_TYPE     (7)
+#define NVM_OFFSET_LEGACY_ACTION_START_TIME_RECVD (8)
+#define NVM_OFFSET_LEGACY_ACTION_MCP_PKT       (10)
+
+#if ((NVM_OFFSET_LEGACY_ACTION_MCP_PKT + ACTION_MCP_PKT_WORDS) > \
+     ACTION_LEGACY_SIZE)
+#error "ACTION_LEGACY_SIZE does not match the earlier action record"
+#endif
+
+/* Next fire time of an action that is not due again */
+#define ACTION_TIME_NONE                       (0xFFFFFFFFUL)
+
+/* Action IDs are 5 bits, so no more actions can be told apart */
+#if (MAX_ACTIONS_SUPPORTED > ACTION_ID_MAX)
+#error "MAX_ACTIONS_SUPPORTED must not exceed 32"
+#endif
 
 typedef struct
 {
@@ -76,6 +112,9 @@ typedef struct
     uint16              time_type;
     uint32              start_time_recvd;
     uint8               mcp_pkt[MAX_MCP_PKT_LEN];
+    uint32              next_fire_time; /* Reference time the action is due */
+    uint8               heap_pos;       /* Position in the expiry heap */
+    bool                loaded;         /* Record read in full from NVM */
 }ACTION_INFO_T;
 
 typedef struct
@@ -88,8 +127,20 @@ typedef struct
     bool                last_part_recvd;
     uint8               full_msg_bitmask;
     timer_id            next_action_tid;
-    uint8               next_action_index;
-    uint32              next_action_exp_time;
+
+    /* Index of the action stored for each action ID */
+    uint8               id_index[ACTION_ID_MAX];
+    uint32              id_bitmask;
+
+    /* Stack of the indexes of the free action slots */
+    uint8               free_index[MAX_ACTIONS_SUPPORTED];
+    uint8               free_count;
+
+    /* Binary min-heap of the indexes of the actions that are due again,
+     * ordered on their next fire time
+     */
+    uint8               heap[MAX_ACTIONS_SUPPORTED];
+    uint8               heap_count;
 }ACTION_HANDLER_DATA_T;
 
 typedef union
@@ -113,7 +164,8 @@ static ACTION_MODEL_RSP_DATA_T action_model_rsp_data;
 /*============================================================================*
  *  Private Function Prototype
  *============================================================================*/
-static void setTimerForNextAction(uint8 current_utc_time[]);
+static void setTimerForNextAction(uint32 curr_ref_time);
+static uint32 getCurrentRefTime(uint8 current_utc_time[]);
 
 /*============================================================================*
  *  Private Function Definitions
@@ -146,31 +198,18 @@ static uint32 getDiffTimeInSeconds(uint8 time1[], uint8 time2[])
      */
     for(index = 0; index < 6; index ++)
     {
-        /* Get the first byte of time1 onto temp */
-        temp1 = time1[index];
-
-        /* If a carry is present and the byte value is greater than zero, then
-         * subtract the value and assign the carry to FALSE.
-         */
-        if(carry == TRUE && temp1 > 0)
-        {
-            temp1--;
-            carry = FALSE;
-        }
-        /* If the byte in array1 is more than or equal to the byte in array2 
-         * then just subtract the value otherwise add the max byte value + 1 
-         * and subtract the array2 value and set the carry bit.
+        /* Subtract the byte of time2 and the carry from the byte of time1
+         * with the max byte value + 1 added. If the result is below the max
+         * byte value + 1, the next byte has to give the carry. A carry into
+         * a zero byte goes on to the byte after it.
          */
-        if(temp1 >= time2[index])
+        temp_sum = 0x0100 + time1[index] - time2[index];
+        if(carry == TRUE)
         {
-            time3[index] = temp1 - time2[index];
-        }
-        else
-        {
-            temp_sum = 0x0100 + temp1;
-            time3[index] = temp_sum - time2[index];
-            carry = TRUE;
+            temp_sum--;
         }
+        time3[index] = temp_sum & 0x00FF;
+        carry = (temp_sum < 0x0100) ? TRUE : FALSE;
     }
 
     /* The below loop divides the time3 value by divisor and gives the quotient
@@ -193,11 +232,11 @@ static uint32 getDiffTimeInSeconds(uint8 time1[], uint8 time2[])
         dividend <<= 8;
         dividend |= time3[temp1];
 
-        /* If the dividend is greater than the divisor then divide the same and 
-         * assign the remainder back to dividend. Left shift the dividend by one
-         * byte for the next byte.
+        /* If the dividend is not less than the divisor then divide the same
+         * and assign the remainder back to dividend. Left shift the dividend
+         * by one byte for the next byte.
          */
-        if(dividend > divisor)
+        if(dividend >= divisor)
         {
             quotient |= dividend/divisor;
             dividend %= divisor;
@@ -221,133 +260,352 @@ static uint32 getDiffTimeInSeconds(uint8 time1[], uint8 time2[])
  *----------------------------------------------------------------------------*/
 static uint32 getSupportedActions(void)
 {
-    uint8 index;
-    uint32 supp_actions_bitmask = 0;
+    return action_hdlr_priv_data.id_bitmask;
+}
 
-    for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      actionHeapSwap
+ *
+ *  DESCRIPTION
+ *      This function swaps two entries of the expiry heap and updates the
+ *      heap positions stored in the actions.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void actionHeapSwap(uint8 pos1, uint8 pos2)
+{
+    uint8 index1 = action_hdlr_priv_data.heap[pos1];
+    uint8 index2 = action_hdlr_priv_data.heap[pos2];
+
+    action_hdlr_priv_data.heap[pos1] = index2;
+    action_hdlr_priv_data.heap[pos2] = index1;
+    action_hdlr_priv_data.actions[index1].heap_pos = pos2;
+    action_hdlr_priv_data.actions[index2].heap_pos = pos1;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      actionHeapFireTime
+ *
+ *  DESCRIPTION
+ *      This function returns the next fire time of the action at a position
+ *      of the expiry heap.
+ *
+ *  RETURNS/MODIFIES
+ *      Next fire time of the action.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 actionHeapFireTime(uint8 pos)
+{
+    return action_hdlr_priv_data.actions[
+                    action_hdlr_priv_data.heap[pos]].next_fire_time;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      actionHeapSiftUp
+ *
+ *  DESCRIPTION
+ *      This function moves a heap entry towards the root until its parent
+ *      is not due later.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void actionHeapSiftUp(uint8 pos)
+{
+    uint8 parent;
+
+    while(pos > 0)
     {
-        if(action_hdlr_priv_data.actions[index].action_id < ACTION_ID_MAX)
+        parent = (pos - 1) / 2;
+        if(actionHeapFireTime(parent) <= actionHeapFireTime(pos))
         {
-            supp_actions_bitmask |= 1 << 
-                            action_hdlr_priv_data.actions[index].action_id;
+            break;
         }
+        actionHeapSwap(parent, pos);
+        pos = parent;
     }
-    return supp_actions_bitmask;
 }
 
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      deleteActions
+ *      actionHeapSiftDown
  *
  *  DESCRIPTION
- *      This function deletes all the actions that are received in the action
- *      bitmask.
+ *      This function moves a heap entry away from the root until none of its
+ *      children is due earlier.
  *
  *  RETURNS/MODIFIES
  *      Nothing
  *
  *----------------------------------------------------------------------------*/
-static void deleteActions(uint32 actions_bitmask)
+static void actionHeapSiftDown(uint8 pos)
 {
-    uint8 index;
-    uint32 action_id_bitmask;
-    uint8 current_time[6];
-    int8   timezone;
+    uint8 child;
 
-    for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+    while((child = 2 * pos + 1) < action_hdlr_priv_data.heap_count)
     {
-        if(action_hdlr_priv_data.actions[index].action_id < ACTION_ID_MAX)
+        if((child + 1 < action_hdlr_priv_data.heap_count) &&
+           (actionHeapFireTime(child + 1) < actionHeapFireTime(child)))
         {
-            action_id_bitmask = 1 << 
-                            action_hdlr_priv_data.actions[index].action_id;
-            if((action_id_bitmask & actions_bitmask) == action_id_bitmask)
-            {
-                action_hdlr_priv_data.actions[index].action_id = 
-                                                            ACTION_ID_INVALID;
+            child++;
+        }
+        if(actionHeapFireTime(pos) <= actionHeapFireTime(child))
+        {
+            break;
+        }
+        actionHeapSwap(pos, child);
+        pos = child;
+    }
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      actionHeapUpdate
+ *
+ *  DESCRIPTION
+ *      This function puts an action in its place in the expiry heap after its
+ *      next fire time has changed. An action that is not due again is taken
+ *      out of the heap.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void actionHeapUpdate(uint8 index)
+{
+    uint8 pos = action_hdlr_priv_data.actions[index].heap_pos;
+    uint8 last, moved;
 
-                /* Action id needs to be made invalid in NVM */
-                Nvm_Write(
-                    (uint16*) (&action_hdlr_priv_data.actions[index].action_id), 
-                     sizeof(uint16),
-                     GET_ACTION_NVM_OFFSET(index) + NVM_OFFSET_ACTION_ID);
+    if(action_hdlr_priv_data.actions[index].next_fire_time == ACTION_TIME_NONE)
+    {
+        if(pos != ACTION_INDEX_INVALID)
+        {
+            /* Fill the gap with the last entry and move that into place */
+            last = --action_hdlr_priv_data.heap_count;
+            if(pos != last)
+            {
+                actionHeapSwap(pos, last);
+                moved = action_hdlr_priv_data.heap[pos];
+                actionHeapSiftUp(pos);
+                actionHeapSiftDown(action_hdlr_priv_data.actions[moved].heap_pos);
             }
+            action_hdlr_priv_data.actions[index].heap_pos = ACTION_INDEX_INVALID;
         }
     }
+    else if(pos == ACTION_INDEX_INVALID)
+    {
+        pos = action_hdlr_priv_data.heap_count++;
+        action_hdlr_priv_data.heap[pos] = index;
+        action_hdlr_priv_data.actions[index].heap_pos = pos;
+        actionHeapSiftUp(pos);
+    }
+    else
+    {
+        actionHeapSiftUp(pos);
+        actionHeapSiftDown(action_hdlr_priv_data.actions[index].heap_pos);
+    }
+}
 
-    if(TimeModelGetUTC(current_time, &timezone) == TRUE)
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      getNextFireTime
+ *
+ *  DESCRIPTION
+ *      This function returns the time an action is due next after the current
+ *      reference time.
+ *
+ *  RETURNS/MODIFIES
+ *      Returns the next fire time or ACTION_TIME_NONE if the action is not due
+ *      again.
+ *
+ *----------------------------------------------------------------------------*/
+static uint32 getNextFireTime(uint8 index, uint32 cur_ref_time)
+{
+    uint32 diff_slots;
+
+    /* The start time of the action has not been elapsed yet.*/
+    if(action_hdlr_priv_data.actions[index].start_time > cur_ref_time)
+    {
+        return action_hdlr_priv_data.actions[index].start_time;
+    }
+
+    /* Caleculate the next repeat time */
+    if(action_hdlr_priv_data.actions[index].repeat_time != 0)
     {
-        setTimerForNextAction(current_time);
+        diff_slots = (cur_ref_time - 
+                      action_hdlr_priv_data.actions[index].start_time) /
+                     action_hdlr_priv_data.actions[index].repeat_time;
+
+        diff_slots++;
+
+        return action_hdlr_priv_data.actions[index].start_time +
+               diff_slots * action_hdlr_priv_data.actions[index].repeat_time;
     }
+    return ACTION_TIME_NONE;
 }
 
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      getNextExpiringAction
+ *      scheduleAllActions
  *
  *  DESCRIPTION
- *      This function returns the time of the next expiring action 
+ *      This function caleculates the next fire time of every action and
+ *      builds the expiry heap again. It is needed only when the system time
+ *      has been updated.
  *
  *  RETURNS/MODIFIES
- *      Returns the time of the next expiring action.
+ *      Nothing
  *
  *----------------------------------------------------------------------------*/
-static uint32 getNextExpiringAction(uint32 cur_ref_time, uint8 *action_index)
+static void scheduleAllActions(uint32 cur_ref_time)
 {
     uint8 index;
-    uint32 next_exp_time = 0xFFFFFFFF;
+    uint8 pos;
+
+    action_hdlr_priv_data.heap_count = 0;
 
     for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
     {
+        action_hdlr_priv_data.actions[index].heap_pos = ACTION_INDEX_INVALID;
+
         if(action_hdlr_priv_data.actions[index].action_id < ACTION_ID_MAX)
         {
-            /* The start time of the action has not been elapsed yet.*/
-            if(action_hdlr_priv_data.actions[index].start_time > cur_ref_time)
+            action_hdlr_priv_data.actions[index].next_fire_time = 
+                                        getNextFireTime(index, cur_ref_time);
+
+            if(action_hdlr_priv_data.actions[index].next_fire_time != 
+                                                            ACTION_TIME_NONE)
             {
-                /* If the start time is less than the next expected time assign
-                 * next expiring time to the start time.
-                 */
-                if(action_hdlr_priv_data.actions[index].start_time < 
-                                                                next_exp_time)
-                {
-                    next_exp_time = 
-                        action_hdlr_priv_data.actions[index].start_time;
-                    *action_index = index;
-                }
+                pos = action_hdlr_priv_data.heap_count++;
+                action_hdlr_priv_data.heap[pos] = index;
+                action_hdlr_priv_data.actions[index].heap_pos = pos;
             }
-            else
-            {
-                uint32 diff_time=0, diff_slots=0, next_repeat_time=0;
+        }
+    }
 
-                /* Caleculate the next repeat time and compare with the expiring
-                 * time.
-                 */
-                if(action_hdlr_priv_data.actions[index].repeat_time != 0)
-                {
-                    diff_time = cur_ref_time - 
-                            action_hdlr_priv_data.actions[index].start_time;
+    /* Order the heap from the last parent up to the root */
+    for(pos = action_hdlr_priv_data.heap_count / 2; pos > 0; pos--)
+    {
+        actionHeapSiftDown(pos - 1);
+    }
+}
 
-                    diff_slots = diff_time / 
-                            action_hdlr_priv_data.actions[index].repeat_time;
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      rebuildActionIndex
+ *
+ *  DESCRIPTION
+ *      This function builds the action ID lookup and the free slot list from
+ *      the stored actions. No action is scheduled until the time is synced.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void rebuildActionIndex(void)
+{
+    uint8 index;
+    uint8 action_id;
 
-                    diff_slots++;
+    MemSet(action_hdlr_priv_data.id_index, ACTION_INDEX_INVALID,
+           sizeof(action_hdlr_priv_data.id_index));
+    action_hdlr_priv_data.id_bitmask = 0;
+    action_hdlr_priv_data.free_count = 0;
+    action_hdlr_priv_data.heap_count = 0;
 
-                    next_repeat_time = 
-                            action_hdlr_priv_data.actions[index].start_time +
-                  (diff_slots)*action_hdlr_priv_data.actions[index].repeat_time;
+    /* Push the free slots from the top, so the lowest is used first */
+    index = MAX_ACTIONS_SUPPORTED;
+    while(index-- > 0)
+    {
+        action_id = action_hdlr_priv_data.actions[index].action_id;
+        action_hdlr_priv_data.actions[index].heap_pos = ACTION_INDEX_INVALID;
 
-                    /* If the repeat time is less than the next exp repeat time, 
-                     * then store this value as the next exp time.
-                     */
-                    if(next_repeat_time < next_exp_time)
-                    {
-                        next_exp_time= next_repeat_time;
-                        *action_index = index;
-                    }
-                }
-            }
+        if(action_id < ACTION_ID_MAX &&
+           action_hdlr_priv_data.id_index[action_id] == ACTION_INDEX_INVALID)
+        {
+            action_hdlr_priv_data.id_index[action_id] = index;
+            action_hdlr_priv_data.id_bitmask |= (uint32)1 << action_id;
+        }
+        else
+        {
+            action_hdlr_priv_data.actions[index].action_id = ACTION_ID_INVALID;
+            action_hdlr_priv_data.free_index[
+                        action_hdlr_priv_data.free_count++] = index;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      deleteActionOnIndex
+ *
+ *  DESCRIPTION
+ *      This function deletes the action stored at an index and returns its
+ *      slot to the free list.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void deleteActionOnIndex(uint8 index)
+{
+    uint8 action_id = action_hdlr_priv_data.actions[index].action_id;
+    uint16 header = ACTION_ID_INVALID;
+
+    action_hdlr_priv_data.id_index[action_id] = ACTION_INDEX_INVALID;
+    action_hdlr_priv_data.id_bitmask &= ~((uint32)1 << action_id);
+
+    action_hdlr_priv_data.actions[index].next_fire_time = ACTION_TIME_NONE;
+    actionHeapUpdate(index);
+
+    action_hdlr_priv_data.actions[index].action_id = ACTION_ID_INVALID;
+    action_hdlr_priv_data.free_index[action_hdlr_priv_data.free_count++] = 
+                                                                        index;
+
+    /* Only the record header needs to be made invalid in NVM */
+    Nvm_Write(&header, sizeof(uint16), 
+              GET_ACTION_NVM_OFFSET(index) + NVM_OFFSET_ACTION_ID);
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      deleteActions
+ *
+ *  DESCRIPTION
+ *      This function deletes all the actions that are received in the action
+ *      bitmask.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void deleteActions(uint32 actions_bitmask)
+{
+    uint8 action_id;
+    uint8 current_time[6];
+    int8   timezone;
+
+    actions_bitmask &= action_hdlr_priv_data.id_bitmask;
+
+    for(action_id = 0; actions_bitmask != 0; action_id++)
+    {
+        if(actions_bitmask & 0x01)
+        {
+            deleteActionOnIndex(action_hdlr_priv_data.id_index[action_id]);
         }
+        actions_bitmask >>= 1;
+    }
+
+    if(TimeModelGetUTC(current_time, &timezone) == TRUE)
+    {
+        setTimerForNextAction(getCurrentRefTime(current_time));
     }
-    return next_exp_time;
 }
 
 /*-----------------------------------------------------------------------------*
@@ -364,28 +622,22 @@ static uint32 getNextExpiringAction(uint32 cur_ref_time, uint8 *action_index)
  *----------------------------------------------------------------------------*/
 static uint8 getActionIdIndex(uint8 action_id)
 {
-    uint8 index;
-
     /* check whether the action is already present if present then send the 
      * same index.
      */
-    for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+    if(action_id < ACTION_ID_MAX &&
+       action_hdlr_priv_data.id_index[action_id] != ACTION_INDEX_INVALID)
     {
-        if(action_id == action_hdlr_priv_data.actions[index].action_id)
-        {
-            return index;
-        }
+        return action_hdlr_priv_data.id_index[action_id];
     }
 
-    /* Check for an empty slot and send the lowest available action info which
-     * is free.
+    /* Send the free slot on the top of the free list. It is taken when the
+     * action is stored.
      */
-    for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+    if(action_hdlr_priv_data.free_count != 0)
     {
-        if(action_hdlr_priv_data.actions[index].action_id > ACTION_ID_MAX)
-        {
-            return index;
-        }
+        return action_hdlr_priv_data.free_index[
+                                    action_hdlr_priv_data.free_count - 1];
     }
 
     return ACTION_INDEX_INVALID;
@@ -429,22 +681,24 @@ static void nextActionTimerHandler(timer_id tid)
 {
     uint8 current_time[6];
     int8  timezone;
-    uint8 index = action_hdlr_priv_data.next_action_index;
-    bool is_time_valid = FALSE;
-    uint32 curr_ref_time = 0;
+    uint8 index;
+    uint32 curr_ref_time;
 
     if (action_hdlr_priv_data.next_action_tid == tid)
     {
         action_hdlr_priv_data.next_action_tid = TIMER_INVALID;
-        is_time_valid = TimeModelGetUTC(current_time, &timezone);
-        if(is_time_valid)
+        if(TimeModelGetUTC(current_time, &timezone) == FALSE)
         {
-            curr_ref_time = getCurrentRefTime(current_time);
+            return;
         }
+        curr_ref_time = getCurrentRefTime(current_time);
 
-        if((index != 0xFF) && (is_time_valid) &&
-          (curr_ref_time >= action_hdlr_priv_data.next_action_exp_time))
+        /* Send every action that has become due */
+        while((action_hdlr_priv_data.heap_count != 0) &&
+              (curr_ref_time >= actionHeapFireTime(0)))
         {
+            index = action_hdlr_priv_data.heap[0];
+
             /* Time has expired send the action here */
             ActionSendMessage(DEFAULT_NW_ID,
                 action_hdlr_priv_data.actions[index].mcp_target_id, 
@@ -471,18 +725,18 @@ static void nextActionTimerHandler(timer_id tid)
                 ((ACTION_REPEAT_FOREVER != action_hdlr_priv_data.actions[index].num_repeats) &&
                  (action_hdlr_priv_data.actions[index].curr_repeat_cnt > action_hdlr_priv_data.actions[index].num_repeats)))
             {
-                action_hdlr_priv_data.actions[index].action_id = ACTION_ID_INVALID;
-
-                /* Action id needs to be made invalid in NVM */
-                Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].action_id),
-                          sizeof(uint16), GET_ACTION_NVM_OFFSET(index) + NVM_OFFSET_ACTION_ID);
+                deleteActionOnIndex(index);
+            }
+            else
+            {
+                /* Move the action to its next repeat */
+                action_hdlr_priv_data.actions[index].next_fire_time = 
+                                        getNextFireTime(index, curr_ref_time);
+                actionHeapUpdate(index);
             }
         }
 
-        if(is_time_valid)
-        {
-            setTimerForNextAction(current_time);
-        }
+        setTimerForNextAction(curr_ref_time);
     }
 }
 
@@ -492,56 +746,43 @@ static void nextActionTimerHandler(timer_id tid)
  *
  *  DESCRIPTION
  *      This function should be called on a new action addition or deletion or
- *      when the system time has been updated. This function would recaleculate
- *      the timer for the next action set and set relavant timers.
+ *      when the system time has been updated, once the expiry heap is up to
+ *      date. It sets the timer for the action at the root of the heap.
  *
  *  RETURNS/MODIFIES
- *      returns the current reference time.
+ *      Nothing
  *
  *----------------------------------------------------------------------------*/
-static void setTimerForNextAction(uint8 current_utc_time[])
+static void setTimerForNextAction(uint32 curr_ref_time)
 {
-    uint32 timer_time, curr_ref_time;
-    uint8 action_index=0;
-
-    /* Get the current reference time based on UTC */
-    curr_ref_time = getCurrentRefTime(current_utc_time);
-
-    /* As the UTC time has changed recaleculate the timer for the next action
-     * to be sent across.
-     */
-    action_hdlr_priv_data.next_action_exp_time = 
-        getNextExpiringAction(curr_ref_time, &action_index);
+    uint32 timer_time, diff_time;
 
     /* Delete the timers as there are no more valid actions */
     TimerDelete(action_hdlr_priv_data.next_action_tid);
     action_hdlr_priv_data.next_action_tid = TIMER_INVALID;
 
-    if(action_hdlr_priv_data.next_action_exp_time != 0xFFFFFFFF)
+    if(action_hdlr_priv_data.heap_count != 0)
     {
-        uint32 diff_time = 
-            action_hdlr_priv_data.next_action_exp_time - curr_ref_time;
+        diff_time = 0;
+        if(actionHeapFireTime(0) > curr_ref_time)
+        {
+            diff_time = actionHeapFireTime(0) - curr_ref_time;
+        }
 
         /* As the time is more than 30 minutes we start a timer for 30 minutes
-         * and take the next action.
+         * and check again on its expiry.
          */
         if(diff_time > (30 * MINUTE_IN_SECONDS))
         {
             timer_time = 30 * MINUTE;
-            action_hdlr_priv_data.next_action_index = 0xFF;
         }
         else
         {
             timer_time = diff_time * SECOND;
-            action_hdlr_priv_data.next_action_index = action_index;
         }
         action_hdlr_priv_data.next_action_tid = 
                         TimerCreate(timer_time, TRUE, nextActionTimerHandler);
     }
-    else
-    {
-        action_hdlr_priv_data.next_action_index = 0xFF;
-    }
 }
 
 /*-----------------------------------------------------------------------------*
@@ -590,63 +831,146 @@ static void pktAssemblyTimeoutHandler(timer_id tid)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      writeActionDataOnIndex
+ *      packActionRecord
  *
  *  DESCRIPTION
- *      This function writes action data structure onto NVM.
+ *      This function packs the action at an index into its NVM record.
  *
  *  RETURNS
  *      Nothing.
  *
  *----------------------------------------------------------------------------*/
-static void writeActionDataOnIndex(uint8 index)
+static void packActionRecord(uint8 index, uint16 record[])
 {
-    uint16 index1, temp;
-    uint16 nvm_act_index = GET_ACTION_NVM_OFFSET(index);
+    ACTION_INFO_T *action = &action_hdlr_priv_data.actions[index];
+    uint16 index1, lo, hi;
 
     /* Pack the mcp packet len and action id onto word to reduce space.*/
-    temp = 
-        action_hdlr_priv_data.actions[index].mcp_pkt_len << 8 |
-        action_hdlr_priv_data.actions[index].action_id;
+    record[NVM_OFFSET_ACTION_ID] = 
+        ((action->mcp_pkt_len & 0x00FF) << 8) | (action->action_id & 0x00FF);
+
+    record[NVM_OFFSET_ACTION_START_TIME] = action->start_time & 0xFFFF;
+    record[NVM_OFFSET_ACTION_START_TIME + 1] = action->start_time >> 16;
 
-    Nvm_Write((uint16*) (&temp), 
-              sizeof(uint16),
-              nvm_act_index + NVM_OFFSET_ACTION_ID);
+    record[NVM_OFFSET_ACTION_REPEAT_TIME] = action->repeat_time & 0xFFFF;
+    record[NVM_OFFSET_ACTION_REPEAT_TIME + 1] = 
+        ((action->repeat_time >> 16) & 0x00FF) | 
+        ((action->time_type & 0x00FF) << 8);
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].start_time),
-              sizeof(uint32),
-              nvm_act_index + NVM_OFFSET_ACTION_START_TIME);
+    record[NVM_OFFSET_ACTION_NUM_REPEAT] = action->num_repeats;
+    record[NVM_OFFSET_ACTION_MCP_TARGET_ID] = action->mcp_target_id;
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].repeat_time),
-              sizeof(uint32),
-              nvm_act_index + NVM_OFFSET_ACTION_REPEAT_TIME);
+    record[NVM_OFFSET_ACTION_START_TIME_RECVD] = 
+                                    action->start_time_recvd & 0xFFFF;
+    record[NVM_OFFSET_ACTION_START_TIME_RECVD + 1] = 
+                                    action->start_time_recvd >> 16;
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].num_repeats),
-              sizeof(uint16),
-              nvm_act_index + NVM_OFFSET_ACTION_NUM_REPEAT);
+    /* Bytes past the packet length are stored as zero */
+    for(index1 = 0; index1 < ACTION_MCP_PKT_WORDS; index1++)
+    {
+        lo = (2 * index1 < action->mcp_pkt_len) ? 
+                                        action->mcp_pkt[2 * index1] : 0;
+        hi = (2 * index1 + 1 < action->mcp_pkt_len) ? 
+                                        action->mcp_pkt[2 * index1 + 1] : 0;
+        record[NVM_OFFSET_ACTION_MCP_PKT + index1] = 
+                                    ((hi & 0x00FF) << 8) | (lo & 0x00FF);
+    }
+}
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].mcp_target_id),
-              sizeof(uint16),
-              nvm_act_index + NVM_OFFSET_ACTION_MCP_TARGET_ID);
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      loadActionOnIndex
+ *
+ *  DESCRIPTION
+ *      This function reads the rest of the record of an action whose header
+ *      was read at boot. Records are only read in full when first needed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void loadActionOnIndex(uint8 index)
+{
+    ACTION_INFO_T *action = &action_hdlr_priv_data.actions[index];
+    uint16 record[ACTION_SIZE];
+    uint16 index1;
+
+    if(action->loaded)
+    {
+        return;
+    }
+    action->loaded = TRUE;
+
+    Nvm_Read(record, sizeof(record), GET_ACTION_NVM_OFFSET(index));
+
+    action->start_time = 
+        ((uint32)record[NVM_OFFSET_ACTION_START_TIME + 1] << 16) |
+        record[NVM_OFFSET_ACTION_START_TIME];
+
+    action->repeat_time = 
+        ((uint32)(record[NVM_OFFSET_ACTION_REPEAT_TIME + 1] & 0x00FF) << 16) |
+        record[NVM_OFFSET_ACTION_REPEAT_TIME];
+    action->time_type = record[NVM_OFFSET_ACTION_REPEAT_TIME + 1] >> 8;
+
+    action->num_repeats = record[NVM_OFFSET_ACTION_NUM_REPEAT];
+    action->mcp_target_id = record[NVM_OFFSET_ACTION_MCP_TARGET_ID];
+
+    action->start_time_recvd = 
+        ((uint32)record[NVM_OFFSET_ACTION_START_TIME_RECVD + 1] << 16) |
+        record[NVM_OFFSET_ACTION_START_TIME_RECVD];
+
+    for(index1 = 0; index1 < action->mcp_pkt_len; index1++)
+    {
+        action->mcp_pkt[index1] = 
+            (record[NVM_OFFSET_ACTION_MCP_PKT + index1 / 2] >> 
+                                            ((index1 & 0x01) * 8)) & 0x00FF;
+    }
+}
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].time_type),
-              sizeof(uint16),
-              nvm_act_index + NVM_OFFSET_ACTION_TIME_TYPE);
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeActionDataOnIndex
+ *
+ *  DESCRIPTION
+ *      This function writes action data structure onto NVM. The stored record
+ *      is read back and only the words that have changed are written, the
+ *      header last so that a new action only becomes valid once its record
+ *      is complete.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void writeActionDataOnIndex(uint8 index)
+{
+    uint16 record[ACTION_SIZE], stored[ACTION_SIZE];
+    uint16 nvm_act_index = GET_ACTION_NVM_OFFSET(index);
+    uint16 start, end;
 
-    Nvm_Write((uint16*) (&action_hdlr_priv_data.actions[index].start_time_recvd),
-              sizeof(uint32),
-              nvm_act_index + NVM_OFFSET_ACTION_START_TIME_RECVD);
+    packActionRecord(index, record);
+    Nvm_Read(stored, sizeof(stored), nvm_act_index);
 
-    for(index1 = 0; 
-        index1 <= action_hdlr_priv_data.actions[index].mcp_pkt_len;
-        index1= index1 + 2)
+    /* Write each run of changed words after the header */
+    for(start = NVM_OFFSET_ACTION_ID + 1; start < ACTION_SIZE; start = end)
     {
-        temp = action_hdlr_priv_data.actions[index].mcp_pkt[index1 + 1] << 8 |
-               action_hdlr_priv_data.actions[index].mcp_pkt[index1];
+        if(record[start] == stored[start])
+        {
+            end = start + 1;
+            continue;
+        }
+        end = start + 1;
+        while(end < ACTION_SIZE && record[end] != stored[end])
+        {
+            end++;
+        }
 
-        Nvm_Write((uint16*) (&temp),
-                  sizeof(uint16),
-                  nvm_act_index + NVM_OFFSET_ACTION_MCP_PKT + (index1/2));
+        Nvm_Write(&record[start], end - start, nvm_act_index + start);
+    }
+
+    if(record[NVM_OFFSET_ACTION_ID] != stored[NVM_OFFSET_ACTION_ID])
+    {
+        Nvm_Write(&record[NVM_OFFSET_ACTION_ID], sizeof(uint16),
+                  nvm_act_index + NVM_OFFSET_ACTION_ID);
     }
 }
 
@@ -666,6 +990,7 @@ static void writeActionDataOnIndex(uint8 index)
 static void decodeActionPktRecvd(uint8 action_id)
 {
     uint8 index, action_type, time_type;
+    uint8 old_action_id;
     uint8* pkt_assembly_ptr;
     uint32 cur_ref_time=0;
     uint8 current_time[6];
@@ -746,16 +1071,40 @@ static void decodeActionPktRecvd(uint8 action_id)
                     action_hdlr_priv_data.actions[index].repeat_time = 0;
                     action_hdlr_priv_data.actions[index].num_repeats = 0;
                 }
+                old_action_id = action_hdlr_priv_data.actions[index].action_id;
                 action_hdlr_priv_data.actions[index].action_id = 
                                         action_hdlr_priv_data.assembly_action_id;
 
+                action_hdlr_priv_data.actions[index].loaded = TRUE;
+
+                /* Take the slot off the free list for a new action */
+                if(old_action_id >= ACTION_ID_MAX)
+                {
+                    action_hdlr_priv_data.free_count--;
+                    action_hdlr_priv_data.id_index[
+                        action_hdlr_priv_data.assembly_action_id] = index;
+                    action_hdlr_priv_data.id_bitmask |= 
+                        (uint32)1 << action_hdlr_priv_data.assembly_action_id;
+                }
+
                 /* Copy the action information onto NVM */
                 writeActionDataOnIndex(index);
 
                 /* Set timer for next action as a new action msg is added */
                 if(TimeModelGetUTC(current_time, &timezone) == TRUE)
                 {
-                    setTimerForNextAction(current_time);
+                    cur_ref_time = getCurrentRefTime(current_time);
+                    action_hdlr_priv_data.actions[index].next_fire_time = 
+                                        getNextFireTime(index, cur_ref_time);
+                    actionHeapUpdate(index);
+                    setTimerForNextAction(cur_ref_time);
+                }
+                else
+                {
+                    /* It is scheduled once the time is synced */
+                    action_hdlr_priv_data.actions[index].next_fire_time = 
+                                                            ACTION_TIME_NONE;
+                    actionHeapUpdate(index);
                 }
             }
         }
@@ -898,25 +1247,23 @@ static CSRmeshResult actionModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
         {
             CSRMESH_ACTION_GET_T *p_event = 
                             (CSRMESH_ACTION_GET_T *)data->data;
-            uint8 index;
-            bool action_found = FALSE;
+            uint8 index = ACTION_INDEX_INVALID;
+            bool action_found;
 
             /* check whether the action is valid and not expired */
-            for(index = 0; index < MAX_ACTIONS_SUPPORTED; index++)
+            if(p_event->actionid < ACTION_ID_MAX)
             {
-                if(p_event->actionid == 
-                                action_hdlr_priv_data.actions[index].action_id)
-                {
-                    action_found = TRUE;
-                    break;
-                }
+                index = action_hdlr_priv_data.id_index[p_event->actionid];
             }
+            action_found = (index != ACTION_INDEX_INVALID);
 
             /* Form and send the action with the action information if the 
              * action is valid and not expired.
              */
             if(action_found == TRUE)
             {
+                loadActionOnIndex(index);
+
                 action_model_rsp_data.set_action_ext.set_action.actionid = 
                     action_hdlr_priv_data.actions[index].action_id;
 
@@ -996,22 +1343,84 @@ extern void ActionModelSyncCurrentTime(uint8 current_time[])
     /* Delete all the actions which have been elapsed */
     for(index=0; index < MAX_ACTIONS_SUPPORTED; index++)
     {
-        if(action_hdlr_priv_data.actions[index].action_id != ACTION_ID_INVALID
-           && action_hdlr_priv_data.actions[index].repeat_time == 0 
-           && curr_ref_time > action_hdlr_priv_data.actions[index].start_time)
+        if(action_hdlr_priv_data.actions[index].action_id != ACTION_ID_INVALID)
         {
-            action_hdlr_priv_data.actions[index].action_id = 
-                                                        ACTION_ID_INVALID;
-
-            /* Action id needs to be made invalid in NVM */
-            Nvm_Write(
-                (uint16*) (&action_hdlr_priv_data.actions[index].action_id), 
-                sizeof(uint16),
-                GET_ACTION_NVM_OFFSET(index) + NVM_OFFSET_ACTION_ID);
+            /* The action can only be scheduled with its full record */
+            loadActionOnIndex(index);
+
+            if(action_hdlr_priv_data.actions[index].repeat_time == 0 
+               && curr_ref_time > action_hdlr_priv_data.actions[index].start_time)
+            {
+                deleteActionOnIndex(index);
+            }
         }
     }
 
-    setTimerForNextAction(current_time);
+    /* The fire times are relative to the time, so all are caleculated again */
+    scheduleAllActions(curr_ref_time);
+    setTimerForNextAction(curr_ref_time);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readLegacyActionOnIndex
+ *
+ *  DESCRIPTION
+ *      This function reads an action stored by earlier firmware. Records
+ *      that hold no valid action leave the slot free.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *----------------------------------------------------------------------------*/
+static void readLegacyActionOnIndex(uint8 index)
+{
+    ACTION_INFO_T *action = &action_hdlr_priv_data.actions[index];
+    uint16 record[ACTION_LEGACY_SIZE];
+    uint16 index1;
+
+    action->action_id = ACTION_ID_INVALID;
+    action->loaded = TRUE;
+
+    if(index >= ACTION_LEGACY_COUNT)
+    {
+        return;
+    }
+
+    Nvm_Read(record, sizeof(record), GET_LEGACY_ACTION_NVM_OFFSET(index));
+
+    if((record[NVM_OFFSET_ACTION_ID] & 0xFF) >= ACTION_ID_MAX ||
+       (record[NVM_OFFSET_ACTION_ID] >> 8) > MAX_MCP_PKT_LEN)
+    {
+        return;
+    }
+
+    action->action_id = record[NVM_OFFSET_ACTION_ID] & 0xFF;
+    action->mcp_pkt_len = record[NVM_OFFSET_ACTION_ID] >> 8;
+
+    action->start_time = 
+        ((uint32)record[NVM_OFFSET_ACTION_START_TIME + 1] << 16) |
+        record[NVM_OFFSET_ACTION_START_TIME];
+
+    /* Repeat times are 24 bits, as they are received */
+    action->repeat_time = 
+        ((uint32)(record[NVM_OFFSET_ACTION_REPEAT_TIME + 1] & 0x00FF) << 16) |
+        record[NVM_OFFSET_ACTION_REPEAT_TIME];
+    action->time_type = record[NVM_OFFSET_LEGACY_ACTION_TIME_TYPE] & 0x00FF;
+
+    action->num_repeats = record[NVM_OFFSET_ACTION_NUM_REPEAT];
+    action->mcp_target_id = record[NVM_OFFSET_ACTION_MCP_TARGET_ID];
+
+    action->start_time_recvd = 
+        ((uint32)record[NVM_OFFSET_LEGACY_ACTION_START_TIME_RECVD + 1] << 16) |
+        record[NVM_OFFSET_LEGACY_ACTION_START_TIME_RECVD];
+
+    for(index1 = 0; index1 < action->mcp_pkt_len; index1++)
+    {
+        action->mcp_pkt[index1] = 
+            (record[NVM_OFFSET_LEGACY_ACTION_MCP_PKT + index1 / 2] >> 
+                                            ((index1 & 0x01) * 8)) & 0x00FF;
+    }
 }
 
 /*----------------------------------------------------------------------------*
@@ -1027,69 +1436,55 @@ extern void ActionModelSyncCurrentTime(uint8 current_time[])
  *----------------------------------------------------------------------------*/
 extern void ReadActionModelDataFromNVM(uint16 offset)
 {
-    uint8 index, index1;
+    uint8 index;
     uint16 temp;
+
+    /* The actions stored by earlier firmware are moved to the records. Their
+     * area is only changed once the version is written after the records, so
+     * an interrupted move is done again.
+     */
+    Nvm_Read(&temp, sizeof(uint16), offset);
+    if(temp != ACTION_NVM_VERSION)
+    {
+        for(index=0; index < MAX_ACTIONS_SUPPORTED; index++)
+        {
+            MemSet(&action_hdlr_priv_data.actions[index], 0,
+                   sizeof(ACTION_INFO_T));
+            readLegacyActionOnIndex(index);
+        }
+        WriteActionModelDataOntoNVM(offset);
+        rebuildActionIndex();
+        return;
+    }
+
+    /* Only the record headers are read at boot. The rest of a record is read
+     * when the action is first needed.
+     */
     for(index=0; index < MAX_ACTIONS_SUPPORTED; index++)
     {
-        uint16 nvm_act_index = GET_ACTION_NVM_OFFSET(index);
+        MemSet(&action_hdlr_priv_data.actions[index], 0, sizeof(ACTION_INFO_T));
 
         /* Read action id and mcp packet len from NVM */
-        Nvm_Read((uint16 *)&temp, sizeof(uint16), 
-                 nvm_act_index + NVM_OFFSET_ACTION_ID);
+        Nvm_Read(&temp, sizeof(uint16), 
+                 GET_ACTION_NVM_OFFSET(index) + NVM_OFFSET_ACTION_ID);
 
         action_hdlr_priv_data.actions[index].action_id = temp & 0xFF;
-        temp >>= 8;
+        action_hdlr_priv_data.actions[index].mcp_pkt_len = (temp >> 8) & 0xFF;
 
-        if(action_hdlr_priv_data.actions[index].action_id < ACTION_ID_MAX)
+        if(action_hdlr_priv_data.actions[index].action_id < ACTION_ID_MAX &&
+           action_hdlr_priv_data.actions[index].mcp_pkt_len <= MAX_MCP_PKT_LEN)
         {
-            action_hdlr_priv_data.actions[index].mcp_pkt_len = temp & 0xFF;
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].start_time,
-                      sizeof(uint32),
-                      nvm_act_index + NVM_OFFSET_ACTION_START_TIME);
-
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].repeat_time,
-                      sizeof(uint32),
-                      nvm_act_index + NVM_OFFSET_ACTION_REPEAT_TIME);
-
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].num_repeats,
-                      sizeof(uint16),
-                      nvm_act_index + NVM_OFFSET_ACTION_NUM_REPEAT);
-
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].mcp_target_id,
-                     sizeof(uint16), 
-                     nvm_act_index + NVM_OFFSET_ACTION_MCP_TARGET_ID);
-
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].time_type,
-                     sizeof(uint16), 
-                     nvm_act_index + NVM_OFFSET_ACTION_TIME_TYPE);
-
-            Nvm_Read(
-                (uint16 *)&action_hdlr_priv_data.actions[index].start_time_recvd,
-                      sizeof(uint32),
-                      nvm_act_index + NVM_OFFSET_ACTION_START_TIME_RECVD);
-
-
-            for(index1=0; 
-                index1 < action_hdlr_priv_data.actions[index].mcp_pkt_len;
-                index1 = index1+2)
-            {
-                /* Read action id and mcp packet len from NVM */
-                Nvm_Read((uint16 *)&temp,
-                        sizeof(uint16), 
-                        nvm_act_index + NVM_OFFSET_ACTION_MCP_PKT + (index1/2));
-                action_hdlr_priv_data.actions[index].mcp_pkt[index1] = 
-                                                                temp & 0xFF;
-                temp >>=8;
-                action_hdlr_priv_data.actions[index].mcp_pkt[index1+1] = 
-                                                                temp & 0xFF;
-            }
+            action_hdlr_priv_data.actions[index].loaded = FALSE;
+        }
+        else
+        {
+            action_hdlr_priv_data.actions[index].action_id = ACTION_ID_INVALID;
+            action_hdlr_priv_data.actions[index].mcp_pkt_len = 0;
+            action_hdlr_priv_data.actions[index].loaded = TRUE;
         }
     }
+
+    rebuildActionIndex();
 }
 
 /*----------------------------------------------------------------------------*
@@ -1097,7 +1492,8 @@ extern void ReadActionModelDataFromNVM(uint16 offset)
  *      WriteActionModelDataOntoNVM
  *
  *  DESCRIPTION
- *      This function writes action model data onto NVM.
+ *      This function writes action model data onto NVM. Records not read in
+ *      full yet are read first, so they must still be held in NVM.
  *
  *  RETURNS
  *      Nothing.
@@ -1106,10 +1502,16 @@ extern void ReadActionModelDataFromNVM(uint16 offset)
 extern void WriteActionModelDataOntoNVM(uint16 offset)
 {
     uint8 index;
+    uint16 version = ACTION_NVM_VERSION;
+
     for(index=0; index < MAX_ACTIONS_SUPPORTED; index++)
     {
+        loadActionOnIndex(index);
         writeActionDataOnIndex(index);
     }
+
+    /* The version is written last, so an interrupted write is redone */
+    Nvm_Write(&version, sizeof(uint16), offset);
 }
 
 /*----------------------------------------------------------------------------*
@@ -1162,7 +1564,9 @@ extern void ActionModelDataInit(void)
     for(index=0; index < MAX_ACTIONS_SUPPORTED; index++)
     {
         action_hdlr_priv_data.actions[index].action_id = ACTION_ID_INVALID;
+        action_hdlr_priv_data.actions[index].loaded = TRUE;
     }
+    rebuildActionIndex();
 }
 #endif /* ENABLE_ACTION_MODEL */
 
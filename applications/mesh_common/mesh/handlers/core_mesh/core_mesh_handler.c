@@ -202,7 +202,7 @@ static void appProcessMeshEvent(CSR_MESH_APP_EVENT_DATA_T
                         if(self_dev_id >= 0x8000 && self_dev_id <= 0x9000)
                         Local_MESH_ID = self_dev_id;
                         Mesh_status = app_state_associated;
-                        tm_100ms.tWriteFlashDelay.word = C_T_tWriteFlashDelay;
+                        TWStart(TM_WRITE_FLASH_DELAY, C_T_tWriteFlashDelay);
                         FlashWrite = ON;
                     if(GetConnectedDeviceId() == CM_INVALID_DEVICE_ID)
                     {
@@ -427,12 +427,12 @@ static void deviceIdAdvertTimeoutHandler(timer_id tid)
             if(Local_MESH_ID != NULL)
             {
                  Local_MESH_ID = CLEAR;  
-                 tm_100ms.tWriteFlashDelay.word = C_T_tWriteFlashDelay;
+                 TWStart(TM_WRITE_FLASH_DELAY, C_T_tWriteFlashDelay);
                  FlashWrite = ON;
             }
             CSRmeshAssociateToANetwork(p_mesh_hdlr_data->appearance , 10);
             /*add by cdy 2017/2/4  */  
-            if(tm_1s.tAdvUUID3Min.fov == ON)
+            if(TWExpired(TM_ADV_UUID))
             {
                  TimerDelete(dev_id_advert_tid);  
                  dev_id_advert_tid = TIMER_INVALID;
@@ -478,7 +478,7 @@ extern void InitiateAssociation(void)
     IOTLightControlDeviceBlink(0, 0, 127, 32, 32);
     
 #ifdef ENABLE_DEVICE_UUID_ADVERTS
-    tm_1s.tAdvUUID3Min.word = C_T_tAdvUUID3Min;/*add by cdy 2017/2/4  */  
+    TWStart(TM_ADV_UUID, C_T_tAdvUUID3Min);/*add by cdy 2017/2/4  */  
     CSRmeshAssociateToANetwork(p_mesh_hdlr_data->appearance , 10);
     /* Restart the timer to send Device ID messages periodically to get
      * associated to a network*/
@@ -21,12 +21,14 @@
  *  SDK Header Files
  *============================================================================*/
 #include <timer.h>
+#include <time.h>
 #include <mem.h>
 
 /*============================================================================*
  *  CSR Mesh Header Files
  *============================================================================*/
 #include <csr_mesh.h>
+#include <csr_sched.h>
 #include <data_server.h>
 #include <data_client.h>
 
@@ -36,6 +38,9 @@
 #include "data_model_handler.h"
 #include "label.h"
 #include "define.h"
+#include "app_event.h"
+#include "msg_cache.h"
+#include "mesh_delta.h"
 #include "app_mesh_handler.h"
 #ifdef ENABLE_WATCHDOG_MODEL
 #include "watchdog_model_handler.h"
@@ -49,15 +54,105 @@
 /* Data stream send retry wait time */
 #define STREAM_SEND_RETRY_TIME            (500 * MILLISECOND)
 #define BLOCK_SEND_RETRY_TIME            (150 * MILLISECOND)
+
+/* Limits of the adaptive segment pacing, which starts at
+ * BLOCK_SEND_RETRY_TIME
+ */
+#define BLOCK_PACE_MIN_TIME               (30 * MILLISECOND)
+#define BLOCK_PACE_MAX_TIME               (1200 * MILLISECOND)
 /* Data stream received timeout value */
 #define RX_STREAM_TIMEOUT                 (5 * SECOND)
 
+/* Time a frame received as a stream is remembered, longer than its sender
+ * keeps starting the stream over when the end flush goes unanswered
+ */
+#define STREAM_RX_DONE_TIME               (30 * SECOND)
+
 /* Max number of retries */
 #define MAX_SEND_RETRIES                  (3)
 
+/* Times a stream is started over after it was given up, before its frame
+ * is counted as failed
+ */
+#define STREAM_MAX_ATTEMPTS               (3)
+
+/* nesn a stream receiver answers to a flush it cannot take yet: a start
+ * while it receives another stream, or an end while it has no slot for the
+ * frame. The sender waits BLOCK_BUSY_WAIT_TIME and sends the flush again.
+ */
+#define STREAM_NESN_BUSY                  (0xFFFE)
+
 /* Max data per per stream send */
 #define MAX_DATA_STREAM_PACKET_SIZE       (8)
 #define MAX_DATA_BLACK_PACKET_SIZE       (10)
+
+/* Bytes of a mesh frame carried in block segments, all but the 7E/E7 header
+ * and message ID which every segment repeats
+ */
+#define BLOCK_PAYLOAD_MAX_LENGTH          (MESH_DATA_MAX_LENGTH - 2)
+
+/* Most segments a frame can be split into, with the smallest segment data */
+#define BLOCK_MAX_SEGMENTS                ((BLOCK_PAYLOAD_MAX_LENGTH + 5) / 6)
+
+/* Words in the bitmap of received segments */
+#define BLOCK_SEGMENT_MAP_WORDS           ((BLOCK_MAX_SEGMENTS + 15) / 16)
+
+/* Test and set segment i (from 0) in a segment bitmap */
+#define BLOCK_MAP_TEST(map, i) \
+                        (((map)[(i) / 16] & ((uint16)1 << ((i) % 16))) != 0)
+#define BLOCK_MAP_SET(map, i)  ((map)[(i) / 16] |= (uint16)1 << ((i) % 16))
+
+/* Byte 2 flags of an acknowledged segment: the frame is sent in
+ * acknowledged mode, the receiver is asked to answer with an ACK, and the
+ * frame is a delta frame (see mesh_delta.h)
+ */
+#define BLOCK_HDR_ACKED                   (0x01)
+#define BLOCK_HDR_POLL                    (0x02)
+#define BLOCK_HDR_DELTA                   (0x04)
+
+/* Block ACK: AC | message ID | segments | bitmap of the segments received,
+ * segment 1 in bit 0 of the first bitmap byte. BLOCK_ACK_RESYNC in the
+ * segments byte asks for a delta frame that could not be decoded to be
+ * sent whole. BLOCK_ACK_BUSY says the receiver had no slot for the frame
+ * and holds none of it; it answers frames sent in either mode.
+ */
+#define BLOCK_ACK_HEADER                  (0xAC)
+#define BLOCK_ACK_RESYNC                  (0x80)
+#define BLOCK_ACK_BUSY                    (0x40)
+#define BLOCK_ACK_HEADER_LENGTH           (3)
+#define BLOCK_ACK_MAP_BYTES               ((BLOCK_MAX_SEGMENTS + 7) / 8)
+
+/* Time to wait for an ACK before the missing segments are resent */
+#define BLOCK_ACK_WAIT_TIME               (300 * MILLISECOND)
+
+/* Resend rounds after which an acknowledged frame is given up */
+#define BLOCK_ACK_MAX_RETRIES             (3)
+
+/* Time a frame waits after a busy answer before it is sent again, in which
+ * the receiver hands two frames to the UART
+ */
+#define BLOCK_BUSY_WAIT_TIME              (200 * MILLISECOND)
+
+/* Time a frame to a single device sent without acknowledgement is kept
+ * after its last segment, for the receiver to answer busy
+ */
+#define BLOCK_BUSY_HOLD_TIME              (150 * MILLISECOND)
+
+/* Busy answers after which a frame is given up */
+#define BLOCK_BUSY_MAX_RETRIES            (30)
+
+/* Frames from different senders that can be reassembled at the same time */
+#define BLOCK_RX_SLOTS                    (3)
+
+/* A frame is dropped when no segment of it arrives for this long */
+#define BLOCK_RX_TIMEOUT                  (2 * SECOND)
+
+/* Senders whose last frame received is remembered after its slot is taken
+ * by another, so late segments of it are not taken for a new frame. Frames
+ * to one device are sent one after the other, so the last frame of each
+ * sender is enough.
+ */
+#define BLOCK_RX_DONE_SLOTS               (8)
 /*============================================================================*
  *  Private Data Type
  *===========================================================================*/
@@ -105,6 +200,9 @@ typedef struct
     uint16 sn;    /* Sequence number to be sent with next pkt */
     uint16 last_data_len; /* Length of last transmitted stream data */
     stream_send_status_t   status; /* Stream status */
+    uint16 attempts; /* Times the stream was started over */
+    uint16 busy;    /* Busy answers since the stream was last started */
+    uint32 queued_time; /* Time DataSend() took the frame */
 }STREAM_TX_T;
 
 
@@ -115,30 +213,112 @@ typedef struct
 }APP_STREAM_STATE_DATA_T;
 
 
+/* Enum for the states of a block reassembly slot */
 typedef enum
 {
-    block_receive_idle = 1,     
-    block_start_flush_received, 
-    block_receive_in_progress  
+    block_receive_idle = 1,     /* Slot is free */
+    block_receive_in_progress,  /* Segments of a frame are arriving */
+    block_receive_complete,     /* Frame waits for BLE_RX_DATA to be free */
+    block_receive_delivered     /* Frame was delivered, kept to answer ACK
+                                 * polls until the slot is needed */
 }block_recv_status_t;
 
+/* Block segment formats. Every segment starts with the 7E/E7 header and the
+ * message ID of the frame, followed by
+ *   legacy:   count << 4 | index                     (byte 2)
+ *   extended: 00 | index                             (bytes 2 and 3)
+ *   acked:    01 | index, or 03 | index to poll,
+ *             04 added for a delta frame             (bytes 2 and 3)
+ * and then the segment data, which is the frame from byte 2 onwards cut into
+ * equal pieces. Frames of up to four segments use the legacy format older
+ * nodes understand, longer frames the extended one, whose segment count
+ * follows from the frame length byte carried in segment 1. Acknowledged
+ * frames have the extended layout; the receiver answers a poll with a
+ * block ACK and only the segments it lacks are resent.
+ */
+typedef enum
+{
+    block_format_legacy = 0,
+    block_format_extended,
+    block_format_acked,
+    block_format_count
+}block_format_t;
+
+typedef struct
+{
+    uint8 header_len;   /* Bytes before the segment data */
+    uint8 data_len;     /* Data bytes in a full segment */
+    uint8 max_segments; /* Most segments a frame can be sent in */
+}BLOCK_SEGMENT_FORMAT_T;
+
+/* Reassembly slot, keyed by sender and message ID */
 typedef struct
 {
     uint16 src_id;
+    uint8 msg_id;
     block_recv_status_t status;
+    uint32 last_time;   /* Time the last segment arrived */
+    uint16 segments;    /* Segments in the frame, 0 until known */
+    uint16 segment_map[BLOCK_SEGMENT_MAP_WORDS]; /* Segments received */
+    bool delta;         /* Segments are of a delta frame */
+    bool resync;        /* Delta frame could not be decoded */
+    uint8 data[MESH_DATA_MAX_LENGTH]; /* Frame being reassembled */
 }BLOCK_RX_T;
 
+/* Last frame received whole from a sender */
 typedef struct
 {
-    uint16 dest_id; /* Data stream destination ID */
-    uint8 data_sequence;/*˳־*/
-    uint8 data_finish_flag;/*ɱ־*/
+    uint16 src_id;      /* Sender of the frame, 0 if the entry is free */
+    uint8 msg_id;       /* Message ID of the frame */
+    uint32 time;        /* Time the frame was completed */
+}BLOCK_RX_DONE_T;
+
+/* Entry of the mesh transmit queue */
+typedef struct
+{
+    uint16 dest_id;     /* Destination of the frame */
+    block_format_t format; /* Segment format of the frame */
+    uint16 segment;     /* Last segment sent in this round */
+    uint16 segments;    /* Segments in the frame */
+    uint16 ack_map[BLOCK_SEGMENT_MAP_WORDS]; /* Segments acknowledged */
+    bool ack_wait;      /* Waiting for an ACK to the last poll, or for a
+                         * busy answer to the last segment of a frame to a
+                         * device sent without acknowledgement */
+    bool busy_wait;     /* Waiting to send the frame again after a busy
+                         * answer */
+    bool delta;         /* Frame was replaced by a delta frame */
+    uint32 poll_time;   /* Time the last poll or last segment was sent, or
+                         * the busy answer came */
+    uint16 retries;     /* Resend rounds so far */
+    uint16 busy;        /* Busy answers so far */
+    uint16 order;       /* Queue order, earlier frames have lower values */
+    bool in_flight;     /* Segments of the frame are being sent */
+    uint32 queued_time; /* Time the frame was queued */
+    uint16 len;         /* Length of the frame, 0 if the entry is free */
+    uint8 data[MESH_DATA_MAX_LENGTH]; /* Frame to send */
 }BLOCK_TX_T;
 
+/* Segment pacing. The scheduler does not report how full its transmit
+ * queue is, so it is estimated: every message sent is advertised
+ * device_repeat_count times, one advert each advertising_interval.
+ */
+typedef struct
+{
+    uint32 interval;    /* Time between runs of the segment timer */
+    uint32 adv_interval; /* Scheduler advertising interval */
+    uint16 repeat_count; /* Adverts of each message sent by this device */
+    uint16 queue_size;  /* Messages the scheduler transmit queue holds */
+    uint16 backlog;     /* Adverts estimated to be waiting */
+    uint32 backlog_time; /* Time the backlog was last updated */
+}BLOCK_PACE_T;
+
 typedef struct
 {
-    BLOCK_RX_T rx;
-    BLOCK_TX_T tx;
+    BLOCK_RX_T rx[BLOCK_RX_SLOTS];
+    BLOCK_RX_DONE_T rx_done[BLOCK_RX_DONE_SLOTS];
+    BLOCK_TX_T tx[MESH_TX_QUEUE_DEPTH];
+    uint16 tx_count;    /* Frames queued or in flight */
+    uint16 tx_order;    /* Order of the next queued frame */
 }APP_BLOCK_STATE_DATA_T;
 /*=============================================================================*
  *  Private Data
@@ -149,6 +329,10 @@ typedef struct
 /* Device info length */
 static uint8 device_info_length;
 
+/* Frame being sent and frame being received as a stream */
+static uint8 stream_tx_data[MESH_DATA_MAX_LENGTH];
+static uint8 stream_rx_data[MESH_DATA_MAX_LENGTH];
+
 /* Application data stream state */
 static APP_STREAM_STATE_DATA_T app_stream_state;
 static APP_BLOCK_STATE_DATA_T app_block_state;
@@ -159,6 +343,32 @@ static uint16 tx_stream_offset = 0;
 /* Stream send retry timer */
 static timer_id stream_send_retry_tid = TIMER_INVALID;
 static timer_id block_send_retry_tid = TIMER_INVALID;
+
+/* Mesh transmit queue statistics */
+static uint16 block_tx_high_water = 0;
+static uint16 block_tx_last_wait_ms = 0;
+static uint16 block_tx_max_wait_ms = 0;
+
+/* Mesh transmit results, to tune pacing and resends on real networks */
+static uint16 block_tx_done_count = 0;
+static uint16 block_tx_failed_count = 0;
+static uint32 block_tx_done_bytes = 0;
+static uint16 block_tx_last_done_ms = 0;
+static uint16 block_tx_max_done_ms = 0;
+static uint16 block_tx_segments_sent = 0;
+static uint16 block_tx_segments_resent = 0;
+
+/* Block frames dropped incomplete, and refused for want of a slot */
+static uint16 block_rx_dropped_count = 0;
+static uint16 block_rx_refused_count = 0;
+
+/* Frame last refused, kept refused until the sender starts it again */
+static uint16 block_rx_busy_src = 0;
+static uint8 block_rx_busy_msg = 0;
+static uint32 block_rx_busy_time = 0;
+
+/* Mesh transmit pacing */
+static BLOCK_PACE_T block_pace;
 /* Stream send retry counter */
 static uint16 stream_send_retry_count = 0;
 
@@ -171,10 +381,16 @@ static bool rx_stream_in_progress = FALSE;
 /* Rx stream timeout tid */
 static timer_id rx_stream_timeout_tid;
 
-static uint8 Tx_Data_Buffer[40];
-static uint8 Block_Send_Num = 0;
-static uint8 Block_Send_Mod = 0;
-static uint8 Tx_Data_Buffer_len = 0;
+/* Answer to a flush other than the nesn of the stream being received */
+static uint16 stream_rx_answer;
+
+/* Layout of each block segment format */
+static const BLOCK_SEGMENT_FORMAT_T block_segment_format[block_format_count] =
+{
+    {3, 7, 4},                          /* block_format_legacy */
+    {4, 6, BLOCK_MAX_SEGMENTS},         /* block_format_extended */
+    {4, 6, BLOCK_MAX_SEGMENTS}          /* block_format_acked */
+};
 /*static APP_DATA_STREAM_CODE_T current_stream_code;*/
 
 /*=============================================================================*
@@ -194,13 +410,39 @@ static void handleCSRmeshDataStreamDataInd(uint16 src_id,
 static void handleCSRmeshDataStreamSendCfm(
                                        CSRMESH_DATA_STREAM_RECEIVED_T *p_event);
 
+static void startStream(uint16 dest_id);
 static void endStream(void);
+static bool streamRxDeliver(uint16 src_id);
+static void streamTxRetry(void);
+static void streamTxBusyInd(void);
 static void MeshRxdCheck_New(void);
 static void blockSendRetryTimer(timer_id tid);
-static void Handle01Data(void);
-static void Handle02Data(void);
-static void Handle03Data(void);
-static void Handle04Data(void);
+static uint16 blockSegmentCount(block_format_t format, uint16 payload_len);
+static uint16 blockBuildSegment(const BLOCK_TX_T *p_tx, uint16 index,
+                                bool poll, uint8 *p_segment);
+static bool blockTxIsBlocked(const BLOCK_TX_T *p_tx);
+static bool blockTxIsDone(const BLOCK_TX_T *p_tx);
+static uint16 blockTxNextMissing(const BLOCK_TX_T *p_tx, uint16 index);
+static void blockTxSendNext(BLOCK_TX_T *p_tx);
+static void blockTxAckInd(uint16 src_id, const uint8 *p_ack, uint16 len);
+static void blockTxStartFrames(void);
+static void blockSendSegments(void);
+static bool blockTxQueue(uint16 dest_id, const uint8 *p_data, uint16 len);
+static void blockPaceReadConfig(void);
+static uint16 blockPaceOccupancy(void);
+static void blockPaceRecordSend(CSRmeshResult result);
+static void blockPaceAdapt(void);
+static void blockTxRecordDone(const BLOCK_TX_T *p_tx);
+static void txRecordDone(bool failed, uint16 len, uint32 queued_time);
+static BLOCK_RX_T *blockRxGetSlot(uint16 src_id, uint8 msg_id, bool open);
+static void blockRxSendAck(const BLOCK_RX_T *p_rx);
+static void blockRxSendState(uint16 src_id, uint8 msg_id, uint8 state,
+                             uint8 map);
+static void blockRxSendBusy(uint16 src_id, uint8 msg_id, bool first);
+static bool blockRxIsDone(uint16 src_id, uint8 msg_id, uint32 max_age);
+static void blockRxSetDone(const BLOCK_RX_T *p_rx);
+static bool blockTxHolds(const BLOCK_TX_T *p_tx);
+static void blockTxBusyInd(BLOCK_TX_T *p_tx);
 /*=============================================================================*
  *  Private Function Implementations
  *============================================================================*/
@@ -220,40 +462,114 @@ static void Handle04Data(void);
 static void streamSendRetryTimer(timer_id tid)
 {
     CSRMESH_DATA_STREAM_SEND_T send_param;
+    CSRMESH_DATA_STREAM_FLUSH_T flush_param;
     if( tid == stream_send_retry_tid )
     {
         stream_send_retry_tid = TIMER_INVALID;
         stream_send_retry_count++;
         if( stream_send_retry_count < MAX_SEND_RETRIES )
         {
-            MemCopy(send_param.streamoctets, &BLE_TX_DATA[tx_stream_offset],
-                                             app_stream_state.tx.last_data_len);
-            send_param.streamoctets_len = app_stream_state.tx.last_data_len;
-            send_param.streamsn = app_stream_state.tx.sn;
-            
-            #ifdef DEBUG_ENABLE
-            uint8 chi = 0;
-            DebugWriteString("\r\n");
-            for(chi =0;chi < send_param.streamoctets_len;chi++)DebugWriteUint8(send_param.streamoctets[chi]);
-            #endif                   
-
-            /* Send the next packet */
-            DataStreamSend(CSR_MESH_DEFAULT_NETID, 
-                                      app_stream_state.tx.dest_id,
-                                      AppGetCurrentTTL(), &send_param);
+            if(app_stream_state.tx.status == stream_send_in_progress)
+            {
+                MemCopy(send_param.streamoctets,
+                        &stream_tx_data[tx_stream_offset],
+                        app_stream_state.tx.last_data_len);
+                send_param.streamoctets_len = app_stream_state.tx.last_data_len;
+                send_param.streamsn = app_stream_state.tx.sn;
+
+                #ifdef DEBUG_ENABLE
+                uint8 chi = 0;
+                DebugWriteString("\r\n");
+                for(chi =0;chi < send_param.streamoctets_len;chi++)DebugWriteUint8(send_param.streamoctets[chi]);
+                #endif
+
+                /* Send the next packet */
+                DataStreamSend(CSR_MESH_DEFAULT_NETID, 
+                                          app_stream_state.tx.dest_id,
+                                          AppGetCurrentTTL(), &send_param);
+            }
+            else
+            {
+                /* ʼflushδõӦط */
+                flush_param.streamsn = app_stream_state.tx.sn;
+                DataStreamFlush(CSR_MESH_DEFAULT_NETID,
+                                app_stream_state.tx.dest_id,
+                                AppGetCurrentTTL(), &flush_param);
+            }
 
             stream_send_retry_tid =  TimerCreate(STREAM_SEND_RETRY_TIME, TRUE,
                                                           streamSendRetryTimer);
         }
         else
         {
-            stream_send_retry_count = 0;
-            endStream();
+            /* նӦ¿ʼ */
+            streamTxRetry();
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      streamTxRetry
+ *
+ *  DESCRIPTION
+ *      Starts the stream being sent over after it was given up. After
+ *      STREAM_MAX_ATTEMPTS the stream is ended, its frame counted as failed
+ *      and f_SendMSGNG set.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void streamTxRetry(void)
+{
+    app_stream_state.tx.attempts++;
+    if(app_stream_state.tx.attempts < STREAM_MAX_ATTEMPTS)
+    {
+        startStream(app_stream_state.tx.dest_id);
+        return;
+    }
+
+    /* ¿ʼδʹ淢ʧ */
+    if(app_stream_state.tx.status != stream_start_flush_sent)
+    {
+        endStream();
+    }
+    txRecordDone(TRUE, 0, 0);
+    resetTxStreamState();
+    f_SendMSGNG = ON;
 #ifdef ENABLE_WATCHDOG_MODEL
-            WatchdogStart();
+    WatchdogStart();
 #endif /* ENABLE_WATCHDOG_MODEL */
-        }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      streamTxBusyInd
+ *
+ *  DESCRIPTION
+ *      Handles a busy answer to the flush that starts or ends the stream
+ *      being sent. The flush is sent again after BLOCK_BUSY_WAIT_TIME
+ *      without using up its retries; after BLOCK_BUSY_MAX_RETRIES busy
+ *      answers the stream is given up.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void streamTxBusyInd(void)
+{
+    app_stream_state.tx.busy++;
+    if(app_stream_state.tx.busy > BLOCK_BUSY_MAX_RETRIES)
+    {
+        streamTxRetry();
+        return;
     }
+
+    stream_send_retry_count = 0;
+    TimerDelete(stream_send_retry_tid);
+    stream_send_retry_tid = TimerCreate(BLOCK_BUSY_WAIT_TIME, TRUE,
+                                                       streamSendRetryTimer);
 }
 
 /*----------------------------------------------------------------------------*
@@ -315,7 +631,7 @@ static void sendNextPacket(void)
     {
         len = (data_pending > MAX_DATA_STREAM_PACKET_SIZE)? 
                                 MAX_DATA_STREAM_PACKET_SIZE : data_pending;
-        MemCopy(send_param.streamoctets, &BLE_TX_DATA[tx_stream_offset],len);
+        MemCopy(send_param.streamoctets, &stream_tx_data[tx_stream_offset],len);
         send_param.streamoctets_len = len;
         send_param.streamsn = app_stream_state.tx.sn;
             
@@ -364,13 +680,25 @@ static void resetRxStreamState(void)
 }
 
 
+/*----------------------------------------------------------------------------*
+ * NAME 
+ *     resetTxStreamState
+ * 
+ * DESCRIPTION
+ *     Ends the stream being sent, stops its retries and lets the gateway
+ *     hand over the next frame.
+ *----------------------------------------------------------------------------*/
 static void resetTxStreamState(void)
 {
+    TimerDelete(stream_send_retry_tid);
+    stream_send_retry_tid = TIMER_INVALID;
+    stream_send_retry_count = 0;
 
     app_stream_state.tx.status = stream_send_idle;
     app_stream_state.tx.sn = 0;
     app_stream_state.tx.dest_id = 0;
 
+    AEPost(AE_MESH_TX_READY, 0);
 }
 /*-----------------------------------------------------------------------------*
  *  NAME
@@ -411,434 +739,1375 @@ static void handleCSRmeshDataStreamFlushInd(
     }
 }
 
-    
+
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      handleCSRmeshDataBlockInd
+ *      blockRxGetSlot
  *
  *  DESCRIPTION
- *      This function handles the CSR_MESH_DATA_BLOCK_IND message
+ *      Returns the slot of message msg_id from src_id. If open is TRUE a new
+ *      frame takes a free slot, else the oldest delivered one. A frame still
+ *      being received is never given up for another; slots that waited more
+ *      than BLOCK_RX_TIMEOUT are freed on the way and counted as dropped if
+ *      their frame was not complete.
  *
  *  RETURNS
- *      Nothing
+ *      The slot, or NULL if the frame has none and open is FALSE or all
+ *      slots hold frames being received or not delivered yet.
  *
  *----------------------------------------------------------------------------*/
-
-static void handleCSRmeshDataBlockInd(uint16 src_id, 
-                                            CSRMESH_DATA_BLOCK_SEND_T *p_event)
+static BLOCK_RX_T *blockRxGetSlot(uint16 src_id, uint8 msg_id, bool open)
 {
-     uint8 block_data_buffer_flag;
-     uint8 block_data_total_flag;
-     uint8 block_data_buffer[10];
-     uint8 i = 0;
-     uint8 j = 0;
-     uint8 block_data_buffer_len;
-
-     block_data_buffer_len = p_event->datagramoctets_len;
-     for(i =0;i < block_data_buffer_len;i++)
-     {
-          block_data_buffer[i] = p_event->datagramoctets[i];    
-     }
-     block_data_buffer_flag = block_data_buffer[2] & 0x0f;/*˳־*/
-     block_data_total_flag = block_data_buffer[2] & 0xf0;/*һݰ*/
-     if(block_data_buffer[0] == 0x7E || block_data_buffer[0] == 0xE7)
-     {
-       if(f_Block_Buffer_Empty == ON)
-       {
-          f_Block_Buffer_Empty = OFF;
-          tm_1s.tRxMeshTimeOut2s.word = C_T_tRxMeshTimeOut2s;/*2볬ʱʱ*/
-          Rx_MessageID = block_data_buffer[1];
-          app_block_state.rx.src_id = src_id;
-          switch(block_data_buffer_flag)
+     const uint32 now = TimeGet32();
+     BLOCK_RX_T *p_free = NULL;
+     BLOCK_RX_T *p_delivered = NULL;
+     BLOCK_RX_T *p_rx;
+     uint16 i;
+
+     for(i = 0;i < BLOCK_RX_SLOTS;i++)
+     {
+          p_rx = &app_block_state.rx[i];
+          if((p_rx->status == block_receive_in_progress ||
+              p_rx->status == block_receive_delivered) &&
+             TimeSub(now, p_rx->last_time) > (int32)BLOCK_RX_TIMEOUT)
           {
-               case 0x01:
-                    BLE_RX_DATA[0] =  block_data_buffer[0];
-                    BLE_RX_DATA[1] =  block_data_buffer[1];
-                    for(j = 2;j < (block_data_buffer_len-1);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j+1];                        
-                    }
-                    f_rxmeshdata01 = ON;
-                    /*ôηֻһ*/
-                    if(block_data_total_flag == 0x10)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR;
-                    }
-               break;
-               case 0x02:
-                    f_rxmeshdata02 = ON;
-                    for(j = 9;j < (block_data_buffer_len+6);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-6];                        
-                    }
-               break;
-               case 0x03:
-                    f_rxmeshdata03 = ON;
-                    for(j = 16;j < (block_data_buffer_len+13);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-13];                        
-                    }
-               break;
-               case 0x04:
-                    f_rxmeshdata04 = ON;
-                    for(j = 23;j < (block_data_buffer_len+20);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-20];                        
-                    }
-               break;
-               default:
-               break;
+               if(p_rx->status == block_receive_in_progress)
+               {
+                    block_rx_dropped_count++;
+               }
+               p_rx->status = block_receive_idle;
           }
-     }
-     else
-     {
-          if(app_block_state.rx.src_id == src_id && block_data_buffer[1] == Rx_MessageID)
+          if(p_rx->status == block_receive_idle)
           {
-               switch(block_data_buffer_flag)
+               if(p_free == NULL)
                {
-               case 0x01:
-                    f_rxmeshdata01 = ON;
-                    BLE_RX_DATA[0] =  block_data_buffer[0];
-                    BLE_RX_DATA[1] =  block_data_buffer[1];
-                    for(j = 2;j < (block_data_buffer_len-1);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j+1];                        
-                    }
-                    if(block_data_total_flag == 0x20 && f_rxmeshdata02 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR;
-                     }
-                    else if(block_data_total_flag == 0x30 && f_rxmeshdata02 == ON && f_rxmeshdata03 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR; 
-                         f_rxmeshdata03 = CLEAR;
-                    }
-               break;
-               case 0x02:
-                    f_rxmeshdata02 = ON;
-                    for(j = 9;j < (block_data_buffer_len+6);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-6];                        
-                    }
-                    if(block_data_total_flag == 0x20 && f_rxmeshdata01 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR;
-                     }
-                    else if(block_data_total_flag == 0x30 && f_rxmeshdata01 == ON && f_rxmeshdata03 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR; 
-                         f_rxmeshdata03 = CLEAR;
-                    }
-               break;
-               case 0x03:
-                    f_rxmeshdata03 = ON;
-                    for(j = 16;j < (block_data_buffer_len+13);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-13];                        
-                    }
-                    if(block_data_total_flag == 0x30 && f_rxmeshdata01 == ON && f_rxmeshdata02 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR;
-                         f_rxmeshdata03 = CLEAR;
-                     }
-               break;
-               case 0x04:
-                    f_rxmeshdata04 = ON;
-                    for(j = 23;j < (block_data_buffer_len+20);j++)
-                    {
-                         BLE_RX_DATA[j] =  block_data_buffer[j-20];                        
-                    }
-                    if(block_data_total_flag == 0x40 && f_rxmeshdata01 == ON && f_rxmeshdata02 == ON && f_rxmeshdata03 == ON)
-                    {
-                         f_meshrxdataOK = ON;   
-                         f_rxmeshdata01 = CLEAR; 
-                         f_rxmeshdata02 = CLEAR;
-                         f_rxmeshdata03 = CLEAR;
-                         f_rxmeshdata04 = CLEAR;
-                     }
-               break;
-               default:
-               break;
-               }                    
+                    p_free = p_rx;
+               }
+               continue;
+          }
+          if(p_rx->src_id == src_id && p_rx->msg_id == msg_id)
+          {
+               return p_rx;
+          }
+          if(p_rx->status == block_receive_delivered &&
+             (p_delivered == NULL ||
+              TimeSub(p_rx->last_time, p_delivered->last_time) < 0))
+          {
+               p_delivered = p_rx;
           }
      }
-   }
-   if(f_meshrxdataOK == ON)
-   {
-        f_meshrxdataOK = OFF;
-        /*ɺ󣬵ȴ100msٴν½*/
-        tm_100ms.tmeshfinishdataWait100ms.word = C_T_tmeshfinishdataWait100ms;
-        MeshRxdCheck_New();
-        if(f_MeshRxdCheckOk == ON)
-        {
-             f_MeshRxdCheckOk = OFF;
-             RX_MESH_ID = app_block_state.rx.src_id;
-             if(BLE_RX_DATA[0] == 0x7E)UartTxDataType = 0xEE;
-             else if(BLE_RX_DATA[0] == 0xE7)UartTxDataType = 0xAA;
-        }
-               
-   }     
+
+     if(!open)
+     {
+          return NULL;
+     }
+     p_rx = (p_free != NULL) ? p_free : p_delivered;
+     if(p_rx != NULL)
+     {
+          p_rx->src_id = src_id;
+          p_rx->msg_id = msg_id;
+          p_rx->status = block_receive_in_progress;
+          p_rx->segments = 0;
+          MemSet(p_rx->segment_map, 0, sizeof(p_rx->segment_map));
+          p_rx->delta = FALSE;
+          p_rx->resync = FALSE;
+     }
+     return p_rx;
 }
 
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      handleCSRmeshDataStreamDataInd
+ *      blockRxSendAck
  *
  *  DESCRIPTION
- *      This function handles the CSR_MESH_DATA_STREAM_DATA_IND message
+ *      Answers a poll with a block ACK carrying the bitmap of the segments
+ *      received so far.
  *
  *  RETURNS
  *      Nothing
  *
  *----------------------------------------------------------------------------*/
-
-static void handleCSRmeshDataStreamDataInd(uint16 src_id, 
-                                            CSRMESH_DATA_STREAM_SEND_T *p_event)
+static void blockRxSendAck(const BLOCK_RX_T *p_rx)
 {
-    /* Restart the stream timeout timer */
-    TimerDelete(rx_stream_timeout_tid);
-    rx_stream_timeout_tid = TimerCreate(RX_STREAM_TIMEOUT, TRUE,
-                                                        rxStreamTimeoutHandler);
-
-    /* Set stream_in_progress flag to TRUE */
-    rx_stream_in_progress = TRUE;
-
-    MemCopy(&BLE_RX_DATA[rx_stream_offset],&p_event->streamoctets[0], p_event->streamoctets_len);
-    rx_stream_offset += p_event->streamoctets_len;    
-       
+     CSRMESH_DATA_BLOCK_SEND_T send_param;
+     uint8 *p_map = &send_param.datagramoctets[BLOCK_ACK_HEADER_LENGTH];
+     uint16 i;
+
+     send_param.datagramoctets[0] = BLOCK_ACK_HEADER;
+     send_param.datagramoctets[1] = p_rx->msg_id;
+     send_param.datagramoctets[2] = p_rx->segments |
+                                    (p_rx->resync ? BLOCK_ACK_RESYNC : 0);
+     MemSet(p_map, 0, BLOCK_ACK_MAP_BYTES);
+     for(i = 0;i < BLOCK_MAX_SEGMENTS;i++)
+     {
+          if(BLOCK_MAP_TEST(p_rx->segment_map, i))
+          {
+               p_map[i / 8] |= (uint8)1 << (i % 8);
+          }
+     }
+     send_param.datagramoctets_len =
+                               BLOCK_ACK_HEADER_LENGTH + BLOCK_ACK_MAP_BYTES;
+     blockPaceRecordSend(DataBlockSend(CSR_MESH_DEFAULT_NETID, p_rx->src_id,
+                                       AppGetCurrentTTL(), &send_param));
 }
 
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      handleCSRmeshDataStreamSendCfm
+ *      blockRxIsDone
  *
  *  DESCRIPTION
- *      This function handles the CSR_MESH_DATA_STREAM_SEND_CFM message
+ *      Checks whether message msg_id from src_id was received whole less
+ *      than max_age ago.
  *
  *  RETURNS
- *      Nothing
+ *      TRUE if the frame was received.
  *
  *----------------------------------------------------------------------------*/
-static void handleCSRmeshDataStreamSendCfm(
-                                    CSRMESH_DATA_STREAM_RECEIVED_T *p_event)
+static bool blockRxIsDone(uint16 src_id, uint8 msg_id, uint32 max_age)
 {
-    
-    tx_stream_offset += app_stream_state.tx.last_data_len;
-    /* Send next block if it is not end of string */
-    sendNextPacket();
+     const BLOCK_RX_DONE_T *p_done;
+     uint16 i;
+
+     for(i = 0;i < BLOCK_RX_DONE_SLOTS;i++)
+     {
+          p_done = &app_block_state.rx_done[i];
+          if(p_done->src_id == src_id && p_done->msg_id == msg_id &&
+             TimeSub(TimeGet32(), p_done->time) <= (int32)max_age)
+          {
+               return TRUE;
+          }
+     }
+     return FALSE;
 }
 
-/*----------------------------------------------------------------------------*
+/*-----------------------------------------------------------------------------*
  *  NAME
- *      startStream
+ *      blockRxSetDone
  *
  *  DESCRIPTION
- *      Initialises the stream model to start sending a data stream. 
- *      This function sets the receiver device ID to which the data is to be
- *      sent using the StreamSendData
+ *      Remembers the frame in a slot as the last one received whole from
+ *      its sender, in the entry of that sender or else the oldest one.
  *
- *  RETURNS/MODIFIES
+ *  RETURNS
  *      Nothing
  *
  *----------------------------------------------------------------------------*/
-
-extern void startStream(uint16 dest_id)
+static void blockRxSetDone(const BLOCK_RX_T *p_rx)
 {
-    CSRMESH_DATA_STREAM_FLUSH_T flush_param;
-    app_stream_state.tx.dest_id = dest_id;
-
-
-    app_stream_state.tx.sn = 0;
-    tx_stream_offset = 0;
-    app_stream_state.tx.status = stream_start_flush_sent;
-    app_stream_state.tx.last_data_len = 0;
-    device_info_length = BLE_TX_DATA_LENGTH;
+     BLOCK_RX_DONE_T *p_done = &app_block_state.rx_done[0];
+     uint16 i;
 
-    flush_param.streamsn = app_stream_state.tx.sn;
-    tm_1s.tMeshTimeOut2s.word = C_T_tMeshTimeOut2s; /*ͳʱ2sʱ*/ 
-    DataStreamFlush(CSR_MESH_DEFAULT_NETID, dest_id, 
-                    AppGetCurrentTTL(), &flush_param);
-}
-static void Handle01Data(void)
-{
-     uint8 i = 0;
-     uint8 len = 0;
-     Tx_Data_Buffer[0] =  BLE_TX_DATA[0];
-     Tx_Data_Buffer[1] =  BLE_TX_DATA[1];
-     Tx_Data_Buffer[2] =  (Block_Send_Num << 4) | 0x01;
-     if(Block_Send_Num <= 1)len = BLE_TX_DATA_LENGTH;
-     else len = 9;
-     for(i = 3;i <= len;i++)
-     {
-          Tx_Data_Buffer[i] = BLE_TX_DATA[i-1];   
-     }
-}
-static void Handle02Data(void)
-{
-     uint8 i = 0;
-     uint8 len = 0;
-     Tx_Data_Buffer[10] =  BLE_TX_DATA[0];
-     Tx_Data_Buffer[11] =  BLE_TX_DATA[1];
-     Tx_Data_Buffer[12] =  (Block_Send_Num << 4) | 0x02;
-     if(Block_Send_Num <= 2 && Block_Send_Mod != 0)len = 12 + Block_Send_Mod;
-     else len = 19;
-     for(i = 13;i <= len;i++)
+     for(i = 0;i < BLOCK_RX_DONE_SLOTS;i++)
      {
-          Tx_Data_Buffer[i] = BLE_TX_DATA[i-4];   
+          if(app_block_state.rx_done[i].src_id == p_rx->src_id)
+          {
+               p_done = &app_block_state.rx_done[i];
+               break;
+          }
+          if(TimeSub(app_block_state.rx_done[i].time, p_done->time) < 0)
+          {
+               p_done = &app_block_state.rx_done[i];
+          }
      }
+     p_done->src_id = p_rx->src_id;
+     p_done->msg_id = p_rx->msg_id;
+     p_done->time = p_rx->last_time;
 }
-static void Handle03Data(void)
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      blockRxSendBusy
+ *
+ *  DESCRIPTION
+ *      Tells the sender of a frame there is no slot for that it was not
+ *      received and has to be sent again later. Further segments of the
+ *      frame are answered once per BLOCK_ACK_WAIT_TIME, but the first
+ *      segment, which starts every new attempt, and a poll always are.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void blockRxSendBusy(uint16 src_id, uint8 msg_id, bool first)
 {
-     uint8 i = 0;
-     uint8 len = 0;
-     Tx_Data_Buffer[20] =  BLE_TX_DATA[0];
-     Tx_Data_Buffer[21] =  BLE_TX_DATA[1];
-     Tx_Data_Buffer[22] =  (Block_Send_Num << 4) | 0x03;
-     if(Block_Send_Num <= 3 && Block_Send_Mod != 0)len = 22 + Block_Send_Mod;
-     else len = 29;
-     for(i = 23;i <= len;i++)
+     const uint32 now = TimeGet32();
+
+     if(!first && src_id == block_rx_busy_src &&
+        msg_id == block_rx_busy_msg &&
+        TimeSub(now, block_rx_busy_time) <= (int32)BLOCK_ACK_WAIT_TIME)
      {
-          Tx_Data_Buffer[i] = BLE_TX_DATA[i-7];   
-     }
-}
-static void Handle04Data(void)
-{
-     uint8 i = 0;
-     uint8 len = 0;
-     Tx_Data_Buffer[30] =  BLE_TX_DATA[0];
-     Tx_Data_Buffer[31] =  BLE_TX_DATA[1];
-     Tx_Data_Buffer[32] =  (Block_Send_Num << 4) | 0x04;
-     if(Block_Send_Num <= 4 && Block_Send_Mod != 0)len = 32 + Block_Send_Mod;
-     else len = 39;
-     for(i = 33;i <= len;i++)
-     {
-          Tx_Data_Buffer[i] = BLE_TX_DATA[i-10];   
-     }          
-}
-static void Mesh_TxData_Handle(void)
-{
-     Block_Send_Num = ((BLE_TX_DATA_LENGTH - 2) / 7); 
-     Block_Send_Mod = ((BLE_TX_DATA_LENGTH - 2) % 7);
-     Tx_Data_Buffer_len = Block_Send_Num * 10 + Block_Send_Mod + 3;
-     if(Block_Send_Mod != 0)Block_Send_Num = Block_Send_Num+1;
-     switch(Block_Send_Num)
-     {
-          case 1:
-               Handle01Data();
-          break;
-          case 2:
-               Handle01Data();
-               Handle02Data();
-          break;
-          case 3:
-               Handle01Data();
-               Handle02Data();
-               Handle03Data();
-          break;
-          case 4:
-               Handle01Data();
-               Handle02Data();
-               Handle03Data();
-               Handle04Data();
-          break;
-          default:
-          break;
+          return;
      }
+     block_rx_busy_src = src_id;
+     block_rx_busy_msg = msg_id;
+     block_rx_busy_time = now;
+     block_rx_refused_count++;
+     blockRxSendState(src_id, msg_id, BLOCK_ACK_BUSY, 0x00);
 }
-/*----------------------------------------------------------------------------*
+
+/*-----------------------------------------------------------------------------*
  *  NAME
- *      StartBlockSendData
+ *      blockRxSendState
  *
  *  DESCRIPTION
- *      Initialises the stream model to start sending a data stream. 
- *      This function sets the receiver device ID to which the data is to be
- *      sent using the BlockSendData
+ *      Sends a block ACK for a frame that has no slot, with state in the
+ *      segments byte and every bitmap byte set to map: a busy answer, or
+ *      for a frame received before its slot was reused, every segment.
  *
- *  RETURNS/MODIFIES
+ *  RETURNS
  *      Nothing
  *
  *----------------------------------------------------------------------------*/
-extern void StartBlockSendData(uint16 dest_id)
+static void blockRxSendState(uint16 src_id, uint8 msg_id, uint8 state,
+                             uint8 map)
 {
-     uint16 data_pending, len;
      CSRMESH_DATA_BLOCK_SEND_T send_param;
-     app_stream_state.tx.dest_id = dest_id;   
-     app_stream_state.tx.sn = 0;
-     Mesh_TxData_Handle();
-     /*Tx_Data_Buffer_len = StrLen((char *)Tx_Data_Buffer);*/
-     device_info_length = Tx_Data_Buffer_len;
-     tx_stream_offset = 0;   
-     data_pending = device_info_length - tx_stream_offset;  
-     TimerDelete(block_send_retry_tid);
-     block_send_retry_tid = TIMER_INVALID;
-     tm_1s.tMeshTimeOut2s.word = C_T_tMeshTimeOut2s; /*ͳʱ2sʱ*/ 
-     
-     if( data_pending )
-     {
-          len = (data_pending > MAX_DATA_BLACK_PACKET_SIZE)? 
-                                MAX_DATA_BLACK_PACKET_SIZE : data_pending;
-          MemCopy(send_param.datagramoctets, &Tx_Data_Buffer[tx_stream_offset],len);
-          send_param.datagramoctets_len = len;
 
-          DataBlockSend(CSR_MESH_DEFAULT_NETID,app_stream_state.tx.dest_id,
-                        AppGetCurrentTTL(),&send_param); 
-          app_stream_state.tx.last_data_len = len;
-          
-          block_send_retry_tid = TimerCreate(BLOCK_SEND_RETRY_TIME, TRUE,
-                                                       blockSendRetryTimer);
-     }
+     send_param.datagramoctets[0] = BLOCK_ACK_HEADER;
+     send_param.datagramoctets[1] = msg_id;
+     send_param.datagramoctets[2] = state;
+     MemSet(&send_param.datagramoctets[BLOCK_ACK_HEADER_LENGTH], map,
+            BLOCK_ACK_MAP_BYTES);
+     send_param.datagramoctets_len =
+                               BLOCK_ACK_HEADER_LENGTH + BLOCK_ACK_MAP_BYTES;
+     blockPaceRecordSend(DataBlockSend(CSR_MESH_DEFAULT_NETID, src_id,
+                                       AppGetCurrentTTL(), &send_param));
 }
-/*----------------------------------------------------------------------------*
+
+/*-----------------------------------------------------------------------------*
  *  NAME
- *      blockSendRetryTimer
+ *      handleCSRmeshDataBlockInd
  *
  *  DESCRIPTION
- *      Timer handler to retry sending next packet
+ *      This function handles the CSR_MESH_DATA_BLOCK_IND message. The
+ *      segment is stored in the slot of its sender and message ID, so frames
+ *      from several nodes can be reassembled at the same time. Block ACKs
+ *      are passed to the transmit queue. A completed acknowledged frame is
+ *      decoded if it is a delta frame; one that cannot be decoded is not
+ *      delivered and the ACK asks for the whole frame instead. A frame there
+ *      is no slot for is answered busy, and its later segments are refused
+ *      until the sender starts it again from the first segment, so it is
+ *      only ever received whole from one attempt. Late segments of a frame
+ *      already received are ignored, even once its slot is reused; a poll
+ *      for it is answered with every segment. Every poll gets an answer.
  *
  *  RETURNS
- *      Nothing.
+ *      Nothing
  *
- *---------------------------------------------------------------------------*/
-static void blockSendRetryTimer(timer_id tid)
-{
-    uint16 data_pending, len;
-    CSRMESH_DATA_BLOCK_SEND_T send_param;
-    tx_stream_offset += app_stream_state.tx.last_data_len; 
-    app_stream_state.tx.sn += app_stream_state.tx.last_data_len;
-    data_pending = device_info_length - tx_stream_offset;  
+ *----------------------------------------------------------------------------*/
+
+static void handleCSRmeshDataBlockInd(uint16 src_id, 
+                                            CSRMESH_DATA_BLOCK_SEND_T *p_event)
+{
+     const uint8 *p_segment = p_event->datagramoctets;
+     const uint16 segment_len = p_event->datagramoctets_len;
+     const BLOCK_SEGMENT_FORMAT_T *p_format;
+     BLOCK_RX_T *p_rx;
+     bool delta = FALSE;
+     bool poll = FALSE;
+     bool refused;
+     uint16 index, count, offset, len, i;
+
+     if(segment_len >= BLOCK_ACK_HEADER_LENGTH &&
+        p_segment[0] == BLOCK_ACK_HEADER)
+     {
+          blockTxAckInd(src_id, p_segment, segment_len);
+          return;
+     }
+     if(segment_len < 4 || (p_segment[0] != 0x7E && p_segment[0] != 0xE7))
+     {
+          return;
+     }
+     /* ְͷɸʽbyte24λΪܰ4λΪ */
+     if((p_segment[2] & 0xf0) != 0)
+     {
+          p_format = &block_segment_format[block_format_legacy];
+          index = p_segment[2] & 0x0f;
+          count = p_segment[2] >> 4;
+     }
+     else
+     {
+          p_format = &block_segment_format[
+               (p_segment[2] & BLOCK_HDR_ACKED) ? block_format_acked :
+                                                  block_format_extended];
+          index = p_segment[3];
+          count = 0;
+          delta = (p_segment[2] & (BLOCK_HDR_ACKED | BLOCK_HDR_DELTA)) ==
+                  (BLOCK_HDR_ACKED | BLOCK_HDR_DELTA);
+          poll = (p_segment[2] & (BLOCK_HDR_ACKED | BLOCK_HDR_POLL)) ==
+                 (BLOCK_HDR_ACKED | BLOCK_HDR_POLL);
+     }
+     len = segment_len - p_format->header_len;
+     offset = 2 + (index - 1) * p_format->data_len;
+     if(index == 0 || index > BLOCK_MAX_SEGMENTS || len > p_format->data_len ||
+        offset + len > MESH_DATA_MAX_LENGTH)
+     {
+          return;
+     }
+
+     /* յֻܴ֡ӵ1¿ʼ */
+     refused = (src_id == block_rx_busy_src &&
+                p_segment[1] == block_rx_busy_msg &&
+                TimeSub(TimeGet32(), block_rx_busy_time) <=
+                (int32)BLOCK_RX_TIMEOUT);
+     p_rx = blockRxGetSlot(src_id, p_segment[1], FALSE);
+     if(p_rx == NULL && blockRxIsDone(src_id, p_segment[1], BLOCK_RX_TIMEOUT))
+     {
+          /* ֡ٵķְռµĻ壻ѯʱظȫյ */
+          if(poll)
+          {
+               blockRxSendState(src_id, p_segment[1], 0, 0xFF);
+          }
+          return;
+     }
+     if(p_rx == NULL && (!refused || index == 1))
+     {
+          p_rx = blockRxGetSlot(src_id, p_segment[1], TRUE);
+     }
+     if(p_rx == NULL)
+     {
+          /* ջ֪ͨͷԺӵ1ط */
+          blockRxSendBusy(src_id, p_segment[1], index == 1 || poll);
+          return;
+     }
+     if(refused)
+     {
+          block_rx_busy_src = 0;
+     }
+
+     /* ֡޷ʱͷķ֡½ */
+     if(p_rx->resync && !delta)
+     {
+          p_rx->status = block_receive_in_progress;
+          p_rx->segments = 0;
+          MemSet(p_rx->segment_map, 0, sizeof(p_rx->segment_map));
+          p_rx->resync = FALSE;
+     }
+
+     /* ֡֡ķְܻ */
+     for(i = 0;i < BLOCK_SEGMENT_MAP_WORDS;i++)
+     {
+          if(p_rx->segment_map[i] != 0)
+          {
+               break;
+          }
+     }
+     if(i == BLOCK_SEGMENT_MAP_WORDS)
+     {
+          p_rx->delta = delta;
+     }
+
+     /* ֡ٽطķְֻӦ */
+     if(p_rx->status == block_receive_in_progress && p_rx->delta == delta)
+     {
+          p_rx->last_time = TimeGet32();
+          if(index == 1)
+          {
+               p_rx->data[0] = p_segment[0];
+               p_rx->data[1] = p_segment[1];
+          }
+          MemCopy(&p_rx->data[offset], &p_segment[p_format->header_len], len);
+          BLOCK_MAP_SET(p_rx->segment_map, index - 1);
+
+          /* չʽܰɵ1е֡ó */
+          if(count != 0)
+          {
+               p_rx->segments = count;
+          }
+          else if(index == 1)
+          {
+               p_rx->segments =
+                    blockSegmentCount(block_format_extended, p_rx->data[2]);
+          }
+
+          count = p_rx->segments;
+          if(count != 0 && count <= BLOCK_MAX_SEGMENTS)
+          {
+               for(i = 0;i < count;i++)
+               {
+                    if(!BLOCK_MAP_TEST(p_rx->segment_map, i))
+                    {
+                         break;
+                    }
+               }
+               if(i == count)
+               {
+                    /* ޷Ĳ֡ϱӦҪط֡ */
+#ifdef ENABLE_MESH_DELTA
+                    if(p_format == &block_segment_format[block_format_acked])
+                    {
+                         p_rx->resync =
+                              !MDRxFrame(src_id, p_rx->data, p_rx->delta);
+                    }
+#else
+                    p_rx->resync = p_rx->delta;
+#endif /* ENABLE_MESH_DELTA */
+                    if(p_rx->resync)
+                    {
+                         p_rx->status = block_receive_delivered;
+                    }
+                    else
+                    {
+                         p_rx->status = block_receive_complete;
+                         blockRxSetDone(p_rx);
+                         DataBlockRxDeliver();
+                    }
+               }
+          }
+     }
+
+     if(poll)
+     {
+          blockRxSendAck(p_rx);
+     }
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      handleCSRmeshDataStreamDataInd
+ *
+ *  DESCRIPTION
+ *      This function handles the CSR_MESH_DATA_STREAM_DATA_IND message
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+
+static void handleCSRmeshDataStreamDataInd(uint16 src_id, 
+                                            CSRMESH_DATA_STREAM_SEND_T *p_event)
+{
+    /* Restart the stream timeout timer */
+    TimerDelete(rx_stream_timeout_tid);
+    rx_stream_timeout_tid = TimerCreate(RX_STREAM_TIMEOUT, TRUE,
+                                                        rxStreamTimeoutHandler);
+
+    /* Set stream_in_progress flag to TRUE */
+    rx_stream_in_progress = TRUE;
+
+    /* ֡ݶʱ֡У鲻ͨ */
+    if(rx_stream_offset + p_event->streamoctets_len <= MESH_DATA_MAX_LENGTH)
+    {
+        MemCopy(&stream_rx_data[rx_stream_offset], &p_event->streamoctets[0],
+                                                p_event->streamoctets_len);
+    }
+    rx_stream_offset += p_event->streamoctets_len;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      streamRxDeliver
+ *
+ *  DESCRIPTION
+ *      Hands a frame received as a stream to a reassembly slot as a complete
+ *      frame, so it reaches BLE_RX_DATA through DataBlockRxDeliver like
+ *      block frames do. A frame whose length does not match its length
+ *      byte, or that was already delivered, for instance again by a sender
+ *      that started the stream over when the end flush went unanswered, is
+ *      dropped.
+ *
+ *  RETURNS
+ *      FALSE if no slot is free for the frame, which stays in
+ *      stream_rx_data, else TRUE.
+ *
+ *----------------------------------------------------------------------------*/
+static bool streamRxDeliver(uint16 src_id)
+{
+    BLOCK_RX_T *p_rx;
+
+    if(rx_stream_offset < 3 || rx_stream_offset > MESH_DATA_MAX_LENGTH ||
+       rx_stream_offset != (stream_rx_data[2] & 0x00FF) + 2)
+    {
+        return TRUE;
+    }
+    if(blockRxIsDone(src_id, stream_rx_data[1], STREAM_RX_DONE_TIME))
+    {
+        return TRUE;
+    }
+
+    p_rx = blockRxGetSlot(src_id, stream_rx_data[1], TRUE);
+    if(p_rx == NULL)
+    {
+        return FALSE;
+    }
+    if(p_rx->status != block_receive_in_progress)
+    {
+        return TRUE;
+    }
+    MemCopy(p_rx->data, stream_rx_data, rx_stream_offset);
+    p_rx->last_time = TimeGet32();
+    p_rx->status = block_receive_complete;
+    blockRxSetDone(p_rx);
+    DataBlockRxDeliver();
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      handleCSRmeshDataStreamSendCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the CSR_MESH_DATA_STREAM_SEND_CFM message
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void handleCSRmeshDataStreamSendCfm(
+                                    CSRMESH_DATA_STREAM_RECEIVED_T *p_event)
+{
+    
+    tx_stream_offset += app_stream_state.tx.last_data_len;
+    /* Send next block if it is not end of string */
+    sendNextPacket();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      startStream
+ *
+ *  DESCRIPTION
+ *      Starts sending the frame in stream_tx_data to dest_id as a data
+ *      stream. Each packet is sent when the previous one is confirmed, so
+ *      the stream runs at the rate the receiver acknowledges.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+
+static void startStream(uint16 dest_id)
+{
+    CSRMESH_DATA_STREAM_FLUSH_T flush_param;
+    app_stream_state.tx.dest_id = dest_id;
+
+
+    app_stream_state.tx.sn = 0;
+    tx_stream_offset = 0;
+    app_stream_state.tx.status = stream_start_flush_sent;
+    app_stream_state.tx.last_data_len = 0;
+    app_stream_state.tx.busy = 0;
+
+    flush_param.streamsn = app_stream_state.tx.sn;
+    TWStart(TM_MESH_TIMEOUT, C_T_tMeshTimeOut2s); /*ͳʱ2sʱ*/ 
+    DataStreamFlush(CSR_MESH_DEFAULT_NETID, dest_id, 
+                    AppGetCurrentTTL(), &flush_param);
+
+    stream_send_retry_count = 0;
+    TimerDelete(stream_send_retry_tid);
+    stream_send_retry_tid = TimerCreate(STREAM_SEND_RETRY_TIME, TRUE,
+                                                       streamSendRetryTimer);
+}
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockSegmentCount
+ *
+ *  DESCRIPTION
+ *      Returns the number of segments a frame payload is cut into.
+ *
+ *  RETURNS
+ *      Number of segments.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 blockSegmentCount(block_format_t format, uint16 payload_len)
+{
+     const uint16 data_len = block_segment_format[format].data_len;
+
+     return (payload_len + data_len - 1) / data_len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockBuildSegment
+ *
+ *  DESCRIPTION
+ *      Builds segment index (from 1) of a queued frame, in the format chosen
+ *      when the frame was queued. poll asks the receiver of an acknowledged
+ *      frame for a block ACK.
+ *
+ *  RETURNS
+ *      Length of the segment.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 blockBuildSegment(const BLOCK_TX_T *p_tx, uint16 index,
+                                bool poll, uint8 *p_segment)
+{
+     const BLOCK_SEGMENT_FORMAT_T *p_format =
+                                        &block_segment_format[p_tx->format];
+     const uint16 offset = (index - 1) * p_format->data_len;
+     uint16 len = (p_tx->len - 2) - offset;
+
+     if(len > p_format->data_len)
+     {
+          len = p_format->data_len;
+     }
+     p_segment[0] = p_tx->data[0];
+     p_segment[1] = p_tx->data[1];
+     if(p_tx->format == block_format_legacy)
+     {
+          p_segment[2] = (p_tx->segments << 4) | index;
+     }
+     else if(p_tx->format == block_format_acked)
+     {
+          p_segment[2] = BLOCK_HDR_ACKED | (poll ? BLOCK_HDR_POLL : 0) |
+                         (p_tx->delta ? BLOCK_HDR_DELTA : 0);
+          p_segment[3] = index;
+     }
+     else
+     {
+          p_segment[2] = 0x00;
+          p_segment[3] = index;
+     }
+     MemCopy(&p_segment[p_format->header_len], &p_tx->data[2 + offset], len);
+
+     return p_format->header_len + len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxIsBlocked
+ *
+ *  DESCRIPTION
+ *      Checks whether a queued frame has to wait because a frame queued
+ *      before it to the same destination is not finished yet, so frames to
+ *      one node arrive in the order they were queued.
+ *
+ *  RETURNS
+ *      TRUE if the frame cannot be started yet.
+ *
+ *---------------------------------------------------------------------------*/
+static bool blockTxIsBlocked(const BLOCK_TX_T *p_tx)
+{
+     const BLOCK_TX_T *p_other;
+     uint16 i;
+
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          p_other = &app_block_state.tx[i];
+          if(p_other != p_tx && p_other->len != 0 &&
+             p_other->dest_id == p_tx->dest_id &&
+             (int16)(p_other->order - p_tx->order) < 0)
+          {
+               return TRUE;
+          }
+     }
+     return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxIsDone
+ *
+ *  DESCRIPTION
+ *      Checks whether a frame in flight is finished: every segment has been
+ *      sent, or for an acknowledged frame acknowledged, or its resend or
+ *      busy budget is used up.
+ *
+ *  RETURNS
+ *      TRUE if the frame can be freed.
+ *
+ *---------------------------------------------------------------------------*/
+static bool blockTxIsDone(const BLOCK_TX_T *p_tx)
+{
+     if(p_tx->busy > BLOCK_BUSY_MAX_RETRIES)
+     {
+          return TRUE;
+     }
+     if(p_tx->busy_wait)
+     {
+          return FALSE;
+     }
+     if(p_tx->format != block_format_acked)
+     {
+          return p_tx->segment >= p_tx->segments && !blockTxHolds(p_tx);
+     }
+     return p_tx->retries > BLOCK_ACK_MAX_RETRIES ||
+            blockTxNextMissing(p_tx, 0) == 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxHolds
+ *
+ *  DESCRIPTION
+ *      Checks whether a frame to a single device sent without
+ *      acknowledgement has sent its last segment and is kept
+ *      BLOCK_BUSY_HOLD_TIME in case the receiver answers busy. A held frame
+ *      sends nothing, so it does not count against MESH_TX_IN_FLIGHT.
+ *
+ *  RETURNS
+ *      TRUE if the frame is held.
+ *
+ *---------------------------------------------------------------------------*/
+static bool blockTxHolds(const BLOCK_TX_T *p_tx)
+{
+     return p_tx->format != block_format_acked && p_tx->ack_wait &&
+            p_tx->segment >= p_tx->segments &&
+            TimeSub(TimeGet32(), p_tx->poll_time) <=
+            (int32)BLOCK_BUSY_HOLD_TIME;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxNextMissing
+ *
+ *  DESCRIPTION
+ *      Finds the first segment after segment index (from 1, 0 to search
+ *      from the start) that the receiver has not acknowledged.
+ *
+ *  RETURNS
+ *      Segment index, or 0 if there is none.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 blockTxNextMissing(const BLOCK_TX_T *p_tx, uint16 index)
+{
+     for(;index < p_tx->segments;index++)
+     {
+          if(!BLOCK_MAP_TEST(p_tx->ack_map, index))
+          {
+               return index + 1;
+          }
+     }
+     return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxSendNext
+ *
+ *  DESCRIPTION
+ *      Sends the next segment of a frame in flight. An acknowledged frame
+ *      only sends the segments not acknowledged yet, polls with the last of
+ *      them and then waits BLOCK_ACK_WAIT_TIME for the ACK before it starts
+ *      another round. A segment the mesh stack refuses is sent again on the
+ *      next run. A frame the receiver answered busy waits
+ *      BLOCK_BUSY_WAIT_TIME and is then sent again from the first segment.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockTxSendNext(BLOCK_TX_T *p_tx)
+{
+     CSRMESH_DATA_BLOCK_SEND_T send_param;
+     CSRmeshResult result;
+     bool poll = FALSE;
+     bool hold = FALSE;
+
+     if(p_tx->busy_wait)
+     {
+          if(TimeSub(TimeGet32(), p_tx->poll_time) <=
+             (int32)BLOCK_BUSY_WAIT_TIME)
+          {
+               return;
+          }
+          p_tx->busy_wait = FALSE;
+     }
+
+     if(p_tx->format != block_format_acked)
+     {
+          if(p_tx->segment >= p_tx->segments)
+          {
+               return;
+          }
+          p_tx->segment++;
+          /* 豸֡ȴԷǷæ */
+          hold = (p_tx->segment == p_tx->segments &&
+                  (p_tx->dest_id & 0x8000) != 0);
+     }
+     else
+     {
+          if(p_tx->ack_wait)
+          {
+               if(TimeSub(TimeGet32(), p_tx->poll_time) <=
+                  (int32)BLOCK_ACK_WAIT_TIME)
+               {
+                    return;
+               }
+               /* Ӧʱطδȷϵķְ */
+               p_tx->ack_wait = FALSE;
+               p_tx->retries++;
+               p_tx->segment = 0;
+               if(p_tx->retries > BLOCK_ACK_MAX_RETRIES)
+               {
+                    return;
+               }
+          }
+          p_tx->segment = blockTxNextMissing(p_tx, p_tx->segment);
+          if(p_tx->segment == 0)
+          {
+               return;
+          }
+          poll = (blockTxNextMissing(p_tx, p_tx->segment) == 0);
+          hold = poll;
+     }
+
+     send_param.datagramoctets_len =
+          blockBuildSegment(p_tx, p_tx->segment, poll,
+                            send_param.datagramoctets);
+     if(hold)
+     {
+          p_tx->ack_wait = TRUE;
+          p_tx->poll_time = TimeGet32();
+     }
+     result = DataBlockSend(CSR_MESH_DEFAULT_NETID, p_tx->dest_id,
+                            AppGetCurrentTTL(), &send_param);
+     blockPaceRecordSend(result);
+     if(result != CSR_MESH_RESULT_SUCCESS)
+     {
+          p_tx->segment--;
+          p_tx->ack_wait = FALSE;
+     }
+     else
+     {
+          block_tx_segments_sent++;
+          if(p_tx->retries != 0)
+          {
+               block_tx_segments_resent++;
+          }
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxAckInd
+ *
+ *  DESCRIPTION
+ *      Handles a block ACK from the receiver of an acknowledged frame. The
+ *      acknowledged segments are never sent again, and if some are still
+ *      missing the next run starts a resend round for them. A delta frame
+ *      the receiver could not decode is sent again as the whole frame. A busy
+ *      answer, which comes for frames sent in either mode, makes the frame
+ *      wait and start again.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockTxAckInd(uint16 src_id, const uint8 *p_ack, uint16 len)
+{
+     BLOCK_TX_T *p_tx;
+     uint16 i, j;
+
+     if(len < BLOCK_ACK_HEADER_LENGTH + BLOCK_ACK_MAP_BYTES)
+     {
+          return;
+     }
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          p_tx = &app_block_state.tx[i];
+          if(p_tx->len == 0 || !p_tx->in_flight ||
+             p_tx->dest_id != src_id || p_tx->data[1] != p_ack[1])
+          {
+               continue;
+          }
+          if((p_ack[2] & BLOCK_ACK_BUSY) != 0)
+          {
+               blockTxBusyInd(p_tx);
+               continue;
+          }
+          if(p_tx->format != block_format_acked)
+          {
+               continue;
+          }
+#ifdef ENABLE_MESH_DELTA
+          if((p_ack[2] & BLOCK_ACK_RESYNC) != 0 && p_tx->delta)
+          {
+               p_tx->len = MDTxRestore(p_tx->dest_id, p_tx->data);
+               p_tx->delta = FALSE;
+               p_tx->segments =
+                    blockSegmentCount(block_format_acked, p_tx->len - 2);
+               MemSet(p_tx->ack_map, 0, sizeof(p_tx->ack_map));
+               p_tx->ack_wait = FALSE;
+               p_tx->segment = 0;
+               p_tx->retries = 0;
+               continue;
+          }
+#endif /* ENABLE_MESH_DELTA */
+          for(j = 0;j < p_tx->segments;j++)
+          {
+               if((p_ack[BLOCK_ACK_HEADER_LENGTH + j / 8] >> (j % 8)) & 0x01)
+               {
+                    BLOCK_MAP_SET(p_tx->ack_map, j);
+               }
+          }
+          if(p_tx->ack_wait)
+          {
+               p_tx->ack_wait = FALSE;
+               p_tx->segment = 0;
+               if(blockTxNextMissing(p_tx, 0) != 0)
+               {
+                    p_tx->retries++;
+               }
+          }
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxBusyInd
+ *
+ *  DESCRIPTION
+ *      Handles a busy answer to a frame in flight. The receiver kept none of
+ *      its segments, so the frame is sent again from the first segment once
+ *      BLOCK_BUSY_WAIT_TIME has passed. Further busy answers to segments
+ *      already sent are ignored while the frame waits.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockTxBusyInd(BLOCK_TX_T *p_tx)
+{
+     if(p_tx->busy_wait)
+     {
+          return;
+     }
+     MemSet(p_tx->ack_map, 0, sizeof(p_tx->ack_map));
+     p_tx->segment = 0;
+     p_tx->ack_wait = FALSE;
+     p_tx->busy_wait = TRUE;
+     p_tx->poll_time = TimeGet32();
+     p_tx->busy++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxStartFrames
+ *
+ *  DESCRIPTION
+ *      Moves the oldest queued frames that are not blocked into flight until
+ *      MESH_TX_IN_FLIGHT frames are being sent, and records how long each of
+ *      them waited in the queue. With ENABLE_MESH_DELTA an acknowledged
+ *      frame is delta encoded here, once the frame before it to the same
+ *      destination is finished.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockTxStartFrames(void)
+{
+     BLOCK_TX_T *p_tx;
+     BLOCK_TX_T *p_next;
+     uint16 in_flight = 0;
+     uint16 i;
+     uint32 wait_ms;
+
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          p_tx = &app_block_state.tx[i];
+          if(p_tx->len != 0 && p_tx->in_flight && !blockTxHolds(p_tx))
+          {
+               in_flight++;
+          }
+     }
+
+     while(in_flight < MESH_TX_IN_FLIGHT)
+     {
+          p_next = NULL;
+          for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+          {
+               p_tx = &app_block_state.tx[i];
+               if(p_tx->len != 0 && !p_tx->in_flight &&
+                  (p_next == NULL ||
+                   (int16)(p_tx->order - p_next->order) < 0) &&
+                  !blockTxIsBlocked(p_tx))
+               {
+                    p_next = p_tx;
+               }
+          }
+          if(p_next == NULL)
+          {
+               return;
+          }
+
+          p_next->in_flight = TRUE;
+          p_next->segment = 0;
+          in_flight++;
+#ifdef ENABLE_MESH_DELTA
+          if(p_next->format == block_format_acked)
+          {
+               p_next->delta =
+                    MDTxEncode(p_next->dest_id, p_next->data, &p_next->len);
+               p_next->segments =
+                    blockSegmentCount(block_format_acked, p_next->len - 2);
+          }
+#endif /* ENABLE_MESH_DELTA */
+
+          wait_ms = (uint32)TimeSub(TimeGet32(), p_next->queued_time) /
+                    MILLISECOND;
+          block_tx_last_wait_ms = (wait_ms > 0xFFFF) ? 0xFFFF : (uint16)wait_ms;
+          if(block_tx_last_wait_ms > block_tx_max_wait_ms)
+          {
+               block_tx_max_wait_ms = block_tx_last_wait_ms;
+          }
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockPaceReadConfig
+ *
+ *  DESCRIPTION
+ *      Takes the transmit queue size, repeat count and advertising interval
+ *      the pacing estimate is based on from the scheduler configuration.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockPaceReadConfig(void)
+{
+     CSR_SCHED_LE_PARAMS_T le_params;
+
+     if(CSRSchedGetConfigParams(&le_params) != CSR_SCHED_RESULT_SUCCESS)
+     {
+          return;
+     }
+     block_pace.queue_size = le_params.mesh_le_param.tx_param.tx_queue_size;
+     block_pace.repeat_count =
+                      le_params.mesh_le_param.tx_param.device_repeat_count;
+     block_pace.adv_interval =
+                      le_params.generic_le_param.advertising_interval;
+     if(block_pace.queue_size == 0)
+     {
+          block_pace.queue_size = 1;
+     }
+     if(block_pace.repeat_count == 0)
+     {
+          block_pace.repeat_count = 1;
+     }
+     if(block_pace.adv_interval < MILLISECOND)
+     {
+          block_pace.adv_interval = MILLISECOND;
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockPaceOccupancy
+ *
+ *  DESCRIPTION
+ *      Takes the adverts sent since the last call off the backlog and
+ *      estimates how many messages from this device are still waiting in
+ *      the scheduler transmit queue.
+ *
+ *  RETURNS
+ *      Estimated number of queued messages.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 blockPaceOccupancy(void)
+{
+     const uint32 now = TimeGet32();
+     uint32 sent;
+
+     if(block_pace.backlog == 0)
+     {
+          block_pace.backlog_time = now;
+          return 0;
+     }
+     sent = (uint32)TimeSub(now, block_pace.backlog_time) /
+            block_pace.adv_interval;
+     if(sent >= block_pace.backlog)
+     {
+          block_pace.backlog = 0;
+          block_pace.backlog_time = now;
+          return 0;
+     }
+     block_pace.backlog -= (uint16)sent;
+     block_pace.backlog_time += sent * block_pace.adv_interval;
+
+     return (block_pace.backlog + block_pace.repeat_count - 1) /
+            block_pace.repeat_count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockPaceRecordSend
+ *
+ *  DESCRIPTION
+ *      Adds a message handed to the mesh stack to the backlog. A message the
+ *      stack refused means its queue is full, whatever the estimate says.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockPaceRecordSend(CSRmeshResult result)
+{
+     const uint16 full = block_pace.queue_size * block_pace.repeat_count;
+
+     (void)blockPaceOccupancy();
+     if(result == CSR_MESH_RESULT_SUCCESS)
+     {
+          block_pace.backlog += block_pace.repeat_count;
+     }
+     else if(block_pace.backlog < full)
+     {
+          block_pace.backlog = full;
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockPaceAdapt
+ *
+ *  DESCRIPTION
+ *      Shortens the pacing interval by a quarter while the scheduler
+ *      transmit queue is at most half full, and doubles it once the queue
+ *      is three quarters full.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockPaceAdapt(void)
+{
+     const uint16 occupancy = blockPaceOccupancy();
+
+     if(occupancy * 4 >= block_pace.queue_size * 3)
+     {
+          block_pace.interval *= 2;
+          if(block_pace.interval > BLOCK_PACE_MAX_TIME)
+          {
+               block_pace.interval = BLOCK_PACE_MAX_TIME;
+          }
+     }
+     else if(occupancy * 2 <= block_pace.queue_size)
+     {
+          block_pace.interval -= block_pace.interval / 4;
+          if(block_pace.interval < BLOCK_PACE_MIN_TIME)
+          {
+               block_pace.interval = BLOCK_PACE_MIN_TIME;
+          }
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxRecordDone
+ *
+ *  DESCRIPTION
+ *      Counts a finished frame as delivered, or as failed if the receiver
+ *      stayed busy or it is an acknowledged frame given up with segments
+ *      missing, and records the time from queueing to finishing it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockTxRecordDone(const BLOCK_TX_T *p_tx)
+{
+     txRecordDone(p_tx->busy > BLOCK_BUSY_MAX_RETRIES ||
+                  (p_tx->format == block_format_acked &&
+                   blockTxNextMissing(p_tx, 0) != 0),
+                  p_tx->len, p_tx->queued_time);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      txRecordDone
+ *
+ *  DESCRIPTION
+ *      Counts a finished block or stream frame of len bytes, queued at
+ *      queued_time, as failed or as delivered.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void txRecordDone(bool failed, uint16 len, uint32 queued_time)
+{
+     uint32 done_ms;
+
+     if(failed)
+     {
+          block_tx_failed_count++;
+          return;
+     }
+
+     block_tx_done_count++;
+     block_tx_done_bytes += len;
+     done_ms = (uint32)TimeSub(TimeGet32(), queued_time) / MILLISECOND;
+     block_tx_last_done_ms = (done_ms > 0xFFFF) ? 0xFFFF : (uint16)done_ms;
+     if(block_tx_last_done_ms > block_tx_max_done_ms)
+     {
+          block_tx_max_done_ms = block_tx_last_done_ms;
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockSendSegments
+ *
+ *  DESCRIPTION
+ *      Runs at the pacing interval while frames are queued. Frees the
+ *      frames that finished on the previous run, starts queued frames in
+ *      their place and, unless the scheduler transmit queue is estimated to
+ *      be full, sends the next segment of every frame in flight, so segments
+ *      to different destinations are interleaved.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockSendSegments(void)
+{
+     BLOCK_TX_T *p_tx;
+     bool freed = FALSE;
+     uint16 i;
+
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          p_tx = &app_block_state.tx[i];
+          if(p_tx->len != 0 && p_tx->in_flight && blockTxIsDone(p_tx))
+          {
+#ifdef ENABLE_MESH_DELTA
+               /* Էȷ֡Ϊһֵ֡Ļ׼ */
+               if(p_tx->format == block_format_acked)
+               {
+                    if(blockTxNextMissing(p_tx, 0) == 0)
+                    {
+                         MDTxAcked(p_tx->dest_id, p_tx->data[1]);
+                    }
+                    else
+                    {
+                         MDTxReset(p_tx->dest_id);
+                    }
+               }
+#endif /* ENABLE_MESH_DELTA */
+               blockTxRecordDone(p_tx);
+               p_tx->len = 0;
+               p_tx->in_flight = FALSE;
+               app_block_state.tx_count--;
+               freed = TRUE;
+          }
+     }
+     if(freed)
+     {
+          /* пλȡһ֡ */
+          AEPost(AE_MESH_TX_READY, 0);
+     }
+
+     blockTxStartFrames();
+
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          p_tx = &app_block_state.tx[i];
+          if(p_tx->len != 0 && p_tx->in_flight &&
+             blockPaceOccupancy() < block_pace.queue_size)
+          {
+               blockTxSendNext(p_tx);
+          }
+     }
+
+     if(app_block_state.tx_count != 0)
+     {
+          blockPaceAdapt();
+          block_send_retry_tid = TimerCreate(block_pace.interval, TRUE,
+                                             blockSendRetryTimer);
+     }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockTxQueue
+ *
+ *  DESCRIPTION
+ *      Queues a frame for dest_id. Up to MESH_TX_IN_FLIGHT queued frames are
+ *      sent at once as series of DataBlockSend segments, one segment of each
+ *      per run of the paced segment timer. Frames to the same destination
+ *      are sent in the order they were queued. With ENABLE_DATA_BLOCK_ACK
+ *      frames to a single device are sent in acknowledged mode.
+ *
+ *  RETURNS/MODIFIES
+ *      TRUE if the frame was queued, FALSE if the queue is full.
+ *
+ *----------------------------------------------------------------------------*/
+static bool blockTxQueue(uint16 dest_id, const uint8 *p_data, uint16 len)
+{
+     const uint16 payload_len = len - 2;
+     BLOCK_TX_T *p_tx = NULL;
+     uint16 i;
+
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          if(app_block_state.tx[i].len == 0)
+          {
+               p_tx = &app_block_state.tx[i];
+               break;
+          }
+     }
+     if(p_tx == NULL)
+     {
+          return FALSE;
+     }
+
+     MemCopy(p_tx->data, p_data, len);
+     p_tx->len = len;
+     p_tx->dest_id = dest_id;
+     p_tx->format = block_format_legacy;
+     p_tx->segments = blockSegmentCount(block_format_legacy, payload_len);
+     if(p_tx->segments >
+        block_segment_format[block_format_legacy].max_segments)
+     {
+          p_tx->format = block_format_extended;
+          p_tx->segments =
+                      blockSegmentCount(block_format_extended, payload_len);
+     }
+#ifdef ENABLE_DATA_BLOCK_ACK
+     /* 豸֡ʹӦģʽ鲥֡Ӧ */
+     if((dest_id & 0x8000) != 0)
+     {
+          p_tx->format = block_format_acked;
+          p_tx->segments =
+                      blockSegmentCount(block_format_acked, payload_len);
+     }
+#endif /* ENABLE_DATA_BLOCK_ACK */
+     p_tx->segment = 0;
+     MemSet(p_tx->ack_map, 0, sizeof(p_tx->ack_map));
+     p_tx->ack_wait = FALSE;
+     p_tx->busy_wait = FALSE;
+     p_tx->delta = FALSE;
+     p_tx->retries = 0;
+     p_tx->busy = 0;
+     p_tx->in_flight = FALSE;
+     p_tx->order = app_block_state.tx_order++;
+     p_tx->queued_time = TimeGet32();
+
+     app_block_state.tx_count++;
+     if(app_block_state.tx_count > block_tx_high_water)
+     {
+          block_tx_high_water = app_block_state.tx_count;
+     }
+
+     /* Ͷʱδʱʼ */
+     if(block_send_retry_tid == TIMER_INVALID)
+     {
+          blockPaceReadConfig();
+          blockSendSegments();
+     }
+     return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      blockSendRetryTimer
+ *
+ *  DESCRIPTION
+ *      Timer handler to send the next segments
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void blockSendRetryTimer(timer_id tid)
+{
     if( tid == block_send_retry_tid )
     {
         block_send_retry_tid = TIMER_INVALID;
-        if( data_pending )
-        {
-              len = (data_pending > MAX_DATA_BLACK_PACKET_SIZE)? 
-                     MAX_DATA_BLACK_PACKET_SIZE : data_pending; 
-              MemCopy(send_param.datagramoctets, &Tx_Data_Buffer[tx_stream_offset],len);
-              send_param.datagramoctets_len = len;
-              DataBlockSend(CSR_MESH_DEFAULT_NETID,app_stream_state.tx.dest_id,
-                            AppGetCurrentTTL(),&send_param); 
-              app_stream_state.tx.last_data_len = len;
-              block_send_retry_tid = TimerCreate(BLOCK_SEND_RETRY_TIME, TRUE,
-                                                       blockSendRetryTimer);
-         }
-        else
-        {
-               tm_100ms.tmfTxdataWait100ms.word = C_T_tmfTxdataWait100ms;
-               TimerDelete(block_send_retry_tid);  
-               block_send_retry_tid = TIMER_INVALID;
-        }
-
+        blockSendSegments();
     }
 }
 
@@ -865,12 +2134,23 @@ static void endStream(void)
     flush_param.streamsn = app_stream_state.tx.sn;
     DataStreamFlush(CSR_MESH_DEFAULT_NETID, app_stream_state.tx.dest_id, 
                                     AppGetCurrentTTL(), &flush_param);
+
+    /* flushδõӦʱط */
+    TimerDelete(stream_send_retry_tid);
+    stream_send_retry_tid = TimerCreate(STREAM_SEND_RETRY_TIME, TRUE,
+                                                       streamSendRetryTimer);
 }
 
 static void MeshRxdCheck_New(void)
 {
   uint8 tempY = 1;
   MeshNowBuffer = 0;
+  /* ֡BLE_RX_DATAʱֱΪУʧ */
+  if(BLE_RX_DATA[2] + 2 > MESH_DATA_MAX_LENGTH)
+  {
+    f_MeshRxdCheckOk = 0;
+    return;
+  }
   while(tempY < (BLE_RX_DATA[2] + 1))
   {
     MeshNowBuffer ^= BLE_RX_DATA[tempY];
@@ -933,17 +2213,20 @@ static CSRmeshResult appDataServerHandler(CSRMESH_MODEL_EVENT_T event_code,
                 b_use_msg = TRUE;
                 rx_stream_offset = 0;
             }
-            else if(app_stream_state.rx.status == stream_start_flush_received)
+            else if(app_stream_state.rx.status == stream_receive_idle &&
+                    app_stream_state.rx.src_id == p_event->src_id)
+            {
+                /* flushӦʧطٴӦ֡ظϱ */
+                send_ack_msg = TRUE;
+            }
+            else if(app_stream_state.rx.status == stream_start_flush_received
+                    && app_stream_state.rx.src_id == p_event->src_id)
             {
                 /* We have already received a flush to start a stream. 
-                 * Respond to the message if it is from the same source. 
-                 * Ignore otherwise. App is already notified no need to notify
-                 * again
+                 * Respond to the message from the same source. App is
+                 * already notified no need to notify again
                  */
-                if( app_stream_state.rx.src_id == p_event->src_id)
-                {
-                    send_ack_msg = TRUE;
-                }
+                send_ack_msg = TRUE;
             }
             else if(app_stream_state.rx.status == stream_receive_in_progress
                     && p_event->src_id == app_stream_state.rx.src_id)
@@ -951,40 +2234,54 @@ static CSRmeshResult appDataServerHandler(CSRMESH_MODEL_EVENT_T event_code,
                 /* Data stream already in progress. Check if the sn is equal to
                  * nesn and the sender is rx.src_id. Otherwise ignore flush
                  */                
-                if(sn == app_stream_state.rx.nesn )
+                if(sn == app_stream_state.rx.nesn &&
+                   !streamRxDeliver(p_event->src_id))
+                {
+                    /* ûпеĽղۣӦæͶԺطflush */
+                    stream_rx_answer = STREAM_NESN_BUSY;
+                    *state_data = &stream_rx_answer;
+                    TimerDelete(rx_stream_timeout_tid);
+                    rx_stream_timeout_tid = TimerCreate(RX_STREAM_TIMEOUT,
+                                              TRUE, rxStreamTimeoutHandler);
+                    break;
+                }
+                else if(sn == app_stream_state.rx.nesn)
                 {
                     /* End of stream */
                     send_ack_msg = TRUE;
                     b_use_msg = TRUE;
                     app_stream_state.rx.status = stream_receive_idle;
                     app_stream_state.rx.nesn = 0xffff; /*add by cdy*/
-                    MeshRxdCheck_New();
-                    if(f_MeshRxdCheckOk == ON)
-                    {
-                         f_MeshRxdCheckOk = OFF;
-                         RX_MESH_ID = app_stream_state.rx.src_id;
-                         if(BLE_RX_DATA[0] == 0x7E)UartTxDataType = 0xEE;
-                         else if(BLE_RX_DATA[0] == 0xE7)UartTxDataType = 0xAA;
-                         /*f_Mesh_Uart_Tx = ON;ôڷͱ־*/
-                    }
                     
                     #ifdef DEBUG_ENABLE
                     uint8 temp = 0;
                     DebugWriteString("\r\n");
 				DebugWriteString("the data is:");
-				for(temp = 0;temp < (BLE_RX_DATA[2]+3);temp++)
+				for(temp = 0;temp < rx_stream_offset &&
+				             temp < MESH_DATA_MAX_LENGTH;temp++)
 				{	   
-					DebugWriteUint8(BLE_RX_DATA[temp]);				   
+					DebugWriteUint8(stream_rx_data[temp]);				   
 				}
                     #endif
                 }
                 else/* if(sn == 0)*/ 
                 {
-                    send_ack_msg = TRUE;
+                    /* ŲӦյֽλͶ¿ʼ */
+                    stream_rx_answer = app_stream_state.rx.nesn;
+                    *state_data = &stream_rx_answer;
                     rx_stream_in_progress = FALSE;
                     resetRxStreamState();
+                    break;
                 }
             }
+            else if(sn == 0 &&
+                    app_stream_state.rx.status != stream_receive_idle)
+            {
+                /* ڽ豸ӦæͶԺ¿ʼ */
+                stream_rx_answer = STREAM_NESN_BUSY;
+                *state_data = &stream_rx_answer;
+                break;
+            }
 
             *state_data = NULL;
             if(send_ack_msg == TRUE)
@@ -1091,7 +2388,14 @@ static CSRmeshResult appDataClientHandler(CSRMESH_MODEL_EVENT_T event_code,
             DebugWriteUint16(app_stream_state.tx.sn); 
             #endif
             
-            if(app_stream_state.tx.status == stream_start_flush_sent &&
+            if((app_stream_state.tx.status == stream_start_flush_sent ||
+                app_stream_state.tx.status == stream_finish_flush_sent) &&
+               nesn == STREAM_NESN_BUSY)
+            {
+                /* նæԺطflush */
+                streamTxBusyInd();
+            }
+            else if(app_stream_state.tx.status == stream_start_flush_sent &&
                nesn == 0)
             {
                 /* Received the acknowledgement for the stream flush
@@ -1115,15 +2419,17 @@ static CSRmeshResult appDataClientHandler(CSRMESH_MODEL_EVENT_T event_code,
                 /* Received the acknowledgement for the stream flush sent
                  * to finish the stream
                  */
+                txRecordDone(FALSE, device_info_length,
+                             app_stream_state.tx.queued_time);
                 resetTxStreamState();
                 f_SendMSGOK = ON; /* ÷ɱ־*/
                 /*nesn = 0; *//*add by cdy*/
             }
             else if(app_stream_state.tx.status == stream_finish_flush_sent &&
-               nesn != 0xffff)
+               nesn != 0xffff && nesn != app_stream_state.tx.sn)
             {
-                resetTxStreamState();
-                f_SendMSGNG = ON; /*÷ʹ־*/
+                /* նδȫ֡¿ʼ */
+                streamTxRetry();
             }
             /* nesn must be tx.sn + tx.last_data_len */
             else if(app_stream_state.tx.status == stream_send_in_progress &&
@@ -1149,6 +2455,306 @@ static CSRmeshResult appDataClientHandler(CSRMESH_MODEL_EVENT_T event_code,
  *  Public Function Implementations
  *============================================================================*/
 
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataSend
+ *
+ *  DESCRIPTION
+ *      Sends a frame to dest_id over the bearer that suits its size. Frames
+ *      that fit the legacy block format, and all frames to groups, go
+ *      through the block transmit queue. Longer frames to a single device
+ *      are sent as a data stream, whose packets are paced by the receiver's
+ *      confirmations. Frames to a destination that has a frame on the other
+ *      bearer wait, so they arrive in the order they were sent.
+ *
+ *  RETURNS
+ *      TRUE if the frame was taken, FALSE if it has to be offered again
+ *      after AE_MESH_TX_READY.
+ *
+ *----------------------------------------------------------------------------*/
+extern bool DataSend(uint16 dest_id, const uint8 *p_data, uint16 len)
+{
+     const bool stream_busy =
+                       (app_stream_state.tx.status != stream_send_idle);
+     uint16 i;
+
+     /* ֡Чʱ֡ */
+     if(len < 3 || len > MESH_DATA_MAX_LENGTH)
+     {
+          return TRUE;
+     }
+     if(stream_busy && app_stream_state.tx.dest_id == dest_id)
+     {
+          return FALSE;
+     }
+     if((dest_id & 0x8000) == 0 ||
+        blockSegmentCount(block_format_legacy, len - 2) <=
+                       block_segment_format[block_format_legacy].max_segments)
+     {
+          return blockTxQueue(dest_id, p_data, len);
+     }
+
+     if(stream_busy)
+     {
+          return FALSE;
+     }
+     for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+     {
+          if(app_block_state.tx[i].len != 0 &&
+             app_block_state.tx[i].dest_id == dest_id)
+          {
+               return FALSE;
+          }
+     }
+
+     MemCopy(stream_tx_data, p_data, len);
+     device_info_length = len;
+     app_stream_state.tx.attempts = 0;
+     app_stream_state.tx.queued_time = TimeGet32();
+     startStream(dest_id);
+     return TRUE;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockRxDeliver
+ *
+ *  DESCRIPTION
+ *      Copies the oldest complete block frame into BLE_RX_DATA and posts it
+ *      for the UART, if BLE_RX_DATA is free. Copies of a frame already sent
+ *      to the UART, which relaying delivers several times, are dropped.
+ *      Called when a frame completes and again when BLE_RX_DATA is released.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+extern void DataBlockRxDeliver(void)
+{
+     BLOCK_RX_T *p_rx;
+     uint16 i, len;
+
+     if(f_Block_Buffer_Empty == OFF)
+     {
+          return;
+     }
+     for(;;)
+     {
+          p_rx = NULL;
+          for(i = 0;i < BLOCK_RX_SLOTS;i++)
+          {
+               if(app_block_state.rx[i].status == block_receive_complete &&
+                  (p_rx == NULL ||
+                   TimeSub(app_block_state.rx[i].last_time,
+                           p_rx->last_time) < 0))
+               {
+                    p_rx = &app_block_state.rx[i];
+               }
+          }
+          if(p_rx == NULL)
+          {
+               return;
+          }
+
+          /* ظ֡ϱλϱ */
+          len = (p_rx->data[2] & 0x00FF) + 2;
+          if(len > MESH_DATA_MAX_LENGTH)
+          {
+               len = MESH_DATA_MAX_LENGTH;
+          }
+          if(!MCIsDuplicate(p_rx->src_id, p_rx->msg_id, p_rx->data, len))
+          {
+               break;
+          }
+          p_rx->status = block_receive_delivered;
+     }
+
+     f_Block_Buffer_Empty = OFF;
+     MemCopy(BLE_RX_DATA, p_rx->data, MESH_DATA_MAX_LENGTH);
+     Rx_MessageID = p_rx->msg_id;
+     p_rx->status = block_receive_delivered;
+
+     /*ϱȴ100msٴдBLE_RX_DATA*/
+     TWStart(TM_MESH_FINISH_DATA_WAIT, C_T_tmeshfinishdataWait100ms);
+     MeshRxdCheck_New();
+     if(f_MeshRxdCheckOk == ON)
+     {
+          f_MeshRxdCheckOk = OFF;
+          RX_MESH_ID = p_rx->src_id;
+          if(BLE_RX_DATA[0] == 0x7E)AEPost(AE_MESH_FRAME_RECEIVED, 0xEE);
+          else if(BLE_RX_DATA[0] == 0xE7)AEPost(AE_MESH_FRAME_RECEIVED, 0xAA);
+     }
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetQueueDepth
+ *
+ *  DESCRIPTION
+ *      Returns the number of frames queued or in flight in the mesh transmit
+ *      queue.
+ *
+ *  RETURNS
+ *      Number of frames
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetQueueDepth(void)
+{
+     return app_block_state.tx_count;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetHighWaterMark
+ *
+ *  DESCRIPTION
+ *      Returns the largest number of frames the mesh transmit queue has held.
+ *
+ *  RETURNS
+ *      Number of frames
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetHighWaterMark(void)
+{
+     return block_tx_high_water;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetQueuedTime
+ *
+ *  DESCRIPTION
+ *      Returns how long the last frame started waited in the mesh transmit
+ *      queue, and the longest any frame waited.
+ *
+ *  RETURNS
+ *      Time the last frame waited, in milliseconds
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetQueuedTime(uint16 *p_max_ms)
+{
+     if(p_max_ms != NULL)
+     {
+          *p_max_ms = block_tx_max_wait_ms;
+     }
+     return block_tx_last_wait_ms;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetDelivered
+ *
+ *  DESCRIPTION
+ *      Returns the number of frames delivered, that is acknowledged or, for
+ *      frames sent without acknowledgement, sent in full, together with the
+ *      number of frames given up and the bytes of the frames delivered as
+ *      they were sent. Frames sent as streams count once their end flush is
+ *      acknowledged, or as given up after STREAM_MAX_ATTEMPTS. The counters
+ *      wrap.
+ *
+ *  RETURNS
+ *      Number of frames delivered
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetDelivered(uint16 *p_failed, uint32 *p_bytes)
+{
+     if(p_failed != NULL)
+     {
+          *p_failed = block_tx_failed_count;
+     }
+     if(p_bytes != NULL)
+     {
+          *p_bytes = block_tx_done_bytes;
+     }
+     return block_tx_done_count;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetDeliveryTime
+ *
+ *  DESCRIPTION
+ *      Returns the time from queueing to delivery of the last frame
+ *      delivered, and the longest such time.
+ *
+ *  RETURNS
+ *      Delivery time of the last frame, in milliseconds
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetDeliveryTime(uint16 *p_max_ms)
+{
+     if(p_max_ms != NULL)
+     {
+          *p_max_ms = block_tx_max_done_ms;
+     }
+     return block_tx_last_done_ms;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetSegments
+ *
+ *  DESCRIPTION
+ *      Returns the number of segments handed to the mesh stack and how many
+ *      of them were resends of acknowledged frames. The counters wrap.
+ *
+ *  RETURNS
+ *      Number of segments sent
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetSegments(uint16 *p_resent)
+{
+     if(p_resent != NULL)
+     {
+          *p_resent = block_tx_segments_resent;
+     }
+     return block_tx_segments_sent;
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockTxGetPacing
+ *
+ *  DESCRIPTION
+ *      Returns the current interval between segments of a frame and the
+ *      estimated number of messages from this device in the scheduler
+ *      transmit queue.
+ *
+ *  RETURNS
+ *      Pacing interval, in milliseconds
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockTxGetPacing(uint16 *p_occupancy)
+{
+     if(p_occupancy != NULL)
+     {
+          *p_occupancy = blockPaceOccupancy();
+     }
+     return (uint16)(block_pace.interval / MILLISECOND);
+}
+
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      DataBlockRxGetDropped
+ *
+ *  DESCRIPTION
+ *      Returns the number of frames given up incomplete after
+ *      BLOCK_RX_TIMEOUT and the number of frames answered busy because
+ *      every reassembly slot was taken.
+ *
+ *  RETURNS
+ *      Number of frames dropped
+ *
+ *----------------------------------------------------------------------------*/
+extern uint16 DataBlockRxGetDropped(uint16 *p_refused)
+{
+     if(p_refused != NULL)
+     {
+          *p_refused = block_rx_refused_count;
+     }
+     return block_rx_dropped_count;
+}
+
 /*-----------------------------------------------------------------------------*
  *  NAME
  *      AppDataStreamInit
@@ -1164,6 +2770,8 @@ extern void DataModelHandlerInit(CsrUint8 nw_id,
                                  uint16 model_groups[],
                                  CsrUint16 num_groups)
 {
+    uint16 i;
+
     /* Register both both data client and server as we support both send
      * and receive stream
      */
@@ -1190,6 +2798,33 @@ extern void DataModelHandlerInit(CsrUint8 nw_id,
     app_stream_state.tx.last_data_len = 0;
     /*cdy add*/
     app_stream_state.tx.sn = 0;
+
+    /* Free the block reassembly slots */
+    for(i = 0;i < BLOCK_RX_SLOTS;i++)
+    {
+        app_block_state.rx[i].status = block_receive_idle;
+    }
+    for(i = 0;i < BLOCK_RX_DONE_SLOTS;i++)
+    {
+        app_block_state.rx_done[i].src_id = 0;
+        app_block_state.rx_done[i].time = TimeGet32();
+    }
+
+    /* Empty the mesh transmit queue */
+    for(i = 0;i < MESH_TX_QUEUE_DEPTH;i++)
+    {
+        app_block_state.tx[i].len = 0;
+        app_block_state.tx[i].in_flight = FALSE;
+    }
+    app_block_state.tx_count = 0;
+    block_send_retry_tid = TIMER_INVALID;
+
+    /* Start pacing segments at the fixed interval used before */
+    block_pace.interval = BLOCK_SEND_RETRY_TIME;
+    block_pace.adv_interval = BLOCK_SEND_RETRY_TIME;
+    block_pace.repeat_count = 1;
+    block_pace.queue_size = 1;
+    block_pace.backlog = 0;
     
     /*MemCopy(&device_info[2], DEVICE_INFO_STRING, sizeof(DEVICE_INFO_STRING));*/
 }
@@ -29,6 +29,9 @@ extern void DataModelHandlerInit(CsrUint8 nw_id,
                                  uint16 model_groups[],
                                  CsrUint16 num_groups);
 
-extern void startStream(uint16 dest_id);
+/* Sends a frame as blocks or, if it is long, as a stream. Returns FALSE if
+ * it has to be offered again after AE_MESH_TX_READY.
+ */
+extern bool DataSend(uint16 dest_id, const uint8 *p_data, uint16 len);
 #endif /* __DATA_MODEL_HANDLER_H__ */
 
@@ -43,8 +43,7 @@ typedef enum
 } time_state;
 
 #define MAX_CLOCK_SKEW                          (250)
-#define MAX_32_BIT_VALUE                        (0xFFFFFFFF)
-#define TICK_INTERVAL_MS                        (50)
+#define TIME_INCREMENT_MAX_MS                   (0xFFFF)
 #define TIME_BROADCAST_TTL                      (0)
 #define RELAY_REPEATS                           (3)
 #define REPEAT_DELAY_MS                         (50)
@@ -53,6 +52,11 @@ typedef enum
 #define MIN_TIME_ZONE_VALUE                     (-48)
 #define TIME_LEN_IN_BYTES                       (6)
 
+/* Longest time between wake-ups. TimeGet32() wraps after about 71 minutes,
+ * so the current time is brought forward at least this often.
+ */
+#define MAX_SLEEP_MS                            (30 * 60 * 1000UL)
+
 /*============================================================================*
  *  Private Data
  *============================================================================*/
@@ -60,11 +64,11 @@ typedef enum
 /* Pointer to model handler Data */
 static TIME_HANDLER_DATA_T* p_time_model_hdlr_data;
 
-/* Timestamp taken for caleculation */
+/* TimeGet32() value at which currenttime was last brought forward */
 static uint32 last_updated_tstamp;
 
-/* Timer for time stamp correction */
-static timer_id tick_timer_tid = TIMER_INVALID;
+/* Timer for the next broadcast, repeat or relay window end */
+static timer_id event_timer_tid = TIMER_INVALID;
 
 /* Time state */
 static time_state g_time_state;
@@ -75,6 +79,20 @@ static uint32   elapsed_ms;
 /* Broadcast repeats counter */
 static uint16   broadcast_repeats;
 
+/* Value of elapsed_ms at which the next repeat is due */
+static uint32   repeat_due_ms;
+
+/* Event timer wake-ups, and those with nothing to do but to bring the time
+ * forward
+ */
+static uint32   wakeup_count;
+static uint32   idle_wakeup_count;
+
+/*============================================================================*
+ *  Private Function Prototype
+ *============================================================================*/
+static void eventTimerHandler(timer_id tid);
+
 /*============================================================================*
  *  Private Function Definitions
  *============================================================================*/
@@ -140,6 +158,38 @@ static bool checkForClockCorrection(uint8 recvd_curr_time[])
     return FALSE;
 }
 
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      updateCurrentTime
+ *
+ *  DESCRIPTION
+ *      This function brings the current time and the elapsed time forward by
+ *      the time passed since they were last updated. Part of a millisecond is
+ *      left to be counted on the next update.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void updateCurrentTime(void)
+{
+    uint32 elapsed_time_ms;
+
+    /* Unsigned difference is right across a roundoff */
+    elapsed_time_ms = (TimeGet32() - last_updated_tstamp) / MILLISECOND;
+    last_updated_tstamp += elapsed_time_ms * MILLISECOND;
+    elapsed_ms += elapsed_time_ms;
+
+    /* TimeIncrement48 adds at most 16 bits at a time */
+    while(elapsed_time_ms > TIME_INCREMENT_MAX_MS)
+    {
+        TimeIncrement48(p_time_model_hdlr_data->currenttime,
+                        TIME_INCREMENT_MAX_MS);
+        elapsed_time_ms -= TIME_INCREMENT_MAX_MS;
+    }
+    TimeIncrement48(p_time_model_hdlr_data->currenttime, elapsed_time_ms);
+}
+
 /*-----------------------------------------------------------------------------*
  *  NAME
  *      sendTimeBroadcast
@@ -155,6 +205,7 @@ static void sendTimeBroadcast(bool new_update)
 {
     CSRMESH_TIME_BROADCAST_T time_bcast;
 
+    updateCurrentTime();
     MemCopyUnPack(time_bcast.currenttime,  p_time_model_hdlr_data->currenttime,
                   TIME_LEN_IN_BYTES);
 
@@ -174,31 +225,81 @@ static void sendTimeBroadcast(bool new_update)
 
 /*-----------------------------------------------------------------------------*
  *  NAME
- *      tickTimerHandler
+ *      startEventTimer
  *
  *  DESCRIPTION
- *      This function handles reference time stamp timer time-out.
+ *      This function starts the timer for the next event, which is the next
+ *      broadcast repeat, the next master broadcast or the end of the relay
+ *      window. Without an event the timer still wakes up after MAX_SLEEP_MS.
  *
  *  RETURNS/MODIFIES
  *      Nothing
  *
  *----------------------------------------------------------------------------*/
-static void tickTimerHandler(timer_id tid)
+static void startEventTimer(void)
 {
-    if (tick_timer_tid == tid)
+    uint32 due_ms, event_ms;
+
+    updateCurrentTime();
+    due_ms = elapsed_ms + MAX_SLEEP_MS;
+
+    if(broadcast_repeats && repeat_due_ms < due_ms)
     {
-        /* start a new timer for the next update */
-        tick_timer_tid =  TimerCreate(TICK_INTERVAL_MS * MILLISECOND, 
-                                      TRUE, tickTimerHandler);
+        due_ms = repeat_due_ms;
+    }
 
-        /* Update the current time by adding the elapsed time */
-        TimeIncrement48(p_time_model_hdlr_data->currenttime, TICK_INTERVAL_MS);
+    if(g_time_state == time_state_master)
+    {
+        /* An interval of 0 broadcasts every REPEAT_DELAY_MS */
+        event_ms = p_time_model_hdlr_data->time_model.interval*1000UL;
+        if(event_ms < REPEAT_DELAY_MS)
+        {
+            event_ms = REPEAT_DELAY_MS;
+        }
+    }
+    else if(g_time_state == time_state_no_relay || 
+            g_time_state == time_state_relay_master)
+    {
+        event_ms = (p_time_model_hdlr_data->time_model.interval*1000UL)/4;
+    }
+    else
+    {
+        event_ms = due_ms;
+    }
+    if(event_ms < due_ms)
+    {
+        due_ms = event_ms;
+    }
 
-        /* Elapsed MS is used to drive all the slower timers */
-        elapsed_ms += TICK_INTERVAL_MS;
+    TimerDelete(event_timer_tid);
+    event_timer_tid = TimerCreate(
+            ((due_ms > elapsed_ms) ? (due_ms - elapsed_ms) : 0) * MILLISECOND,
+            TRUE, eventTimerHandler);
+}
 
-        /* update the last updated time stamp */
-        last_updated_tstamp = TimeGet32();
+/*-----------------------------------------------------------------------------*
+ *  NAME
+ *      eventTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the event timer time-out. The time is brought
+ *      forward on each time-out instead of on a periodic tick.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing
+ *
+ *----------------------------------------------------------------------------*/
+static void eventTimerHandler(timer_id tid)
+{
+    bool idle = TRUE;
+
+    if (event_timer_tid == tid)
+    {
+        event_timer_tid = TIMER_INVALID;
+        wakeup_count++;
+
+        /* Update the current time and the elapsed time */
+        updateCurrentTime();
         
         /* start broadcasting at the broadcast interval if you are a master */
         if(g_time_state == time_state_master)
@@ -208,6 +309,7 @@ static void tickTimerHandler(timer_id tid)
             {
                 broadcast_repeats = MASTER_REPEATS;
                 elapsed_ms = 0;
+                repeat_due_ms = 0;
             }
         }
         else
@@ -222,20 +324,27 @@ static void tickTimerHandler(timer_id tid)
                     /* We relay received broadcasts again */
                     g_time_state = time_state_relay;
                     elapsed_ms = 0;
+                    idle = FALSE;
                 }
             }
         }
 
         /* Check for broadcast repeats */
-        if (broadcast_repeats)
+        if (broadcast_repeats && elapsed_ms >= repeat_due_ms)
         { 
-            if (elapsed_ms % REPEAT_DELAY_MS == 0) 
-            {
-                /* It's time for a repeat */
-                -- broadcast_repeats;
-                sendTimeBroadcast(FALSE);
-            }
+            /* It's time for a repeat */
+            -- broadcast_repeats;
+            sendTimeBroadcast(FALSE);
+            repeat_due_ms = elapsed_ms + REPEAT_DELAY_MS;
+            idle = FALSE;
         }
+
+        if(idle)
+        {
+            idle_wakeup_count++;
+        }
+
+        startEventTimer();
     }
 }
 
@@ -317,11 +426,6 @@ static CSRmeshResult timeModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
                         g_time_state = time_state_relay_master;
                     }
 
-                    /* Start the tick timer */
-                    TimerDelete(tick_timer_tid);
-                    tick_timer_tid = 
-                        TimerCreate(TICK_INTERVAL_MS * MILLISECOND,
-                                    TRUE, tickTimerHandler);
                 }
                 else if(g_time_state == time_state_relay)
                 {
@@ -348,6 +452,7 @@ static CSRmeshResult timeModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
                             sendTimeBroadcast(TRUE);
                             elapsed_ms = 0;
                             broadcast_repeats = RELAY_REPEATS;
+                            repeat_due_ms = REPEAT_DELAY_MS;
                         }
                         g_time_state = time_state_no_relay;
                     }
@@ -370,10 +475,18 @@ static CSRmeshResult timeModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
                     MemCopyPack(p_time_model_hdlr_data->currenttime, 
                                 p_event->currenttime,
                                 TIME_LEN_IN_BYTES);
+                    last_updated_tstamp = TimeGet32();
                     p_time_model_hdlr_data->timezone = p_event->timezone;
                     sendTimeBroadcast(TRUE);
                     elapsed_ms = 0;
                     broadcast_repeats = RELAY_REPEATS;
+                    repeat_due_ms = REPEAT_DELAY_MS;
+                }
+
+                /* Start the timer for the next event of the new state */
+                if(g_time_state != time_state_init)
+                {
+                    startEventTimer();
                 }
             }
         }
@@ -406,25 +519,10 @@ static CSRmeshResult timeModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
  *----------------------------------------------------------------------------*/
 extern bool TimeModelGetUTC(uint8 current_time[], CsrInt8 *timezone)
 {
-    uint32 curr_tstamp, elapsed_time_ms;
-
     if(g_time_state != time_state_init)
     {
-        curr_tstamp = TimeGet32();
-
-        /* Check for roundoff */
-        if(curr_tstamp > last_updated_tstamp)
-        {
-            elapsed_time_ms = (curr_tstamp - last_updated_tstamp)/1000;
-        }
-        else
-        {
-            elapsed_time_ms = (curr_tstamp + 
-                           (MAX_32_BIT_VALUE - last_updated_tstamp))/1000;
-        }
-
         /* Send the updated current time by adding the elapsed time */
-        TimeIncrement48(p_time_model_hdlr_data->currenttime, elapsed_time_ms);
+        updateCurrentTime();
         MemCopyUnPack(current_time, p_time_model_hdlr_data->currenttime,
                       TIME_LEN_IN_BYTES);
 
@@ -453,6 +551,7 @@ extern bool TimeModelSetUTC(uint8 utc_time[], CsrInt8 timezone)
         MemCopyPack(p_time_model_hdlr_data->currenttime, 
                     utc_time,
                     TIME_LEN_IN_BYTES);
+        last_updated_tstamp = TimeGet32();
         p_time_model_hdlr_data->timezone = timezone;
 
         /* set state to master */
@@ -461,12 +560,11 @@ extern bool TimeModelSetUTC(uint8 utc_time[], CsrInt8 timezone)
         /* Broadcast here and then repeat the same for five times. */
         broadcast_repeats = MASTER_REPEATS;
         elapsed_ms = 0;
+        repeat_due_ms = REPEAT_DELAY_MS;
         sendTimeBroadcast(TRUE);
 
-        /* Start the tick timer */
-        TimerDelete(tick_timer_tid);
-        tick_timer_tid = TimerCreate(TICK_INTERVAL_MS * MILLISECOND,
-                                     TRUE, tickTimerHandler);
+        /* Start the timer for the first repeat */
+        startEventTimer();
         return TRUE;
     }
     return FALSE;
@@ -562,9 +660,34 @@ extern void TimeModelDataInit(TIME_HANDLER_DATA_T* time_handler_data)
     g_time_state = time_state_init;
     elapsed_ms = 0;
     broadcast_repeats = 0;
+    repeat_due_ms = 0;
+    wakeup_count = 0;
+    idle_wakeup_count = 0;
 
-    TimerDelete(tick_timer_tid);
-    tick_timer_tid = TIMER_INVALID;
+    TimerDelete(event_timer_tid);
+    event_timer_tid = TIMER_INVALID;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimeModelGetWakeups
+ *
+ *  DESCRIPTION
+ *      This function returns the number of event timer wake-ups since the
+ *      time model data was initialised, and the number of those that only
+ *      brought the time forward.
+ *
+ *  RETURNS
+ *      Number of wake-ups.
+ *
+ *---------------------------------------------------------------------------*/
+extern uint32 TimeModelGetWakeups(uint32 *p_idle)
+{
+    if(p_idle != NULL)
+    {
+        *p_idle = idle_wakeup_count;
+    }
+    return wakeup_count;
 }
 
 #endif /* ENABLE_TIME_MODEL */
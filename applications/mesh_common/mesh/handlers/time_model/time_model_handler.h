@@ -50,4 +50,9 @@ extern bool TimeModelSetUTC(uint8 utc_time[], CsrInt8 timezone);
 /* The function can be used to get the UTC from the time model */
 extern bool TimeModelGetUTC(uint8 current_time[], CsrInt8 *timezone);
 
+/* The function returns the number of time model timer wake-ups, and the
+ * number of those with nothing to do but to keep the time
+ */
+extern uint32 TimeModelGetWakeups(uint32 *p_idle);
+
 #endif /* __TIME_MODEL_HANDLER_H__ */
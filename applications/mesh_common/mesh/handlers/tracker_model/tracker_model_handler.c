@@ -63,6 +63,45 @@
 // Time before we delete asset from cache (10 minutes)
 #define DEFAULT_DELETE_INTERVAL                           (600)
 
+// Cache capacities, can be set in user_config.h (at most 64 each)
+#ifndef TRACKER_MAX_CACHED_ASSETS
+#define TRACKER_MAX_CACHED_ASSETS                         (10)
+#endif
+#ifndef TRACKER_MAX_PENDING_ASSETS
+#define TRACKER_MAX_PENDING_ASSETS                        (5)
+#endif
+
+#if (TRACKER_MAX_CACHED_ASSETS > 64) || (TRACKER_MAX_PENDING_ASSETS > 64)
+#error "Tracker caches hold at most 64 assets"
+#endif
+
+// Buckets of a cache hash index: a power of two at least twice the capacity
+#define TRACKER_HASH_SIZE(n)  ((n) <= 4 ? 8 : (n) <= 8 ? 16 : (n) <= 16 ? 32 :\
+                               (n) <= 32 ? 64 : 128)
+
+// No slot, ends the age and free lists of a cache
+#define TRACKER_NO_SLOT                                   (0xFF)
+
+// Airtime of one tracker report sent once on the three advertising
+// channels: 47 byte packet at 1 Mbps = 376 us per channel
+#define TRACKER_REPORT_AIRTIME_US                         (3 * 376)
+
+// Seconds over which suppressed reports are counted
+#define TRACKER_STATS_PERIOD                              (60)
+
+// Seconds after which an asset is reported again although its zone and side
+// effects did not change, can be set in user_config.h
+#ifndef TRACKER_REPORT_REFRESH
+#define TRACKER_REPORT_REFRESH                            (60)
+#endif
+
+// Seconds after which the RSSI another tracker reported is forgotten. Longer
+// than TRACKER_REPORT_REFRESH, so a tracker that still hears the asset more
+// strongly reports it again first.
+#ifndef TRACKER_ELSEWHERE_TIMEOUT
+#define TRACKER_ELSEWHERE_TIMEOUT                         (2 * TRACKER_REPORT_REFRESH)
+#endif
+
 typedef struct
 {
     uint16   dev_id;            /* Dev ID of asset.*/
@@ -72,13 +111,39 @@ typedef struct
     uint32   deleteCount;       /* Time before removed from cache,or time before report for new assets */
     uint8    count;             /* How many times heard (used for averaging RSSI) */
     uint16   effects;           /* Asset side effects mask */
+    int8     rssiElsewhere;     /* Strongest RSSI another tracker reported, 0 if none */
+    uint32   timeElsewhere;     /* Timestamp in seconds when rssiElsewhere was reported */
+    uint32   timeReported;      /* Timestamp in seconds when last reported */
+    uint8    older;             /* Slot heard before this one, or next free slot */
+    uint8    newer;             /* Slot heard after this one */
 } ASSET_INFO_T;
 
+/* Asset cache. Assets are found through an open addressed hash index on
+ * the device ID, whose buckets hold slot + 1 and 0 when free, and are kept
+ * in a list from the least to the most recently heard, so the asset to
+ * evict is at its head.
+ */
+typedef struct
+{
+    ASSET_INFO_T               *asset;     /* Slots */
+    uint8                      *hash;      /* Hash index */
+    uint16                      capacity;  /* Number of slots */
+    uint16                      hashMask;  /* Buckets - 1 */
+    uint16                      count;     /* Slots in use */
+    uint8                       oldest;    /* Head of the age list */
+    uint8                       newest;    /* Tail of the age list */
+    uint8                       free;      /* Head of the free slot list */
+} ASSET_CACHE_T;
+
 /* Application Model Handler Data Structure */
 typedef struct
 {
     ASSET_INFO_T                trackerCache [TRACKER_MAX_CACHED_ASSETS];
     ASSET_INFO_T                pendingCache [TRACKER_MAX_PENDING_ASSETS];
+    uint8                       trackerHash [TRACKER_HASH_SIZE(TRACKER_MAX_CACHED_ASSETS)];
+    uint8                       pendingHash [TRACKER_HASH_SIZE(TRACKER_MAX_PENDING_ASSETS)];
+    ASSET_CACHE_T               tracker;
+    ASSET_CACHE_T               pending;
     int8                        zoneThresholds[TRACKER_MAX_ZONES];
     uint32                      assetDeleteInterval; // in seconds
     uint16                      reportDest;     // Dest addr for reports 
@@ -86,6 +151,8 @@ typedef struct
     uint16                      delayFactor;
     uint32                      secTimerCount;
     uint32                      delayFactorTimerCount;
+    uint16                      suppressedCount;     // Reports suppressed this period
+    uint16                      suppressedLastPeriod; // Reports suppressed last period
 } TRACKER_HANDLER_DATA_T;
 
 /*============================================================================*
@@ -107,12 +174,94 @@ static CSRMESH_TRACKER_FOUND_T tracker_found;
 /*============================================================================*
  *  Private Function Definitions
  *============================================================================*/
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerHashHome
+ *
+ *  DESCRIPTION
+ *      The function returns the bucket of the hash index a device id is
+ *      looked up from. Mesh device ids are mostly consecutive, so the low
+ *      bits are used, with the high byte folded in.
+ *
+ *  RETURNS
+ *      Bucket of the device id
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 trackerHashHome(ASSET_CACHE_T *cache, uint16 device_id)
+{
+    return (device_id ^ (device_id >> 8)) & cache->hashMask;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerListUnlink
+ *
+ *  DESCRIPTION
+ *      The function takes a slot out of the age list of the cache
+ *
+ *  RETURNS
+ *      None
+ *
+ *---------------------------------------------------------------------------*/
+static void trackerListUnlink(ASSET_CACHE_T *cache, uint16 index)
+{
+    ASSET_INFO_T *asset = &cache->asset[index];
+
+    if(asset->older != TRACKER_NO_SLOT)
+    {
+        cache->asset[asset->older].newer = asset->newer;
+    }
+    else
+    {
+        cache->oldest = asset->newer;
+    }
+
+    if(asset->newer != TRACKER_NO_SLOT)
+    {
+        cache->asset[asset->newer].older = asset->older;
+    }
+    else
+    {
+        cache->newest = asset->older;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerListAppend
+ *
+ *  DESCRIPTION
+ *      The function puts a slot at the most recently heard end of the age
+ *      list of the cache
+ *
+ *  RETURNS
+ *      None
+ *
+ *---------------------------------------------------------------------------*/
+static void trackerListAppend(ASSET_CACHE_T *cache, uint16 index)
+{
+    ASSET_INFO_T *asset = &cache->asset[index];
+
+    asset->older = cache->newest;
+    asset->newer = TRACKER_NO_SLOT;
+
+    if(cache->newest != TRACKER_NO_SLOT)
+    {
+        cache->asset[cache->newest].newer = index;
+    }
+    else
+    {
+        cache->oldest = index;
+    }
+    cache->newest = index;
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      trackerFindAssetInCache
  *
  *  DESCRIPTION
- *      The function checks whether the device id of the passed asset is 
+ *      The function checks whether the device id of the passed asset is
  *      present in the asset cache and if present it returns the index
  *      of the cached asset.
  *
@@ -120,14 +269,20 @@ static CSRMESH_TRACKER_FOUND_T tracker_found;
  *      Index of the asset in the passed cache
  *
  *---------------------------------------------------------------------------*/
-static uint16 trackerFindAssetInCache(uint16 device_id, ASSET_INFO_T asset_cache[],
-                                      uint16 asset_count)
+static uint16 trackerFindAssetInCache(uint16 device_id, ASSET_CACHE_T *cache)
 {
+    uint16 bucket;
     uint16 index;
 
-    for(index = 0; index < asset_count; index++)
+    /* The index is never more than half full, so a free bucket ends the
+     * search
+     */
+    for(bucket = trackerHashHome(cache, device_id);
+        cache->hash[bucket] != 0;
+        bucket = (bucket + 1) & cache->hashMask)
     {
-        if(asset_cache[index].dev_id == device_id)
+        index = cache->hash[bucket] - 1;
+        if(cache->asset[index].dev_id == device_id)
         {
             return index;
         }
@@ -137,42 +292,108 @@ static uint16 trackerFindAssetInCache(uint16 device_id, ASSET_INFO_T asset_cache
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      trackerFindFreeSlotInCache
+ *      trackerRemoveAssetFromCache
  *
  *  DESCRIPTION
- *      The function finds a free slot in the cache and returns the index for
- *      the same
+ *      The function removes the asset in the passed slot from the cache. The
+ *      entries after its bucket are moved back into the gap, so lookups
+ *      never stop early at it.
  *
  *  RETURNS
- *      Index of the first free slot to store the asset in the passed cache
+ *      None
  *
  *---------------------------------------------------------------------------*/
-static uint16 trackerFindFreeSlotInCache(ASSET_INFO_T asset_cache[],uint16 asset_count)
+static void trackerRemoveAssetFromCache(ASSET_CACHE_T *cache, uint16 index)
 {
-    uint16 index;
-    uint16 oldest_index=0, max_age_seconds=0, age_seconds;
+    const uint16 mask = cache->hashMask;
+    uint16 hole, next, home;
 
-    for(index = 0; index < asset_count; index++)
+    hole = trackerHashHome(cache, cache->asset[index].dev_id);
+    while(cache->hash[hole] != index + 1)
     {
-        if(asset_cache[index].dev_id == 0x00)
-        {
-            return index;
-        }
+        hole = (hole + 1) & mask;
     }
 
-    for(index = 0; index < asset_count; index++)
+    for(next = (hole + 1) & mask; cache->hash[next] != 0;
+        next = (next + 1) & mask)
     {
-        age_seconds = (tracker_hdlr_data.secTimerCount > asset_cache[index].timeLastHeard) ?
-                        (tracker_hdlr_data.secTimerCount - asset_cache[index].timeLastHeard) :
-                        ((0xFFFF - asset_cache[index].timeLastHeard) + tracker_hdlr_data.secTimerCount);
+        home = trackerHashHome(cache,
+                               cache->asset[cache->hash[next] - 1].dev_id);
 
-        if(age_seconds > max_age_seconds)
+        /* The entry can fill the hole if the hole is on its probe path */
+        if(((next - home) & mask) >= ((next - hole) & mask))
         {
-            max_age_seconds = age_seconds;
-            oldest_index = index;
+            cache->hash[hole] = cache->hash[next];
+            hole = next;
         }
     }
-    return oldest_index;
+    cache->hash[hole] = 0;
+
+    trackerListUnlink(cache, index);
+    MemSet(&cache->asset[index], 0, sizeof(ASSET_INFO_T));
+    cache->asset[index].older = cache->free;
+    cache->free = index;
+    cache->count--;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerAddAssetToCache
+ *
+ *  DESCRIPTION
+ *      The function stores a new asset in a free slot of the cache, or in
+ *      place of the asset heard least recently if the cache is full
+ *
+ *  RETURNS
+ *      Index of the slot the asset is stored in
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 trackerAddAssetToCache(uint16 device_id, ASSET_CACHE_T *cache)
+{
+    uint16 index;
+    uint16 bucket;
+
+    if(cache->free == TRACKER_NO_SLOT)
+    {
+        trackerRemoveAssetFromCache(cache, cache->oldest);
+    }
+
+    index = cache->free;
+    cache->free = cache->asset[index].older;
+    cache->asset[index].dev_id = device_id;
+
+    bucket = trackerHashHome(cache, device_id);
+    while(cache->hash[bucket] != 0)
+    {
+        bucket = (bucket + 1) & cache->hashMask;
+    }
+    cache->hash[bucket] = index + 1;
+
+    trackerListAppend(cache, index);
+    cache->count++;
+
+    return index;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerTouchAssetInCache
+ *
+ *  DESCRIPTION
+ *      The function moves an asset that has just been heard to the most
+ *      recently heard end of the age list
+ *
+ *  RETURNS
+ *      None
+ *
+ *---------------------------------------------------------------------------*/
+static void trackerTouchAssetInCache(ASSET_CACHE_T *cache, uint16 index)
+{
+    if(cache->newest != index)
+    {
+        trackerListUnlink(cache, index);
+        trackerListAppend(cache, index);
+    }
 }
 
 /*----------------------------------------------------------------------------*
@@ -186,14 +407,44 @@ static uint16 trackerFindFreeSlotInCache(ASSET_INFO_T asset_cache[],uint16 asset
  *      None
  *
  *---------------------------------------------------------------------------*/
-static void trackerClearCache(ASSET_INFO_T asset_cache[],uint16 asset_count)
+static void trackerClearCache(ASSET_CACHE_T *cache)
 {
     uint16 index;
 
-    for(index = 0; index < asset_count; index++)
+    MemSet(cache->asset, 0, cache->capacity * sizeof(ASSET_INFO_T));
+    MemSet(cache->hash, 0, (cache->hashMask + 1) * sizeof(uint8));
+
+    for(index = 0; index < cache->capacity; index++)
     {
-        MemSet(&asset_cache[index], 0, sizeof(ASSET_INFO_T));
+        cache->asset[index].older = (index + 1 < cache->capacity) ?
+                                    index + 1 : TRACKER_NO_SLOT;
     }
+    cache->free = 0;
+    cache->oldest = TRACKER_NO_SLOT;
+    cache->newest = TRACKER_NO_SLOT;
+    cache->count = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trackerInitCache
+ *
+ *  DESCRIPTION
+ *      The function sets up an empty cache on the passed slots and hash
+ *      index buckets
+ *
+ *  RETURNS
+ *      None
+ *
+ *---------------------------------------------------------------------------*/
+static void trackerInitCache(ASSET_CACHE_T *cache, ASSET_INFO_T asset[],
+                             uint16 capacity, uint8 hash[], uint16 buckets)
+{
+    cache->asset = asset;
+    cache->capacity = capacity;
+    cache->hash = hash;
+    cache->hashMask = buckets - 1;
+    trackerClearCache(cache);
 }
 
 /*----------------------------------------------------------------------------*
@@ -207,18 +458,9 @@ static void trackerClearCache(ASSET_INFO_T asset_cache[],uint16 asset_count)
  *      Returns TRUE if the cache is empty otherwise returns FALSE
  *
  *---------------------------------------------------------------------------*/
-static bool trackerIsCacheEmpty(ASSET_INFO_T asset_cache[],uint16 asset_count)
+static bool trackerIsCacheEmpty(ASSET_CACHE_T *cache)
 {
-    uint16 index;
-
-    for(index = 0; index < asset_count; index++)
-    {
-        if(asset_cache[index].dev_id != 0x00)
-        {
-            return FALSE;
-        }
-    }
-    return TRUE;
+    return cache->count == 0;
 }
 
 /*-----------------------------------------------------------------------------*
@@ -251,7 +493,12 @@ static uint16 convertRssiToZone(int8 rssi)
  *      pendingCacheTimerHandler
  *
  *  DESCRIPTION
- *      This function handles the expiry of the asset cache timer 
+ *      This function handles the expiry of the pending cache timer. Assets
+ *      whose report delay is over move to the asset cache and are reported,
+ *      unless this tracker already reported the asset in the same zone with
+ *      the same side effects less than TRACKER_REPORT_REFRESH seconds ago,
+ *      or another tracker reported it with a stronger RSSI than this tracker
+ *      hears it at.
  *
  *  RETURNS/MODIFIES
  *      Nothing
@@ -261,12 +508,14 @@ static void pendingCacheTimerHandler(timer_id tid)
 {
     if (pending_cache_timer_tid == tid)
     {
-        uint16 index;
+        uint16 index, next;
         tracker_hdlr_data.delayFactorTimerCount++;
         pending_cache_timer_tid = TIMER_INVALID;
 
-        for(index=0; index < TRACKER_MAX_PENDING_ASSETS; index++)
+        /* Only the slots in use are visited, through the age list */
+        for(index = tracker_hdlr_data.pending.oldest; index != TRACKER_NO_SLOT; index = next)
         {
+            next = tracker_hdlr_data.pendingCache[index].newer;
             if(tracker_hdlr_data.pendingCache[index].deleteCount == tracker_hdlr_data.delayFactorTimerCount)
             {
                 ASSET_INFO_T *pending_asset = &tracker_hdlr_data.pendingCache[index];
@@ -275,50 +524,75 @@ static void pendingCacheTimerHandler(timer_id tid)
                 if (pending_asset->proximity == MARK_FOR_DELETE) 
                 {
                     /* This asset was heard more strongly elsewhere remove the pending entry */
-                    MemSet(&tracker_hdlr_data.pendingCache[index], 0, sizeof(ASSET_INFO_T));
+                    trackerRemoveAssetFromCache(&tracker_hdlr_data.pending, index);
                 }
                 else
                 {
                     /* Check whether the asset is already present in the asset cache */
                     cached_index = 
-                        trackerFindAssetInCache(pending_asset->dev_id, tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS);
+                        trackerFindAssetInCache(pending_asset->dev_id, &tracker_hdlr_data.tracker);
 
                     /* Asset not present in tracker cache, hence add it onto tracker cache */
                     if(cached_index == 0xFFFF)
                     {
-                        cached_index = trackerFindFreeSlotInCache(tracker_hdlr_data.trackerCache,  TRACKER_MAX_CACHED_ASSETS);
+                        cached_index = trackerAddAssetToCache(pending_asset->dev_id, &tracker_hdlr_data.tracker);
+                        tracker_hdlr_data.trackerCache[cached_index].timeLastHeard = pending_asset->timeLastHeard;
+                        tracker_hdlr_data.trackerCache[cached_index].proximity = MARK_FOR_DELETE;
                     }
 
                     /* Update the asset information in tracker cache and remove from the pending entry */
                     if(cached_index != 0xFFFF)
                     {
                         ASSET_INFO_T *cached_asset = &tracker_hdlr_data.trackerCache[cached_index];
+                        uint16 zone = convertRssiToZone(pending_asset->rssi);
                         CSRMESH_TRACKER_REPORT_T report;
-                        
-                        report.assetdeviceid = cached_asset->dev_id = pending_asset->dev_id;
-                        report.sideeffects = cached_asset->effects = pending_asset->effects;
-                        report.rssi = cached_asset->rssi = pending_asset->rssi;
-                        report.zone = cached_asset->proximity = convertRssiToZone(pending_asset->rssi);
-                        report.ageseconds = (tracker_hdlr_data.secTimerCount >= cached_asset->timeLastHeard) ? (tracker_hdlr_data.secTimerCount - cached_asset->timeLastHeard) : 
-                                            ((0xFFFF - cached_asset->timeLastHeard) + tracker_hdlr_data.secTimerCount);
-
-                        /* Send tracker report */
-                        TrackerReport(DEFAULT_NW_ID,
-                                      tracker_hdlr_data.reportDest,
-                                      AppGetCurrentTTL(),
-                                      &report);
+
+                        /* Report only if the asset moved to another zone,
+                         * changed its side effects or is due a refresh, and
+                         * no tracker hears it more strongly
+                         */
+                        if((cached_asset->rssiElsewhere != 0 &&
+                            pending_asset->rssi <= cached_asset->rssiElsewhere) ||
+                           (cached_asset->rssiElsewhere == 0 &&
+                            cached_asset->proximity == zone &&
+                            cached_asset->effects == pending_asset->effects &&
+                            tracker_hdlr_data.secTimerCount - cached_asset->timeReported < TRACKER_REPORT_REFRESH))
+                        {
+                            tracker_hdlr_data.suppressedCount++;
+                        }
+                        else
+                        {
+                            report.assetdeviceid = cached_asset->dev_id;
+                            report.sideeffects = pending_asset->effects;
+                            report.rssi = pending_asset->rssi;
+                            report.zone = zone;
+                            report.ageseconds = (tracker_hdlr_data.secTimerCount >= cached_asset->timeLastHeard) ? (tracker_hdlr_data.secTimerCount - cached_asset->timeLastHeard) : 
+                                                ((0xFFFF - cached_asset->timeLastHeard) + tracker_hdlr_data.secTimerCount);
+
+                            /* Send tracker report */
+                            TrackerReport(DEFAULT_NW_ID,
+                                          tracker_hdlr_data.reportDest,
+                                          AppGetCurrentTTL(),
+                                          &report);
+
+                            cached_asset->proximity = zone;
+                            cached_asset->rssiElsewhere = 0;
+                            cached_asset->timeReported = tracker_hdlr_data.secTimerCount;
+                        }
+                        cached_asset->effects = pending_asset->effects;
+                        cached_asset->rssi = pending_asset->rssi;
 
                         /* Store the delete interval for this asset deletion */
                         cached_asset->deleteCount = tracker_hdlr_data.secTimerCount + tracker_hdlr_data.assetDeleteInterval;
                     }
                     /* Removing the asset from the pending entry */
-                    MemSet(&tracker_hdlr_data.pendingCache[index], 0, sizeof(ASSET_INFO_T));
+                    trackerRemoveAssetFromCache(&tracker_hdlr_data.pending, index);
                 }
             }
         }
 
         /* If there are any pending assets then re-start the timer */
-        if(!trackerIsCacheEmpty(tracker_hdlr_data.pendingCache, TRACKER_MAX_PENDING_ASSETS))
+        if(!trackerIsCacheEmpty(&tracker_hdlr_data.pending))
         {
             pending_cache_timer_tid = TimerCreate(tracker_hdlr_data.delayFactor * MILLISECOND,
                                                   TRUE, pendingCacheTimerHandler);
@@ -332,7 +606,10 @@ static void pendingCacheTimerHandler(timer_id tid)
  *      assetCacheTimerHandler
  *
  *  DESCRIPTION
- *      This function handles the expiry of the asset cache timer 
+ *      This function handles the expiry of the asset cache timer. Assets
+ *      not heard for the delete interval are removed, and an RSSI another
+ *      tracker reported more than TRACKER_ELSEWHERE_TIMEOUT seconds ago is
+ *      forgotten.
  *
  *  RETURNS/MODIFIES
  *      Nothing
@@ -342,30 +619,49 @@ static void assetCacheTimerHandler(timer_id tid)
 {
     if (asset_cache_timer_tid == tid)
     {
-        uint16 index;
+        uint16 index, next;
         tracker_hdlr_data.secTimerCount++;
         asset_cache_timer_tid = TIMER_INVALID;
 
-        for(index=0; index < TRACKER_MAX_CACHED_ASSETS; index++)
+        if((tracker_hdlr_data.secTimerCount % TRACKER_STATS_PERIOD) == 0)
         {
-            if(tracker_hdlr_data.trackerCache[index].deleteCount == tracker_hdlr_data.secTimerCount)
+            tracker_hdlr_data.suppressedLastPeriod = tracker_hdlr_data.suppressedCount;
+            tracker_hdlr_data.suppressedCount = 0;
+        }
+
+        for(index = tracker_hdlr_data.tracker.oldest; index != TRACKER_NO_SLOT; index = next)
+        {
+            ASSET_INFO_T *asset = &tracker_hdlr_data.trackerCache[index];
+
+            next = asset->newer;
+            if(asset->deleteCount == tracker_hdlr_data.secTimerCount)
             {
                 /* Remove the asset from tracker cache as the delete interval 
                  * has expired for the asset.
                  */
-                MemSet(&tracker_hdlr_data.trackerCache[index], 0, sizeof(ASSET_INFO_T));
+                trackerRemoveAssetFromCache(&tracker_hdlr_data.tracker, index);
+            }
+            else if(asset->rssiElsewhere != 0 &&
+                    tracker_hdlr_data.secTimerCount - asset->timeElsewhere >= TRACKER_ELSEWHERE_TIMEOUT)
+            {
+                /* The other tracker has not reported the asset for long,
+                 * it may have moved away: report it again
+                 */
+                asset->rssiElsewhere = 0;
             }
         }
 
         /* If there are any pending or cached assets then re-start the timer */
-        if((!trackerIsCacheEmpty(tracker_hdlr_data.pendingCache, TRACKER_MAX_PENDING_ASSETS)) ||
-          (!trackerIsCacheEmpty(tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS)))
+        if((!trackerIsCacheEmpty(&tracker_hdlr_data.pending)) ||
+          (!trackerIsCacheEmpty(&tracker_hdlr_data.tracker)))
         {
             asset_cache_timer_tid = TimerCreate(SECOND, TRUE, assetCacheTimerHandler);
         }
         else
         {
             tracker_hdlr_data.secTimerCount = 0;
+            tracker_hdlr_data.suppressedLastPeriod = tracker_hdlr_data.suppressedCount;
+            tracker_hdlr_data.suppressedCount = 0;
         }
     }
 }
@@ -397,7 +693,7 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
 
             /* Check whether the device is present in the pending cache */
             asset_index = 
-                trackerFindAssetInCache(data->src_id, tracker_hdlr_data.pendingCache, TRACKER_MAX_PENDING_ASSETS);
+                trackerFindAssetInCache(data->src_id, &tracker_hdlr_data.pending);
 
             if (rssi < ASSET_MIN_RSSI) rssi = ASSET_MIN_RSSI;
             if (rssi > ASSET_MAX_RSSI) rssi = ASSET_MAX_RSSI;
@@ -418,16 +714,16 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
                 asset->rssi = rssi;
 #endif
                 asset->timeLastHeard = tracker_hdlr_data.secTimerCount;
+                trackerTouchAssetInCache(&tracker_hdlr_data.pending, asset_index);
             }
             /* The asset is not present in the pending cache so add to pending cache */
             else
             {
-                asset_index = trackerFindFreeSlotInCache(tracker_hdlr_data.pendingCache,  TRACKER_MAX_PENDING_ASSETS);
+                asset_index = trackerAddAssetToCache(data->src_id, &tracker_hdlr_data.pending);
                 if(asset_index != 0xFFFF)
                 {
                     ASSET_INFO_T *asset = &tracker_hdlr_data.pendingCache[asset_index];
                     
-                    asset->dev_id = data->src_id;
                     asset->effects = p_event->sideeffects;
                     asset->rssi = rssi;
                     asset->count = 1;
@@ -457,13 +753,14 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
             }
 
             asset_index = 
-                trackerFindAssetInCache(data->src_id, tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS);
+                trackerFindAssetInCache(data->src_id, &tracker_hdlr_data.tracker);
 
             /* Check whether the asset is present in the tracker cache */
             if(asset_index != 0xFFFF)
             {
                 ASSET_INFO_T *asset = &tracker_hdlr_data.trackerCache[asset_index];
                 asset->timeLastHeard = tracker_hdlr_data.secTimerCount;
+                trackerTouchAssetInCache(&tracker_hdlr_data.tracker, asset_index);
                 asset->rssi = rssi;
                 asset->effects = p_event->sideeffects;
                 asset->deleteCount = tracker_hdlr_data.secTimerCount + tracker_hdlr_data.assetDeleteInterval;
@@ -478,10 +775,13 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
 
             /* Find the asset in the tracker cache */
             uint16 asset_index = 
-                trackerFindAssetInCache(p_event->assetdeviceid, tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS);
+                trackerFindAssetInCache(p_event->assetdeviceid, &tracker_hdlr_data.tracker);
 
-            /* If the device is found in the tracker cache, send the relavant info in tracker found. */
-            if(asset_index != 0xFFFF)
+            /* If the device is found in the tracker cache and no tracker hears it more strongly, send
+             * the relavant info in tracker found.
+             */
+            if(asset_index != 0xFFFF &&
+               tracker_hdlr_data.trackerCache[asset_index].rssiElsewhere == 0)
             {
                 ASSET_INFO_T *asset = &tracker_hdlr_data.trackerCache[asset_index];
                 MemSet(&tracker_found, 0, sizeof(CSRMESH_TRACKER_FOUND_T));
@@ -517,7 +817,7 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
             int8 rssi = 0xFF00 | p_event->rssi;
 
             asset_index = 
-                trackerFindAssetInCache(p_event->assetdeviceid, tracker_hdlr_data.pendingCache, TRACKER_MAX_PENDING_ASSETS);
+                trackerFindAssetInCache(p_event->assetdeviceid, &tracker_hdlr_data.pending);
 
             /* If the device is found in the pending cahche and the report contains a better RSSI value then mark for delete */
             if(asset_index != 0xFFFF)
@@ -529,14 +829,21 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
             }
 
             asset_index = 
-                trackerFindAssetInCache(p_event->assetdeviceid, tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS);
+                trackerFindAssetInCache(p_event->assetdeviceid, &tracker_hdlr_data.tracker);
 
-            /* If the device is found in the tracker cache, and the report contains a better RSSI value then delete the asset. */
+            /* If the device is found in the tracker cache, and the report contains a better RSSI value then
+             * remember it, so this tracker does not report the asset until it hears it more strongly or
+             * the report is TRACKER_ELSEWHERE_TIMEOUT old.
+             */
             if(asset_index != 0xFFFF)
             {
-                if(rssi > tracker_hdlr_data.trackerCache[asset_index].rssi)
+                ASSET_INFO_T *asset = &tracker_hdlr_data.trackerCache[asset_index];
+
+                if(rssi > asset->rssi &&
+                   (asset->rssiElsewhere == 0 || rssi >= asset->rssiElsewhere))
                 {
-                    MemSet(&tracker_hdlr_data.trackerCache[asset_index], 0, sizeof(ASSET_INFO_T));
+                    asset->rssiElsewhere = rssi;
+                    asset->timeElsewhere = tracker_hdlr_data.secTimerCount;
                 }
             }
         }
@@ -545,8 +852,8 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
         case CSRMESH_TRACKER_CLEAR_CACHE:
         {
             /* Clear the pending and the tracker cache */
-            trackerClearCache(tracker_hdlr_data.pendingCache, TRACKER_MAX_PENDING_ASSETS);
-            trackerClearCache(tracker_hdlr_data.trackerCache, TRACKER_MAX_CACHED_ASSETS);
+            trackerClearCache(&tracker_hdlr_data.pending);
+            trackerClearCache(&tracker_hdlr_data.tracker);
         }
         break;
 
@@ -577,6 +884,29 @@ static CSRmeshResult trackerModelEventHandler(CSRMESH_MODEL_EVENT_T event_code,
  *  Public Function Definitions
  *============================================================================*/
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TrackerGetAirtimeSaved
+ *
+ *  DESCRIPTION
+ *      This function returns the airtime saved in the last minute by tracker
+ *      reports that were not sent, because the asset zone and side effects
+ *      had not changed or another tracker heard the asset more strongly.
+ *
+ *  RETURNS
+ *      Airtime saved in milliseconds.
+ *
+ *---------------------------------------------------------------------------*/
+extern uint16 TrackerGetAirtimeSaved(uint16 *p_suppressed)
+{
+    if(p_suppressed != NULL)
+    {
+        *p_suppressed = tracker_hdlr_data.suppressedLastPeriod;
+    }
+    return (uint16)(((uint32)tracker_hdlr_data.suppressedLastPeriod *
+                     TRACKER_REPORT_AIRTIME_US) / 1000);
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      ReadTrackerModelDataFromNVM
@@ -701,6 +1031,13 @@ extern void TrackerModelDataInit(void)
 {
     MemSet(&tracker_hdlr_data, 0, sizeof(TRACKER_HANDLER_DATA_T));
 
+    trackerInitCache(&tracker_hdlr_data.tracker, tracker_hdlr_data.trackerCache,
+                     TRACKER_MAX_CACHED_ASSETS, tracker_hdlr_data.trackerHash,
+                     TRACKER_HASH_SIZE(TRACKER_MAX_CACHED_ASSETS));
+    trackerInitCache(&tracker_hdlr_data.pending, tracker_hdlr_data.pendingCache,
+                     TRACKER_MAX_PENDING_ASSETS, tracker_hdlr_data.pendingHash,
+                     TRACKER_HASH_SIZE(TRACKER_MAX_PENDING_ASSETS));
+
     tracker_hdlr_data.zoneThresholds[0] = DEFAULT_ZONE0_THRESHOLD;
     tracker_hdlr_data.zoneThresholds[1] = DEFAULT_ZONE1_THRESHOLD;
     tracker_hdlr_data.zoneThresholds[2] = DEFAULT_ZONE2_THRESHOLD;
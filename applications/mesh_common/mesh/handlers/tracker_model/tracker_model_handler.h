@@ -34,4 +34,9 @@ extern void ReadTrackerModelDataFromNVM(uint16 offset);
 /* The function writes the tracker model data onto NVM */
 extern void WriteTrackerModelDataOntoNVM(uint16 offset);
 
+/* The function returns the airtime in ms saved in the last minute by
+ * suppressed tracker reports, and the number of reports suppressed
+ */
+extern uint16 TrackerGetAirtimeSaved(uint16 *p_suppressed);
+
 #endif /* __TRACKER_MODEL_HANDLER_H__ */